@@ -0,0 +1,292 @@
+#include "addressspace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <iterator>
+
+static const quint64 kPageSize = 4096;
+
+static quint64 pageAlignUp(quint64 v)
+{
+    return (v + kPageSize - 1) & ~(kPageSize - 1);
+}
+
+AddressSpace::AddressSpace()
+{
+    clear();
+}
+
+void AddressSpace::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_regions.clear();
+    m_heapStart = m_heapEnd = 0;
+    m_heapShrunk = false;
+    m_recentUnmaps.clear();
+    m_stats = Stats();
+    m_history.assign(kHistorySeconds, Sample());
+}
+
+bool AddressSpace::load(pid_t pid, quint64 ts)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", pid);
+    FILE *f = fopen(path, "re");
+    if (!f)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        // 00400000-00452000 r-xp 00000000 08:02 173521      /usr/bin/dbus-daemon
+        unsigned long long start, end, offset, inode;
+        char perms[5];
+        char dev[16];
+        int pathOffset = 0;
+        if (sscanf(line, "%llx-%llx %4s %llx %15s %llu %n", &start, &end, perms, &offset, dev, &inode, &pathOffset) < 6)
+            continue;
+        const char *name = line + pathOffset;
+        if (strncmp(name, "[heap]", 6) == 0) {
+            m_heapStart = start;
+            m_heapEnd = end;
+            m_stats.mappedBytes += end - start;
+            m_stats.anonBytes += end - start;
+            continue;
+        }
+        if (strncmp(name, "[vsyscall]", 10) == 0)
+            continue; // 不在进程自己的地址空间里，也不会被 munmap
+        int prot = (perms[0] == 'r' ? PROT_READ : 0) | (perms[1] == 'w' ? PROT_WRITE : 0) | (perms[2] == 'x' ? PROT_EXEC : 0);
+        // 没有对应文件的映射（包括 [stack]、[anon:...]）算匿名映射
+        insertRegion(start, { end, prot, inode == 0, 0 });
+    }
+    fclose(f);
+    touch(ts);
+    return true;
+}
+
+bool AddressSpace::reload(pid_t pid, quint64 ts)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_regions.clear();
+        m_heapStart = m_heapEnd = 0;
+        m_heapShrunk = false;
+        m_recentUnmaps.clear();
+        m_stats.mappedBytes = 0;
+        m_stats.anonBytes = 0;
+        m_stats.regions = 0;
+    }
+    return load(pid, ts);
+}
+
+std::map<quint64, AddressSpace::Region>::iterator AddressSpace::insertRegion(quint64 start, const Region &r)
+{
+    auto it = m_regions.insert_or_assign(start, r).first;
+    m_stats.mappedBytes += r.end - start;
+    if (r.anon)
+        m_stats.anonBytes += r.end - start;
+    m_stats.regions = m_regions.size();
+    return it;
+}
+
+template <typename Fn>
+void AddressSpace::carve(quint64 start, quint64 end, Fn removed)
+{
+    auto it = m_regions.upper_bound(start);
+    if (it != m_regions.begin() && std::prev(it)->second.end > start)
+        --it;
+    while (it != m_regions.end() && it->first < end) {
+        const quint64 regionStart = it->first;
+        const Region region = it->second;
+        it = m_regions.erase(it);
+        m_stats.mappedBytes -= region.end - regionStart;
+        if (region.anon)
+            m_stats.anonBytes -= region.end - regionStart;
+
+        // 留下两侧没有被覆盖的部分
+        if (regionStart < start)
+            insertRegion(regionStart, { start, region.prot, region.anon, region.createdTs });
+        if (region.end > end)
+            it = std::next(insertRegion(end, { region.end, region.prot, region.anon, region.createdTs }));
+
+        Region piece = region;
+        piece.end = std::min(region.end, end);
+        removed(std::max(regionStart, start), piece, regionStart >= start && region.end <= end);
+    }
+    m_stats.regions = m_regions.size();
+}
+
+void AddressSpace::noteMapped(quint64 bytes, bool anon, quint64 ts)
+{
+    m_stats.mapCalls++;
+    m_stats.bytesMapped += bytes;
+    if (anon)
+        m_stats.freshAnonPages += bytes / kPageSize;
+    touch(ts);
+    Sample &s = m_history[size_t(ts / 1000000000ULL) % m_history.size()];
+    s.bytesMapped += bytes;
+    s.calls++;
+}
+
+void AddressSpace::noteUnmapped(quint64 bytes, quint64 ts)
+{
+    m_stats.unmapCalls++;
+    m_stats.bytesUnmapped += bytes;
+    touch(ts);
+    Sample &s = m_history[size_t(ts / 1000000000ULL) % m_history.size()];
+    s.bytesUnmapped += bytes;
+    s.calls++;
+}
+
+// 更新 ts 所在那一秒的采样点；环形数组中的旧秒直接覆盖
+void AddressSpace::touch(quint64 ts)
+{
+    qint64 second = qint64(ts / 1000000000ULL);
+    Sample &s = m_history[size_t(second) % m_history.size()];
+    if (s.second != second)
+        s = Sample{ second, 0, 0, 0, 0, 0 };
+    s.mappedBytes = m_stats.mappedBytes;
+    s.anonBytes = m_stats.anonBytes;
+}
+
+void AddressSpace::applyMmap(quint64 addr, quint64 len, int prot, int flags, quint64 ts)
+{
+    len = pageAlignUp(len);
+    if (len == 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // MAP_FIXED 会替换掉原有的映射
+    carve(addr, addr + len, [](quint64, const Region &, bool) {});
+    const bool anon = (flags & MAP_ANONYMOUS) != 0;
+    insertRegion(addr, { addr + len, prot, anon, ts });
+    if (anon) {
+        auto it = m_recentUnmaps.find(len);
+        if (it != m_recentUnmaps.end() && ts - it->second < kShortLivedNs) {
+            m_stats.remapSameSize++;
+            m_recentUnmaps.erase(it);
+        }
+    }
+    noteMapped(len, anon, ts);
+}
+
+void AddressSpace::applyMunmap(quint64 addr, quint64 len, quint64 ts)
+{
+    len = pageAlignUp(len);
+    if (len == 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    quint64 removedBytes = 0;
+    carve(addr, addr + len, [&](quint64 start, const Region &piece, bool whole) {
+        quint64 bytes = piece.end - start;
+        removedBytes += bytes;
+        if (whole && piece.createdTs != 0 && ts - piece.createdTs < kShortLivedNs) {
+            m_stats.shortLived++;
+            m_stats.shortLivedBytes += bytes;
+        }
+        if (whole && piece.anon) {
+            if (m_recentUnmaps.size() >= 1024)
+                m_recentUnmaps.clear();
+            m_recentUnmaps[bytes] = ts;
+        }
+    });
+    noteUnmapped(removedBytes, ts);
+}
+
+void AddressSpace::applyMremap(quint64 oldAddr, quint64 oldLen, quint64 newAddr, quint64 newLen, quint64 ts)
+{
+    oldLen = pageAlignUp(oldLen);
+    newLen = pageAlignUp(newLen);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 新区域沿用原映射的属性；原区域不在表里（例如附加前就被替换过）时按匿名读写处理
+    Region attrs = { 0, PROT_READ | PROT_WRITE, true, ts };
+    bool found = false;
+    carve(oldAddr, oldAddr + oldLen, [&](quint64, const Region &piece, bool) {
+        if (!found)
+            attrs = piece;
+        found = true;
+    });
+    carve(newAddr, newAddr + newLen, [](quint64, const Region &, bool) {});
+    attrs.end = newAddr + newLen;
+    insertRegion(newAddr, attrs);
+    // 只把净增长计为新映射，收缩计为解除映射
+    if (newLen > oldLen)
+        noteMapped(newLen - oldLen, attrs.anon, ts);
+    else if (newLen < oldLen)
+        noteUnmapped(oldLen - newLen, ts);
+    else
+        touch(ts);
+}
+
+void AddressSpace::applyMprotect(quint64 addr, quint64 len, int prot, quint64 ts)
+{
+    len = pageAlignUp(len);
+    if (len == 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.protectCalls++;
+    std::vector<std::pair<quint64, Region>> pieces;
+    bool split = false;
+    carve(addr, addr + len, [&](quint64 start, const Region &piece, bool whole) {
+        pieces.emplace_back(start, piece);
+        split |= !whole;
+    });
+    for (auto &piece : pieces) {
+        piece.second.prot = prot;
+        insertRegion(piece.first, piece.second);
+    }
+    if (split)
+        m_stats.protectSplits++;
+    touch(ts);
+}
+
+void AddressSpace::applyBrk(quint64 newBreak, quint64 ts)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_heapStart == 0) {
+        // 附加时还没有堆（或没读到 maps）：第一次 brk 的返回值就是堆的起点
+        m_heapStart = m_heapEnd = newBreak;
+        return;
+    }
+    // 堆按页映射，brk 的返回值不一定页对齐
+    quint64 oldEnd = pageAlignUp(m_heapEnd);
+    quint64 newEnd = pageAlignUp(std::max(newBreak, m_heapStart));
+    m_heapEnd = std::max(newBreak, m_heapStart);
+    if (newEnd > oldEnd) {
+        m_stats.mappedBytes += newEnd - oldEnd;
+        m_stats.anonBytes += newEnd - oldEnd;
+        if (m_heapShrunk)
+            m_stats.brkRegrowths++;
+        m_heapShrunk = false;
+        noteMapped(newEnd - oldEnd, true, ts);
+    } else if (newEnd < oldEnd) {
+        m_stats.mappedBytes -= oldEnd - newEnd;
+        m_stats.anonBytes -= oldEnd - newEnd;
+        m_heapShrunk = true;
+        noteUnmapped(oldEnd - newEnd, ts);
+    }
+}
+
+AddressSpace::Stats AddressSpace::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::vector<AddressSpace::Sample> AddressSpace::history() const
+{
+    std::vector<Sample> out;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        qint64 newest = -1;
+        for (const Sample &s : m_history)
+            newest = std::max(newest, s.second);
+        for (const Sample &s : m_history) {
+            if (s.second >= 0 && s.second > newest - kHistorySeconds)
+                out.push_back(s);
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const Sample &a, const Sample &b) { return a.second < b.second; });
+    return out;
+}
@@ -0,0 +1,94 @@
+#ifndef ADDRESSSPACE_H
+#define ADDRESSSPACE_H
+
+#include <QtGlobal>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+// 被追踪进程的地址空间：附加时读入 /proc/<pid>/maps，之后由 mmap/munmap/mremap/mprotect/brk 的出口增量维护。
+// 映射互不重叠，按起始地址存放在有序树中，每次变化只触及与之重叠的几段，代价为 O(log n + 重叠段数)。
+// 除当前映射外还累计分配器抖动的几种迹象：短命映射、刚解除又映射同样大小、brk 收缩后再增长、mprotect 拆段。
+// apply*() 在追踪线程调用，stats()/history() 在 GUI 线程调用，两者之间加锁（只有内存相关的调用会进来）。
+class AddressSpace
+{
+public:
+    static constexpr quint64 kShortLivedNs = 1000000000ULL; // 存活不到 1 秒就被完全解除的映射算短命映射
+    static constexpr int kHistorySeconds = 300;
+
+    struct Stats {
+        quint64 mappedBytes = 0;     // 当前映射总量（含 brk 堆）
+        quint64 anonBytes = 0;       // 其中匿名映射（含 brk 堆）
+        quint64 regions = 0;
+        quint64 mapCalls = 0;        // 新增映射的调用：mmap、mremap、brk 增长
+        quint64 unmapCalls = 0;      // munmap、brk 收缩
+        quint64 protectCalls = 0;
+        quint64 bytesMapped = 0;     // 累计新映射的字节数
+        quint64 bytesUnmapped = 0;   // 累计解除映射的字节数
+        quint64 shortLived = 0;
+        quint64 shortLivedBytes = 0;
+        quint64 remapSameSize = 0;   // kShortLivedNs 内解除又映射了同样大小的匿名区域（分配器反复归还/申请）
+        quint64 brkRegrowths = 0;    // brk 收缩后又增长（malloc trim 过于积极）
+        quint64 protectSplits = 0;   // mprotect 只改了一段映射的一部分，把它拆开（保护页、JIT 等）
+        quint64 freshAnonPages = 0;  // 新的匿名页数：每页首次访问都要缺页，是缺页次数的下限估计
+    };
+
+    // 每秒一个采样点，只记录有变化的秒
+    struct Sample {
+        qint64 second = -1;          // CLOCK_MONOTONIC 秒
+        quint64 mappedBytes = 0;     // 这一秒结束时的值
+        quint64 anonBytes = 0;
+        quint64 bytesMapped = 0;     // 这一秒内新映射的字节数
+        quint64 bytesUnmapped = 0;
+        quint32 calls = 0;           // 这一秒内改变映射的调用数
+    };
+
+    AddressSpace();
+
+    void clear();
+    // 读入已有的映射作为起点，ts 为读入时间（ns）；读不到（进程已退出、没有权限）时从空的地址空间开始
+    bool load(pid_t pid, quint64 ts);
+    // execve 之后调用：旧映像的映射全部作废，从 /proc/<pid>/maps 重新读入新映像的初始映射；累计计数和历史保留
+    bool reload(pid_t pid, quint64 ts);
+
+    // 参数与系统调用一致，只在调用成功时调用；ts 为出口时间戳（ns）
+    void applyMmap(quint64 addr, quint64 len, int prot, int flags, quint64 ts);
+    void applyMunmap(quint64 addr, quint64 len, quint64 ts);
+    void applyMremap(quint64 oldAddr, quint64 oldLen, quint64 newAddr, quint64 newLen, quint64 ts);
+    void applyMprotect(quint64 addr, quint64 len, int prot, quint64 ts);
+    void applyBrk(quint64 newBreak, quint64 ts);
+
+    Stats stats() const;
+    // 最近 kHistorySeconds 秒内有变化的采样点，按时间排序
+    std::vector<Sample> history() const;
+
+private:
+    struct Region {
+        quint64 end;
+        int prot;
+        bool anon;
+        quint64 createdTs;   // 0 表示附加前就存在，存活时间未知
+    };
+
+    std::map<quint64, Region>::iterator insertRegion(quint64 start, const Region &r);
+    // 把 [start, end) 从映射表中挖掉，部分重叠的段拆开保留剩余部分；
+    // removed(pieceStart, piece, whole) 对每个被移除的部分调用一次，piece.end 已截到 end，whole 表示整段都被移除
+    template <typename Fn>
+    void carve(quint64 start, quint64 end, Fn removed);
+    void noteMapped(quint64 bytes, bool anon, quint64 ts);
+    void noteUnmapped(quint64 bytes, quint64 ts);
+    void touch(quint64 ts);
+
+    mutable std::mutex m_mutex;
+    std::map<quint64, Region> m_regions;
+    quint64 m_heapStart = 0;      // brk 堆不放进映射表，单独记录
+    quint64 m_heapEnd = 0;
+    bool m_heapShrunk = false;
+    std::unordered_map<quint64, quint64> m_recentUnmaps; // 匿名映射长度 -> 最近一次解除的时间
+    Stats m_stats;
+    std::vector<Sample> m_history; // 以秒取模的环形数组
+};
+
+#endif // ADDRESSSPACE_H
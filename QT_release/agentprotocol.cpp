@@ -0,0 +1,273 @@
+#include "agentprotocol.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace agentprotocol {
+
+QString modeName(Mode mode)
+{
+    switch (mode) {
+        case EventsMode: return "events";
+        case SummaryMode: return "summary";
+        case AutoMode: return "auto";
+    }
+    return "unknown";
+}
+
+size_t beginFrame(std::string &out, FrameType type)
+{
+    size_t start = out.size();
+    putU32(out, 0); // 负载长度，endFrame 时回填
+    putU8(out, type);
+    return start;
+}
+
+void endFrame(std::string &out, size_t frameStart)
+{
+    quint32 length = quint32(out.size() - frameStart - 5);
+    memcpy(&out[frameStart], &length, sizeof(length));
+}
+
+void putU8(std::string &out, quint8 v) { out.push_back(char(v)); }
+void putU16(std::string &out, quint16 v) { out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+void putU32(std::string &out, quint32 v) { out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+void putU64(std::string &out, quint64 v) { out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+void putBytes(std::string &out, std::string_view bytes)
+{
+    putU32(out, quint32(bytes.size()));
+    out.append(bytes.data(), bytes.size());
+}
+
+template <typename T>
+static T readValue(Reader &r)
+{
+    T v = 0;
+    if (!r.ok || size_t(r.end - r.p) < sizeof(T)) {
+        r.ok = false;
+        return 0;
+    }
+    memcpy(&v, r.p, sizeof(T));
+    r.p += sizeof(T);
+    return v;
+}
+
+quint8 Reader::u8() { return readValue<quint8>(*this); }
+quint16 Reader::u16() { return readValue<quint16>(*this); }
+quint32 Reader::u32() { return readValue<quint32>(*this); }
+quint64 Reader::u64() { return readValue<quint64>(*this); }
+
+std::string_view Reader::bytes()
+{
+    quint32 n = u32();
+    if (!ok || size_t(end - p) < n) {
+        ok = false;
+        return std::string_view();
+    }
+    std::string_view v(p, n);
+    p += n;
+    return v;
+}
+
+bool FrameBuffer::next(FrameType &type, std::string_view &payload)
+{
+    if (m_corrupt)
+        return false;
+    // 已取走的部分积累到一定大小再整体前移，避免每帧一次 memmove
+    if (m_pos > 0 && (m_pos == m_data.size() || m_pos > (1u << 20))) {
+        m_data.erase(0, m_pos);
+        m_pos = 0;
+    }
+    if (m_data.size() - m_pos < 5)
+        return false;
+    quint32 length;
+    memcpy(&length, m_data.data() + m_pos, sizeof(length));
+    if (length > kMaxFrame) {
+        m_corrupt = true;
+        return false;
+    }
+    if (m_data.size() - m_pos - 5 < length)
+        return false;
+    type = FrameType(quint8(m_data[m_pos + 4]));
+    payload = std::string_view(m_data.data() + m_pos + 5, length);
+    m_pos += 5 + length;
+    return true;
+}
+
+bool parseAddress(const QString &text, Address &out, QString *error)
+{
+    QString spec = text.trimmed();
+    out = Address();
+    if (spec.startsWith("unix:")) {
+        out.isUnix = true;
+        out.path = spec.mid(5).toStdString();
+        if (out.path.empty() || out.path.size() >= sizeof(sockaddr_un::sun_path)) {
+            *error = QString("invalid unix socket path \"%1\"").arg(spec.mid(5));
+            return false;
+        }
+        return true;
+    }
+    if (spec.startsWith("tcp:"))
+        spec = spec.mid(4);
+    const int tokenAt = spec.indexOf(",token=");
+    if (tokenAt >= 0) {
+        out.tokenFile = spec.mid(tokenAt + 7).toStdString();
+        spec = spec.left(tokenAt);
+        if (out.tokenFile.empty()) {
+            *error = QString("missing token file path in \"%1\"").arg(text);
+            return false;
+        }
+    }
+    int colon = spec.lastIndexOf(':');
+    bool ok = false;
+    uint port = spec.mid(colon + 1).toUInt(&ok);
+    if (!ok || port == 0 || port > 65535) {
+        *error = QString("expected unix:/path, tcp:host:port or host:port, got \"%1\"").arg(text);
+        return false;
+    }
+    out.host = colon > 0 ? spec.left(colon).toStdString() : std::string("127.0.0.1");
+    out.port = quint16(port);
+    return true;
+}
+
+bool readToken(const std::string &path, uid_t owner, std::string &token, QString *error)
+{
+    const QString name = QString::fromStdString(path);
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) {
+        *error = QString("%1: %2").arg(name, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    char buf[256];
+    ssize_t n = -1;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        *error = QString("%1: not a regular file").arg(name);
+    else if (st.st_uid != owner || (st.st_mode & 077) != 0)
+        *error = QString("%1: must be owned by uid %2 with mode 0600").arg(name).arg(unsigned(owner));
+    else if ((n = read(fd, buf, sizeof(buf))) < 0)
+        *error = QString("%1: %2").arg(name, strerror(errno));
+    close(fd);
+    if (n < 0)
+        return false;
+    token = QByteArray(buf, int(n)).trimmed().toStdString();
+    if (token.size() < kMinTokenLength) {
+        *error = QString("%1: token shorter than %2 characters").arg(name).arg(kMinTokenLength);
+        return false;
+    }
+    return true;
+}
+
+bool tokenMatches(std::string_view expected, std::string_view given)
+{
+    if (expected.empty() || expected.size() != given.size())
+        return false;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < expected.size(); ++i)
+        diff |= static_cast<unsigned char>(expected[i] ^ given[i]);
+    return diff == 0;
+}
+
+// 对 TCP 地址逐个尝试解析结果，fn 返回 true 表示成功
+template <typename Fn>
+static int withSocket(const Address &address, QString *error, Fn fn)
+{
+    if (address.isUnix) {
+        sockaddr_un sa = {};
+        sa.sun_family = AF_UNIX;
+        memcpy(sa.sun_path, address.path.c_str(), address.path.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && fn(fd, reinterpret_cast<const sockaddr*>(&sa), socklen_t(sizeof(sa))))
+            return fd;
+        *error = QString("%1: %2").arg(QString::fromStdString(address.path), strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *results = nullptr;
+    const std::string port = std::to_string(address.port);
+    int rc = getaddrinfo(address.host.c_str(), port.c_str(), &hints, &results);
+    if (rc != 0) {
+        *error = QString("%1: %2").arg(QString::fromStdString(address.host), gai_strerror(rc));
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo *ai = results; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        if (fn(fd, ai->ai_addr, ai->ai_addrlen)) {
+            // 事件批次已经在应用层合并，不需要 Nagle 再攒
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            break;
+        }
+        *error = QString("%1:%2: %3").arg(QString::fromStdString(address.host)).arg(address.port).arg(strerror(errno));
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(results);
+    return fd;
+}
+
+int listenOn(const Address &address, QString *error)
+{
+    if (address.isUnix)
+        unlink(address.path.c_str()); // 上一次运行留下的 socket 文件
+    return withSocket(address, error, [](int fd, const sockaddr *sa, socklen_t len) {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        return bind(fd, sa, len) == 0 && listen(fd, 4) == 0;
+    });
+}
+
+int connectTo(const Address &address, QString *error)
+{
+    return withSocket(address, error, [](int fd, const sockaddr *sa, socklen_t len) {
+        return connect(fd, sa, len) == 0;
+    });
+}
+
+bool sendAll(int fd, const char *data, size_t size, int timeoutMs)
+{
+    const quint64 deadline = monotonicNs() + quint64(timeoutMs) * 1000000ULL;
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            data += n;
+            size -= size_t(n);
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            return false;
+        quint64 now = monotonicNs();
+        if (now >= deadline)
+            return false;
+        pollfd pfd = { fd, POLLOUT, 0 };
+        poll(&pfd, 1, int((deadline - now) / 1000000ULL) + 1);
+    }
+    return true;
+}
+
+quint64 monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return quint64(ts.tv_sec) * 1000000000ULL + quint64(ts.tv_nsec);
+}
+
+} // namespace agentprotocol
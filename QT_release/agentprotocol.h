@@ -0,0 +1,134 @@
+#ifndef AGENTPROTOCOL_H
+#define AGENTPROTOCOL_H
+
+#include <QString>
+#include <QtGlobal>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+// 追踪代理（--agent，以 root 运行）与 GUI 之间的流协议，走 Unix socket 或 TCP（可经 SSH 端口转发）。
+// 每帧：u32 负载长度 + u8 帧类型 + 负载，整数一律小端。
+//   代理 -> GUI：Hello（版本、代理的 CLOCK_MONOTONIC）、Strings（新驻留的字符串）、
+//               Events（一批事件，沿用追踪文件的列式编码）、Summary（按秒、按 syscall 的合计）、
+//               Status（追踪器计数器与代理的发送积压）、Finished（结束原因）
+//   GUI -> 代理：Auth（TCP 连接的令牌）、Start（pid、模式、追踪过滤表达式）、SetMode、Stop
+// Unix socket 靠 SO_PEERCRED 认对端；TCP 没有对端身份，必须先发 Auth 且令牌与代理的令牌文件一致，
+// 否则代理回复 Finished 后断开，不会处理 Start。
+// 事件里的 commId/pathId 是代理 StringTable 的 id，GUI 收到 Strings 后映射成本地 id。
+namespace agentprotocol {
+
+constexpr quint32 kMagic = 0x41535451;      // "QTSA"
+constexpr quint16 kVersion = 2;
+constexpr quint32 kMaxFrame = 32u << 20;    // 超过即视为数据损坏
+constexpr quint32 kMaxBatchEvents = 4096;   // 每个 Events 帧最多的事件数
+constexpr quint32 kMaxSummaryEntries = 65536; // 每个 Summary 帧最多的条目数，更多时分成几帧
+constexpr size_t kSummaryEntryBytes = 26;   // Summary 帧里每条：u64 秒、u16 syscall、u32 次数、u32 失败、u64 耗时
+constexpr quint32 kMinTokenLength = 32;     // 令牌文件内容（十六进制）的最短长度
+// 代理以 root 运行，默认监听的 socket 文件交给 sudo 前的用户，权限 0600
+constexpr const char *kDefaultAddress = "unix:/run/syscallmonitor-agent.sock";
+
+enum FrameType : quint8 {
+    Hello = 1,
+    Start,
+    SetMode,
+    Stop,
+    Strings,
+    Events,
+    Summary,
+    Status,
+    Finished,
+    Auth,
+};
+
+// Events：发送原始事件，发送积压时停止从追踪器取事件（追踪器队列满后丢弃并计数）
+// Summaries：只发送按秒合计，带宽最省
+// Auto：平时发送事件，积压超过上限时改为合计，积压清空后恢复
+enum Mode : quint8 { EventsMode, SummaryMode, AutoMode };
+QString modeName(Mode mode);
+
+struct SummaryEntry {
+    qint64 second = 0;        // CLOCK_MONOTONIC 秒（GUI 收到后换算到本机时钟）
+    qint16 syscall = -1;
+    quint32 count = 0;
+    quint32 errors = 0;
+    quint64 durationNs = 0;
+};
+
+struct StatusInfo {
+    quint64 stops = 0;
+    quint64 waitNs = 0;
+    quint64 processNs = 0;
+    quint64 emitted = 0;      // 追踪器写入代理队列的事件数
+    quint64 dropped = 0;      // 代理队列满时追踪器丢弃的事件数
+    quint64 filtered = 0;
+    quint64 summarized = 0;   // 以合计代替原始事件发送的事件数
+    quint64 bytesSent = 0;
+    quint64 backlogBytes = 0; // 已编码但还没写进 socket 的字节数
+};
+
+// --- 写端：追加到 out，beginFrame/endFrame 之间写负载 ---
+size_t beginFrame(std::string &out, FrameType type);
+void endFrame(std::string &out, size_t frameStart);
+void putU8(std::string &out, quint8 v);
+void putU16(std::string &out, quint16 v);
+void putU32(std::string &out, quint32 v);
+void putU64(std::string &out, quint64 v);
+void putBytes(std::string &out, std::string_view bytes); // u32 长度 + 内容
+
+// --- 读端：越界时 ok 置为 false，之后的读取都返回 0 ---
+struct Reader {
+    const char *p;
+    const char *end;
+    bool ok = true;
+
+    Reader(std::string_view payload) : p(payload.data()), end(payload.data() + payload.size()) {}
+    quint8 u8();
+    quint16 u16();
+    quint32 u32();
+    quint64 u64();
+    std::string_view bytes();
+    std::string_view rest() { std::string_view r(p, size_t(end - p)); p = end; return r; }
+};
+
+// 从 socket 读到的字节流中切出完整的帧
+class FrameBuffer
+{
+public:
+    void append(const char *data, size_t size) { m_data.append(data, size); }
+    // 取出下一帧；payload 在下一次 append/next 之前有效。数据不完整时返回 false，损坏时另外置 corrupt()
+    bool next(FrameType &type, std::string_view &payload);
+    bool corrupt() const { return m_corrupt; }
+
+private:
+    std::string m_data;
+    size_t m_pos = 0;
+    bool m_corrupt = false;
+};
+
+// --- 地址：unix:/path/to.sock、tcp:host:port 或 host:port（省略 host 时为 127.0.0.1） ---
+// TCP 地址后可跟 ,token=/path/to/token，客户端连接后读出令牌发给代理
+struct Address {
+    bool isUnix = false;
+    std::string path;
+    std::string host;
+    quint16 port = 0;
+    std::string tokenFile;
+};
+bool parseAddress(const QString &text, Address &out, QString *error);
+// 读令牌文件：必须是属于 owner、同组和其他用户都不可读写的普通文件，去掉首尾空白后至少 kMinTokenLength 个字符
+bool readToken(const std::string &path, uid_t owner, std::string &token, QString *error);
+// 长度相同且逐字节相等；比较时间与内容无关。expected 为空时总是 false
+bool tokenMatches(std::string_view expected, std::string_view given);
+// 失败返回 -1 并给出原因；返回的 fd 为阻塞模式
+int listenOn(const Address &address, QString *error);
+int connectTo(const Address &address, QString *error);
+// 阻塞写完整个缓冲区，timeoutMs 内写不完返回 false
+bool sendAll(int fd, const char *data, size_t size, int timeoutMs);
+
+quint64 monotonicNs();
+
+} // namespace agentprotocol
+
+#endif // AGENTPROTOCOL_H
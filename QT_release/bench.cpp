@@ -0,0 +1,187 @@
+#include "bench.h"
+#include "columnkernels.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 命令行模式：SyscallMonitor --bench-kernels [百万行数，默认 16]
+// 在合成的列数据上分别用标量和 AVX2 实现跑每个分析内核，输出吞吐量与加速比
+int runKernelBench(const QStringList &args)
+{
+    using namespace columnkernels;
+    bool ok = true;
+    // 行号是 quint32：先按 64 位算，超过 UINT32_MAX（4294 百万行以上）时拒绝，而不是回绕成一个小数
+    const quint64 requested = quint64(args.isEmpty() ? 16 : args.at(0).toUInt(&ok)) * 1000000u;
+    if (!ok || requested == 0 || requested > UINT32_MAX) {
+        fprintf(stderr, "usage: SyscallMonitor --bench-kernels [million rows, 1-%u]\n", unsigned(UINT32_MAX / 1000000u));
+        return 2;
+    }
+    const quint32 rows = quint32(requested);
+
+    // 时间戳递增，耗时大致呈对数正态分布，10% 的调用失败，40 种 syscall
+    std::vector<quint64> ts(rows), duration(rows);
+    std::vector<qint64> ret(rows);
+    std::vector<qint16> syscall(rows);
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> latency(8.0, 1.5);
+    quint64 now = 1000000000000ULL;
+    for (quint32 i = 0; i < rows; ++i) {
+        now += 500 + rng() % 2000;
+        ts[i] = now;
+        duration[i] = quint64(latency(rng));
+        ret[i] = rng() % 10 == 0 ? -11 : qint64(rng() % 4096);
+        syscall[i] = qint16(rng() % 40);
+    }
+    std::vector<quint32> selection(rows);
+    std::vector<quint16> buckets(rows);
+    std::vector<Aggregate> byKey(kMaxKeys);
+    const quint64 from = ts[rows / 4];
+    const quint64 to = ts[rows / 4 * 3];
+    quint32 selected = selectRange(ts.data(), rows, from, to, selection.data());
+
+    struct Kernel {
+        const char *name;
+        double bytesPerRow;  // 每行读取的列数据
+        bool onSelection;    // 只处理 selection 选中的行
+        std::function<void()> run;
+    };
+    const std::vector<Kernel> kernels = {
+        { "selectRange(ts)", 8, false, [&] { selectRange(ts.data(), rows, from, to, selection.data()); } },
+        { "aggregate(dur)", 16, false, [&] { Aggregate a; aggregate(duration.data(), ret.data(), nullptr, rows, a); } },
+        { "aggregate(dur, sel 50%)", 20, true, [&] { Aggregate a; aggregate(duration.data(), ret.data(), selection.data(), selected, a); } },
+        { "aggregateByKey(syscall)", 18, false, [&] { aggregateByKey(syscall.data(), duration.data(), ret.data(), nullptr, rows, byKey.data()); } },
+        { "latencyBuckets(dur)", 8, false, [&] { latencyBuckets(duration.data(), nullptr, rows, buckets.data()); } },
+        { "log2Histogram(dur)", 8, false, [&] { quint64 counts[65] = {}; log2Histogram(duration.data(), nullptr, rows, counts); } },
+    };
+
+    printf("%u rows, detected ISA: %s\n\n", rows, isaName(detectedIsa()));
+    printf("%-26s %-7s %10s %9s %8s\n", "kernel", "isa", "Mrows/s", "GB/s", "speedup");
+    for (const Kernel &k : kernels) {
+        double scalarSeconds = 0;
+        for (int isa = Scalar; isa <= detectedIsa(); ++isa) {
+            setIsa(Isa(isa));
+            k.run(); // 预热：页面换入、缓存
+            double best = 1e9;
+            for (int rep = 0; rep < 5; ++rep) {
+                auto start = std::chrono::steady_clock::now();
+                k.run();
+                best = qMin(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+            if (isa == Scalar)
+                scalarSeconds = best;
+            double processed = k.onSelection ? selected : rows;
+            printf("%-26s %-7s %10.0f %9.2f %7.2fx\n", k.name, isaName(Isa(isa)), processed / best / 1e6,
+                   processed * k.bytesPerRow / best / 1e9, scalarSeconds / best);
+        }
+    }
+    setIsa(detectedIsa());
+    return 0;
+}
+
+// 命令行模式：SyscallMonitor --loopback-workload [秒数，默认 60] [客户端数，默认 4]
+// 在 127.0.0.1 上跑一个 epoll 回显服务器和若干客户端线程，给网络面板提供一个可以附加的本地负载：
+// 每个客户端反复建立连接、发送几条大小不一的消息并读回，中间随机停顿
+int runLoopbackWorkload(const QStringList &args)
+{
+    bool ok = true;
+    const int seconds = args.size() > 0 ? args.at(0).toInt(&ok) : 60;
+    const int clients = ok && args.size() > 1 ? args.at(1).toInt(&ok) : 4;
+    if (!ok || seconds <= 0 || clients <= 0) {
+        fprintf(stderr, "usage: SyscallMonitor --loopback-workload [seconds] [clients]\n");
+        return 2;
+    }
+
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0
+        || listen(listener, 128) < 0 || getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &addrLen) < 0) {
+        perror("loopback listener");
+        return 1;
+    }
+    printf("pid %d serving on 127.0.0.1:%d for %d s with %d clients\n", getpid(), ntohs(addr.sin_port), seconds, clients);
+    fflush(stdout);
+
+    std::atomic<bool> running(true);
+    std::thread server([&] {
+        int ep = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = listener;
+        epoll_ctl(ep, EPOLL_CTL_ADD, listener, &ev);
+        epoll_event ready[32];
+        char buf[16384];
+        while (running.load(std::memory_order_relaxed)) {
+            int n = epoll_wait(ep, ready, 32, 100);
+            for (int i = 0; i < n; ++i) {
+                int fd = ready[i].data.fd;
+                if (fd == listener) {
+                    int conn = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+                    if (conn < 0)
+                        continue;
+                    ev.events = EPOLLIN;
+                    ev.data.fd = conn;
+                    epoll_ctl(ep, EPOLL_CTL_ADD, conn, &ev);
+                    continue;
+                }
+                ssize_t got = recv(fd, buf, sizeof(buf), 0);
+                if (got <= 0 || send(fd, buf, size_t(got), MSG_NOSIGNAL) < 0) {
+                    epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+                    close(fd);
+                }
+            }
+        }
+        close(ep);
+    });
+
+    std::vector<std::thread> workers;
+    for (int c = 0; c < clients; ++c) {
+        workers.emplace_back([&, c] {
+            std::mt19937 rng(c + 1);
+            std::vector<char> msg(16384, 'x');
+            std::vector<char> reply(msg.size());
+            while (running.load(std::memory_order_relaxed)) {
+                int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+                    for (int m = 0; m < 20 && running.load(std::memory_order_relaxed); ++m) {
+                        size_t len = 64 + rng() % (msg.size() - 64);
+                        if (send(fd, msg.data(), len, MSG_NOSIGNAL) < 0)
+                            break;
+                        size_t echoed = 0;
+                        while (echoed < len) {
+                            ssize_t got = recv(fd, reply.data(), reply.size(), 0);
+                            if (got <= 0)
+                                break;
+                            echoed += size_t(got);
+                        }
+                        if (echoed < len)
+                            break;
+                        usleep(1000 + rng() % 20000);
+                    }
+                }
+                close(fd);
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running.store(false);
+    for (std::thread &t : workers)
+        t.join();
+    server.join();
+    close(listener);
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <QStringList>
+
+// 命令行基准与测试负载，由 main() 按第一个参数分派，返回值是进程的退出码
+
+// --bench-kernels [百万行数]：分析内核的标量与 AVX2 实现在合成列数据上的吞吐量
+int runKernelBench(const QStringList &args);
+// --loopback-workload [秒数] [客户端数]：127.0.0.1 上的回显服务器和客户端，给网络面板一个可附加的负载
+int runLoopbackWorkload(const QStringList &args);
+
+#endif // BENCH_H
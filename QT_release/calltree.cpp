@@ -0,0 +1,53 @@
+#include "calltree.h"
+
+CallTree::CallTree()
+{
+    clear();
+}
+
+void CallTree::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_nodes.assign(1, Node());
+    m_index.clear();
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+quint32 CallTree::child(quint32 parent, quint32 frame)
+{
+    quint64 key = (quint64(parent) << 32) | frame;
+    auto it = m_index.find(key);
+    if (it != m_index.end())
+        return it->second;
+
+    quint32 id = quint32(m_nodes.size());
+    Node node;
+    node.frame = frame;
+    node.parent = parent;
+    node.nextSibling = m_nodes[parent].firstChild;
+    m_nodes.push_back(node);
+    m_nodes[parent].firstChild = id;
+    m_index.emplace(key, id);
+    return id;
+}
+
+void CallTree::add(const quint32 *frames, int count, quint32 leaf, quint64 durationNs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    quint32 node = 0;
+    m_nodes[0].totalNs += durationNs;
+    m_nodes[0].calls++;
+    for (int i = 0; i <= count; ++i) {
+        node = child(node, i < count ? frames[i] : leaf);
+        m_nodes[node].totalNs += durationNs;
+        m_nodes[node].calls++;
+    }
+    m_nodes[node].selfNs += durationNs;
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<CallTree::Node> CallTree::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nodes;
+}
@@ -0,0 +1,48 @@
+#ifndef CALLTREE_H
+#define CALLTREE_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// 去重后的调用栈树：相同调用路径只保存一份，节点上累计经过该路径的系统调用耗时。
+// 帧用 StringTable 中的 id 表示（函数名、最后一层为 syscall 名）。
+// add() 在追踪线程调用，snapshot() 在 GUI 线程调用，两者之间只在节点表上加锁。
+class CallTree
+{
+public:
+    struct Node {
+        quint32 frame = 0;       // StringTable id，根节点为 0
+        quint32 parent = 0;
+        quint32 firstChild = 0;  // 0 表示没有（节点 0 是根，不会作为子节点出现）
+        quint32 nextSibling = 0;
+        quint64 totalNs = 0;     // 经过该节点的调用总耗时
+        quint64 selfNs = 0;      // 以该节点结尾的调用耗时
+        quint64 calls = 0;
+    };
+
+    CallTree();
+
+    void clear();
+
+    // frames 从最外层（main/_start）到最内层，随后以 leaf（syscall 名）结尾
+    void add(const quint32 *frames, int count, quint32 leaf, quint64 durationNs);
+
+    // 每次 add() 后递增，GUI 据此判断是否需要重新取快照
+    quint64 generation() const { return m_generation.load(std::memory_order_relaxed); }
+
+    // 节点表的拷贝，下标 0 为根
+    std::vector<Node> snapshot() const;
+
+private:
+    quint32 child(quint32 parent, quint32 frame);
+
+    mutable std::mutex m_mutex;
+    std::vector<Node> m_nodes;
+    std::unordered_map<quint64, quint32> m_index; // (parent << 32 | frame) -> 节点
+    std::atomic<quint64> m_generation{0};
+};
+
+#endif // CALLTREE_H
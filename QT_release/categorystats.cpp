@@ -0,0 +1,81 @@
+#include "categorystats.h"
+#include "errnostats.h"
+
+#include <algorithm>
+
+void CategoryStats::clear()
+{
+    m_categories.fill(Node());
+    m_syscalls.assign(kMaxSyscall, Node());
+    m_errnos.clear();
+    m_changed.clear();
+}
+
+void CategoryStats::record(long syscall, long ret, quint64 durationNs)
+{
+    const int err = ErrnoStats::errnoFromRet(ret);
+    const int category = getSyscallCategory(syscall);
+
+    Node &c = m_categories[size_t(category)];
+    add(c, err != 0, durationNs);
+    markDirty(c, categoryKey(category));
+
+    if (syscall < 0 || syscall >= kMaxSyscall)
+        return;
+    Node &s = m_syscalls[size_t(syscall)];
+    add(s, err != 0, durationNs);
+    markDirty(s, syscallKey(syscall));
+
+    if (err == 0)
+        return;
+    const quint64 key = errnoKey(syscall, err);
+    Node &e = m_errnos[key];
+    add(e, true, durationNs);
+    markDirty(e, key);
+}
+
+QList<quint64> CategoryStats::takeChanged()
+{
+    // key 的高位是层级，排序后父层级在前，界面创建子节点时父节点已经存在
+    std::sort(m_changed.begin(), m_changed.end());
+    QList<quint64> changed;
+    changed.reserve(int(m_changed.size()));
+    for (quint64 key : m_changed) {
+        changed.append(key);
+        switch (levelOf(key)) {
+        case CategoryLevel: m_categories[size_t(categoryOf(key))].dirty = false; break;
+        case SyscallLevel: m_syscalls[size_t(syscallOf(key))].dirty = false; break;
+        case ErrnoLevel: m_errnos[key].dirty = false; break;
+        }
+    }
+    m_changed.clear();
+    return changed;
+}
+
+const CategoryStats::Node* CategoryStats::node(quint64 key) const
+{
+    switch (levelOf(key)) {
+    case CategoryLevel: {
+        int c = categoryOf(key);
+        return c < SyscallCategoryCount ? &m_categories[size_t(c)] : nullptr;
+    }
+    case SyscallLevel: {
+        long nr = syscallOf(key);
+        return nr >= 0 && nr < kMaxSyscall ? &m_syscalls[size_t(nr)] : nullptr;
+    }
+    case ErrnoLevel: {
+        auto it = m_errnos.constFind(key);
+        return it == m_errnos.constEnd() ? nullptr : &it.value();
+    }
+    }
+    return nullptr;
+}
+
+quint64 CategoryStats::parentKey(quint64 key)
+{
+    switch (levelOf(key)) {
+    case ErrnoLevel: return syscallKey(syscallOf(key));
+    case SyscallLevel: return categoryKey(getSyscallCategory(syscallOf(key)));
+    default: return key;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef CATEGORYSTATS_H
+#define CATEGORYSTATS_H
+
+#include <QHash>
+#include <QList>
+#include <array>
+#include <vector>
+#include "syscall_map.h"
+
+// 分类 -> syscall -> errno 三层汇总（分类见 syscall_map.h，由 generate_syscall_map 生成）。
+// 每个事件只更新三个节点；与 ErrnoStats 一样记录有变化的节点，界面只刷新这些节点
+class CategoryStats
+{
+public:
+    enum Level { CategoryLevel, SyscallLevel, ErrnoLevel };
+
+    struct Node {
+        quint64 count = 0;
+        quint64 errors = 0;
+        quint64 durationNs = 0;
+        quint64 maxNs = 0;
+        bool dirty = false;
+    };
+
+    static constexpr int kMaxSyscall = 512; // 超出范围的 syscall 只计入分类
+
+    CategoryStats() { clear(); }
+    void clear();
+
+    void record(long syscall, long ret, quint64 durationNs);
+
+    // 自上次调用以来有变化的节点，父节点排在子节点之前
+    QList<quint64> takeChanged();
+
+    const Node* node(quint64 key) const;
+    const Node& category(int category) const { return m_categories[size_t(category)]; }
+
+    // 节点 key：高 16 位是层级，分类层低位是分类号，syscall 层是 syscall 号，errno 层是 (syscall << 16) | errno
+    static quint64 categoryKey(int category) { return quint64(CategoryLevel) << 48 | quint64(category); }
+    static quint64 syscallKey(long syscall) { return quint64(SyscallLevel) << 48 | quint64(quint32(syscall)); }
+    static quint64 errnoKey(long syscall, int err) { return quint64(ErrnoLevel) << 48 | quint64(quint32(syscall)) << 16 | quint16(err); }
+    static Level levelOf(quint64 key) { return Level(key >> 48); }
+    static int categoryOf(quint64 key) { return int(key & 0xffff); }
+    static long syscallOf(quint64 key) { return levelOf(key) == ErrnoLevel ? long((key >> 16) & 0xffffffff) : long(key & 0xffffffff); }
+    static int errnoOf(quint64 key) { return int(key & 0xffff); }
+    // 树中的父节点；分类节点返回自身
+    static quint64 parentKey(quint64 key);
+
+private:
+    static void add(Node &n, bool failed, quint64 durationNs) {
+        n.count++;
+        n.errors += failed ? 1 : 0;
+        n.durationNs += durationNs;
+        n.maxNs = durationNs > n.maxNs ? durationNs : n.maxNs;
+    }
+    void markDirty(Node &n, quint64 key) {
+        if (!n.dirty) {
+            n.dirty = true;
+            m_changed.push_back(key);
+        }
+    }
+
+    std::array<Node, SyscallCategoryCount> m_categories;
+    std::vector<Node> m_syscalls;         // 下标为 syscall 号
+    QHash<quint64, Node> m_errnos;        // key 为 errnoKey
+    std::vector<quint64> m_changed;
+};
+
+#endif // CATEGORYSTATS_H
@@ -0,0 +1,154 @@
+#include "cgroupwatch.h"
+#include "processscan.h"
+
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+// 子 cgroup 的创建/删除，以及目录内文件的写入（往 cgroup.procs 写 pid 移入进程）
+static const uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ONLYDIR;
+
+CgroupWatch::~CgroupWatch()
+{
+    if (m_inotify != -1)
+        close(m_inotify);
+}
+
+QString CgroupWatch::cgroup2Mount()
+{
+    FILE *mounts = fopen("/proc/self/mounts", "re");
+    if (!mounts)
+        return QString();
+    QString found;
+    char line[1024];
+    char dir[PATH_MAX];
+    char type[64];
+    while (fgets(line, sizeof(line), mounts)) {
+        if (sscanf(line, "%*s %4095s %63s", dir, type) == 2 && strcmp(type, "cgroup2") == 0) {
+            found = QString::fromLocal8Bit(dir);
+            break;
+        }
+    }
+    fclose(mounts);
+    return found;
+}
+
+static bool isCgroupDirectory(const std::string &dir)
+{
+    return access((dir + "/cgroup.procs").c_str(), F_OK) == 0;
+}
+
+bool CgroupWatch::open(const QString &path, QString *error)
+{
+    std::string p = path.trimmed().toStdString();
+    while (p.size() > 1 && p.back() == '/')
+        p.pop_back();
+    std::string dir;
+    if (!p.empty() && p[0] == '/' && isCgroupDirectory(p)) {
+        dir = p;
+    } else {
+        const std::string mount = cgroup2Mount().toStdString();
+        std::string candidate = mount + (p.empty() || p[0] != '/' ? "/" : "") + p;
+        if (!mount.empty() && isCgroupDirectory(candidate))
+            dir = candidate;
+    }
+    if (dir.empty()) {
+        if (error)
+            *error = QString("%1 is not a cgroup: no cgroup.procs there or under the cgroup2 mount").arg(path);
+        return false;
+    }
+    m_root = dir;
+    m_dirs.clear();
+    m_treeChanged = true;
+    if (m_inotify == -1)
+        m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    return true;
+}
+
+bool CgroupWatch::drain()
+{
+    if (m_inotify == -1)
+        return false;
+    bool changed = false;
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t n;
+    while ((n = read(m_inotify, buf, sizeof(buf))) > 0) {
+        for (ssize_t off = 0; off < n;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(buf + off);
+            // 子 cgroup 增减、监视被移除（目录已删除）或事件溢出时，下次 scan() 重新遍历子树
+            if ((event->mask & IN_ISDIR) || (event->mask & (IN_IGNORED | IN_Q_OVERFLOW)))
+                m_treeChanged = true;
+            changed = true;
+            off += ssize_t(sizeof(struct inotify_event) + event->len);
+        }
+    }
+    return changed;
+}
+
+// 先加监视再列目录：两者之间新建的子 cgroup 会有事件，不会漏掉
+void CgroupWatch::walk(const std::string &dir)
+{
+    m_dirs.push_back(dir);
+    if (m_inotify != -1)
+        inotify_add_watch(m_inotify, dir.c_str(), kWatchMask);
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+    while (struct dirent *entry = readdir(d)) {
+        if (entry->d_type != DT_DIR || strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        walk(dir + "/" + entry->d_name);
+    }
+    closedir(d);
+}
+
+void CgroupWatch::scan(const std::function<bool(pid_t)> &known, std::vector<Thread> &added)
+{
+    if (m_treeChanged || m_inotify == -1) {
+        m_treeChanged = false;
+        m_dirs.clear();
+        walk(m_root);
+    }
+    const size_t first = added.size();
+    std::vector<pid_t> tids;
+    std::vector<pid_t> procs;
+    for (const std::string &dir : m_dirs) {
+        tids.clear();
+        // cgroup v2 的 cgroup.threads 列出全部线程（线程化的子 cgroup 里 cgroup.procs 不可读），v1 是 tasks；
+        // 都读不到时退回 cgroup.procs，再列出各进程的 /proc/<pid>/task
+        if (!processscan::readPidFile((dir + "/cgroup.threads").c_str(), tids)
+            && !processscan::readPidFile((dir + "/tasks").c_str(), tids)) {
+            procs.clear();
+            processscan::readPidFile((dir + "/cgroup.procs").c_str(), procs);
+            char task[64];
+            for (pid_t pid : procs) {
+                snprintf(task, sizeof(task), "/proc/%d/task", int(pid));
+                processscan::listPids(task, tids);
+            }
+        }
+        for (pid_t tid : tids) {
+            if (known(tid))
+                continue;
+            Thread t;
+            t.tid = tid;
+            t.tgid = processscan::threadGroup(tid, &t.ppid);
+            if (t.tgid > 0)
+                added.push_back(t);
+        }
+    }
+    // 迁移中的线程可能同时出现在两个 cgroup 里
+    std::sort(added.begin() + ptrdiff_t(first), added.end(), [](const Thread &a, const Thread &b) {
+        if (a.tgid != b.tgid)
+            return a.tgid < b.tgid;
+        if ((a.tid == a.tgid) != (b.tid == b.tgid))
+            return a.tid == a.tgid;
+        return a.tid < b.tid;
+    });
+    added.erase(std::unique(added.begin() + ptrdiff_t(first), added.end(), [](const Thread &a, const Thread &b) {
+        return a.tid == b.tid;
+    }), added.end());
+}
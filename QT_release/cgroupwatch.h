@@ -0,0 +1,50 @@
+#ifndef CGROUPWATCH_H
+#define CGROUPWATCH_H
+
+#include <QString>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// 一个 cgroup 子树（systemd unit、容器）的成员枚举与变化通知，追踪器按 cgroup 附加时使用。
+// 每个 cgroup 目录一个 inotify 监视：子 cgroup 的创建/删除，以及往 cgroup.procs 写 pid（systemd、docker exec
+// 移入进程的做法）产生的 IN_MODIFY。成员变化本身不产生事件，用 clone3(CLONE_INTO_CGROUP) 直接生在 cgroup 里的进程
+// 只能靠调用方定期 scan() 发现；被追踪进程自己 fork 出的子进程由追踪器的 fork 事件跟随，不依赖这里
+class CgroupWatch
+{
+public:
+    struct Thread {
+        pid_t tid = 0;
+        pid_t tgid = 0;
+        pid_t ppid = 0;
+    };
+
+    ~CgroupWatch();
+
+    // cgroup2 的挂载点：纯 v2 系统上是 /sys/fs/cgroup，混合模式下通常是 /sys/fs/cgroup/unified；没有时为空
+    static QString cgroup2Mount();
+
+    // path 是 cgroup 目录，或相对 cgroup2 挂载点的路径（/proc/<pid>/cgroup 里 "0::" 之后的写法，
+    // 如 /system.slice/nginx.service）；cgroup v1 的层级目录也可以（读 tasks，没有 populated 通知）
+    bool open(const QString &path, QString *error);
+    QString directory() const { return QString::fromStdString(m_root); }
+    // 非阻塞的 inotify fd，可挂到 epoll 上；inotify 不可用时为 -1，调用方只能靠定期 scan()
+    int notifyFd() const { return m_inotify; }
+    // 读空 inotify，有变化时返回 true
+    bool drain();
+    // 枚举子树内的全部线程：known(tid) 为 true 的直接跳过，其余查出所属进程和父进程后追加到 added，
+    // 同一进程的主线程排在其他线程之前；期间已退出的线程不在结果里
+    void scan(const std::function<bool(pid_t)> &known, std::vector<Thread> &added);
+    int cgroupCount() const { return int(m_dirs.size()); }
+
+private:
+    void walk(const std::string &dir);
+
+    std::string m_root;
+    std::vector<std::string> m_dirs; // 子树内的 cgroup 目录，子 cgroup 有变化时重新遍历
+    bool m_treeChanged = true;
+    int m_inotify = -1;
+};
+
+#endif // CGROUPWATCH_H
@@ -0,0 +1,59 @@
+#ifndef CHUNKSUMMARY_H
+#define CHUNKSUMMARY_H
+
+#include <QtGlobal>
+#include "syscallevent.h"
+
+// 一段连续事件（追踪文件的一块、EventStore 的一个事件块）的摘要。
+// 查询时先用摘要判断这一段里“不可能”有匹配的事件，从而整段跳过而不解码。
+// 定长 POD，原样写入追踪文件的索引区。
+struct ChunkSummary
+{
+    static constexpr int kSyscallBits = 512;
+    static constexpr int kTidBits = 256;
+
+    quint64 minTs = ~0ULL;
+    quint64 maxTs = 0;            // 最后一个事件的开始时间
+    quint64 maxDuration = 0;
+    quint32 eventCount = 0;
+    quint32 errorCount = 0;
+    quint64 syscalls[kSyscallBits / 64] = {}; // 出现过的 syscall 号
+    quint64 tids[kTidBits / 64] = {};         // TID 的布隆过滤器（两个哈希位）
+
+    static int tidBit(quint32 tid, int k) {
+        quint32 h = (tid + quint32(k) * 0x7F4A7C15u) * 0x9E3779B1u;
+        return int(h >> 24);
+    }
+
+    void add(const SyscallEvent &e) {
+        minTs = e.ts < minTs ? e.ts : minTs;
+        maxTs = e.ts > maxTs ? e.ts : maxTs;
+        maxDuration = e.duration > maxDuration ? e.duration : maxDuration;
+        eventCount++;
+        if (e.ret < 0 && e.ret >= -4095)
+            errorCount++;
+        if (e.syscall >= 0 && e.syscall < kSyscallBits)
+            syscalls[e.syscall / 64] |= 1ULL << (e.syscall % 64);
+        for (int k = 0; k < 2; ++k) {
+            int bit = tidBit(e.tid, k);
+            tids[bit / 64] |= 1ULL << (bit % 64);
+        }
+    }
+
+    bool hasSyscall(int nr) const {
+        return nr >= 0 && nr < kSyscallBits && (syscalls[nr / 64] >> (nr % 64)) & 1;
+    }
+    // 可能误报，不会漏报
+    bool mayHaveTid(quint32 tid) const {
+        for (int k = 0; k < 2; ++k) {
+            int bit = tidBit(tid, k);
+            if (!((tids[bit / 64] >> (bit % 64)) & 1))
+                return false;
+        }
+        return true;
+    }
+};
+
+static_assert(sizeof(ChunkSummary) == 128, "ChunkSummary is stored in trace files");
+
+#endif // CHUNKSUMMARY_H
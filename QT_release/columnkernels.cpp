@@ -0,0 +1,343 @@
+#include "columnkernels.h"
+#include "latencyhistogram.h"
+
+#include <atomic>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define COLUMNKERNELS_AVX2 1
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+namespace columnkernels {
+
+static inline bool isErrorReturn(qint64 ret)
+{
+    return ret < 0 && ret >= -4095;
+}
+
+// ---------------- 标量实现 ----------------
+
+static quint32 selectRangeScalar(const quint64 *values, quint32 count, quint64 lo, quint64 hi, quint32 *selection)
+{
+    quint32 n = 0;
+    for (quint32 i = 0; i < count; ++i) {
+        // 无分支：先写，再按条件前移
+        selection[n] = i;
+        n += (values[i] >= lo) & (values[i] < hi);
+    }
+    return n;
+}
+
+static void aggregateScalar(const quint64 *values, const qint64 *ret, const quint32 *selection, quint32 count,
+                            Aggregate &out)
+{
+    Aggregate a;
+    for (quint32 r = 0; r < count; ++r) {
+        quint32 i = selection ? selection[r] : r;
+        quint64 v = values[i];
+        a.sum += v;
+        a.min = v < a.min ? v : a.min;
+        a.max = v > a.max ? v : a.max;
+        a.errors += isErrorReturn(ret[i]);
+    }
+    a.count = count;
+    out.merge(a);
+}
+
+static void aggregateByKeyScalar(const qint16 *keys, const quint64 *values, const qint64 *ret,
+                                 const quint32 *selection, quint32 count, Aggregate *out)
+{
+    for (quint32 r = 0; r < count; ++r) {
+        quint32 i = selection ? selection[r] : r;
+        int k = keys[i];
+        if (k < 0 || k >= kMaxKeys)
+            continue;
+        Aggregate &a = out[k];
+        quint64 v = values[i];
+        a.count++;
+        a.sum += v;
+        a.min = v < a.min ? v : a.min;
+        a.max = v > a.max ? v : a.max;
+        a.errors += isErrorReturn(ret[i]);
+    }
+}
+
+static void latencyBucketsScalar(const quint64 *values, const quint32 *selection, quint32 count, quint16 *buckets)
+{
+    for (quint32 r = 0; r < count; ++r)
+        buckets[r] = quint16(LatencyHistogram::bucketOf(values[selection ? selection[r] : r]));
+}
+
+static inline int log2Bucket(quint64 v)
+{
+    return v == 0 ? 0 : 64 - __builtin_clzll(v);
+}
+
+static void log2HistogramScalar(const quint64 *values, const quint32 *selection, quint32 count, quint64 *counts)
+{
+    for (quint32 r = 0; r < count; ++r)
+        counts[log2Bucket(values[selection ? selection[r] : r])]++;
+}
+
+// ---------------- AVX2 实现 ----------------
+#ifdef COLUMNKERNELS_AVX2
+
+// 64 位无符号比较：两边都翻转符号位后用有符号比较
+static const long long kSignBit = (long long)0x8000000000000000ULL;
+
+// selectRange 的左压缩表：8 位掩码 -> 被选中的 lane 号依次排在前面
+struct PackTable {
+    alignas(32) quint32 lanes[256][8];
+    PackTable() {
+        for (int m = 0; m < 256; ++m) {
+            int k = 0;
+            for (int b = 0; b < 8; ++b) {
+                if (m & (1 << b))
+                    lanes[m][k++] = quint32(b);
+            }
+            for (; k < 8; ++k)
+                lanes[m][k] = 0;
+        }
+    }
+};
+static const PackTable kPackTable;
+
+AVX2_TARGET static inline __m256i load4(const quint64 *values, const quint32 *selection, quint32 r)
+{
+    if (selection)
+        return _mm256_i32gather_epi64(reinterpret_cast<const long long*>(values),
+                                      _mm_loadu_si128(reinterpret_cast<const __m128i*>(selection + r)), 8);
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + r));
+}
+
+AVX2_TARGET static inline __m256i load4(const qint64 *values, const quint32 *selection, quint32 r)
+{
+    return load4(reinterpret_cast<const quint64*>(values), selection, r);
+}
+
+// ret 是 -errno（-4095..-1）的 lane 全 1
+AVX2_TARGET static inline __m256i errorMask(__m256i ret)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi64(ret, _mm256_set1_epi64x(-4096)),
+                            _mm256_cmpgt_epi64(_mm256_setzero_si256(), ret));
+}
+
+AVX2_TARGET static quint32 selectRangeAvx2(const quint64 *values, quint32 count, quint64 lo, quint64 hi,
+                                           quint32 *selection)
+{
+    const __m256i sign = _mm256_set1_epi64x(kSignBit);
+    const __m256i vlo = _mm256_set1_epi64x((long long)(lo ^ 0x8000000000000000ULL));
+    const __m256i vhi = _mm256_set1_epi64x((long long)(hi ^ 0x8000000000000000ULL));
+    quint32 n = 0;
+    quint32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), sign);
+        __m256i b = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 4)), sign);
+        __m256i inA = _mm256_andnot_si256(_mm256_cmpgt_epi64(vlo, a), _mm256_cmpgt_epi64(vhi, a));
+        __m256i inB = _mm256_andnot_si256(_mm256_cmpgt_epi64(vlo, b), _mm256_cmpgt_epi64(vhi, b));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(inA)) | (_mm256_movemask_pd(_mm256_castsi256_pd(inB)) << 4);
+        // 8 个行号一起写出，n <= i，最多写到 selection[i + 7]，不会越界
+        __m256i rows = _mm256_add_epi32(_mm256_set1_epi32(int(i)),
+                                        _mm256_load_si256(reinterpret_cast<const __m256i*>(kPackTable.lanes[mask])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(selection + n), rows);
+        n += quint32(__builtin_popcount(unsigned(mask)));
+    }
+    for (; i < count; ++i) {
+        selection[n] = i;
+        n += (values[i] >= lo) & (values[i] < hi);
+    }
+    return n;
+}
+
+AVX2_TARGET static void aggregateAvx2(const quint64 *values, const qint64 *ret, const quint32 *selection,
+                                      quint32 count, Aggregate &out)
+{
+    const __m256i sign = _mm256_set1_epi64x(kSignBit);
+    __m256i sum = _mm256_setzero_si256();
+    __m256i errors = _mm256_setzero_si256();
+    // min/max 在翻转符号位后的有符号域里比较
+    __m256i min = _mm256_set1_epi64x((long long)(~0ULL ^ 0x8000000000000000ULL));
+    __m256i max = sign;
+    quint32 r = 0;
+    for (; r + 4 <= count; r += 4) {
+        __m256i v = load4(values, selection, r);
+        sum = _mm256_add_epi64(sum, v);
+        __m256i f = _mm256_xor_si256(v, sign);
+        min = _mm256_blendv_epi8(min, f, _mm256_cmpgt_epi64(min, f));
+        max = _mm256_blendv_epi8(max, f, _mm256_cmpgt_epi64(f, max));
+        errors = _mm256_sub_epi64(errors, errorMask(load4(ret, selection, r)));
+    }
+
+    alignas(32) quint64 s[4], lo[4], hi[4], e[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(s), sum);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lo), _mm256_xor_si256(min, sign));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(hi), _mm256_xor_si256(max, sign));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(e), errors);
+    Aggregate a;
+    for (int j = 0; j < 4; ++j) {
+        a.sum += s[j];
+        a.min = lo[j] < a.min ? lo[j] : a.min;
+        a.max = hi[j] > a.max ? hi[j] : a.max;
+        a.errors += e[j];
+    }
+    a.count = r;
+    out.merge(a);
+    if (r < count) {
+        if (selection)
+            aggregateScalar(values, ret, selection + r, count - r, out);
+        else
+            aggregateScalar(values + r, ret + r, nullptr, count - r, out);
+    }
+}
+
+// 小于 2^52 的值可以精确转换成 double，对数类内核直接读指数位；
+// 4 个值中有 >= 2^52 的返回 true，这一组改走标量
+AVX2_TARGET static inline bool anyInexact(__m256i v)
+{
+    __m256i high = _mm256_srli_epi64(v, 52);
+    return !_mm256_testz_si256(high, high);
+}
+
+// v | 0x433... 当作 double 再减 2^52，得到与 v 相等的 double，指数位即 floor(log2 v)
+AVX2_TARGET static inline __m256i exactDoubleBits(__m256i v)
+{
+    const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+    const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+    return _mm256_castpd_si256(_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(v, magic)), two52));
+}
+
+AVX2_TARGET static void latencyBucketsAvx2(const quint64 *values, const quint32 *selection, quint32 count,
+                                           quint16 *buckets)
+{
+    static_assert(LatencyHistogram::kLinear == 16 && LatencyHistogram::kSubBits == 3,
+                  "latencyBucketsAvx2 hard-codes the LatencyHistogram layout");
+    // 指数位与尾数最高 3 位连在一起正好是 (1023 + e) * 8 + sub
+    const __m256i offset = _mm256_set1_epi64x(((1023 + 4) << 3) - LatencyHistogram::kLinear);
+    const __m256i pick = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    quint32 r = 0;
+    for (; r + 4 <= count; r += 4) {
+        __m256i v = load4(values, selection, r);
+        if (anyInexact(v)) {
+            for (int j = 0; j < 4; ++j)
+                buckets[r + j] = quint16(LatencyHistogram::bucketOf(values[selection ? selection[r + j] : r + j]));
+            continue;
+        }
+        __m256i b = _mm256_sub_epi64(_mm256_srli_epi64(exactDoubleBits(v), 49), offset);
+        __m256i small = _mm256_cmpeq_epi64(_mm256_srli_epi64(v, 4), _mm256_setzero_si256());
+        b = _mm256_blendv_epi8(b, v, small);
+        __m128i low = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(b, pick));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(buckets + r), _mm_packus_epi32(low, low));
+    }
+    for (; r < count; ++r)
+        buckets[r] = quint16(LatencyHistogram::bucketOf(values[selection ? selection[r] : r]));
+}
+
+AVX2_TARGET static void log2HistogramAvx2(const quint64 *values, const quint32 *selection, quint32 count,
+                                          quint64 *counts)
+{
+    // 桶号在寄存器里算好直接取出来累加，不经过内存中转；多份私有计数表实测没有收益
+    const __m256i bias = _mm256_set1_epi64x(1022);
+    quint32 r = 0;
+    for (; r + 4 <= count; r += 4) {
+        __m256i v = load4(values, selection, r);
+        if (anyInexact(v)) {
+            for (int j = 0; j < 4; ++j)
+                counts[log2Bucket(values[selection ? selection[r + j] : r + j])]++;
+            continue;
+        }
+        __m256i e = _mm256_sub_epi64(_mm256_srli_epi64(exactDoubleBits(v), 52), bias);
+        e = _mm256_andnot_si256(_mm256_cmpeq_epi64(v, _mm256_setzero_si256()), e);
+        __m128i lo = _mm256_castsi256_si128(e);
+        __m128i hi = _mm256_extracti128_si256(e, 1);
+        counts[_mm_cvtsi128_si64(lo)]++;
+        counts[_mm_extract_epi64(lo, 1)]++;
+        counts[_mm_cvtsi128_si64(hi)]++;
+        counts[_mm_extract_epi64(hi, 1)]++;
+    }
+    for (; r < count; ++r)
+        counts[log2Bucket(values[selection ? selection[r] : r])]++;
+}
+
+#endif // COLUMNKERNELS_AVX2
+
+// ---------------- 分派 ----------------
+
+Isa detectedIsa()
+{
+#ifdef COLUMNKERNELS_AVX2
+    static const Isa detected = __builtin_cpu_supports("avx2") ? Avx2 : Scalar;
+    return detected;
+#else
+    return Scalar;
+#endif
+}
+
+static std::atomic<int> s_active{-1};
+
+Isa activeIsa()
+{
+    int isa = s_active.load(std::memory_order_relaxed);
+    if (isa < 0) {
+        isa = detectedIsa();
+        s_active.store(isa, std::memory_order_relaxed);
+    }
+    return Isa(isa);
+}
+
+void setIsa(Isa isa)
+{
+    s_active.store(isa <= detectedIsa() ? isa : detectedIsa(), std::memory_order_relaxed);
+}
+
+const char* isaName(Isa isa)
+{
+    return isa == Avx2 ? "avx2" : "scalar";
+}
+
+quint32 selectRange(const quint64 *values, quint32 count, quint64 lo, quint64 hi, quint32 *selection)
+{
+#ifdef COLUMNKERNELS_AVX2
+    if (activeIsa() == Avx2)
+        return selectRangeAvx2(values, count, lo, hi, selection);
+#endif
+    return selectRangeScalar(values, count, lo, hi, selection);
+}
+
+void aggregate(const quint64 *values, const qint64 *ret, const quint32 *selection, quint32 count, Aggregate &out)
+{
+#ifdef COLUMNKERNELS_AVX2
+    if (activeIsa() == Avx2)
+        return aggregateAvx2(values, ret, selection, count, out);
+#endif
+    aggregateScalar(values, ret, selection, count, out);
+}
+
+void aggregateByKey(const qint16 *keys, const quint64 *values, const qint64 *ret,
+                    const quint32 *selection, quint32 count, Aggregate *out)
+{
+    // 分组累加的瓶颈是按 key 的随机读-改-写。试过 AVX2 下几行分给几份私有表、
+    // 以及把一个 key 的五个累加值合成一次 256 位更新，实测都不比标量快，两种 ISA 共用标量实现
+    aggregateByKeyScalar(keys, values, ret, selection, count, out);
+}
+
+void latencyBuckets(const quint64 *values, const quint32 *selection, quint32 count, quint16 *buckets)
+{
+#ifdef COLUMNKERNELS_AVX2
+    if (activeIsa() == Avx2)
+        return latencyBucketsAvx2(values, selection, count, buckets);
+#endif
+    latencyBucketsScalar(values, selection, count, buckets);
+}
+
+void log2Histogram(const quint64 *values, const quint32 *selection, quint32 count, quint64 *counts)
+{
+#ifdef COLUMNKERNELS_AVX2
+    if (activeIsa() == Avx2)
+        return log2HistogramAvx2(values, selection, count, counts);
+#endif
+    log2HistogramScalar(values, selection, count, counts);
+}
+
+} // namespace columnkernels
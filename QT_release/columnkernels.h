@@ -0,0 +1,58 @@
+#ifndef COLUMNKERNELS_H
+#define COLUMNKERNELS_H
+
+#include <QtGlobal>
+
+// 离线分析用的列扫描内核：范围筛选、count/sum/min/max（整体或按 key）、延迟直方图分桶。
+// 除 aggregateByKey 外都有标量实现和 AVX2 实现，第一次调用时按 CPU 能力选择，结果完全相同。
+// SyscallMonitor --bench-kernels 输出各内核两种实现的吞吐量。
+//
+// 约定：selection 为 nullptr 时处理第 0..count-1 行；否则处理 selection[0..count-1] 指定的行。
+namespace columnkernels {
+
+enum Isa { Scalar, Avx2 };
+
+// 本机支持的最好指令集
+Isa detectedIsa();
+// 当前使用的指令集；setIsa 只能选本机支持的（基准测试时用来对比标量实现）
+Isa activeIsa();
+void setIsa(Isa isa);
+const char* isaName(Isa isa);
+
+constexpr int kMaxKeys = 512; // 按 key 聚合时 key 的范围 [0, kMaxKeys)，超出范围的行不计入
+
+struct Aggregate {
+    quint64 count = 0;
+    quint64 sum = 0;
+    quint64 min = ~0ULL;
+    quint64 max = 0;
+    quint64 errors = 0;   // ret 是 -errno 的行数
+
+    void merge(const Aggregate &other) {
+        count += other.count;
+        sum += other.sum;
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+        errors += other.errors;
+    }
+};
+
+// values[i] 在 [lo, hi) 内的行号依次写入 selection（至少 count 个位置），返回行数
+quint32 selectRange(const quint64 *values, quint32 count, quint64 lo, quint64 hi, quint32 *selection);
+
+// values 的 count/sum/min/max 与 ret 的失败次数，累加到 out
+void aggregate(const quint64 *values, const qint64 *ret, const quint32 *selection, quint32 count, Aggregate &out);
+
+// 按 keys 分组累加到 out[0..kMaxKeys)；受随机写限制，只有标量实现
+void aggregateByKey(const qint16 *keys, const quint64 *values, const qint64 *ret,
+                    const quint32 *selection, quint32 count, Aggregate *out);
+
+// 每行的 LatencyHistogram 桶号，buckets[r] 对应第 r 个被处理的行
+void latencyBuckets(const quint64 *values, const quint32 *selection, quint32 count, quint16 *buckets);
+
+// 以 2 为底的对数直方图累加到 counts[65]：counts[0] 是 0，counts[e + 1] 是 [2^e, 2^(e+1))
+void log2Histogram(const quint64 *values, const quint32 *selection, quint32 count, quint64 *counts);
+
+} // namespace columnkernels
+
+#endif // COLUMNKERNELS_H
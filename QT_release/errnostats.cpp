@@ -0,0 +1,111 @@
+#include "errnostats.h"
+#include <string.h> // strerrorname_np
+
+void ErrnoStats::clear()
+{
+    m_entries.clear();
+    m_calls.clear();
+    m_retry.clear();
+    m_dirty.clear();
+}
+
+void ErrnoStats::record(long syscall, long ret, unsigned int tid, quint64 ts)
+{
+    m_calls[syscall]++;
+
+    int err = errnoFromRet(ret);
+    RetryState &rs = m_retry[tid];
+
+    if (err == 0) {
+        // 成功的调用打断该线程上的连续失败
+        rs.streak = 0;
+        rs.reported = false;
+        return;
+    }
+
+    quint64 key = makeKey(syscall, err);
+    Entry &e = m_entries[key];
+    if (e.count == 0) {
+        e.syscall = syscall;
+        e.err = err;
+    }
+    e.count++;
+    e.lastTs = ts;
+    m_dirty.insert(key);
+
+    // --- 重试循环检测 ---
+    bool sameFailure = rs.syscall == syscall && rs.err == err
+                       && ts >= rs.lastTs && ts - rs.lastTs <= kRetryWindowNs;
+    if (sameFailure) {
+        rs.streak++;
+    } else {
+        rs.syscall = syscall;
+        rs.err = err;
+        rs.streak = 1;
+        rs.reported = false;
+    }
+    rs.lastTs = ts;
+
+    if (rs.streak > e.maxStreak)
+        e.maxStreak = rs.streak;
+    if (rs.streak >= kRetryThreshold && !rs.reported) {
+        // 一个循环只记一次，直到被成功调用或其他失败打断
+        e.retryLoops++;
+        rs.reported = true;
+    }
+}
+
+QList<quint64> ErrnoStats::tick(double elapsedSec)
+{
+    // 上个周期有计数的条目即使本周期没变化也要把速率刷新为 0
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        Entry &e = it.value();
+        quint64 delta = e.count - e.countAtLastTick;
+        double rate = elapsedSec > 0 ? delta / elapsedSec : 0.0;
+        if (rate != e.ratePerSec)
+            m_dirty.insert(it.key());
+        e.ratePerSec = rate;
+        e.countAtLastTick = e.count;
+    }
+
+    QList<quint64> changed = m_dirty.values();
+    m_dirty.clear();
+    return changed;
+}
+
+const ErrnoStats::Entry* ErrnoStats::entry(quint64 key) const
+{
+    auto it = m_entries.constFind(key);
+    return it == m_entries.constEnd() ? nullptr : &it.value();
+}
+
+QString ErrnoStats::errnoName(int err)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 32))
+    if (const char *name = strerrorname_np(err))
+        return QString::fromLatin1(name);
+#endif
+    return QString("E%1").arg(err);
+}
+
+int ErrnoStats::errnoFromName(const QString &name)
+{
+    bool isNumber;
+    int err = name.toInt(&isNumber);
+    if (isNumber)
+        return (err > 0 && err <= 4095) ? err : 0;
+    // errno 的取值都很小，逐个比较名字即可
+    for (err = 1; err < 256; ++err) {
+        if (errnoName(err).compare(name.trimmed(), Qt::CaseInsensitive) == 0)
+            return err;
+    }
+    return 0;
+}
+
+QString ErrnoStats::formatReturn(long ret)
+{
+    int err = errnoFromRet(ret);
+    if (err == 0)
+        return QString::number(ret);
+    return QString("-1 %1").arg(errnoName(err));
+}
@@ -0,0 +1,67 @@
+#ifndef ERRNOSTATS_H
+#define ERRNOSTATS_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+// 把系统调用返回值归类为 errno，按 (syscall, errno) 统计失败次数和速率，
+// 并检测同一线程上同一 syscall 反复以同一 errno 失败的“重试循环”（EAGAIN 自旋、EINTR 重试等）
+class ErrnoStats
+{
+public:
+    struct Entry {
+        long syscall = -1;
+        int err = 0;
+        quint64 count = 0;
+        quint64 countAtLastTick = 0; // 上一次 tick() 时的计数，用于计算速率
+        double ratePerSec = 0.0;
+        quint64 retryLoops = 0;      // 检测到的重试循环次数
+        quint64 maxStreak = 0;       // 最长连续失败次数
+        quint64 lastTs = 0;
+    };
+
+    // 同一 TID 上两次失败间隔不超过该窗口才算连续
+    static constexpr quint64 kRetryWindowNs = 100 * 1000 * 1000ULL; // 100 ms
+    // 连续失败达到该次数记为一次重试循环
+    static constexpr quint64 kRetryThreshold = 8;
+
+    void clear();
+
+    // 每个事件调用一次；ret 在 [-4095, -1] 内视为失败
+    void record(long syscall, long ret, unsigned int tid, quint64 ts);
+
+    // 每秒调用一次：刷新速率，返回自上次以来发生变化的条目 key
+    QList<quint64> tick(double elapsedSec);
+
+    const Entry* entry(quint64 key) const;
+    quint64 callsFor(long syscall) const { return m_calls.value(syscall, 0); }
+
+    // 错误返回值 -> errno，成功返回 0
+    static int errnoFromRet(long ret) { return (ret < 0 && ret >= -4095) ? int(-ret) : 0; }
+    // 例如 2 -> "ENOENT"
+    static QString errnoName(int err);
+    // 例如 "ENOENT" -> 2，也接受数字；无法识别返回 0
+    static int errnoFromName(const QString &name);
+    // 例如 -2 -> "-1 ENOENT"，成功时原样输出数字
+    static QString formatReturn(long ret);
+
+private:
+    static quint64 makeKey(long syscall, int err) { return (quint64(quint32(syscall)) << 16) | quint16(err); }
+
+    struct RetryState {
+        long syscall = -1;
+        int err = 0;
+        quint64 streak = 0;
+        quint64 lastTs = 0;
+        bool reported = false;
+    };
+
+    QHash<quint64, Entry> m_entries;
+    QHash<long, quint64> m_calls;          // 每个 syscall 的总调用次数，用于计算失败比例
+    QHash<unsigned int, RetryState> m_retry;
+    QSet<quint64> m_dirty;                 // 本周期内有变化的 key
+};
+
+#endif // ERRNOSTATS_H
@@ -0,0 +1,56 @@
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include "syscallevent.h"
+
+// 追踪线程 -> GUI 线程的单生产者单消费者环形队列。
+// 容量固定、预先分配，push/pop 都不加锁也不分配内存；队列满时 push 返回 false，
+// 由调用方计入丢弃计数。GUI 用定时器批量 pop，取代每个事件一次的跨线程信号。
+class EventQueue
+{
+public:
+    explicit EventQueue(size_t capacityPow2 = 1 << 18)
+        : m_buffer(capacityPow2), m_mask(capacityPow2 - 1) {}
+
+    // 只能由生产者（追踪线程）调用
+    bool push(const SyscallEvent &e) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == m_buffer.size()) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == m_buffer.size())
+                return false;
+        }
+        m_buffer[tail & m_mask] = e;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 只能由消费者（GUI 线程）调用，返回实际取出的条数
+    size_t pop(SyscallEvent *out, size_t max) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t n = tail - head;
+        if (n > max)
+            n = max;
+        for (size_t i = 0; i < n; ++i)
+            out[i] = m_buffer[(head + i) & m_mask];
+        m_head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t size() const {
+        return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_relaxed);
+    }
+    size_t capacity() const { return m_buffer.size(); }
+
+private:
+    std::vector<SyscallEvent> m_buffer;
+    const size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    size_t m_cachedHead = 0; // 生产者缓存的 head，减少对共享缓存行的读取
+};
+
+#endif // EVENTQUEUE_H
@@ -0,0 +1,131 @@
+#include "eventstore.h"
+
+#include <string.h>
+
+// ---------------- Arena ----------------
+
+Arena::Arena()
+{
+    for (auto &chunk : m_chunks)
+        chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+Arena::~Arena()
+{
+    quint32 count = m_chunkCount.load(std::memory_order_relaxed);
+    for (quint32 i = 0; i < count; ++i)
+        delete[] m_chunks[i].load(std::memory_order_relaxed);
+}
+
+quint32 Arena::allocate(quint32 size, char **out)
+{
+    // 8 字节对齐，保证放进来的结构体可以直接按指针访问
+    quint32 aligned = (size + 7u) & ~7u;
+    if (aligned == 0 || aligned > kChunkSize - 8)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    quint32 count = m_chunkCount.load(std::memory_order_relaxed);
+    if (m_used + aligned > kChunkSize) {
+        if (count == kMaxChunks)
+            return 0;
+        m_chunks[count].store(new char[kChunkSize], std::memory_order_release);
+        m_chunkCount.store(++count, std::memory_order_relaxed);
+        // 第 0 块跳过开头 8 字节，使引用 0 可以表示“空”
+        m_used = (count == 1) ? 8 : 0;
+    }
+
+    quint32 chunk = count - 1;
+    quint32 ref = (chunk << kChunkBits) | m_used;
+    *out = m_chunks[chunk].load(std::memory_order_relaxed) + m_used;
+    m_used += aligned;
+    return ref;
+}
+
+quint32 Arena::append(const void *data, quint32 size)
+{
+    char *dst = nullptr;
+    quint32 ref = allocate(size, &dst);
+    if (ref != 0)
+        memcpy(dst, data, size);
+    return ref;
+}
+
+// ---------------- StringTable ----------------
+
+StringTable::StringTable(Arena &arena)
+    : m_arena(arena)
+{
+    m_refs.push_back(0); // id 0：空字符串
+}
+
+quint32 StringTable::intern(std::string_view s)
+{
+    if (s.empty())
+        return 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(s);
+    if (it != m_index.end())
+        return it->second;
+
+    // 布局：[u32 长度][字节][\0]，索引中的 key 直接指向 Arena 里的这份拷贝
+    char *dst = nullptr;
+    quint32 ref = m_arena.allocate(quint32(sizeof(quint32) + s.size() + 1), &dst);
+    if (ref == 0)
+        return 0;
+    quint32 len = quint32(s.size());
+    memcpy(dst, &len, sizeof(len));
+    memcpy(dst + sizeof(len), s.data(), s.size());
+    dst[sizeof(len) + s.size()] = '\0';
+
+    quint32 id = quint32(m_refs.size());
+    m_refs.push_back(ref);
+    m_index.emplace(std::string_view(dst + sizeof(len), s.size()), id);
+    return id;
+}
+
+std::string_view StringTable::view(quint32 id) const
+{
+    quint32 ref;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (id == 0 || id >= m_refs.size())
+            return std::string_view();
+        ref = m_refs[id];
+    }
+    const char *p = m_arena.at(ref);
+    quint32 len;
+    memcpy(&len, p, sizeof(len));
+    return std::string_view(p + sizeof(len), len);
+}
+
+quint32 StringTable::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return quint32(m_refs.size());
+}
+
+// ---------------- EventStore ----------------
+
+EventStore::EventStore()
+    : m_strings(m_arena)
+{
+}
+
+void EventStore::append(const SyscallEvent &e)
+{
+    if (m_size % kBlockEvents == 0 && m_size / kBlockEvents == m_blocks.size()) {
+        m_blocks.emplace_back(new SyscallEvent[kBlockEvents]);
+        m_summaries.emplace_back();
+    }
+    m_blocks[m_size / kBlockEvents][m_size % kBlockEvents] = e;
+    m_summaries[m_size / kBlockEvents].add(e);
+    m_size++;
+}
+
+quint64 EventStore::memoryBytes() const
+{
+    return quint64(m_blocks.size()) * (kBlockEvents * sizeof(SyscallEvent) + sizeof(ChunkSummary))
+           + m_arena.bytesReserved();
+}
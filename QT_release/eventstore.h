@@ -0,0 +1,108 @@
+#ifndef EVENTSTORE_H
+#define EVENTSTORE_H
+
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "syscallevent.h"
+#include "chunksummary.h"
+
+// 会话级的字节分配器：按 1 MB 的块追加分配，块一旦分配就不再移动也不单独释放，
+// 随会话一起销毁。分配结果用 32 位引用表示（块号 << 20 | 块内偏移），0 为空引用。
+// 追加可以在追踪线程进行；已发布的数据可以在任意线程无锁读取。
+class Arena
+{
+public:
+    static constexpr quint32 kChunkBits = 20;
+    static constexpr quint32 kChunkSize = 1u << kChunkBits;
+    static constexpr quint32 kMaxChunks = 4096; // 最多 4 GB
+
+    Arena();
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // 分配 size 字节，返回引用；空间耗尽或 size 超过一个块时返回 0
+    quint32 allocate(quint32 size, char **out);
+    quint32 append(const void *data, quint32 size);
+
+    const char* at(quint32 ref) const {
+        return m_chunks[ref >> kChunkBits].load(std::memory_order_acquire) + (ref & (kChunkSize - 1));
+    }
+    quint64 bytesReserved() const { return quint64(m_chunkCount.load(std::memory_order_relaxed)) * kChunkSize; }
+
+private:
+    std::mutex m_mutex;
+    std::atomic<char*> m_chunks[kMaxChunks];
+    std::atomic<quint32> m_chunkCount{0};
+    quint32 m_used = kChunkSize; // 当前块已用字节，初始值让第一次分配时新建块
+};
+
+// 字符串驻留表：同样的进程名、路径只在 Arena 中保存一份，之后用 32 位 id 引用。
+// id 0 固定为空字符串。intern() 与 view() 都是线程安全的。
+class StringTable
+{
+public:
+    explicit StringTable(Arena &arena);
+
+    quint32 intern(std::string_view s);
+    quint32 intern(const QString &s) {
+        QByteArray utf8 = s.toUtf8();
+        return intern(std::string_view(utf8.constData(), size_t(utf8.size())));
+    }
+
+    // 返回的视图指向 Arena，在会话结束前一直有效
+    std::string_view view(quint32 id) const;
+    QString string(quint32 id) const {
+        std::string_view v = view(id);
+        return QString::fromUtf8(v.data(), int(v.size()));
+    }
+    quint32 size() const;
+
+private:
+    Arena &m_arena;
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string_view, quint32> m_index;
+    std::vector<quint32> m_refs; // id -> Arena 引用
+};
+
+// 一次追踪会话的全部事件。事件记录按 64K 条一块分配，追加时不会搬移已有记录。
+// 只在 GUI 线程追加和读取；StringTable/Arena 与追踪线程共享。
+class EventStore
+{
+public:
+    static constexpr quint64 kBlockEvents = 1 << 16;
+
+    EventStore();
+
+    Arena& arena() { return m_arena; }
+    StringTable& strings() { return m_strings; }
+    const Arena& arena() const { return m_arena; }
+    const StringTable& strings() const { return m_strings; }
+
+    void append(const SyscallEvent &e);
+    quint64 size() const { return m_size; }
+    const SyscallEvent& at(quint64 index) const {
+        return m_blocks[index / kBlockEvents][index % kBlockEvents];
+    }
+
+    // 每个事件块一份摘要，过滤时据此整块跳过；最后一块的摘要随追加更新
+    size_t blockCount() const { return m_summaries.size(); }
+    const ChunkSummary& blockSummary(size_t block) const { return m_summaries[block]; }
+
+    // 事件块与 Arena 实际占用的内存
+    quint64 memoryBytes() const;
+
+private:
+    Arena m_arena;
+    StringTable m_strings;
+    std::vector<std::unique_ptr<SyscallEvent[]>> m_blocks;
+    std::vector<ChunkSummary> m_summaries;
+    quint64 m_size = 0;
+};
+
+#endif // EVENTSTORE_H
@@ -0,0 +1,111 @@
+#include "eventtablemodel.h"
+#include "mainwindow.h"
+#include "errnostats.h"
+#include "syscall_map.h"
+
+#include <limits>
+
+EventTableModel::EventTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+void EventTableModel::setStore(const EventStore *store)
+{
+    beginResetModel();
+    m_store = store;
+    m_rows = 0;
+    m_matches.clear();
+    m_scanned = 0;
+    if (m_filter)
+        m_filter->resetPathCache();
+    endResetModel();
+    syncRows();
+}
+
+void EventTableModel::setFilter(std::unique_ptr<TraceQuery> filter)
+{
+    beginResetModel();
+    m_filter = std::move(filter);
+    m_rows = 0;
+    m_matches.clear();
+    m_scanned = 0;
+    endResetModel();
+    syncRows();
+}
+
+void EventTableModel::scanFiltered()
+{
+    const quint64 end = m_store->size();
+    const TraceQuery::PathLookup paths = [this](quint32 id) { return m_store->strings().view(id); };
+    while (m_scanned < end) {
+        size_t block = size_t(m_scanned / EventStore::kBlockEvents);
+        quint64 blockEnd = qMin<quint64>((block + 1) * EventStore::kBlockEvents, end);
+        // 摘要覆盖这一块目前已有的全部事件，不可能匹配时直接跳到块尾
+        if (m_filter->mayMatch(m_store->blockSummary(block))) {
+            for (quint64 i = m_scanned; i < blockEnd; ++i) {
+                if (m_filter->matches(m_store->at(i), paths))
+                    m_matches.push_back(i);
+            }
+        }
+        m_scanned = blockEnd;
+    }
+}
+
+void EventTableModel::syncRows()
+{
+    if (!m_store)
+        return;
+    quint64 available = m_store->size();
+    if (m_filter) {
+        scanFiltered();
+        available = m_matches.size();
+    }
+    // QAbstractItemModel 的行号是 int，超过上限的事件仍保存在 EventStore 中，只是不再显示
+    int target = int(qMin<quint64>(available, std::numeric_limits<int>::max()));
+    if (target <= m_rows)
+        return;
+    beginInsertRows(QModelIndex(), m_rows, target - 1);
+    m_rows = target;
+    endInsertRows();
+}
+
+int EventTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows;
+}
+
+int EventTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant EventTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!m_store || !index.isValid() || role != Qt::DisplayRole)
+        return QVariant();
+
+    const SyscallEvent &e = m_store->at(storeIndex(index.row()));
+    switch (index.column()) {
+        case PidColumn: return e.tid;
+        case ProcessColumn: return m_store->strings().string(e.commId);
+        case NumberColumn: return e.syscall;
+        case NameColumn: return getSyscallName(e.syscall);
+        case ReturnColumn: return ErrnoStats::formatReturn(e.ret);
+        case DurationColumn: return formatDuration(qint64(e.duration));
+        case PathColumn: return e.pathId ? m_store->strings().string(e.pathId) : QString();
+        default: return QVariant();
+    }
+}
+
+QVariant EventTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+    if (orientation == Qt::Vertical)
+        return (m_store && section < m_rows) ? QVariant(storeIndex(section) + 1) : QVariant(section + 1);
+    static const char *const kHeaders[ColumnCount] = {
+        "PID", "Process", "Syscall Number", "Syscall Name", "Return Value", "Duration", "Path"
+    };
+    return (section >= 0 && section < ColumnCount) ? QString(kHeaders[section]) : QVariant();
+}
@@ -0,0 +1,45 @@
+#ifndef EVENTTABLEMODEL_H
+#define EVENTTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <memory>
+#include <vector>
+#include "eventstore.h"
+#include "tracequery.h"
+
+// 系统调用表格的数据模型：直接读取 EventStore，不为每行创建 QTableWidgetItem。
+// 单元格文本只在视图需要绘制时才格式化，所以只有可见行才有开销。
+class EventTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Column { PidColumn, ProcessColumn, NumberColumn, NameColumn, ReturnColumn, DurationColumn, PathColumn, ColumnCount };
+
+    explicit EventTableModel(QObject *parent = nullptr);
+
+    // 切换到新的会话（nullptr 表示清空）
+    void setStore(const EventStore *store);
+    // EventStore 追加事件之后调用，一次性通知视图插入了多少行
+    void syncRows();
+    // 只显示匹配的事件（nullptr 表示显示全部）；切换条件时从头重新筛选
+    void setFilter(std::unique_ptr<TraceQuery> filter);
+    bool isFiltered() const { return bool(m_filter); }
+    // 表格行号 -> EventStore 中的事件下标
+    quint64 storeIndex(int row) const { return m_filter ? m_matches[size_t(row)] : quint64(row); }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    void scanFiltered();
+
+    const EventStore *m_store = nullptr;
+    int m_rows = 0;
+    std::unique_ptr<TraceQuery> m_filter;
+    std::vector<quint64> m_matches; // 过滤时每一行对应的事件下标
+    quint64 m_scanned = 0;          // 已经筛选过的事件数
+};
+
+#endif // EVENTTABLEMODEL_H
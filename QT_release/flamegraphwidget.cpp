@@ -0,0 +1,152 @@
+#include "flamegraphwidget.h"
+#include "eventstore.h"
+#include "mainwindow.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <algorithm>
+
+FlameGraphWidget::FlameGraphWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    setMouseTracking(true);
+}
+
+void FlameGraphWidget::setTree(std::vector<CallTree::Node> nodes, const StringTable *strings)
+{
+    m_nodes = std::move(nodes);
+    m_strings = strings;
+    if (m_zoom >= m_nodes.size())
+        m_zoom = 0;
+    relayout();
+}
+
+void FlameGraphWidget::clear()
+{
+    m_nodes.clear();
+    m_strings = nullptr;
+    m_zoom = 0;
+    relayout();
+}
+
+QString FlameGraphWidget::frameName(quint32 node) const
+{
+    if (node == 0)
+        return "all";
+    return m_strings ? m_strings->string(m_nodes[node].frame) : QString();
+}
+
+void FlameGraphWidget::relayout()
+{
+    m_boxes.clear();
+    m_depth = 0;
+    if (!m_nodes.empty() && m_nodes[m_zoom].totalNs > 0)
+        place(m_zoom, 0.0, width(), 0);
+    // 行数超出可见高度时撑开控件，由外层的 QScrollArea 滚动
+    setMinimumHeight((m_depth + 1) * kRowHeight);
+    update();
+}
+
+void FlameGraphWidget::place(quint32 node, double x, double width, int depth)
+{
+    m_boxes.push_back({ QRectF(x, depth, width, 0), node }); // y 先记深度，绘制时再换算
+    m_depth = std::max(m_depth, depth);
+
+    // 子节点按名字排序，布局不随插入顺序变化
+    std::vector<quint32> children;
+    for (quint32 c = m_nodes[node].firstChild; c != 0; c = m_nodes[c].nextSibling)
+        children.push_back(c);
+    std::sort(children.begin(), children.end(), [this](quint32 a, quint32 b) {
+        return frameName(a) < frameName(b);
+    });
+
+    const double scale = width / double(m_nodes[node].totalNs);
+    for (quint32 c : children) {
+        double w = m_nodes[c].totalNs * scale;
+        // 不足半个像素的帧画不出来，连同子树一起跳过
+        if (w >= 0.5)
+            place(c, x, w, depth + 1);
+        x += w;
+    }
+}
+
+int FlameGraphWidget::boxAt(const QPointF &pos) const
+{
+    int depth = (height() - 1 - int(pos.y())) / kRowHeight;
+    for (size_t i = 0; i < m_boxes.size(); ++i) {
+        const QRectF &r = m_boxes[i].rect;
+        if (int(r.y()) == depth && pos.x() >= r.left() && pos.x() < r.right())
+            return int(i);
+    }
+    return -1;
+}
+
+void FlameGraphWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+    if (m_boxes.empty()) {
+        painter.setPen(palette().color(QPalette::PlaceholderText));
+        painter.drawText(rect(), Qt::AlignCenter, "No stacks captured. List syscalls above before starting a trace.");
+        return;
+    }
+
+    const QFontMetrics metrics = painter.fontMetrics();
+    for (const Box &box : m_boxes) {
+        QRectF r(box.rect.x(), height() - (box.rect.y() + 1) * kRowHeight, box.rect.width(), kRowHeight - 1);
+        const CallTree::Node &n = m_nodes[box.node];
+        QString name = frameName(box.node);
+        // 暖色系按名字散列；最内层的 syscall 用冷色，与用户态帧区分开
+        uint h = qHash(name);
+        QColor color = (n.firstChild == 0 && box.node != 0)
+                           ? QColor::fromHsv(200 + int(h % 30), 120, 230)
+                           : QColor::fromHsv(int(h % 50), 150 + int(h % 80), 235);
+        painter.fillRect(r, color);
+        if (r.width() > 30) {
+            painter.setPen(Qt::black);
+            painter.drawText(r.adjusted(3, 0, -3, 0), Qt::AlignVCenter | Qt::AlignLeft,
+                             metrics.elidedText(name, Qt::ElideRight, int(r.width()) - 6));
+        }
+    }
+}
+
+void FlameGraphWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    relayout();
+}
+
+void FlameGraphWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    int i = boxAt(event->pos());
+    if (i < 0) {
+        QToolTip::hideText();
+        return;
+    }
+    const CallTree::Node &n = m_nodes[m_boxes[i].node];
+    double percent = m_nodes[0].totalNs ? 100.0 * n.totalNs / m_nodes[0].totalNs : 0.0;
+    QToolTip::showText(event->globalPosition().toPoint(),
+                       QString("%1\nTotal: %2 (%3% of captured syscall time)\nSelf: %4\nCalls: %5")
+                           .arg(frameName(m_boxes[i].node))
+                           .arg(formatDuration(n.totalNs))
+                           .arg(percent, 0, 'f', 1)
+                           .arg(formatDuration(n.selfNs))
+                           .arg(n.calls),
+                       this);
+}
+
+void FlameGraphWidget::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::RightButton) {
+        m_zoom = 0;
+    } else {
+        int i = boxAt(event->pos());
+        if (i < 0)
+            return;
+        quint32 node = m_boxes[i].node;
+        m_zoom = (node == m_zoom) ? m_nodes[node].parent : node;
+    }
+    relayout();
+}
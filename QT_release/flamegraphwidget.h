@@ -0,0 +1,48 @@
+#ifndef FLAMEGRAPHWIDGET_H
+#define FLAMEGRAPHWIDGET_H
+
+#include <QWidget>
+#include <vector>
+#include "calltree.h"
+
+class StringTable;
+
+// 火焰图：横向宽度表示经过该调用路径的系统调用耗时，根在最下面，越往上调用越深。
+// 单击一个帧放大到该帧，单击最底下的帧退回上一层，右键回到全图。
+class FlameGraphWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    static constexpr int kRowHeight = 18;
+
+    explicit FlameGraphWidget(QWidget *parent = nullptr);
+
+    // nodes 来自 CallTree::snapshot()，帧名从 strings 中取
+    void setTree(std::vector<CallTree::Node> nodes, const StringTable *strings);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private:
+    struct Box {
+        QRectF rect;
+        quint32 node;
+    };
+
+    void relayout();
+    void place(quint32 node, double x, double width, int depth);
+    QString frameName(quint32 node) const;
+    int boxAt(const QPointF &pos) const;
+
+    std::vector<CallTree::Node> m_nodes;
+    const StringTable *m_strings = nullptr;
+    quint32 m_zoom = 0;            // 当前放大到的节点，画在最底下一行
+    int m_depth = 0;               // 当前布局的最大深度
+    std::vector<Box> m_boxes;
+};
+
+#endif // FLAMEGRAPHWIDGET_H
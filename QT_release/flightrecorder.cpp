@@ -0,0 +1,147 @@
+#include "flightrecorder.h"
+#include "tracefile.h"
+#include "errnostats.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <algorithm>
+
+// 平均速率至少积累这么多秒、当前这一秒至少有这么多调用，才判断是否突增
+static const int kRateWarmupSeconds = 3;
+static const quint64 kRateMinCalls = 200;
+// 写入线程按块拷贝环，拷贝期间被覆盖的槽位连同所在的块一起丢弃
+static const quint64 kCopyChunk = 4096;
+
+FlightRecorder::FlightRecorder(const Config &config, const StringTable *strings, DumpCallback done)
+    : m_config(config)
+    , m_strings(strings)
+    , m_done(std::move(done))
+    , m_capacity(std::max<quint64>(config.bufferBytes / sizeof(SyscallEvent), 1024))
+{
+    // 一次性分配并写一遍，让页面在追踪开始前就已经映射好
+    m_ring.reset(new SyscallEvent[m_capacity]());
+    m_writer = std::thread(&FlightRecorder::writerLoop, this);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    // 已经请求的转储仍然写完
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_stopping = true;
+    }
+    m_requestReady.notify_one();
+    m_writer.join();
+}
+
+const char* FlightRecorder::triggerName(Trigger reason)
+{
+    switch (reason) {
+    case LatencyTrigger: return "latency";
+    case ErrnoTrigger: return "errno";
+    case RateTrigger: return "rate";
+    case ManualTrigger: return "manual";
+    default: return "none";
+    }
+}
+
+FlightRecorder::Trigger FlightRecorder::record(const SyscallEvent &e)
+{
+    // 先占用槽位再写：写入线程拷贝后读到的 m_written 包括正在写的这一个
+    const quint64 index = m_written.load(std::memory_order_relaxed);
+    m_written.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_ring[index % m_capacity] = e;
+
+    // 按秒统计调用数，跨秒时更新平均速率
+    quint64 second = e.ts / 1000000000ULL;
+    if (second != m_second) {
+        if (m_second != 0) {
+            m_averageRate = m_secondsSeen == 0 ? double(m_secondCount) : 0.8 * m_averageRate + 0.2 * m_secondCount;
+            m_secondsSeen++;
+        }
+        m_second = second;
+        m_secondCount = 0;
+        m_rateFired = false;
+    }
+    m_secondCount++;
+
+    if (e.ts < m_quietUntil)
+        return NoTrigger;
+
+    Trigger reason = NoTrigger;
+    if (m_config.latencyNs != 0 && e.duration >= m_config.latencyNs)
+        reason = LatencyTrigger;
+    else if (m_config.err != 0 && ErrnoStats::errnoFromRet(e.ret) == m_config.err)
+        reason = ErrnoTrigger;
+    else if (m_config.rateSpike > 0 && !m_rateFired && m_secondsSeen >= kRateWarmupSeconds
+             && m_secondCount >= kRateMinCalls && m_secondCount > m_config.rateSpike * m_averageRate) {
+        reason = RateTrigger;
+        m_rateFired = true;
+    }
+    return reason;
+}
+
+void FlightRecorder::dump(Trigger reason, quint64 nowTs, pid_t pid)
+{
+    // 冷却一个窗口：紧接着的触发得到的内容几乎相同
+    m_quietUntil = nowTs + m_config.windowNs;
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_requests.push_back({ reason, nowTs, pid, m_written.load(std::memory_order_relaxed) });
+    }
+    m_requestReady.notify_one();
+}
+
+void FlightRecorder::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_requestMutex);
+    for (;;) {
+        m_requestReady.wait(lock, [this] { return m_stopping || !m_requests.empty(); });
+        if (m_requests.empty())
+            return;
+        const DumpRequest request = m_requests.front();
+        m_requests.pop_front();
+        lock.unlock();
+        writeDump(request);
+        lock.lock();
+    }
+}
+
+void FlightRecorder::writeDump(const DumpRequest &request)
+{
+    // 环内事件按出口顺序写入，ts 是入口时间：多线程、跟随子进程时互相交错，不能二分查找窗口起点，
+    // 从最老的事件起逐个按 ts 筛选，保持写入顺序。追踪线程同时还在写环：触发之后已被覆盖的先跳过，
+    // 拷完再看拷贝期间又覆盖到了哪里，丢掉那之前的块（窗口最老的一端可能因此短一点）
+    const quint64 from = request.nowTs > m_config.windowNs ? request.nowTs - m_config.windowNs : 0;
+    quint64 begin = request.end - std::min(request.end, m_capacity);
+    const quint64 claimed = m_written.load(std::memory_order_acquire);
+    if (claimed > m_capacity)
+        begin = std::max(begin, claimed - m_capacity);
+    std::vector<SyscallEvent> events;
+    std::vector<size_t> chunkStart; // 每块开始时已拷贝的事件数
+    for (quint64 i = begin; i < request.end; ++i) {
+        if ((i - begin) % kCopyChunk == 0)
+            chunkStart.push_back(events.size());
+        const SyscallEvent &e = m_ring[i % m_capacity];
+        if (e.ts >= from)
+            events.push_back(e);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const quint64 after = m_written.load(std::memory_order_relaxed);
+    if (after > m_capacity && after - m_capacity > begin) {
+        const size_t overwritten = size_t((after - m_capacity - begin + kCopyChunk - 1) / kCopyChunk);
+        const size_t drop = overwritten < chunkStart.size() ? chunkStart[overwritten] : events.size();
+        events.erase(events.begin(), events.begin() + qint64(drop));
+    }
+
+    QString name = QString("flight-%1-%2-%3.qtrace")
+                       .arg(request.pid)
+                       .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"))
+                       .arg(triggerName(request.reason));
+    QString path = QDir(m_config.directory.isEmpty() ? QDir::tempPath() : m_config.directory).filePath(name);
+    TraceWriter writer;
+    bool ok = writer.open(path) && writer.write(events.data(), events.size()) && writer.finish(*m_strings);
+    if (m_done)
+        m_done(path, triggerName(request.reason), events.size(), ok ? QString() : writer.errorString());
+}
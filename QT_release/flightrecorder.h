@@ -0,0 +1,88 @@
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "syscallevent.h"
+
+class StringTable;
+
+// 飞行记录器：追踪线程把事件写进一块预先分配好的环形缓冲区，只保留最近的一段；
+// 触发条件满足时把触发前 windowNs 内的事件写成 .qtrace 文件。
+// record() 在每个事件上只做几次比较；dump() 只把触发交给常驻的写入线程，从环里挑出窗口内的事件和写文件都在那里进行，
+// 追踪线程在停顿路径上既不拷贝环，也不等待写入线程。
+class FlightRecorder
+{
+public:
+    struct Config {
+        quint64 windowNs = 10ULL * 1000000000ULL;   // 保留触发前多长时间的事件
+        quint64 bufferBytes = 64ULL << 20;          // 环形缓冲区大小，决定最多保留多少事件
+        quint64 latencyNs = 0;                      // 单次调用耗时超过该值时触发，0 关闭
+        int err = 0;                                // 返回该 errno 时触发，0 关闭
+        double rateSpike = 0.0;                     // 每秒调用数超过近期平均的该倍数时触发，0 关闭
+        QString directory;                          // 输出目录
+    };
+
+    enum Trigger { NoTrigger, LatencyTrigger, ErrnoTrigger, RateTrigger, ManualTrigger };
+
+    // 后台写完一个文件后在写入线程中调用：文件路径、事件数、错误信息（成功时为空）
+    using DumpCallback = std::function<void(const QString &path, const QString &reason, quint64 events, const QString &error)>;
+
+    FlightRecorder(const Config &config, const StringTable *strings, DumpCallback done);
+    ~FlightRecorder();
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    // 每个事件调用一次，返回该事件满足的触发条件。上一次触发后的一个窗口内不再自动触发
+    Trigger record(const SyscallEvent &e);
+
+    // 请求把 [nowTs - windowNs, nowTs] 内的事件写成文件：记下此刻环的写入位置交给写入线程，立即返回
+    void dump(Trigger reason, quint64 nowTs, pid_t pid);
+
+    quint64 capacity() const { return m_capacity; }
+    static const char* triggerName(Trigger reason);
+
+private:
+    Config m_config;
+    const StringTable *m_strings;
+    DumpCallback m_done;
+
+    std::unique_ptr<SyscallEvent[]> m_ring;
+    quint64 m_capacity;
+    // 累计写入的事件数，m_written % m_capacity 是下一个写入位置。只有追踪线程写；
+    // 写入线程拷贝之后据此判断哪些槽位在拷贝期间可能已被覆盖
+    std::atomic<quint64> m_written{0};
+
+    // 速率突增检测：按事件时间戳划分秒，近期平均用 EWMA
+    quint64 m_second = 0;
+    quint64 m_secondCount = 0;
+    double m_averageRate = 0.0;
+    int m_secondsSeen = 0;
+    bool m_rateFired = false;             // 同一秒内只触发一次
+
+    quint64 m_quietUntil = 0;             // 触发后的冷却期截止时间
+
+    struct DumpRequest {
+        Trigger reason;
+        quint64 nowTs;
+        pid_t pid;
+        quint64 end;                      // 触发时的 m_written：只取这之前写入的事件
+    };
+    void writerLoop();
+    void writeDump(const DumpRequest &request);
+
+    std::mutex m_requestMutex;
+    std::condition_variable m_requestReady;
+    std::deque<DumpRequest> m_requests;
+    bool m_stopping = false;
+    std::thread m_writer;
+};
+
+#endif // FLIGHTRECORDER_H
@@ -0,0 +1,164 @@
+#include "futexstats.h"
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <algorithm>
+
+#ifndef FUTEX_LOCK_PI2
+#define FUTEX_LOCK_PI2 13
+#endif
+
+QString FutexStats::opName(int op)
+{
+    static const char *const names[] = {
+        "FUTEX_WAIT", "FUTEX_WAKE", "FUTEX_FD", "FUTEX_REQUEUE", "FUTEX_CMP_REQUEUE", "FUTEX_WAKE_OP",
+        "FUTEX_LOCK_PI", "FUTEX_UNLOCK_PI", "FUTEX_TRYLOCK_PI", "FUTEX_WAIT_BITSET", "FUTEX_WAKE_BITSET",
+        "FUTEX_WAIT_REQUEUE_PI", "FUTEX_CMP_REQUEUE_PI", "FUTEX_LOCK_PI2",
+    };
+    const int cmd = op & FUTEX_CMD_MASK;
+    QString name = cmd < int(sizeof(names) / sizeof(names[0])) ? QString(names[cmd]) : QString("FUTEX_%1").arg(cmd);
+    if (op & FUTEX_PRIVATE_FLAG)
+        name += "_PRIVATE";
+    if (op & FUTEX_CLOCK_REALTIME)
+        name += "|FUTEX_CLOCK_REALTIME";
+    return name;
+}
+
+bool FutexStats::isWaitOp(int op)
+{
+    switch (op & FUTEX_CMD_MASK) {
+        case FUTEX_WAIT: case FUTEX_WAIT_BITSET: case FUTEX_WAIT_REQUEUE_PI:
+        case FUTEX_LOCK_PI: case FUTEX_LOCK_PI2:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void FutexStats::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_locks.clear();
+    m_totals = Totals();
+    m_changed = false;
+}
+
+void FutexStats::noteTid(pid_t *tids, quint8 &count, pid_t tid)
+{
+    for (int i = 0; i < count; ++i) {
+        if (tids[i] == tid)
+            return;
+    }
+    if (count < kMaxTids)
+        tids[count++] = tid;
+}
+
+void FutexStats::onSyscall(pid_t tid, const quint64 args[6], qint64 ret, quint64 ts, quint64 durationNs,
+                           const quint32 *frames, int depth)
+{
+    const quint64 uaddr = args[0];
+    const int op = int(args[1]);
+    const int cmd = op & FUTEX_CMD_MASK;
+    const bool failed = ret < 0 && ret >= -4095;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_totals.calls++;
+    m_changed = true;
+    auto it = m_locks.find(uaddr);
+    if (it == m_locks.end()) {
+        if (m_locks.size() >= kMaxAddresses) {
+            m_totals.overflow++;
+            return;
+        }
+        it = m_locks.emplace(uaddr, Lock()).first;
+        it->second.uaddr = uaddr;
+        m_totals.addresses = m_locks.size();
+    }
+    Lock &l = it->second;
+    l.shared = !(op & FUTEX_PRIVATE_FLAG);
+    l.pi |= cmd == FUTEX_LOCK_PI || cmd == FUTEX_LOCK_PI2 || cmd == FUTEX_UNLOCK_PI || cmd == FUTEX_TRYLOCK_PI
+            || cmd == FUTEX_WAIT_REQUEUE_PI || cmd == FUTEX_CMP_REQUEUE_PI;
+    l.lastOp = op;
+    l.lastVal = quint32(args[2]);
+    l.lastTs = ts;
+
+    if (isWaitOp(op)) {
+        if (failed && ret == -EAGAIN) {
+            l.retries++;
+            return;
+        }
+        // 超时和被信号打断的调用同样睡过，等待时间照算
+        if (failed && ret == -ETIMEDOUT)
+            l.timeouts++;
+        else if (failed && ret != -EINTR)
+            l.errors++;
+        l.waits++;
+        l.waitNs += durationNs;
+        l.maxWaitNs = std::max(l.maxWaitNs, durationNs);
+        m_totals.waits++;
+        m_totals.waitNs += durationNs;
+        noteTid(l.waiters, l.waiterCount, tid);
+        if (depth > 0) {
+            // 最内层在前，跳过的帧补 0
+            for (int i = 0; i < kSiteFrames; ++i)
+                l.site[i] = i < depth ? frames[depth - 1 - i] : 0;
+        }
+        return;
+    }
+
+    switch (cmd) {
+        case FUTEX_WAKE: case FUTEX_WAKE_BITSET: case FUTEX_WAKE_OP: case FUTEX_UNLOCK_PI:
+        case FUTEX_REQUEUE: case FUTEX_CMP_REQUEUE: case FUTEX_CMP_REQUEUE_PI:
+            if (failed) {
+                l.errors++;
+                break;
+            }
+            // FUTEX_UNLOCK_PI 成功时返回 0，交接由内核完成，不算空唤醒
+            l.wakeCalls++;
+            l.woken += quint64(ret);
+            if (ret == 0 && cmd != FUTEX_UNLOCK_PI)
+                l.emptyWakes++;
+            m_totals.wakeCalls++;
+            noteTid(l.wakers, l.wakerCount, tid);
+            break;
+        default:
+            // FUTEX_TRYLOCK_PI 等不阻塞的调用：只计失败
+            if (failed && ret != -EAGAIN)
+                l.errors++;
+            break;
+    }
+}
+
+bool FutexStats::changed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_changed;
+}
+
+std::vector<FutexStats::Lock> FutexStats::snapshot(size_t limit, Totals *totals)
+{
+    // 总等待时间相同（例如都还没有等待过）时按 EAGAIN 和唤醒次数排
+    auto ranked = [](const Lock *a, const Lock *b) {
+        if (a->waitNs != b->waitNs)
+            return a->waitNs > b->waitNs;
+        if (a->retries != b->retries)
+            return a->retries > b->retries;
+        return a->wakeCalls > b->wakeCalls;
+    };
+    std::vector<const Lock *> order;
+    std::vector<Lock> out;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 只在锁内排指针，拷贝出前 limit 个
+    order.reserve(m_locks.size());
+    for (const auto &entry : m_locks)
+        order.push_back(&entry.second);
+    limit = std::min(limit, order.size());
+    std::partial_sort(order.begin(), order.begin() + ptrdiff_t(limit), order.end(), ranked);
+    out.reserve(limit);
+    for (size_t i = 0; i < limit; ++i)
+        out.push_back(*order[i]);
+    if (totals)
+        *totals = m_totals;
+    m_changed = false;
+    return out;
+}
@@ -0,0 +1,79 @@
+#ifndef FUTEXSTATS_H
+#define FUTEXSTATS_H
+
+#include <QString>
+#include <QtGlobal>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+// 锁竞争统计：在 futex 出口按参数（uaddr, op, val）解码，把等待和唤醒按 futex 地址聚合。
+// 只用入口处已经读到的寄存器，不读被追踪进程的内存，每次调用只是一次哈希查找，
+// 适合 futex 密集的负载。等待时长即 FUTEX_WAIT 类调用的耗时（已扣除停顿开销）。
+// futex 在调用栈采集列表中时，记下最近一次等待的内层几帧作为调用点。
+// onSyscall() 在追踪线程调用，snapshot() 在 GUI 线程调用，两者之间加锁。
+class FutexStats
+{
+public:
+    static constexpr int kMaxTids = 8;             // 每个地址记录的等待者/唤醒者 TID 数上限
+    static constexpr int kSiteFrames = 4;          // 调用点保留的内层帧数
+    static constexpr size_t kMaxAddresses = 65536; // 超出后新的地址只计入 overflow
+
+    struct Lock {
+        quint64 uaddr = 0;
+        bool shared = false;      // 没有 FUTEX_PRIVATE_FLAG：跨进程的 futex
+        bool pi = false;          // 优先级继承锁（FUTEX_LOCK_PI 等）
+        quint64 waits = 0;        // 真正进入等待的调用（不含 EAGAIN）
+        quint64 waitNs = 0;
+        quint64 maxWaitNs = 0;
+        quint64 timeouts = 0;     // ETIMEDOUT
+        quint64 retries = 0;      // EAGAIN：进入等待前值已变化，说明抢锁时有竞争但没有睡眠
+        quint64 wakeCalls = 0;
+        quint64 woken = 0;        // 唤醒调用返回的被唤醒（含被 requeue）的线程数之和
+        quint64 emptyWakes = 0;   // 没有唤醒任何线程的唤醒调用
+        quint64 errors = 0;       // 其他失败（EINTR 等）
+        int lastOp = 0;           // 最近一次调用的 op 和 val
+        quint32 lastVal = 0;
+        pid_t waiters[kMaxTids] = {};
+        pid_t wakers[kMaxTids] = {};
+        quint8 waiterCount = 0;
+        quint8 wakerCount = 0;
+        quint32 site[kSiteFrames] = {}; // StringTable 中的帧名 id，最内层在前，0 表示没有
+        quint64 lastTs = 0;
+    };
+
+    struct Totals {
+        quint64 calls = 0;
+        quint64 waits = 0;
+        quint64 waitNs = 0;
+        quint64 wakeCalls = 0;
+        quint64 addresses = 0;
+        quint64 overflow = 0;     // 因地址数超出上限而没有按地址统计的调用
+    };
+
+    // FUTEX_WAIT_PRIVATE、FUTEX_WAKE、FUTEX_LOCK_PI|FUTEX_CLOCK_REALTIME 这样的 op 名
+    static QString opName(int op);
+    // 第一个参数是 FUTEX_WAIT 类操作（调用可能阻塞）
+    static bool isWaitOp(int op);
+
+    void clear();
+    // futex 出口调用，args 为入口处的 6 个参数；frames 为入口处采到的调用栈（最外层在前），没有时 depth 为 0
+    void onSyscall(pid_t tid, const quint64 args[6], qint64 ret, quint64 ts, quint64 durationNs,
+                   const quint32 *frames, int depth);
+
+    // 上次 snapshot 之后是否有新的 futex 调用
+    bool changed() const;
+    // 按总等待时间排序的前 limit 个地址
+    std::vector<Lock> snapshot(size_t limit, Totals *totals);
+
+private:
+    static void noteTid(pid_t *tids, quint8 &count, pid_t tid);
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<quint64, Lock> m_locks;
+    Totals m_totals;
+    bool m_changed = false;
+};
+
+#endif // FUTEXSTATS_H
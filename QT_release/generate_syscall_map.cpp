@@ -1,10 +1,62 @@
 // generate_syscall_map.cpp
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
+#include <map>
 #include <algorithm>
 
+// 系统调用分类：按名字归类，没有列出的归入 other。
+// 顺序即生成的 SyscallCategory 枚举顺序，改动后需要重新生成 syscall_map.h
+struct CategoryRule {
+    const char *name;
+    const char *enumName;
+    const char *members; // 空格分隔
+};
+
+static const CategoryRule kCategoryRules[] = {
+    { "file", "SyscallCategoryFile",
+      "read write open close stat fstat lstat lseek pread64 pwrite64 readv writev access creat openat openat2 "
+      "newfstatat statx faccessat faccessat2 readlink readlinkat unlink unlinkat rename renameat renameat2 mkdir "
+      "mkdirat rmdir truncate ftruncate fsync fdatasync sync syncfs sync_file_range getdents getdents64 chmod fchmod "
+      "fchmodat fchmodat2 chown fchown lchown fchownat link linkat symlink symlinkat sendfile copy_file_range splice "
+      "tee vmsplice flock fcntl dup dup2 dup3 ioctl preadv pwritev preadv2 pwritev2 fadvise64 fallocate getcwd chdir "
+      "fchdir chroot mknod mknodat utime utimes utimensat futimesat statfs fstatfs name_to_handle_at "
+      "open_by_handle_at inotify_init inotify_init1 inotify_add_watch inotify_rm_watch fanotify_init fanotify_mark "
+      "setxattr lsetxattr fsetxattr getxattr lgetxattr fgetxattr listxattr llistxattr flistxattr removexattr "
+      "lremovexattr fremovexattr io_setup io_destroy io_getevents io_pgetevents io_submit io_cancel io_uring_setup "
+      "io_uring_enter io_uring_register close_range umask mount umount2 pivot_root readahead" },
+    { "net", "SyscallCategoryNet",
+      "socket socketpair bind listen accept accept4 connect getsockname getpeername sendto recvfrom sendmsg recvmsg "
+      "sendmmsg recvmmsg shutdown setsockopt getsockopt" },
+    { "memory", "SyscallCategoryMemory",
+      "brk mmap munmap mprotect mremap madvise msync mlock mlock2 munlock mlockall munlockall mincore mbind "
+      "set_mempolicy get_mempolicy set_mempolicy_home_node migrate_pages move_pages membarrier memfd_create "
+      "process_vm_readv process_vm_writev process_madvise pkey_mprotect pkey_alloc pkey_free userfaultfd "
+      "remap_file_pages memfd_secret process_mrelease" },
+    { "process", "SyscallCategoryProcess",
+      "clone clone3 fork vfork execve execveat exit exit_group wait4 waitid kill tgkill tkill getpid gettid getppid "
+      "getuid geteuid getgid getegid setuid setgid setreuid setregid setresuid setresgid getresuid getresgid "
+      "getgroups setgroups setsid getsid setpgid getpgid getpgrp prctl arch_prctl set_tid_address ptrace getrlimit "
+      "setrlimit prlimit64 getrusage sched_setaffinity sched_getaffinity sched_setscheduler sched_getscheduler "
+      "sched_setparam sched_getparam sched_get_priority_max sched_get_priority_min setpriority getpriority "
+      "rt_sigaction rt_sigprocmask rt_sigreturn rt_sigsuspend rt_sigtimedwait rt_sigqueueinfo rt_tgsigqueueinfo "
+      "rt_sigpending sigaltstack pause pidfd_open pidfd_send_signal pidfd_getfd unshare setns capget capset "
+      "personality uname sysinfo seccomp setfsuid setfsgid ioprio_set ioprio_get sched_setattr sched_getattr "
+      "sched_rr_get_interval set_thread_area get_thread_area getcpu rseq restart_syscall" },
+    // 等待与进程间通信：锁、就绪通知、管道和 SysV/POSIX IPC
+    { "sync", "SyscallCategorySync",
+      "futex futex_waitv set_robust_list get_robust_list poll ppoll select pselect6 epoll_create epoll_create1 "
+      "epoll_ctl epoll_wait epoll_pwait epoll_pwait2 eventfd eventfd2 signalfd signalfd4 pipe pipe2 shmget shmat "
+      "shmdt shmctl msgget msgsnd msgrcv msgctl semget semop semtimedop semctl mq_open mq_unlink mq_timedsend "
+      "mq_timedreceive mq_notify mq_getsetattr sched_yield" },
+    { "time", "SyscallCategoryTime",
+      "nanosleep clock_nanosleep clock_gettime clock_settime clock_getres clock_adjtime gettimeofday settimeofday "
+      "time times adjtimex timer_create timer_settime timer_gettime timer_getoverrun timer_delete timerfd_create "
+      "timerfd_settime timerfd_gettime alarm setitimer getitimer" },
+};
+
 int main() {
     // 系统调用头文件路径
     std::ifstream header_file("/usr/include/x86_64-linux-gnu/asm/unistd_64.h");
@@ -15,13 +67,7 @@ int main() {
 
     std::string line;
     const std::string prefix = "#define __NR_";
-    
-    // 输出 C++ 代码头部
-    std::cout << "// This file is auto-generated by generate_syscall_map.cpp. DO NOT EDIT.\n";
-    std::cout << "#pragma once\n";
-    std::cout << "#include <QMap>\n";
-    std::cout << "#include <QString>\n\n";
-    std::cout << "static const QMap<long, const char*> syscall_map = {\n";
+    std::vector<std::pair<long, std::string>> entries;
 
     // 逐行读取头文件
     while (std::getline(header_file, line)) {
@@ -33,21 +79,79 @@ int main() {
                 std::string name = line.substr(name_start, name_end - name_start);
                 std::string number_str = line.substr(name_end + 1);
                 try {
-                    long number = std::stol(number_str);
-                    // 输出 map 条目
-                    std::cout << "    {" << number << ", \"" << name << "\"},\n";
+                    entries.push_back({ std::stol(number_str), name });
                 } catch (const std::invalid_argument& e) {
                     // 忽略无法解析的行
                 }
             }
         }
     }
-    
-    // 输出 C++ 代码尾部
+
+    // 名字 -> 分类下标
+    const int category_count = int(sizeof(kCategoryRules) / sizeof(kCategoryRules[0]));
+    std::map<std::string, int> category_of;
+    for (int c = 0; c < category_count; ++c) {
+        std::istringstream members(kCategoryRules[c].members);
+        std::string name;
+        while (members >> name)
+            category_of[name] = c;
+    }
+
+    // 输出 C++ 代码头部
+    std::cout << "// This file is auto-generated by generate_syscall_map.cpp. DO NOT EDIT.\n";
+    std::cout << "#pragma once\n";
+    std::cout << "#include <QMap>\n";
+    std::cout << "#include <QString>\n\n";
+    std::cout << "static const QMap<long, const char*> syscall_map = {\n";
+    for (const auto &entry : entries)
+        std::cout << "    {" << entry.first << ", \"" << entry.second << "\"},\n";
     std::cout << "};\n\n";
     std::cout << "static QString getSyscallName(long number) {\n";
     std::cout << "    return syscall_map.value(number, \"Unknown\");\n";
+    std::cout << "}\n\n";
+
+    // 分类：枚举、名字和按 syscall 号索引的分类表
+    std::cout << "// 系统调用分类，规则见 generate_syscall_map.cpp 中的 kCategoryRules\n";
+    std::cout << "enum SyscallCategory {\n";
+    for (int c = 0; c < category_count; ++c)
+        std::cout << "    " << kCategoryRules[c].enumName << ",\n";
+    std::cout << "    SyscallCategoryOther,\n";
+    std::cout << "    SyscallCategoryCount\n";
+    std::cout << "};\n\n";
+    std::cout << "static const char *const syscall_category_names[SyscallCategoryCount] = {";
+    for (int c = 0; c < category_count; ++c)
+        std::cout << " \"" << kCategoryRules[c].name << "\",";
+    std::cout << " \"other\" };\n\n";
+
+    long max_number = -1;
+    for (const auto &entry : entries)
+        max_number = std::max(max_number, entry.first);
+    std::vector<int> categories(size_t(max_number + 1), category_count);
+    for (const auto &entry : entries) {
+        auto it = category_of.find(entry.second);
+        if (it != category_of.end())
+            categories[size_t(entry.first)] = it->second;
+    }
+    std::cout << "// 下标为 syscall 号\n";
+    std::cout << "static const unsigned char syscall_categories[" << categories.size() << "] = {";
+    for (size_t i = 0; i < categories.size(); ++i)
+        std::cout << (i % 32 == 0 ? "\n    " : " ") << categories[i] << ",";
+    std::cout << "\n};\n\n";
+
+    std::cout << "static int getSyscallCategory(long number) {\n";
+    std::cout << "    return (number >= 0 && number < long(sizeof(syscall_categories))) ? syscall_categories[number] : SyscallCategoryOther;\n";
+    std::cout << "}\n\n";
+    std::cout << "static QString getSyscallCategoryName(int category) {\n";
+    std::cout << "    return (category >= 0 && category < SyscallCategoryCount) ? syscall_category_names[category] : \"Unknown\";\n";
+    std::cout << "}\n\n";
+    std::cout << "// 分类名 -> 分类，无法识别返回 -1\n";
+    std::cout << "static int syscallCategoryFromName(const QString &name) {\n";
+    std::cout << "    for (int c = 0; c < SyscallCategoryCount; ++c) {\n";
+    std::cout << "        if (name == QLatin1String(syscall_category_names[c]))\n";
+    std::cout << "            return c;\n";
+    std::cout << "    }\n";
+    std::cout << "    return -1;\n";
     std::cout << "}\n";
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,236 @@
+#include "latencyheatmapwidget.h"
+#include "mainwindow.h"
+#include "syscall_map.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <algorithm>
+#include <cmath>
+
+// 256 级调色板：深蓝 -> 紫 -> 橙 -> 浅黄，首次使用时生成
+static const QRgb *heatPalette()
+{
+    static QRgb palette[256];
+    static bool ready = false;
+    if (!ready) {
+        const QColor stops[] = { QColor(20, 24, 82), QColor(120, 28, 109), QColor(237, 105, 37), QColor(252, 255, 164) };
+        for (int i = 0; i < 256; ++i) {
+            double t = i / 255.0 * 3.0;
+            int s = std::min(int(t), 2);
+            double f = t - s;
+            const QColor &a = stops[s];
+            const QColor &b = stops[s + 1];
+            palette[i] = qRgb(int(a.red() + (b.red() - a.red()) * f),
+                              int(a.green() + (b.green() - a.green()) * f),
+                              int(a.blue() + (b.blue() - a.blue()) * f));
+        }
+        ready = true;
+    }
+    return palette;
+}
+
+static QRgb heatColor(quint32 count, QRgb empty)
+{
+    if (count == 0)
+        return empty;
+    static const double scale = 255.0 / std::log2(1.0 + LatencyHeatmapWidget::kScaleMax);
+    int level = std::min(255, int(std::log2(1.0 + count) * scale));
+    return heatPalette()[level];
+}
+
+// 档的简短标签：0、1µs、2µs …… 1s、2s
+static QString latencyLabel(int bucket)
+{
+    quint64 ns = RollingStats::latencyBucketFloor(bucket);
+    if (ns == 0)
+        return "0";
+    if (ns < 1000000)
+        return QString("%1µs").arg(ns / 1000);
+    if (ns < 1000000000)
+        return QString("%1ms").arg(ns / 1000000);
+    return QString("%1s").arg(ns / 1000000000);
+}
+
+LatencyHeatmapWidget::LatencyHeatmapWidget(QWidget *parent)
+    : QWidget(parent)
+    , m_image(kColumns, kRows, QImage::Format_RGB32)
+    , m_counts(size_t(kColumns) * kRows, 0)
+{
+    setMouseTracking(true);
+    setMinimumHeight(kRows * 8);
+    reset();
+}
+
+void LatencyHeatmapWidget::setSyscall(long syscall)
+{
+    if (m_category < 0 && m_syscall == syscall)
+        return;
+    m_syscall = syscall;
+    m_category = -1;
+    m_members.clear();
+    m_dirty = true;
+}
+
+void LatencyHeatmapWidget::setCategory(int category)
+{
+    if (m_category == category)
+        return;
+    m_category = category;
+    m_syscall = -1;
+    m_members.clear();
+    for (int nr = 0; nr < RollingStats::kMaxSyscall; ++nr) {
+        if (getSyscallCategory(nr) == category)
+            m_members.push_back(nr);
+    }
+    m_dirty = true;
+}
+
+void LatencyHeatmapWidget::clear()
+{
+    m_dirty = true;
+    reset();
+    update();
+}
+
+void LatencyHeatmapWidget::reset()
+{
+    m_image.fill(palette().color(QPalette::Base));
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_firstSecond = -1;
+    m_lastSecond = -1;
+}
+
+void LatencyHeatmapWidget::fillColumn(const RollingStats &stats, qint64 second)
+{
+    quint32 column[kRows] = {};
+    if (const RollingStats::Bucket *b = stats.bucketAt(second)) {
+        if (m_category < 0) {
+            if (const RollingStats::LatencyRow *row = b->latencyOf(m_syscall))
+                std::copy(row->begin(), row->end(), column);
+        } else {
+            for (int nr : m_members) {
+                if (const RollingStats::LatencyRow *row = b->latencyOf(nr)) {
+                    for (int i = 0; i < kRows; ++i)
+                        column[i] += (*row)[i];
+                }
+            }
+        }
+    }
+
+    const int x = int(second % kColumns);
+    const QRgb empty = palette().color(QPalette::Base).rgb();
+    bool any = false;
+    for (int i = 0; i < kRows; ++i) {
+        m_counts[size_t(x) * kRows + i] = column[i];
+        // 低延迟在下面
+        reinterpret_cast<QRgb *>(m_image.scanLine(kRows - 1 - i))[x] = heatColor(column[i], empty);
+        any = any || column[i] != 0;
+    }
+    if (any && (m_firstSecond < 0 || second < m_firstSecond))
+        m_firstSecond = second;
+}
+
+void LatencyHeatmapWidget::advance(const RollingStats &stats, qint64 nowSec)
+{
+    if (m_dirty) {
+        reset();
+        m_dirty = false;
+    }
+    if (m_syscall < 0 && m_category < 0)
+        return;
+
+    // 第一次（或刚切换选择）从环中最旧的一秒开始；之后只补新的列，并重算上一秒
+    qint64 from = m_lastSecond < 0 ? nowSec - RollingStats::kBuckets + 1 : m_lastSecond - 1;
+    from = std::max({ from, nowSec - kColumns + 1, qint64(0) });
+    for (qint64 sec = from; sec <= nowSec; ++sec)
+        fillColumn(stats, sec);
+    m_lastSecond = nowSec;
+    if (m_firstSecond >= 0 && m_firstSecond <= nowSec - kColumns)
+        m_firstSecond = nowSec - kColumns + 1;
+    update();
+}
+
+QRect LatencyHeatmapWidget::plotRect() const
+{
+    const QFontMetrics metrics = fontMetrics();
+    const int left = metrics.horizontalAdvance("999ms") + 8;
+    const int bottom = metrics.height() + 6;
+    return rect().adjusted(left, 4, -8, -bottom);
+}
+
+qint64 LatencyHeatmapWidget::visibleFirst() const
+{
+    return std::min(m_firstSecond, m_lastSecond - kMinVisibleColumns + 1);
+}
+
+void LatencyHeatmapWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+    const QRect plot = plotRect();
+    painter.fillRect(plot, palette().base());
+    if (m_firstSecond < 0 || m_lastSecond < 0) {
+        painter.setPen(palette().color(QPalette::PlaceholderText));
+        painter.drawText(plot, Qt::AlignCenter, "No calls of the selected syscall in the last 5 minutes.");
+        return;
+    }
+
+    // 可见的秒 [first, last] 在环里最多分成两段，各自缩放贴图；不做平滑，每列边界清楚
+    const qint64 first = visibleFirst();
+    const qint64 last = m_lastSecond;
+    const double columnWidth = double(plot.width()) / double(last - first + 1);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
+    qint64 sec = std::max(first, m_firstSecond);
+    while (sec <= last) {
+        const int x = int(sec % kColumns);
+        const qint64 run = std::min<qint64>(last - sec + 1, kColumns - x);
+        QRectF target(plot.left() + (sec - first) * columnWidth, plot.top(), run * columnWidth, plot.height());
+        painter.drawImage(target, m_image, QRectF(x, 0, run, kRows));
+        sec += run;
+    }
+
+    // 纵轴：每 4 档一个标签；横轴：距现在的时间
+    painter.setPen(palette().color(QPalette::WindowText));
+    const double rowHeight = double(plot.height()) / kRows;
+    for (int bucket = 0; bucket < kRows; bucket += 4) {
+        const int y = int(plot.bottom() - bucket * rowHeight);
+        painter.drawLine(plot.left() - 3, y, plot.left(), y);
+        painter.drawText(QRect(0, y - fontMetrics().height(), plot.left() - 5, fontMetrics().height()),
+                         Qt::AlignRight | Qt::AlignBottom, latencyLabel(bucket));
+    }
+    const qint64 span = last - first + 1;
+    const qint64 step = span <= 120 ? 15 : span <= 600 ? 60 : span <= 1800 ? 300 : 600;
+    for (qint64 ago = 0; ago < span; ago += step) {
+        const int x = int(plot.left() + (span - ago - 0.5) * columnWidth);
+        painter.drawLine(x, plot.bottom(), x, plot.bottom() + 3);
+        const QString text = ago == 0 ? QString("now") : ago % 60 == 0 ? QString("-%1m").arg(ago / 60) : QString("-%1s").arg(ago);
+        painter.drawText(QRect(x - 40, plot.bottom() + 4, 80, fontMetrics().height()), Qt::AlignHCenter, text);
+    }
+}
+
+void LatencyHeatmapWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    const QRect plot = plotRect();
+    if (m_firstSecond < 0 || !plot.contains(event->pos())) {
+        QToolTip::hideText();
+        return;
+    }
+    const qint64 first = visibleFirst();
+    const double columnWidth = double(plot.width()) / double(m_lastSecond - first + 1);
+    const qint64 sec = first + qint64((event->pos().x() - plot.left()) / columnWidth);
+    const int bucket = std::clamp(int((plot.bottom() - event->pos().y()) * kRows / std::max(plot.height(), 1)), 0, kRows - 1);
+    if (sec < m_firstSecond || sec > m_lastSecond) {
+        QToolTip::hideText();
+        return;
+    }
+    const quint32 count = m_counts[size_t(sec % kColumns) * kRows + bucket];
+    const QString range = bucket == kRows - 1
+                              ? QString(">= %1").arg(formatDuration(qint64(RollingStats::latencyBucketFloor(bucket))))
+                              : QString("%1 - %2").arg(formatDuration(qint64(RollingStats::latencyBucketFloor(bucket))),
+                                                       formatDuration(qint64(RollingStats::latencyBucketFloor(bucket + 1))));
+    QToolTip::showText(event->globalPosition().toPoint(),
+                       QString("%1 s ago\n%2\nCalls: %3").arg(m_lastSecond - sec).arg(range).arg(count),
+                       this);
+}
@@ -0,0 +1,54 @@
+#ifndef LATENCYHEATMAPWIDGET_H
+#define LATENCYHEATMAPWIDGET_H
+
+#include <QImage>
+#include <QWidget>
+#include <vector>
+#include "rollingstats.h"
+
+// 延迟热力图：横轴是时间（每秒一列），纵轴是 2 的幂耗时档（下快上慢），颜色是这一秒落在该档的调用数。
+// 平均值和分位数看不出的双峰（例如 read 要么命中页缓存要么读盘）在这里是两条横带。
+// 数据取自 RollingStats 的按秒耗时分布，不逐事件绘制；画面保存在一张环形的 QImage 里，
+// 每次 advance() 只重算新增的几列，绘制时按可见范围缩放贴图，开销与追踪时长无关。
+class LatencyHeatmapWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    static constexpr int kColumns = 3600;                  // 保留最近 1 小时，超出 RollingStats 的部分只在图里
+    static constexpr int kRows = RollingStats::kLatencyBuckets;
+    static constexpr int kMinVisibleColumns = 60;          // 刚开始追踪时也按 1 分钟宽度显示，避免几列被拉得很宽
+    static constexpr double kScaleMax = 1e6;               // 颜色按对数刻度，每格每秒 100 万次为最亮
+
+    explicit LatencyHeatmapWidget(QWidget *parent = nullptr);
+
+    // 选择一个 syscall 或一个分类（SyscallCategory），下一次 advance() 时从 RollingStats 中还在的
+    // 最近 kBuckets 秒重建，更早的列留空
+    void setSyscall(long syscall);
+    void setCategory(int category);
+    void clear();
+
+    // 补上 nowSec 之前还没画的列；最近两列总是重算，因为迟到的事件还会落进去
+    void advance(const RollingStats &stats, qint64 nowSec);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    void reset();
+    void fillColumn(const RollingStats &stats, qint64 second);
+    QRect plotRect() const;
+    qint64 visibleFirst() const;
+
+    long m_syscall = -1;
+    int m_category = -1;
+    std::vector<int> m_members;            // 分类包含的 syscall 号
+    bool m_dirty = true;
+
+    QImage m_image;                         // kColumns x kRows，第 second % kColumns 列
+    std::vector<quint32> m_counts;          // 与 m_image 对应的计数，用于提示
+    qint64 m_firstSecond = -1;              // 第一列有数据的秒
+    qint64 m_lastSecond = -1;               // 已经画到的秒
+};
+
+#endif // LATENCYHEATMAPWIDGET_H
@@ -0,0 +1,62 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QtGlobal>
+#include <array>
+
+// 对数-线性延迟直方图：每个 2 的幂区间再均分为 8 个子桶，相对误差不超过 12.5%。
+// 固定 496 个桶，合并就是逐桶相加，可以流式地计算任意分位数。
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBits = 3;
+    static constexpr int kLinear = 16; // 小于 16 ns 的值每个值一个桶
+    static constexpr int kBuckets = kLinear + (64 - 4) * (1 << kSubBits);
+
+    static int bucketOf(quint64 ns) {
+        if (ns < quint64(kLinear))
+            return int(ns);
+        int e = 63 - __builtin_clzll(ns); // ns >= 16 时 e >= 4
+        int sub = int((ns >> (e - kSubBits)) & ((1 << kSubBits) - 1));
+        return kLinear + (e - 4) * (1 << kSubBits) + sub;
+    }
+    // 桶的下界
+    static quint64 bucketFloor(int bucket) {
+        if (bucket < kLinear)
+            return quint64(bucket);
+        int e = (bucket - kLinear) / (1 << kSubBits) + 4;
+        int sub = (bucket - kLinear) % (1 << kSubBits);
+        return (quint64(1) << e) | (quint64(sub) << (e - kSubBits));
+    }
+
+    void add(quint64 ns) { m_counts[bucketOf(ns)]++; m_total++; }
+    // 桶号已经算好时（见 columnkernels::latencyBuckets）
+    void addBucket(int bucket) { m_counts[bucket]++; m_total++; }
+    void merge(const LatencyHistogram &other) {
+        for (int i = 0; i < kBuckets; ++i)
+            m_counts[i] += other.m_counts[i];
+        m_total += other.m_total;
+    }
+    quint64 total() const { return m_total; }
+    quint64 countAt(int bucket) const { return m_counts[bucket]; }
+
+    // q 取 0~1，返回该分位数所在桶的下界（ns）
+    quint64 percentile(double q) const {
+        if (m_total == 0)
+            return 0;
+        quint64 rank = quint64(q * double(m_total - 1)) + 1;
+        quint64 seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += m_counts[i];
+            if (seen >= rank)
+                return bucketFloor(i);
+        }
+        return bucketFloor(kBuckets - 1);
+    }
+
+private:
+    std::array<quint64, kBuckets> m_counts{};
+    quint64 m_total = 0;
+};
+
+#endif // LATENCYHISTOGRAM_H
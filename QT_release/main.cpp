@@ -1,9 +1,309 @@
 #include "mainwindow.h"
+#include "tracer.h"
+#include "tracediff.h"
+#include "tracefile.h"
+#include "tracequery.h"
+#include "errnostats.h"
+#include "syscall_map.h"
+#include "traceagent.h"
+#include "remotetracer.h"
+#include "eventqueue.h"
+#include "eventstore.h"
+#include "selftest.h"
+#include "bench.h"
 
 #include <QApplication>
+#include <QStringList>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 命令行模式：SyscallMonitor --diff A.qtrace B.qtrace [--window-a s:e] [--window-b s:e] [--by-category]
+// A、B 可以是同一个文件，配合两个时间窗口比较同一次追踪的前后两段；--by-category 按分类而不是 syscall 对比
+static int runDiff(const QStringList &args)
+{
+    QStringList inputs;
+    TimeWindow windowA, windowB;
+    bool byCategory = false;
+    for (int i = 0; i < args.size(); ++i) {
+        const QString &arg = args.at(i);
+        if (arg == "--by-category") {
+            byCategory = true;
+        } else if ((arg == "--window-a" || arg == "--window-b") && i + 1 < args.size()) {
+            TimeWindow &w = arg == "--window-a" ? windowA : windowB;
+            if (!TimeWindow::parse(args.at(++i), w)) {
+                fprintf(stderr, "invalid time window: %s (expected start:end in seconds)\n", qPrintable(args.at(i)));
+                return 2;
+            }
+        } else {
+            inputs << arg;
+        }
+    }
+    if (inputs.size() != 2) {
+        fprintf(stderr, "usage: SyscallMonitor --diff A.qtrace B.qtrace [--window-a s:e] [--window-b s:e] [--by-category]\n");
+        return 2;
+    }
+
+    TraceProfile a, b;
+    QString error;
+    if (!buildProfiles(inputs.at(0), windowA, inputs.at(1), windowB, a, b, &error)) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    if (byCategory) {
+        a = groupByCategory(a);
+        b = groupByCategory(b);
+    }
+    fputs(formatDiffTable(a, b, diffProfiles(a, b)).toUtf8().constData(), stdout);
+    return 0;
+}
+
+// 命令行模式：SyscallMonitor --query FILE.qtrace [--count] FILTER...
+// FILTER 与界面上过滤栏的语法相同，例如 tid=1234 syscall=read,write dur>1ms time=12:00:05-12:00:10
+static int runQueryCommand(const QStringList &args)
+{
+    QString path;
+    QStringList filter;
+    bool countOnly = false;
+    for (const QString &arg : args) {
+        if (arg == "--count")
+            countOnly = true;
+        else if (path.isEmpty())
+            path = arg;
+        else
+            filter << arg;
+    }
+    if (path.isEmpty()) {
+        fprintf(stderr, "usage: SyscallMonitor --query FILE.qtrace [--count] [tid=..] [pid=..] [syscall=a,b] "
+                        "[dur>1ms] [time=HH:MM:SS-HH:MM:SS] [t=start-end] [errors] [path~substr]\n");
+        return 2;
+    }
+
+    TraceReader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "%s\n", qPrintable(reader.errorString()));
+        return 1;
+    }
+    TraceQuery::Context context;
+    TraceQuery query;
+    QString error;
+    if (!queryContext(reader, context, &error)) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    if (!TraceQuery::parse(filter.join(' '), context, query, &error)) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 2;
+    }
+
+    QueryStats stats;
+    bool ok = runQuery(reader, query, [&](const SyscallEvent &e) {
+        if (!countOnly) {
+            // 时间相对于文件中的第一个事件
+            printf("+%.6fs %7u %-16s %-18s %-14s %10.3fus %s\n",
+                   (e.ts - context.firstTs) / 1e9, e.tid, reader.string(e.commId).c_str(),
+                   getSyscallName(e.syscall).toUtf8().constData(),
+                   ErrnoStats::formatReturn(e.ret).toUtf8().constData(),
+                   e.duration / 1e3, reader.string(e.pathId).c_str());
+        }
+        return true;
+    }, stats, &error);
+    if (!ok) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    if (countOnly)
+        printf("%llu\n", (unsigned long long)stats.eventsMatched);
+    fprintf(stderr, "%llu matching events; decoded %llu of %llu events, skipped %llu of %llu chunks%s\n",
+            (unsigned long long)stats.eventsMatched, (unsigned long long)stats.eventsScanned,
+            (unsigned long long)reader.eventCount(), (unsigned long long)stats.chunksSkipped,
+            (unsigned long long)stats.chunksTotal, reader.hasSummaries() ? "" : " (no chunk index in this file)");
+    return 0;
+}
+
+// 命令行模式：sudo SyscallMonitor --agent [unix:/path/to.sock，默认 /run/syscallmonitor-agent.sock]
+//           sudo SyscallMonitor --agent --tcp [host:port，默认 127.0.0.1:7341] --token-file 令牌文件
+// 无界面的追踪代理，GUI 在 "Agent" 栏填同一个地址连接；远程机器上配合 ssh -L 7341:/path/to.sock 使用。
+// TCP 必须显式指定，并用只有 sudo 前用户可读的令牌文件认证，GUI 的地址写成 host:port,token=令牌文件
+static int runAgent(const QStringList &args)
+{
+    static const char usage[] = "usage: SyscallMonitor --agent [unix:/path]\n"
+                                "       SyscallMonitor --agent --tcp [host:port] --token-file path\n";
+    bool tcp = false;
+    QString tokenPath;
+    QString spec;
+    for (int i = 0; i < args.size(); ++i) {
+        if (args.at(i) == "--tcp")
+            tcp = true;
+        else if (args.at(i) == "--token-file" && i + 1 < args.size())
+            tokenPath = args.at(++i);
+        else if (spec.isEmpty() && !args.at(i).startsWith("--"))
+            spec = args.at(i);
+        else {
+            fprintf(stderr, "%s", usage);
+            return 2;
+        }
+    }
+    if (spec.isEmpty())
+        spec = tcp ? QString("127.0.0.1:7341") : QString(agentprotocol::kDefaultAddress);
+    agentprotocol::Address address;
+    QString error;
+    if (!agentprotocol::parseAddress(spec, address, &error)) {
+        fprintf(stderr, "%s%s\n", usage, qPrintable(error));
+        return 2;
+    }
+    if (address.isUnix == tcp || (tcp && tokenPath.isEmpty()) || !address.tokenFile.empty()) {
+        fprintf(stderr, "%sTCP needs both --tcp and --token-file; without --tcp the address must be unix:/path\n", usage);
+        return 2;
+    }
+    // 经 sudo 启动时，socket 文件和令牌文件交给原来的用户，其他本地用户连不上也读不到
+    const char *sudoUid = getenv("SUDO_UID");
+    uid_t allowedUid = sudoUid ? uid_t(strtoul(sudoUid, nullptr, 10)) : getuid();
+    std::string token;
+    if (tcp && !TraceAgent::loadOrCreateToken(tokenPath.toStdString(), allowedUid, token, &error)) {
+        fprintf(stderr, "agent: token file: %s\n", qPrintable(error));
+        return 1;
+    }
+    // socket 文件一创建就是 0600，bind 与 chmod 之间没有别人能连上的窗口
+    const mode_t oldMask = umask(077);
+    int fd = agentprotocol::listenOn(address, &error);
+    umask(oldMask);
+    if (fd < 0) {
+        fprintf(stderr, "agent: cannot listen: %s\n", qPrintable(error));
+        return 1;
+    }
+    if (address.isUnix) {
+        if (chown(address.path.c_str(), allowedUid, gid_t(-1)) != 0 || chmod(address.path.c_str(), 0600) != 0)
+            perror("agent: socket permissions");
+        fprintf(stderr, "agent: listening on unix:%s (uid %u)\n", address.path.c_str(), unsigned(allowedUid));
+    } else {
+        fprintf(stderr, "agent: listening on %s:%u; connect with %s:%u,token=%s\n", address.host.c_str(),
+                unsigned(address.port), address.host.c_str(), unsigned(address.port), qPrintable(tokenPath));
+    }
+    TraceAgent agent(fd, address.isUnix, allowedUid, token);
+    return agent.run();
+}
+
+// 命令行模式：SyscallMonitor --agent-client 地址 PID [events|summary|auto] [秒数，默认 10]
+// 地址的写法与 GUI 的 Agent 栏相同，TCP 代理需要带 ,token=令牌文件
+// 不开界面连接代理，每秒输出收到的事件数、合计覆盖的调用数和字节量，用于在本机验证两端
+static int runAgentClient(const QStringList &args)
+{
+    agentprotocol::Address address;
+    QString error;
+    bool ok = args.size() >= 2;
+    const unsigned pid = ok ? args.at(1).toUInt(&ok) : 0;
+    const QString modeText = args.size() > 2 ? args.at(2) : QString("events");
+    const int seconds = args.size() > 3 ? args.at(3).toInt() : 10;
+    agentprotocol::Mode mode = agentprotocol::EventsMode;
+    if (modeText == "summary")
+        mode = agentprotocol::SummaryMode;
+    else if (modeText == "auto")
+        mode = agentprotocol::AutoMode;
+    else if (modeText != "events")
+        ok = false;
+    if (!ok || seconds <= 0 || !agentprotocol::parseAddress(args.at(0), address, &error)) {
+        fprintf(stderr, "usage: SyscallMonitor --agent-client address pid [events|summary|auto] [seconds]\n%s\n",
+                qPrintable(error));
+        return 2;
+    }
+
+    EventQueue queue;
+    Arena arena;
+    StringTable strings(arena);
+    TracerMetrics metrics;
+    RemoteTracer remote(address);
+    remote.setMetrics(&metrics);
+    remote.setEventSink(&queue, &strings);
+    remote.setMode(mode);
+    QString message;
+    std::atomic<bool> done(false);
+    QObject::connect(&remote, &RemoteTracer::finished, [&message](const QString &m) { message = m; });
+    std::thread client([&]() {
+        remote.start(pid);
+        done.store(true);
+    });
+
+    std::vector<SyscallEvent> buffer(1 << 14);
+    quint64 totalEvents = 0, totalSummarized = 0;
+    for (int second = 1; !done.load(); ++second) {
+        quint64 events = 0, summarized = 0;
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (std::chrono::steady_clock::now() < until && !done.load()) {
+            size_t n;
+            while ((n = queue.pop(buffer.data(), buffer.size())) > 0)
+                events += n;
+            for (const agentprotocol::SummaryEntry &s : remote.takeSummaries())
+                summarized += s.count;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        totalEvents += events;
+        totalSummarized += summarized;
+        printf("%3d s: %8llu events, %8llu summarized calls, tracer stops %llu, dropped %llu\n", second,
+               (unsigned long long)events, (unsigned long long)summarized,
+               (unsigned long long)metrics.stops.load(), (unsigned long long)metrics.dropped.load());
+        fflush(stdout);
+        if (second == seconds)
+            remote.stop();
+    }
+    client.join();
+    size_t n;
+    while ((n = queue.pop(buffer.data(), buffer.size())) > 0)
+        totalEvents += n;
+    for (const agentprotocol::SummaryEntry &s : remote.takeSummaries())
+        totalSummarized += s.count;
+    printf("total: %llu events, %llu summarized calls, %u strings\n%s\n", (unsigned long long)totalEvents,
+           (unsigned long long)totalSummarized, strings.size(), qPrintable(message));
+    return message.startsWith("Error") ? 1 : 0;
+}
+
+// argv[first] 之后的参数，交给命令行子命令
+static QStringList restArgs(int argc, char *argv[], int first)
+{
+    QStringList args;
+    for (int i = first; i < argc; ++i)
+        args << QString::fromLocal8Bit(argv[i]);
+    return args;
+}
 
 int main(int argc, char *argv[])
 {
+    // 命令行子命令不需要创建 GUI。会启动追踪线程的子命令要在创建线程之前屏蔽 SIGCHLD，追踪线程靠 signalfd 接收它
+    struct Command {
+        const char *flag;
+        int (*run)(const QStringList &args);
+        bool tracesLocally;
+    };
+    static const Command kCommands[] = {
+        { "--diff", runDiff, false },
+        { "--query", runQueryCommand, false },
+        { "--bench-kernels", runKernelBench, false },
+        { "--loopback-workload", runLoopbackWorkload, false },
+        { "--agent", runAgent, true },
+        { "--agent-client", runAgentClient, false },
+        { "--record-stops", runRecordStops, true },
+        { "--replay-stops", runReplayStops, false },
+        { "--filter-self-test", runFilterSelfTest, false },
+        { "--tracer-smoke-test", runTracerSmokeTest, true },
+    };
+    if (argc > 1) {
+        for (const Command &command : kCommands) {
+            if (strcmp(argv[1], command.flag) != 0)
+                continue;
+            if (command.tracesLocally)
+                Tracer::blockChildSignal();
+            return command.run(restArgs(argc, argv, 2));
+        }
+    }
+
+    // 在 QApplication 创建任何线程之前屏蔽 SIGCHLD，追踪线程通过 signalfd 接收 ptrace 停顿通知
+    Tracer::blockChildSignal();
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -1,11 +1,28 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "tracer.h"
+#include "remotetracer.h"
+#include "eventstore.h"
+#include "eventqueue.h"
+#include "eventtablemodel.h"
+#include "timelineitem.h"
+#include "tracefile.h"
+#include "tracediff.h"
+#include "tracequery.h"
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QApplication>
+#include <QShortcut>
 #include <QMessageBox>
 #include <QtCharts/QValueAxis>
 #include <QDir>
-#include <QRegularExpression> // 用于判断目录名是否是数字
+#include <QRegularExpression>
 #include <QFile>
+#include <QStatusBar>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QCloseEvent>
+#include <QSignalBlocker>
 // 我们需要一个 syscall-number -> name 的映射
 #include <QMap>
 #include "syscall_map.h"
@@ -21,6 +38,17 @@ qint64 get_system_boot_time_epoch_ns() {
     // 系统启动时间 = 当前时间 - monotonic 时间
     return now_epoch_ns - now_monotonic_ns;
 }
+// 与 Tracer 的时间戳同一个时钟，用于确定滚动窗口的“当前秒”
+qint64 currentMonotonicSecond() {
+    struct timespec ts_now;
+    clock_gettime(CLOCK_MONOTONIC, &ts_now);
+    return ts_now.tv_sec;
+}
+static quint64 currentMonotonicNs() {
+    struct timespec ts_now;
+    clock_gettime(CLOCK_MONOTONIC, &ts_now);
+    return quint64(ts_now.tv_sec) * 1000000000ULL + quint64(ts_now.tv_nsec);
+}
 QString formatTimestamp(qint64 nanoseconds) {
     qint64 boot_time_ns = get_system_boot_time_epoch_ns();
     qint64 real_time_ns = boot_time_ns + nanoseconds;
@@ -76,18 +104,58 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , m_tracer(nullptr)
+    , m_remote(nullptr)
     , m_tracerThread(nullptr)
     , m_chart(nullptr) // 初始化为空指针
     , m_series(nullptr)
+    , m_rollingStats(new RollingStats())
+    , m_rateChart(nullptr)
+    , m_rateSeries(nullptr)
+    , m_errorRateSeries(nullptr)
+    , m_diffChart(nullptr)
+    , m_memoryChart(nullptr)
+    , m_mappedSeries(nullptr)
+    , m_anonSeries(nullptr)
+    , m_churnSeries(nullptr)
     , m_chartUpdateTimer(nullptr)
     , m_timelineScene(nullptr)
+    , m_tableModel(nullptr)
+    , m_drainTimer(nullptr)
+    , m_diagnosticsLabel(nullptr)
 {
     ui->setupUi(this);
 
-    // --- 表格初始化 (不变) ---
-    ui->syscallTable->setColumnCount(5);
-    ui->syscallTable->setHorizontalHeaderLabels({"PID", "Process", "Syscall Number", "Syscall Name", "Return Value"});
+    // --- 表格初始化：数据直接来自 EventStore ---
+    m_tableModel = new EventTableModel(this);
+    ui->syscallTable->setModel(m_tableModel);
     ui->syscallTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    // 所有行等高，视图不必逐行测量
+    ui->syscallTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    // 清空过滤栏（包括点清除按钮）立即恢复显示全部事件
+    connect(ui->filterEdit, &QLineEdit::textChanged, this, [this](const QString &text) {
+        if (text.isEmpty())
+            applyFilter();
+    });
+
+    // --- errno 统计表初始化 ---
+    ui->errnoTable->setColumnCount(7);
+    ui->errnoTable->setHorizontalHeaderLabels({"Syscall", "Errno", "Count", "Rate (/s)", "% of Calls", "Retry Loops", "Max Streak"});
+    ui->errnoTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->errnoTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->errnoTable->setSortingEnabled(true);
+
+    // --- 耗时拆分表初始化 ---
+    ui->timeSplitTable->setColumnCount(6);
+    ui->timeSplitTable->setHorizontalHeaderLabels({"Syscall", "Calls", "Total", "On-CPU %", "Runqueue %", "Blocked %"});
+    ui->timeSplitTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->timeSplitTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    // --- 分类汇总树：分类 -> syscall -> errno ---
+    ui->categoryTree->setColumnCount(6);
+    ui->categoryTree->setHeaderLabels({"Category / Syscall / Errno", "Calls", "Errors", "Total", "Avg", "Max"});
+    ui->categoryTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->categoryTree->setSortingEnabled(true);
+    ui->categoryTree->sortByColumn(1, Qt::DescendingOrder);
 
     // --- 时间线场景初始化 (保持简单) ---
     m_timelineScene = new QGraphicsScene(this);
@@ -99,11 +167,146 @@ MainWindow::MainWindow(QWidget *parent)
     ui->frequencyChartView->setChart(m_chart); // 将 chart 关联到 view
     ui->frequencyChartView->setRenderHint(QPainter::Antialiasing);
 
+    // 统计窗口：Lifetime 用累计计数，其余从滚动统计中查询
+    ui->windowCombo->addItem("Lifetime", 0);
+    ui->windowCombo->addItem("Last 1 s", 1);
+    ui->windowCombo->addItem("Last 10 s", 10);
+    ui->windowCombo->addItem("Last 60 s", 60);
+    ui->windowCombo->addItem("Last 5 min", RollingStats::kBuckets);
+    connect(ui->windowCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+        if (m_series)
+            updateFrequencyChart();
+    });
+
+    // 远程代理的传输模式，追踪过程中也可以切换
+    ui->agentModeCombo->addItem("Events", agentprotocol::EventsMode);
+    ui->agentModeCombo->addItem("Summary", agentprotocol::SummaryMode);
+    ui->agentModeCombo->addItem("Auto", agentprotocol::AutoMode);
+    connect(ui->agentModeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+        if (m_remote)
+            m_remote->setMode(agentprotocol::Mode(ui->agentModeCombo->currentData().toInt()));
+    });
+
+    // --- 延迟热力图：先列分类，再按名字列出所有 syscall；data 为 syscall 号，分类为 -1 - 分类 ---
+    for (int c = 0; c < SyscallCategoryCount; ++c)
+        ui->latencyTargetCombo->addItem(QString("class: %1").arg(getSyscallCategoryName(c)), -1 - c);
+    QList<QPair<QString, int>> syscallNames;
+    for (auto it = syscall_map.constBegin(); it != syscall_map.constEnd(); ++it)
+        syscallNames.append({ QString(it.value()), int(it.key()) });
+    std::sort(syscallNames.begin(), syscallNames.end());
+    for (const auto &entry : syscallNames)
+        ui->latencyTargetCombo->addItem(entry.first, entry.second);
+    connect(ui->latencyTargetCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+        const int target = ui->latencyTargetCombo->currentData().toInt();
+        if (target < 0)
+            ui->latencyHeatmap->setCategory(-1 - target);
+        else
+            ui->latencyHeatmap->setSyscall(target);
+        ui->latencyHeatmap->advance(*m_rollingStats, currentMonotonicSecond());
+    });
+    ui->latencyHeatmap->setCategory(-1 - ui->latencyTargetCombo->currentData().toInt());
+
+    // --- 速率曲线：最近 5 分钟每秒的调用数和失败数 ---
+    m_rateChart = new QChart();
+    m_rateSeries = new QLineSeries();
+    m_rateSeries->setName("calls/s");
+    m_errorRateSeries = new QLineSeries();
+    m_errorRateSeries->setName("errors/s");
+    m_rateChart->addSeries(m_rateSeries);
+    m_rateChart->addSeries(m_errorRateSeries);
+    QValueAxis *rateAxisX = new QValueAxis();
+    rateAxisX->setRange(-(RollingStats::kBuckets - 1), 0);
+    rateAxisX->setLabelFormat("%d");
+    rateAxisX->setTitleText("Seconds ago");
+    QValueAxis *rateAxisY = new QValueAxis();
+    rateAxisY->setLabelFormat("%d");
+    rateAxisY->setTitleText("Rate (/s)");
+    m_rateChart->addAxis(rateAxisX, Qt::AlignBottom);
+    m_rateChart->addAxis(rateAxisY, Qt::AlignLeft);
+    for (QLineSeries *series : { m_rateSeries, m_errorRateSeries }) {
+        series->attachAxis(rateAxisX);
+        series->attachAxis(rateAxisY);
+    }
+    m_rateChart->setTitle("Syscall Rate");
+    ui->rateChartView->setChart(m_rateChart);
+    ui->rateChartView->setRenderHint(QPainter::Antialiasing);
+
+    // --- 追踪对比表格；速率变化条形图和地址空间曲线一样，到第一次用到时才创建 ---
+    ui->diffTable->setColumnCount(15);
+    ui->diffTable->setHorizontalHeaderLabels({"Syscall", "Count A", "Count B", "Rate A (/s)", "Rate B (/s)", "Δ Rate %",
+                                              "p50 A", "p50 B", "p90 A", "p90 B", "p99 A", "p99 B",
+                                              "Err% A", "Err% B", "Hint"});
+    ui->diffTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->diffTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    // --- 网络面板：每个 socket 一行，下面是 epoll_wait 按就绪数分桶的等待时间 ---
+    ui->networkTable->setColumnCount(14);
+    ui->networkTable->setHorizontalHeaderLabels({"FD", "Proto", "State", "Local", "Peer", "Calls", "Bytes Out", "Bytes In",
+                                                 "Out (B/s)", "In (B/s)", "Blocked", "Max Call", "Connect", "Errors"});
+    ui->networkTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->networkTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->networkTable->setSortingEnabled(true);
+    ui->epollTable->setColumnCount(6);
+    ui->epollTable->setHorizontalHeaderLabels({"Ready Events", "Calls", "Total Wait", "Avg Wait", "Max Wait", "Events"});
+    ui->epollTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->epollTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->epollTable->verticalHeader()->setVisible(false);
+
+    // --- 锁竞争面板：按总等待时间排好序，不再允许点表头重排 ---
+    ui->futexTable->setColumnCount(15);
+    ui->futexTable->setHorizontalHeaderLabels({"Address", "Kind", "Waits", "Total Wait", "Avg Wait", "Max Wait", "Timeouts",
+                                               "EAGAIN", "Wakes", "Woken", "Empty Wakes", "Waiter TIDs", "Waker TIDs",
+                                               "Last Call", "Wait Site"});
+    ui->futexTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->futexTable->horizontalHeader()->setStretchLastSection(true);
+    ui->futexTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    // --- 进程面板：进程按父子关系成树，下面是按可执行映像的汇总 ---
+    ui->processTree->setColumnCount(8);
+    ui->processTree->setHeaderLabels({"PID", "Command", "Image", "Calls", "Errors", "Syscall Time", "Wall Time", "Status"});
+    ui->processTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->imageTable->setColumnCount(8);
+    ui->imageTable->setHorizontalHeaderLabels({"Image", "Processes", "Calls", "Errors", "Syscall Time", "Wall Time",
+                                               "Avg Wall / Process", "Top Syscalls"});
+    ui->imageTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->imageTable->horizontalHeader()->setStretchLastSection(true);
+    ui->imageTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    // --- 重复序列表 ---
+    ui->sequenceTable->setColumnCount(6);
+    ui->sequenceTable->setHorizontalHeaderLabels({"Sequence", "Count", "Total Time", "Avg / Occurrence", "Identical Args %", "Path"});
+    ui->sequenceTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->sequenceTable->horizontalHeader()->setStretchLastSection(true);
+    ui->sequenceTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    // --- 序列表、调用栈火焰图、分类树、地址空间、网络、锁竞争和进程面板：只在切到对应标签页时刷新 ---
+    connect(ui->analysisTabs, &QTabWidget::currentChanged, this, &MainWindow::updateSequenceTable);
+    connect(ui->analysisTabs, &QTabWidget::currentChanged, this, &MainWindow::updateFlameGraph);
+    connect(ui->analysisTabs, &QTabWidget::currentChanged, this, &MainWindow::updateCategoryTree);
+    connect(ui->analysisTabs, &QTabWidget::currentChanged, this, &MainWindow::updateMemoryPanel);
+    connect(ui->analysisTabs, &QTabWidget::currentChanged, this, &MainWindow::updateNetworkPanel);
+    connect(ui->analysisTabs, &QTabWidget::currentChanged, this, &MainWindow::updateLocksPanel);
+    connect(ui->analysisTabs, &QTabWidget::currentChanged, this, &MainWindow::updateProcessesPanel);
+
+    // --- 飞行记录器：F9 手动触发 ---
+    ui->recorderDirEdit->setText(QDir::tempPath());
+    new QShortcut(QKeySequence(Qt::Key_F9), this, this, &MainWindow::on_dumpNowButton_clicked);
+
     // --- 定时器初始化 ---
     m_chartUpdateTimer = new QTimer(this);
-    connect(m_chartUpdateTimer, &QTimer::timeout, this, &MainWindow::updateFrequencyChart);
+    connect(m_chartUpdateTimer, &QTimer::timeout, this, &MainWindow::refreshPanels);
+
+    // 事件队列按固定周期批量取出，取代每个事件一次的跨线程信号
+    m_drainTimer = new QTimer(this);
+    connect(m_drainTimer, &QTimer::timeout, this, &MainWindow::drainEvents);
+    m_drainBuffer.resize(1 << 14);
 
-    //刷新进程
+    // --- 状态栏诊断信息 ---
+    m_diagnosticsLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_diagnosticsLabel);
+
+    // 先恢复上次的会话（布局、过滤条件、最近追踪过的进程），进程扫描在后台进行，窗口不等它
+    restoreSession();
     populateProcessList();
 
     connect(ui->lineEdit, &QLineEdit::textChanged, this, &MainWindow::filterProcessList);
@@ -111,38 +314,173 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    m_scanCancel.store(true);
+    if (m_scanThread.joinable())
+        m_scanThread.join();
     if (m_tracerThread && m_tracerThread->isRunning()) {
-        m_tracer->stop();
+        if (m_remote)
+            m_remote->stop();
+        else
+            m_tracer->stop();
         m_tracerThread->quit();
         m_tracerThread->wait();
     }
+    m_tableModel->setStore(nullptr);
+    m_timelineScene->clear();
+    delete m_queue;
+    delete m_store;
+    delete m_rollingStats;
     delete ui;
 }
 
 void MainWindow::on_startButton_clicked()
 {
     if (m_tracerThread && m_tracerThread->isRunning()) {
-        m_tracer->stop();
+        if (m_remote)
+            m_remote->stop();
+        else
+            m_tracer->stop();
         ui->startButton->setEnabled(false);
         return;
     }
 
-    bool ok;
-    unsigned int pid = ui->pidInput->text().toUInt(&ok);
-    if (!ok || ui->pidInput->text().isEmpty()) {
-        QMessageBox::warning(this, "Invalid PID", "Please enter a valid process ID.");
+    // 填了 cgroup 时追踪其中的全部进程，不需要 PID
+    const QString cgroupPath = ui->cgroupEdit->text().trimmed();
+    const bool byCgroup = !cgroupPath.isEmpty();
+    unsigned int pid = 0;
+    if (!byCgroup) {
+        bool ok;
+        pid = ui->pidInput->text().toUInt(&ok);
+        if (!ok || ui->pidInput->text().isEmpty()) {
+            QMessageBox::warning(this, "Invalid PID", "Please enter a valid process ID.");
+            return;
+        }
+    }
+
+    // 需要采集调用栈的 syscall：名字或编号，逗号/空白分隔
+    QSet<int> stackSyscalls;
+    const QStringList stackNames = ui->stackSyscallsEdit->text().split(QRegularExpression("[,\\s]+"), Qt::SkipEmptyParts);
+    for (const QString &name : stackNames) {
+        int nr = syscallFromName(name);
+        if (nr < 0) {
+            QMessageBox::warning(this, "Unknown Syscall", QString("\"%1\" is not a known syscall name.").arg(name));
+            return;
+        }
+        stackSyscalls.insert(nr);
+    }
+
+    // 追踪过滤表达式：在追踪线程上求值，只编译一次
+    SyscallFilter traceFilter;
+    QString filterError;
+    if (!SyscallFilter::compile(ui->traceFilterEdit->text(), traceFilter, &filterError)) {
+        QMessageBox::warning(this, "Trace Filter", QString("Invalid trace filter: %1").arg(filterError));
         return;
     }
 
+    // 远程代理：过滤表达式以文本发给代理，在代理端编译和求值；
+    // 调用栈、调度拆分、飞行记录器和地址空间/网络/锁面板依赖本机的追踪器，远程时不可用
+    agentprotocol::Address agentAddress;
+    const QString agentText = ui->agentEdit->text().trimmed();
+    const bool remote = !agentText.isEmpty();
+    if (remote) {
+        QString addressError;
+        if (!agentprotocol::parseAddress(agentText, agentAddress, &addressError)) {
+            QMessageBox::warning(this, "Agent", QString("Invalid agent address: %1").arg(addressError));
+            return;
+        }
+        if (ui->flightRecorderCheckBox->isChecked()) {
+            QMessageBox::warning(this, "Agent", "The flight recorder is only available when tracing locally.");
+            return;
+        }
+        if (byCgroup) {
+            QMessageBox::warning(this, "Agent", "Attaching to a cgroup is only available when tracing locally.");
+            return;
+        }
+    }
+
+    // 飞行记录器的触发条件
+    FlightRecorder::Config recorderConfig;
+    const bool flightRecorder = ui->flightRecorderCheckBox->isChecked();
+    if (flightRecorder) {
+        recorderConfig.windowNs = quint64(ui->recorderWindowSpin->value()) * 1000000000ULL;
+        recorderConfig.bufferBytes = quint64(ui->recorderBufferSpin->value()) << 20;
+        recorderConfig.latencyNs = quint64(ui->latencyTriggerSpin->value() * 1e6);
+        recorderConfig.rateSpike = ui->rateTriggerSpin->value();
+        recorderConfig.directory = ui->recorderDirEdit->text();
+        const QString errName = ui->errnoTriggerEdit->text().trimmed();
+        if (!errName.isEmpty()) {
+            recorderConfig.err = ErrnoStats::errnoFromName(errName);
+            if (recorderConfig.err == 0) {
+                QMessageBox::warning(this, "Unknown Errno", QString("\"%1\" is not a known errno name.").arg(errName));
+                return;
+            }
+        }
+        if (!QDir(recorderConfig.directory).exists()) {
+            QMessageBox::warning(this, "Flight Recorder", QString("Output directory %1 does not exist.").arg(recorderConfig.directory));
+            return;
+        }
+    }
+
     // --- 重置所有UI和数据，为新的追踪做准备 ---
 
     // 1. 清理旧数据
     m_syscallCounts.clear();
     m_timelineScene->clear();
-    m_syscallLaneMap.clear();
+    m_currentBlock = nullptr;
+    m_syscallLanes.fill(-1, RollingStats::kMaxSyscall);
+    m_syscallLaneOf.fill(-1, RollingStats::kMaxSyscall);
+    m_categoryLaneOf.fill(-1, SyscallCategoryCount);
     m_nextLane = 0;
+    m_nextCategoryLane = 0;
     m_timelineStartTs = 0;
-    ui->syscallTable->setRowCount(0);
+    ui->timelineView->setMouseTracking(true);
+
+    // 新会话：先让表格、时间线和火焰图放开旧的 EventStore，再释放它
+    m_tableModel->setStore(nullptr);
+    ui->flameGraph->clear();
+    delete m_queue;
+    delete m_store;
+    m_store = new EventStore();
+    m_queue = new EventQueue();
+    m_tableModel->setStore(m_store);
+    applyFilter();
+    m_errnoStats.clear();
+    m_errnoRows.clear();
+    ui->errnoTable->setRowCount(0);
+    m_errnoTickClock.start();
+    m_timeSplits.clear();
+    m_timeSplitsDirty = false;
+    ui->timeSplitTable->setRowCount(0);
+    m_sequences.clear();
+    ui->sequenceTable->setRowCount(0);
+    m_categoryStats.clear();
+    m_categoryItems.clear();
+    ui->categoryTree->clear();
+    m_callTree.clear();
+    m_callTreeGeneration = m_callTree.generation();
+    m_addressSpace.clear();
+    if (m_memoryChart) {
+        for (QLineSeries *series : { m_mappedSeries, m_anonSeries, m_churnSeries })
+            series->clear();
+    }
+    ui->memoryStatsLabel->clear();
+    m_networkStats.clear();
+    m_networkRows.clear();
+    ui->networkTable->setRowCount(0);
+    ui->epollTable->setRowCount(0);
+    m_futexStats.clear();
+    ui->futexTable->setRowCount(0);
+    m_processTree.clear();
+    m_processItems.clear();
+    ui->processTree->clear();
+    ui->imageTable->setRowCount(0);
+    m_rollingStats->clear();
+    ui->latencyHeatmap->clear();
+    m_rateSeries->clear();
+    m_errorRateSeries->clear();
+    m_metrics.reset();
+    m_lastStops = m_lastWaitNs = m_lastProcessNs = m_lastHandleNs = 0;
+    m_diagnosticsClock.start();
 
     // 2. 重置图表
     m_chart->removeAllSeries();
@@ -154,7 +492,7 @@ void MainWindow::on_startButton_clicked()
     m_series = new QBarSeries();
     m_chart->addSeries(m_series);
 
-    m_chart->setTitle("Top 10 System Call Frequency");
+    m_chart->setTitle(m_categoryView ? "Syscall Category Frequency" : "Top 10 System Call Frequency");
     m_chart->setAnimationOptions(QChart::SeriesAnimations);
 
     // --- 使用新的 API ---
@@ -175,82 +513,179 @@ void MainWindow::on_startButton_clicked()
 
     // --- 启动追踪线程---
     m_tracerThread = new QThread();
-    m_tracer = new Tracer();
-    m_tracer->moveToThread(m_tracerThread);
-
-    connect(m_tracerThread, &QThread::started, m_tracer, [this, pid](){ m_tracer->start(pid); });
-    connect(m_tracer, &Tracer::finished, this, &MainWindow::onTracingFinished);
-    connect(m_tracer, &Tracer::newSyscallData, this, &MainWindow::handleSyscallData);
-
-    m_tracerThread->start();
+    if (remote) {
+        m_remote = new RemoteTracer(agentAddress);
+        m_remote->setMetrics(&m_metrics);
+        m_remote->setEventSink(m_queue, &m_store->strings());
+        m_remote->setFilterText(ui->traceFilterEdit->text());
+        m_remote->setMode(agentprotocol::Mode(ui->agentModeCombo->currentData().toInt()));
+        m_remote->moveToThread(m_tracerThread);
+        connect(m_tracerThread, &QThread::started, m_remote, [this, pid](){ m_remote->start(pid); });
+        connect(m_remote, &RemoteTracer::finished, this, &MainWindow::onTracingFinished);
+        m_tracerThread->start();
+        statusBar()->showMessage(QString("Tracing PID %1 through agent %2").arg(pid).arg(agentText));
+    } else {
+        m_tracer = new Tracer();
+        m_tracer->setSchedSampling(ui->schedstatCheckBox->isChecked());
+        m_tracer->setMetrics(&m_metrics);
+        m_tracer->setEventSink(m_queue, &m_store->strings());
+        m_tracer->setStackCapture(stackSyscalls, &m_callTree);
+        m_tracer->setFlightRecorder(flightRecorder, recorderConfig);
+        m_tracer->setFilter(traceFilter);
+        m_tracer->setAddressSpace(&m_addressSpace);
+        m_tracer->setNetworkStats(&m_networkStats);
+        m_tracer->setFutexStats(&m_futexStats);
+        m_tracer->setFollowChildren(ui->followChildrenCheckBox->isChecked());
+        m_tracer->setProcessTree(&m_processTree);
+        m_tracer->setCgroup(cgroupPath);
+        m_tracer->moveToThread(m_tracerThread);
+
+        connect(m_tracerThread, &QThread::started, m_tracer, [this, pid](){ m_tracer->start(pid); });
+        connect(m_tracer, &Tracer::finished, this, &MainWindow::onTracingFinished);
+        connect(m_tracer, &Tracer::newSyscallTiming, this, &MainWindow::handleSyscallTiming);
+        connect(m_tracer, &Tracer::flightRecorderDumped, this, &MainWindow::onFlightRecorderDumped);
+
+        m_tracerThread->start();
+        // 最近追踪的进程列表只记本机的 PID，按 cgroup 追踪时不记
+        if (byCgroup)
+            statusBar()->showMessage(QString("Tracing every process in cgroup %1").arg(cgroupPath));
+        else
+            rememberTarget(pid);
+    }
 
     // --- 更新UI状态 ---
+    saveSession();
     ui->startButton->setText("Stop Tracing");
     ui->pidInput->setEnabled(false);
+    ui->schedstatCheckBox->setEnabled(false);
+    ui->followChildrenCheckBox->setEnabled(false);
+    ui->cgroupEdit->setEnabled(false);
+    ui->stackSyscallsEdit->setEnabled(false);
+    ui->traceFilterEdit->setEnabled(false);
+    ui->agentEdit->setEnabled(false);
+    setRecorderInputsEnabled(false);
+    ui->dumpNowButton->setEnabled(flightRecorder);
+    if (flightRecorder)
+        statusBar()->showMessage("Flight recorder armed: events are kept in the ring buffer and only written out on a trigger");
     m_chartUpdateTimer->start(1000); // 启动图表更新定时器
+    m_drainTimer->start(30);
 }
-// 新的槽函数，用于处理接收到的数据
-void MainWindow::handleSyscallData(quint64 ts, quint64 duration, long ret, long syscall, unsigned int pid, const QString& comm)
+// 定时器槽函数：从事件队列批量取出事件，写入 EventStore 并更新各项统计，
+// 表格和时间线每批只通知一次
+bool MainWindow::drainEvents()
 {
-    // --- 更新表格 ---
-    int row = ui->syscallTable->rowCount();
-    ui->syscallTable->insertRow(row);
-    ui->syscallTable->setItem(row, 0, new QTableWidgetItem(QString::number(pid)));
-    ui->syscallTable->setItem(row, 1, new QTableWidgetItem(comm));
-    ui->syscallTable->setItem(row, 2, new QTableWidgetItem(QString::number(syscall)));
-
-    QString syscallName = getSyscallName(syscall);
-    ui->syscallTable->setItem(row, 3, new QTableWidgetItem(syscallName));
-    ui->syscallTable->setItem(row, 4, new QTableWidgetItem(QString::number(ret)));
+    if (!m_queue || !m_store)
+        return false;
+
+    QElapsedTimer handleClock;
+    handleClock.start();
+
+    if (m_remote)
+        applyRemoteSummaries();
+
+    quint64 firstNew = m_store->size();
+    size_t n;
+    int batches = 0;
+    bool more = false;
+    while ((n = m_queue->pop(m_drainBuffer.data(), m_drainBuffer.size())) > 0) {
+        for (size_t i = 0; i < n; ++i)
+            recordEvent(m_drainBuffer[i]);
+        TracerMetrics::add(m_metrics.consumed, n);
+        if (++batches >= kDrainBatchesPerTick || handleClock.nsecsElapsed() >= kDrainBudgetNs) {
+            more = true;
+            break;
+        }
+    }
+    quint64 end = m_store->size();
+    if (end == firstNew)
+        return false;
 
+    // --- 更新表格 ---
+    if (m_filterPending)
+        applyFilter();
+    m_tableModel->syncRows();
     ui->syscallTable->scrollToBottom();
-    QString name = getSyscallName(syscall);
-    m_syscallCounts[name]++; // 增加对应系统调用的计数
 
-    // --- 更新时间线 ---
-        if (m_timelineStartTs == 0) {
-        m_timelineStartTs = ts; // 将第一个事件的时间戳作为时间线的起点
+    // --- 更新时间线：每 kEventsPerBlock 个事件一个图元 ---
+    if (m_timelineStartTs == 0) {
+        m_timelineStartTs = m_store->at(0).ts; // 将第一个事件的时间戳作为时间线的起点
     }
-    ui->timelineView->setMouseTracking(true);
-    // 为 syscall 分配一个 "泳道" (Y 轴位置)
-    if (!m_syscallLaneMap.contains(syscallName)) {
-        m_syscallLaneMap[syscallName] = m_nextLane++;
+    quint64 next = firstNew;
+    while (next < end) {
+        if (!m_currentBlock || m_currentBlock->isFull()) {
+            m_currentBlock = new TimelineBlockItem(m_store, &m_syscallLanes, next, m_timelineStartTs);
+            m_timelineScene->addItem(m_currentBlock);
+        }
+        quint64 blockEnd = qMin(end, next + m_currentBlock->capacityLeft());
+        m_currentBlock->extendTo(blockEnd);
+        next = blockEnd;
     }
-    int lane = m_syscallLaneMap[syscallName];
-
-    // 定义时间线的缩放比例和尺寸
-    const double scale = 0.00001; // 100,000 ns = 1 pixel
-    const int laneHeight = 20;
-    const int laneSpacing = 5;
 
-    // 计算矩形的位置和大小
-    double x = (ts - m_timelineStartTs) * scale;
-    double y = lane * (laneHeight + laneSpacing);
-    double w = (duration > 0) ? (duration * scale) : 2.0; // 持续时间太短的给个最小宽度
+    // 自动滚动到最新的事件
+    ui->timelineView->ensureVisible(m_currentBlock->eventRect(end - 1), 50, 50);
 
-    // 创建一个代表该系统调用的矩形
-    QGraphicsRectItem *item = new QGraphicsRectItem(x, y, w, laneHeight);
+    TracerMetrics::add(m_metrics.handleNs, handleClock.nsecsElapsed());
+    return more;
+}
 
-    // 根据系统调用类型设置不同颜色
-    QColor color = QColor::fromHsv((syscall * 20) % 360, 200, 230);
-    item->setBrush(color);
-    item->setPen(Qt::NoPen);
+// 代理在 Summary/Auto 模式下发来的按秒合计：没有单个事件，只计入 Top 10 的累计计数和滚动统计
+// （时间窗口 Top 10、速率曲线）；表格、时间线、errno 等按事件的面板看不到这部分调用
+void MainWindow::applyRemoteSummaries()
+{
+    const std::vector<agentprotocol::SummaryEntry> summaries = m_remote->takeSummaries();
+    for (const agentprotocol::SummaryEntry &s : summaries) {
+        m_syscallCounts[s.syscall] += int(s.count);
+        m_rollingStats->recordSummary(s.second, s.syscall, s.count, s.errors, s.durationNs);
+    }
+}
 
-    // 添加工具提示，鼠标悬浮时显示详细信息
-    item->setToolTip(QString("Syscall: %1\nStart: %2 \nDuration: %3 ")
-                         .arg(syscallName)
-                         .arg(formatTimestamp(ts))
-                         .arg(formatDuration(duration)));
+void MainWindow::recordEvent(const SyscallEvent &e)
+{
+    m_store->append(e);
+    m_syscallCounts[e.syscall]++; // 增加对应系统调用的计数
+    m_errnoStats.record(e.syscall, e.ret, e.tid, e.ts);
+    m_rollingStats->record(e.ts, e.syscall, e.duration, ErrnoStats::errnoFromRet(e.ret) != 0);
+    m_sequences.record(e.tid, e.syscall, e.duration, e.pathId);
+    m_categoryStats.record(e.syscall, e.ret, e.duration);
+
+    // 为 syscall 分配一个 "泳道" (Y 轴位置)，同时给它的分类分配一个
+    if (e.syscall >= 0 && e.syscall < m_syscallLanes.size() && m_syscallLanes[e.syscall] < 0) {
+        m_syscallLaneOf[e.syscall] = m_nextLane++;
+        int category = getSyscallCategory(e.syscall);
+        if (m_categoryLaneOf[category] < 0)
+            m_categoryLaneOf[category] = m_nextCategoryLane++;
+        m_syscallLanes[e.syscall] = m_categoryView ? m_categoryLaneOf[category] : m_syscallLaneOf[e.syscall];
+    }
+}
 
-    m_timelineScene->addItem(item);
+// 切换按 syscall / 按分类显示：重算每个 syscall 的泳道，已有的图元按新泳道重新计算范围
+void MainWindow::rebuildTimelineLanes()
+{
+    for (int nr = 0; nr < m_syscallLanes.size(); ++nr) {
+        if (m_syscallLaneOf[nr] >= 0)
+            m_syscallLanes[nr] = m_categoryView ? m_categoryLaneOf[getSyscallCategory(nr)] : m_syscallLaneOf[nr];
+    }
+    for (QGraphicsItem *item : m_timelineScene->items()) {
+        if (auto *block = dynamic_cast<TimelineBlockItem*>(item))
+            block->relayout();
+    }
+}
 
-    // 自动滚动到最新的事件
-    ui->timelineView->ensureVisible(item, 50, 50);
+void MainWindow::on_categoryViewCheckBox_toggled(bool checked)
+{
+    m_categoryView = checked;
+    rebuildTimelineLanes();
+    if (m_series)
+        updateFrequencyChart();
 }
 
 // 槽函数，用于处理追踪结束的事件
 void MainWindow::onTracingFinished(const QString& message)
 {
+    // 追踪线程已经停止写入，把队列里剩下的事件取完再刷新一次面板
+    m_drainTimer->stop();
+    while (drainEvents()) {}
+    refreshPanels();
     m_chartUpdateTimer->stop();
     m_tracerThread->quit();
     m_tracerThread->wait();
@@ -258,9 +693,19 @@ void MainWindow::onTracingFinished(const QString& message)
     m_tracerThread = nullptr;
     delete m_tracer;
     m_tracer = nullptr;
+    delete m_remote;
+    m_remote = nullptr;
 
     ui->startButton->setText("Start Tracing");
     ui->pidInput->setEnabled(true);
+    ui->schedstatCheckBox->setEnabled(true);
+    ui->followChildrenCheckBox->setEnabled(true);
+    ui->cgroupEdit->setEnabled(true);
+    ui->stackSyscallsEdit->setEnabled(true);
+    ui->traceFilterEdit->setEnabled(true);
+    ui->agentEdit->setEnabled(true);
+    setRecorderInputsEnabled(true);
+    ui->dumpNowButton->setEnabled(false);
     ui->startButton->setEnabled(true);
 
     if (!message.contains("stopped")) { // 如果不是正常停止，则显示错误信息
@@ -268,6 +713,517 @@ void MainWindow::onTracingFinished(const QString& message)
     }
 }
 
+// 定时器槽函数：批量刷新所有统计面板，并记录这次刷新的耗时
+void MainWindow::refreshPanels()
+{
+    QElapsedTimer flushClock;
+    flushClock.start();
+    updateFrequencyChart();
+    updateRateChart();
+    updateErrnoTable();
+    updateTimeSplitTable();
+    updateSequenceTable();
+    updateFlameGraph();
+    updateCategoryTree();
+    updateMemoryPanel();
+    updateNetworkPanel();
+    updateLocksPanel();
+    updateProcessesPanel();
+    // 热力图每秒只补一两列，标签页不可见时也推进，否则切回来时超出滚动统计的那段历史就没了
+    ui->latencyHeatmap->advance(*m_rollingStats, currentMonotonicSecond());
+    m_metrics.lastFlushNs.store(flushClock.nsecsElapsed(), std::memory_order_relaxed);
+
+    updateDiagnostics();
+}
+
+// 状态栏：根据两次刷新之间计数器的增量计算速率和时间占比
+void MainWindow::updateDiagnostics()
+{
+    m_metrics.storageBytes.store(m_store ? m_store->memoryBytes() : 0, std::memory_order_relaxed);
+
+    double elapsedSec = m_diagnosticsClock.restart() / 1000.0;
+    if (elapsedSec <= 0)
+        return;
+
+    quint64 stops = m_metrics.stops.load(std::memory_order_relaxed);
+    quint64 waitNs = m_metrics.waitNs.load(std::memory_order_relaxed);
+    quint64 processNs = m_metrics.processNs.load(std::memory_order_relaxed);
+    quint64 handleNs = m_metrics.handleNs.load(std::memory_order_relaxed);
+
+    quint64 dWait = waitNs - m_lastWaitNs;
+    quint64 dProcess = processNs - m_lastProcessNs;
+    double waitPercent = (dWait + dProcess) > 0 ? 100.0 * dWait / (dWait + dProcess) : 0.0;
+    double guiBusyPercent = 100.0 * (handleNs - m_lastHandleNs) / (elapsedSec * 1e9);
+
+    m_diagnosticsLabel->setText(
+        QString("stops/s: %1 | waitpid: %2% / processing: %3% | queue: %4 | dropped: %5 | "
+                "GUI busy: %6% | flush: %7 | storage: ~%8 MB")
+            .arg(qRound((stops - m_lastStops) / elapsedSec))
+            .arg(waitPercent, 0, 'f', 1)
+            .arg(100.0 - waitPercent, 0, 'f', 1)
+            .arg(m_metrics.queueDepth())
+            .arg(m_metrics.dropped.load(std::memory_order_relaxed))
+            .arg(guiBusyPercent, 0, 'f', 1)
+            .arg(formatDuration(m_metrics.lastFlushNs.load(std::memory_order_relaxed)))
+            .arg(m_metrics.storageBytes.load(std::memory_order_relaxed) / (1024.0 * 1024.0), 0, 'f', 1));
+    // 设置了追踪过滤时附带被排除的事件数
+    quint64 filtered = m_metrics.filtered.load(std::memory_order_relaxed);
+    if (filtered > 0)
+        m_diagnosticsLabel->setText(m_diagnosticsLabel->text() + QString(" | filtered: %1").arg(filtered));
+    // 开启调用栈采集时附带回溯的平均开销
+    quint64 stacks = m_metrics.stacks.load(std::memory_order_relaxed);
+    if (stacks > 0)
+        m_diagnosticsLabel->setText(m_diagnosticsLabel->text()
+                                    + QString(" | stacks: %1 (avg %2)")
+                                          .arg(stacks)
+                                          .arg(formatDuration(m_metrics.stackNs.load(std::memory_order_relaxed) / stacks)));
+
+    m_lastStops = stops;
+    m_lastWaitNs = waitNs;
+    m_lastProcessNs = processNs;
+    m_lastHandleNs = handleNs;
+}
+
+void MainWindow::setRecorderInputsEnabled(bool enabled)
+{
+    for (QWidget *w : std::initializer_list<QWidget*>{ ui->flightRecorderCheckBox, ui->recorderWindowSpin, ui->recorderBufferSpin,
+                                                       ui->latencyTriggerSpin, ui->errnoTriggerEdit, ui->rateTriggerSpin,
+                                                       ui->recorderDirEdit })
+        w->setEnabled(enabled);
+}
+
+// 手动触发：按钮或 F9。追踪线程在下一次停顿时写出
+void MainWindow::on_dumpNowButton_clicked()
+{
+    if (!m_tracer || !ui->dumpNowButton->isEnabled())
+        return;
+    m_tracer->requestDump();
+    statusBar()->showMessage("Flight recorder dump requested", 3000);
+}
+
+void MainWindow::onFlightRecorderDumped(const QString &path, const QString &reason, quint64 events, const QString &error)
+{
+    QString text = error.isEmpty()
+                       ? QString("[%1] %2 (%3 events)").arg(reason, path).arg(events)
+                       : QString("[%1] failed: %2").arg(reason, error);
+    ui->dumpList->addItem(text);
+    ui->dumpList->scrollToBottom();
+    statusBar()->showMessage(QString("Flight recorder: %1").arg(text), 5000);
+}
+
+// 重复序列表：标签页可见时才刷新，最多显示 20 个
+void MainWindow::updateSequenceTable()
+{
+    if (!m_store || ui->analysisTabs->currentWidget() != ui->sequencesTab)
+        return;
+
+    const QVector<SequenceMiner::Pattern> patterns = m_sequences.top(20);
+    ui->sequenceTable->setRowCount(patterns.size());
+    for (int row = 0; row < patterns.size(); ++row) {
+        const SequenceMiner::Pattern &p = patterns.at(row);
+        QStringList names;
+        for (int i = 0; i < SequenceMiner::length(p.key); ++i)
+            names << getSyscallName(SequenceMiner::syscallAt(p.key, i));
+        QString count = QString::number(p.count);
+        if (p.error > 0)
+            count += QString(" (±%1)").arg(p.error);
+        QString identical = p.lastArgs != 0 || p.sameArgs > 0
+                                ? QString::number(100.0 * p.sameArgs / p.count, 'f', 1)
+                                : QString("-");
+        QStringList cells = { names.join(" → "), count, formatDuration(p.totalNs),
+                              formatDuration(p.totalNs / p.count), identical,
+                              p.pathId ? m_store->strings().string(p.pathId) : QString() };
+        for (int col = 0; col < cells.size(); ++col) {
+            QTableWidgetItem *item = ui->sequenceTable->item(row, col);
+            if (!item) {
+                item = new QTableWidgetItem();
+                ui->sequenceTable->setItem(row, col, item);
+            }
+            item->setText(cells.at(col));
+        }
+        // 参数几乎每次都相同的循环最可能是可以缓存掉的冗余调用
+        bool redundant = p.lastArgs != 0 && p.sameArgs * 10 >= p.count * 9;
+        ui->sequenceTable->item(row, 0)->setForeground(redundant ? QBrush(Qt::red) : QBrush());
+    }
+}
+
+// 火焰图：标签页可见且调用树有变化时才取快照重新布局
+void MainWindow::updateFlameGraph()
+{
+    if (!m_store || ui->analysisTabs->currentWidget() != ui->stacksTab)
+        return;
+    quint64 generation = m_callTree.generation();
+    if (generation == m_callTreeGeneration)
+        return;
+    m_callTreeGeneration = generation;
+    ui->flameGraph->setTree(m_callTree.snapshot(), &m_store->strings());
+}
+
+// 只刷新上个周期内有变化的节点；标签页不可见时变化留到切换过来时再刷新
+void MainWindow::updateCategoryTree()
+{
+    if (ui->analysisTabs->currentWidget() != ui->categoryTab)
+        return;
+    const QList<quint64> changed = m_categoryStats.takeChanged();
+    if (changed.isEmpty())
+        return;
+
+    // 更新期间关闭排序，否则每次 setData 都会让行跳动
+    ui->categoryTree->setSortingEnabled(false);
+    for (quint64 key : changed) {
+        const CategoryStats::Node *n = m_categoryStats.node(key);
+        if (!n)
+            continue;
+        QTreeWidgetItem *item = m_categoryItems.value(key, nullptr);
+        if (!item) {
+            // 父节点总是和子节点一起变化，并且排在前面，这里一定已经建好
+            switch (CategoryStats::levelOf(key)) {
+            case CategoryStats::CategoryLevel:
+                item = new QTreeWidgetItem(ui->categoryTree, { getSyscallCategoryName(CategoryStats::categoryOf(key)) });
+                break;
+            case CategoryStats::SyscallLevel:
+                item = new QTreeWidgetItem(m_categoryItems.value(CategoryStats::parentKey(key)),
+                                           { getSyscallName(CategoryStats::syscallOf(key)) });
+                break;
+            case CategoryStats::ErrnoLevel:
+                item = new QTreeWidgetItem(m_categoryItems.value(CategoryStats::parentKey(key)),
+                                           { ErrnoStats::errnoName(CategoryStats::errnoOf(key)) });
+                break;
+            }
+            m_categoryItems.insert(key, item);
+        }
+        item->setData(1, Qt::DisplayRole, QVariant::fromValue<qulonglong>(n->count));
+        item->setData(2, Qt::DisplayRole, QVariant::fromValue<qulonglong>(n->errors));
+        item->setText(3, formatDuration(n->durationNs));
+        item->setText(4, formatDuration(n->durationNs / n->count));
+        item->setText(5, formatDuration(n->maxNs));
+    }
+    ui->categoryTree->setSortingEnabled(true);
+}
+
+// 地址空间增长曲线：第一次切到 Memory 标签页时才创建
+void MainWindow::ensureMemoryChart()
+{
+    if (m_memoryChart)
+        return;
+    m_memoryChart = new QChart();
+    m_mappedSeries = new QLineSeries();
+    m_mappedSeries->setName("mapped MB");
+    m_anonSeries = new QLineSeries();
+    m_anonSeries->setName("anonymous MB");
+    m_churnSeries = new QLineSeries();
+    m_churnSeries->setName("churn MB/s");
+    for (QLineSeries *series : { m_mappedSeries, m_anonSeries, m_churnSeries })
+        m_memoryChart->addSeries(series);
+    QValueAxis *memoryAxisX = new QValueAxis();
+    memoryAxisX->setRange(-(AddressSpace::kHistorySeconds - 1), 0);
+    memoryAxisX->setLabelFormat("%d");
+    memoryAxisX->setTitleText("Seconds ago");
+    QValueAxis *memoryAxisY = new QValueAxis();
+    memoryAxisY->setTitleText("Mapped (MB)");
+    QValueAxis *churnAxisY = new QValueAxis();
+    churnAxisY->setTitleText("Churn (MB/s)");
+    m_memoryChart->addAxis(memoryAxisX, Qt::AlignBottom);
+    m_memoryChart->addAxis(memoryAxisY, Qt::AlignLeft);
+    m_memoryChart->addAxis(churnAxisY, Qt::AlignRight);
+    for (QLineSeries *series : { m_mappedSeries, m_anonSeries }) {
+        series->attachAxis(memoryAxisX);
+        series->attachAxis(memoryAxisY);
+    }
+    m_churnSeries->attachAxis(memoryAxisX);
+    m_churnSeries->attachAxis(churnAxisY);
+    m_memoryChart->setTitle("Address Space Growth");
+    ui->memoryChartView->setChart(m_memoryChart);
+    ui->memoryChartView->setRenderHint(QPainter::Antialiasing);
+}
+
+// 地址空间面板：曲线按秒重建（没有变化的秒沿用前一秒的映射量），文字汇总抖动迹象
+void MainWindow::updateMemoryPanel()
+{
+    if (ui->analysisTabs->currentWidget() != ui->memoryTab)
+        return;
+    ensureMemoryChart();
+    const double MB = 1024.0 * 1024.0;
+    const AddressSpace::Stats stats = m_addressSpace.stats();
+    const std::vector<AddressSpace::Sample> history = m_addressSpace.history();
+
+    qint64 now = currentMonotonicSecond();
+    QVector<QPointF> mapped, anon, churn;
+    double peak = 0, peakChurn = 0;
+    double lastMapped = 0, lastAnon = 0;
+    bool started = false;
+    quint64 recentBytes = 0, recentCalls = 0;
+    size_t next = 0;
+    for (int ago = AddressSpace::kHistorySeconds - 1; ago >= 0; --ago) {
+        qint64 second = now - ago;
+        double churnMb = 0;
+        while (next < history.size() && history[next].second <= second) {
+            const AddressSpace::Sample &s = history[next++];
+            lastMapped = s.mappedBytes / MB;
+            lastAnon = s.anonBytes / MB;
+            started = true;
+            if (s.second == second) {
+                churnMb = (s.bytesMapped + s.bytesUnmapped) / MB;
+                if (ago < 10) {
+                    recentBytes += s.bytesMapped + s.bytesUnmapped;
+                    recentCalls += s.calls;
+                }
+            }
+        }
+        if (!started)
+            continue;
+        mapped.append(QPointF(-ago, lastMapped));
+        anon.append(QPointF(-ago, lastAnon));
+        churn.append(QPointF(-ago, churnMb));
+        peak = qMax(peak, lastMapped);
+        peakChurn = qMax(peakChurn, churnMb);
+    }
+    m_mappedSeries->replace(mapped);
+    m_anonSeries->replace(anon);
+    m_churnSeries->replace(churn);
+    const QList<QAbstractAxis*> axes = m_memoryChart->axes(Qt::Vertical);
+    for (QAbstractAxis *axis : axes) {
+        QValueAxis *valueAxis = qobject_cast<QValueAxis*>(axis);
+        if (valueAxis)
+            valueAxis->setRange(0, qMax(valueAxis->alignment() == Qt::AlignRight ? peakChurn : peak, 1.0) * 1.1);
+    }
+
+    QString text = QString("Mapped: %1 MB in %2 regions (anonymous %3 MB) | churn (last 10 s): %4 MB/s, %5 calls/s | "
+                           "mmap/brk: %6, munmap: %7, mprotect: %8\n"
+                           "Short-lived mappings (< 1 s): %9 (%10 MB) | re-mapped same size within 1 s: %11 | "
+                           "brk shrink then regrow: %12 | mprotect splits: %13 | "
+                           "fresh anonymous pages (each faults on first touch): %14")
+                       .arg(stats.mappedBytes / MB, 0, 'f', 1)
+                       .arg(stats.regions)
+                       .arg(stats.anonBytes / MB, 0, 'f', 1)
+                       .arg(recentBytes / MB / 10.0, 0, 'f', 2)
+                       .arg(recentCalls / 10.0, 0, 'f', 1)
+                       .arg(stats.mapCalls)
+                       .arg(stats.unmapCalls)
+                       .arg(stats.protectCalls)
+                       .arg(stats.shortLived)
+                       .arg(stats.shortLivedBytes / MB, 0, 'f', 1)
+                       .arg(stats.remapSameSize)
+                       .arg(stats.brkRegrowths)
+                       .arg(stats.protectSplits)
+                       .arg(stats.freshAnonPages);
+    // 与对比表的 Hint 列一样，只在迹象明显时给出建议
+    if (stats.remapSameSize > 100 && stats.remapSameSize * 4 > stats.mapCalls)
+        text += "\nHint: the allocator keeps returning and re-requesting the same sizes; "
+                "a higher M_MMAP_THRESHOLD or a caching allocator keeps those pages mapped.";
+    if (stats.brkRegrowths > 20)
+        text += "\nHint: the heap is trimmed and then grown again; a higher M_TRIM_THRESHOLD avoids the repeated faults.";
+    ui->memoryStatsLabel->setText(text);
+}
+
+// 网络面板：只刷新上个周期内有变化的 socket；标签页不可见时变化留到切换过来时再取
+void MainWindow::updateNetworkPanel()
+{
+    if (ui->analysisTabs->currentWidget() != ui->networkTab)
+        return;
+    const NetworkStats::Changes changes = m_networkStats.takeChanges();
+
+    ui->networkTable->setSortingEnabled(false);
+    for (quint32 id : changes.removed) {
+        QTableWidgetItem *first = m_networkRows.take(id);
+        if (first)
+            ui->networkTable->removeRow(first->row());
+    }
+    for (const NetworkStats::Socket &s : changes.updated) {
+        int row;
+        QTableWidgetItem *first = m_networkRows.value(s.id, nullptr);
+        if (first) {
+            row = first->row();
+        } else {
+            row = ui->networkTable->rowCount();
+            ui->networkTable->insertRow(row);
+            first = new QTableWidgetItem();
+            ui->networkTable->setItem(row, 0, first);
+            for (int col = 1; col < 14; ++col)
+                ui->networkTable->setItem(row, col, new QTableWidgetItem());
+            m_networkRows.insert(s.id, first);
+        }
+        // 吞吐量按该 socket 第一次到最后一次活动之间的时间平均
+        double lifetimeSec = s.lastTs > s.firstTs ? (s.lastTs - s.firstTs) / 1e9 : 0.0;
+        first->setData(Qt::DisplayRole, s.fd);
+        ui->networkTable->item(row, 1)->setText(NetworkStats::protocolName(s.family, s.type));
+        ui->networkTable->item(row, 2)->setText(NetworkStats::stateName(s.state));
+        ui->networkTable->item(row, 3)->setText(s.local.isEmpty() ? "-" : s.local);
+        ui->networkTable->item(row, 4)->setText(s.peer.isEmpty() ? "-" : s.peer);
+        ui->networkTable->item(row, 5)->setData(Qt::DisplayRole, QVariant::fromValue<qulonglong>(s.calls));
+        ui->networkTable->item(row, 6)->setData(Qt::DisplayRole, QVariant::fromValue<qulonglong>(s.bytesOut));
+        ui->networkTable->item(row, 7)->setData(Qt::DisplayRole, QVariant::fromValue<qulonglong>(s.bytesIn));
+        ui->networkTable->item(row, 8)->setData(Qt::DisplayRole, lifetimeSec > 0 ? qRound(s.bytesOut / lifetimeSec * 10) / 10.0 : 0.0);
+        ui->networkTable->item(row, 9)->setData(Qt::DisplayRole, lifetimeSec > 0 ? qRound(s.bytesIn / lifetimeSec * 10) / 10.0 : 0.0);
+        ui->networkTable->item(row, 10)->setText(formatDuration(s.blockedNs));
+        ui->networkTable->item(row, 11)->setText(formatDuration(s.maxNs));
+        ui->networkTable->item(row, 12)->setText(s.connectNs ? formatDuration(s.connectNs) : "-");
+        ui->networkTable->item(row, 13)->setData(Qt::DisplayRole, QVariant::fromValue<qulonglong>(s.errors));
+    }
+    ui->networkTable->setSortingEnabled(true);
+
+    // epoll 表行数固定：每个分桶一行，最后一行是失败的调用
+    const NetworkStats::EpollStats epoll = m_networkStats.epollStats();
+    ui->epollTable->setRowCount(NetworkStats::kEpollBuckets + 1);
+    for (int b = 0; b < NetworkStats::kEpollBuckets; ++b) {
+        const NetworkStats::EpollBucket &bucket = epoll.buckets[b];
+        const QStringList cells = {
+            NetworkStats::epollBucketName(b),
+            QString::number(bucket.calls),
+            formatDuration(bucket.waitNs),
+            bucket.calls ? formatDuration(bucket.waitNs / bucket.calls) : "-",
+            formatDuration(bucket.maxNs),
+            QString::number(bucket.events),
+        };
+        for (int col = 0; col < cells.size(); ++col)
+            ui->epollTable->setItem(b, col, new QTableWidgetItem(cells.at(col)));
+    }
+    ui->epollTable->setItem(NetworkStats::kEpollBuckets, 0, new QTableWidgetItem("failed (EINTR ...)"));
+    ui->epollTable->setItem(NetworkStats::kEpollBuckets, 1, new QTableWidgetItem(QString::number(epoll.interrupted)));
+}
+
+// 锁竞争面板：排名靠前的 futex 地址整表重建，没有新的 futex 调用时不动
+void MainWindow::updateLocksPanel()
+{
+    if (ui->analysisTabs->currentWidget() != ui->locksTab || !m_futexStats.changed())
+        return;
+    FutexStats::Totals totals;
+    const std::vector<FutexStats::Lock> locks = m_futexStats.snapshot(200, &totals);
+
+    QString summary = QString("%1 futex calls on %2 addresses: %3 waits, %4 total wait, %5 wakes")
+                          .arg(totals.calls).arg(totals.addresses).arg(totals.waits)
+                          .arg(formatDuration(totals.waitNs)).arg(totals.wakeCalls);
+    if (totals.overflow)
+        summary += QString(" (%1 calls beyond %2 addresses not attributed)").arg(totals.overflow).arg(FutexStats::kMaxAddresses);
+    ui->futexSummaryLabel->setText(summary);
+
+    auto tidList = [](const pid_t *tids, int count) {
+        QStringList out;
+        for (int i = 0; i < count; ++i)
+            out << QString::number(tids[i]);
+        if (count == FutexStats::kMaxTids)
+            out << "...";
+        return out.join(", ");
+    };
+    ui->futexTable->setRowCount(int(locks.size()));
+    for (int row = 0; row < int(locks.size()); ++row) {
+        const FutexStats::Lock &l = locks[size_t(row)];
+        QStringList site;
+        for (quint32 frame : l.site) {
+            if (frame)
+                site << m_store->strings().string(frame);
+        }
+        QStringList kind;
+        kind << (l.shared ? "shared" : "private");
+        if (l.pi)
+            kind << "PI";
+        const QStringList cells = {
+            QString("0x%1").arg(l.uaddr, 0, 16),
+            kind.join(" "),
+            QString::number(l.waits),
+            formatDuration(l.waitNs),
+            l.waits ? formatDuration(l.waitNs / l.waits) : "-",
+            formatDuration(l.maxWaitNs),
+            QString::number(l.timeouts),
+            QString::number(l.retries),
+            QString::number(l.wakeCalls),
+            QString::number(l.woken),
+            QString::number(l.emptyWakes),
+            tidList(l.waiters, l.waiterCount),
+            tidList(l.wakers, l.wakerCount),
+            QString("%1 val=%2").arg(FutexStats::opName(l.lastOp)).arg(l.lastVal),
+            site.isEmpty() ? "-" : site.join(" <- "),
+        };
+        for (int col = 0; col < cells.size(); ++col)
+            ui->futexTable->setItem(row, col, new QTableWidgetItem(cells.at(col)));
+    }
+}
+
+// 进程面板：树节点只刷新有变化的进程，映像表按调用数整表重建；没有变化时不动
+void MainWindow::updateProcessesPanel()
+{
+    if (ui->analysisTabs->currentWidget() != ui->processesTab || !m_processTree.changed())
+        return;
+    const ProcessTree::Changes changes = m_processTree.takeChanges();
+    const quint64 now = currentMonotonicNs();
+
+    ui->processTree->setSortingEnabled(false);
+    for (const ProcessTree::Process &p : changes.updated) {
+        QTreeWidgetItem *item = m_processItems.value(p.index, nullptr);
+        if (!item) {
+            // 父进程先于子进程建节点，takeChanges 也按这个顺序给出
+            QTreeWidgetItem *parent = m_processItems.value(p.parent, nullptr);
+            item = parent ? new QTreeWidgetItem(parent) : new QTreeWidgetItem(ui->processTree);
+            item->setData(0, Qt::DisplayRole, int(p.pid));
+            item->setExpanded(true);
+            m_processItems.insert(p.index, item);
+        }
+        QString status = p.endNs == 0 ? "running" : p.detached ? "detached" : ProcessTree::exitText(p.exitStatus);
+        if (p.execs)
+            status += QString(", %1 exec").arg(p.execs);
+        if (p.threads > 1)
+            status += QString(", %1 threads").arg(p.threads);
+        item->setText(1, p.comm);
+        item->setText(2, p.image.isEmpty() ? "-" : p.image);
+        item->setData(3, Qt::DisplayRole, QVariant::fromValue<qulonglong>(p.calls));
+        item->setData(4, Qt::DisplayRole, QVariant::fromValue<qulonglong>(p.errors));
+        item->setText(5, formatDuration(p.syscallNs));
+        item->setText(6, formatDuration((p.endNs ? p.endNs : now) - p.startNs));
+        item->setText(7, status);
+    }
+    ui->processTree->setSortingEnabled(true);
+
+    std::vector<ProcessTree::Image> images = m_processTree.images(now);
+    std::sort(images.begin(), images.end(), [](const ProcessTree::Image &a, const ProcessTree::Image &b) {
+        return a.calls > b.calls;
+    });
+    const ProcessTree::Totals &totals = changes.totals;
+    QString summary = QString("%1 processes (%2 running), %3 threads, %4 exec, %5 images")
+                          .arg(totals.processes).arg(totals.running).arg(totals.threads)
+                          .arg(totals.execs).arg(images.size());
+    if (totals.overflow)
+        summary += QString(" (%1 processes beyond %2 not shown)").arg(totals.overflow).arg(ProcessTree::kMaxProcesses);
+    ui->processSummaryLabel->setText(summary);
+
+    ui->imageTable->setRowCount(int(images.size()));
+    for (int row = 0; row < int(images.size()); ++row) {
+        const ProcessTree::Image &image = images[size_t(row)];
+        // 剖面按该映像的 syscall 总耗时排序，表格里显示前三个，提示里显示前十五个
+        std::vector<int> order;
+        for (size_t nr = 0; nr < image.syscalls.size(); ++nr) {
+            if (image.syscalls[nr].calls)
+                order.push_back(int(nr));
+        }
+        std::sort(order.begin(), order.end(), [&image](int a, int b) {
+            return image.syscalls[size_t(a)].ns > image.syscalls[size_t(b)].ns;
+        });
+        QStringList top;
+        QStringList profile;
+        for (size_t i = 0; i < order.size() && i < 15; ++i) {
+            const ProcessTree::SyscallTotal &t = image.syscalls[size_t(order[i])];
+            const QString name = getSyscallName(order[i]);
+            if (i < 3)
+                top << QString("%1 %2%").arg(name).arg(image.syscallNs ? qRound(100.0 * t.ns / image.syscallNs) : 0);
+            profile << QString("%1: %2 calls, %3 errors, %4").arg(name).arg(t.calls).arg(t.errors).arg(formatDuration(t.ns));
+        }
+        const QStringList cells = {
+            image.path.isEmpty() ? "-" : image.path,
+            QString::number(image.processes),
+            QString::number(image.calls),
+            QString::number(image.errors),
+            formatDuration(image.syscallNs),
+            formatDuration(image.wallNs),
+            image.processes ? formatDuration(image.wallNs / image.processes) : "-",
+            top.isEmpty() ? "-" : top.join(", "),
+        };
+        for (int col = 0; col < cells.size(); ++col) {
+            QTableWidgetItem *item = new QTableWidgetItem(cells.at(col));
+            item->setToolTip(profile.join("\n"));
+            ui->imageTable->setItem(row, col, item);
+        }
+    }
+}
+
 // 实现新的槽函数 updateFrequencyChart():
 void MainWindow::updateFrequencyChart()
 {
@@ -275,8 +1231,35 @@ void MainWindow::updateFrequencyChart()
 
     // QMap 不方便按值排序，我们复制到一个 QList<QPair> 中
     QList<QPair<QString, int>> sortedCounts;
-    for(auto it = m_syscallCounts.constBegin(); it != m_syscallCounts.constEnd(); ++it) {
-        sortedCounts.append({it.key(), it.value()});
+    int windowSeconds = ui->windowCombo->currentData().toInt();
+    m_chart->setTitle(m_categoryView ? "Syscall Category Frequency" : "Top 10 System Call Frequency");
+    if (m_categoryView) {
+        // 按分类：同类的 syscall（read、pread64、readv……）合成一根柱子
+        quint64 counts[SyscallCategoryCount] = {};
+        if (windowSeconds == 0) {
+            for (int c = 0; c < SyscallCategoryCount; ++c)
+                counts[c] = m_categoryStats.category(c).count;
+        } else {
+            RollingStats::Window window;
+            m_rollingStats->query(windowSeconds, currentMonotonicSecond(), window);
+            for (int nr = 0; nr < RollingStats::kMaxSyscall; ++nr)
+                counts[getSyscallCategory(nr)] += window.counts[nr];
+        }
+        for (int c = 0; c < SyscallCategoryCount; ++c) {
+            if (counts[c] > 0)
+                sortedCounts.append({getSyscallCategoryName(c), int(counts[c])});
+        }
+    } else if (windowSeconds == 0) {
+        for(auto it = m_syscallCounts.constBegin(); it != m_syscallCounts.constEnd(); ++it) {
+            sortedCounts.append({getSyscallName(it.key()), it.value()});
+        }
+    } else {
+        RollingStats::Window window;
+        m_rollingStats->query(windowSeconds, currentMonotonicSecond(), window);
+        for (int nr = 0; nr < RollingStats::kMaxSyscall; ++nr) {
+            if (window.counts[nr] > 0)
+                sortedCounts.append({getSyscallName(nr), int(window.counts[nr])});
+        }
     }
 
     // 按计数值降序排序
@@ -314,6 +1297,294 @@ void MainWindow::updateFrequencyChart()
         }
     }
 }
+// 只刷新上个周期内有变化的 (syscall, errno) 行，避免整表重建
+void MainWindow::updateErrnoTable()
+{
+    double elapsedSec = m_errnoTickClock.restart() / 1000.0;
+    const QList<quint64> changed = m_errnoStats.tick(elapsedSec);
+    if (changed.isEmpty())
+        return;
+
+    // 更新期间关闭排序，否则每次 setData 都会让行跳动
+    ui->errnoTable->setSortingEnabled(false);
+    for (quint64 key : changed) {
+        const ErrnoStats::Entry *e = m_errnoStats.entry(key);
+        if (!e)
+            continue;
+
+        int row;
+        QTableWidgetItem *first = m_errnoRows.value(key, nullptr);
+        if (first) {
+            row = first->row();
+        } else {
+            row = ui->errnoTable->rowCount();
+            ui->errnoTable->insertRow(row);
+            first = new QTableWidgetItem(getSyscallName(e->syscall));
+            ui->errnoTable->setItem(row, 0, first);
+            ui->errnoTable->setItem(row, 1, new QTableWidgetItem(ErrnoStats::errnoName(e->err)));
+            for (int col = 2; col < 7; ++col)
+                ui->errnoTable->setItem(row, col, new QTableWidgetItem());
+            m_errnoRows.insert(key, first);
+        }
+
+        quint64 calls = m_errnoStats.callsFor(e->syscall);
+        double percent = calls > 0 ? 100.0 * e->count / calls : 0.0;
+        // 用 DisplayRole 存数值，排序时按数字而不是字符串比较
+        ui->errnoTable->item(row, 2)->setData(Qt::DisplayRole, QVariant::fromValue<qulonglong>(e->count));
+        ui->errnoTable->item(row, 3)->setData(Qt::DisplayRole, qRound(e->ratePerSec * 10) / 10.0);
+        ui->errnoTable->item(row, 4)->setData(Qt::DisplayRole, qRound(percent * 10) / 10.0);
+        ui->errnoTable->item(row, 5)->setData(Qt::DisplayRole, QVariant::fromValue<qulonglong>(e->retryLoops));
+        ui->errnoTable->item(row, 6)->setData(Qt::DisplayRole, QVariant::fromValue<qulonglong>(e->maxStreak));
+    }
+    ui->errnoTable->setSortingEnabled(true);
+}
+
+void MainWindow::handleSyscallTiming(long syscall, quint64 onCpu, quint64 runqWait, quint64 blocked)
+{
+    TimeSplit &t = m_timeSplits[syscall];
+    t.calls++;
+    t.onCpu += onCpu;
+    t.runqWait += runqWait;
+    t.blocked += blocked;
+    m_timeSplitsDirty = true;
+}
+
+// 行数只与出现过的 syscall 种类有关，直接整表重建即可
+void MainWindow::updateTimeSplitTable()
+{
+    if (!m_timeSplitsDirty)
+        return;
+    m_timeSplitsDirty = false;
+
+    ui->timeSplitTable->setSortingEnabled(false);
+    ui->timeSplitTable->setRowCount(m_timeSplits.size());
+    int row = 0;
+    for (auto it = m_timeSplits.constBegin(); it != m_timeSplits.constEnd(); ++it, ++row) {
+        const TimeSplit &t = it.value();
+        quint64 total = t.onCpu + t.runqWait + t.blocked;
+        auto percent = [total](quint64 part) {
+            return total > 0 ? qRound(1000.0 * part / total) / 10.0 : 0.0;
+        };
+
+        ui->timeSplitTable->setItem(row, 0, new QTableWidgetItem(getSyscallName(it.key())));
+        auto *callsItem = new QTableWidgetItem();
+        callsItem->setData(Qt::DisplayRole, QVariant::fromValue<qulonglong>(t.calls));
+        ui->timeSplitTable->setItem(row, 1, callsItem);
+        ui->timeSplitTable->setItem(row, 2, new QTableWidgetItem(formatDuration(total)));
+        const quint64 parts[3] = { t.onCpu, t.runqWait, t.blocked };
+        for (int i = 0; i < 3; ++i) {
+            auto *item = new QTableWidgetItem();
+            item->setData(Qt::DisplayRole, percent(parts[i]));
+            ui->timeSplitTable->setItem(row, 3 + i, item);
+        }
+    }
+    ui->timeSplitTable->setSortingEnabled(true);
+}
+
+// 用滚动统计中每一秒的桶重建速率曲线，点数固定为 kBuckets
+void MainWindow::updateRateChart()
+{
+    qint64 now = currentMonotonicSecond();
+    QVector<QPointF> calls;
+    QVector<QPointF> errors;
+    calls.reserve(RollingStats::kBuckets);
+    errors.reserve(RollingStats::kBuckets);
+    quint64 peak = 0;
+    for (int ago = RollingStats::kBuckets - 1; ago >= 0; --ago) {
+        const RollingStats::Bucket *b = m_rollingStats->bucketAt(now - ago);
+        quint64 total = b ? b->total : 0;
+        quint64 failed = b ? b->totalErrors : 0;
+        calls.append(QPointF(-ago, total));
+        errors.append(QPointF(-ago, failed));
+        peak = qMax(peak, total);
+    }
+    // replace() 一次性替换所有点，比逐点 append 少很多重绘
+    m_rateSeries->replace(calls);
+    m_errorRateSeries->replace(errors);
+
+    if (!m_rateChart->axes(Qt::Vertical).isEmpty()) {
+        QValueAxis *axisY = qobject_cast<QValueAxis*>(m_rateChart->axes(Qt::Vertical).first());
+        if (axisY)
+            axisY->setRange(0, qMax<quint64>(peak, 1));
+    }
+}
+
+void MainWindow::on_saveTraceButton_clicked()
+{
+    if (!m_store || m_store->size() == 0) {
+        QMessageBox::information(this, "Save Trace", "There are no events to save yet.");
+        return;
+    }
+    const QString compressedFilter = "Compressed qtsys traces (*.qtrace)";
+    QString selectedFilter;
+    QString path = QFileDialog::getSaveFileName(this, "Save Trace", QString(),
+                                                "qtsys traces (*.qtrace);;" + compressedFilter, &selectedFilter);
+    if (path.isEmpty())
+        return;
+    if (!path.endsWith(".qtrace"))
+        path += ".qtrace";
+
+    // 追踪仍在进行时也可以保存：只写出当前已经取到 GUI 的事件
+    TraceWriter::Options options;
+    options.compress = selectedFilter == compressedFilter;
+    TraceWriter writer;
+    bool ok = writer.open(path, options);
+    quint64 count = m_store->size();
+    // EventStore 的每个块内事件是连续的，整块交给 writer
+    for (quint64 i = 0; ok && i < count; i += EventStore::kBlockEvents)
+        ok = writer.write(&m_store->at(i), size_t(qMin(EventStore::kBlockEvents, count - i)));
+    ok = ok && writer.finish(m_store->strings());
+    if (!ok)
+        QMessageBox::warning(this, "Save Trace", writer.errorString());
+    else
+        statusBar()->showMessage(QString("Saved %1 events to %2").arg(count).arg(path), 5000);
+}
+
+void MainWindow::on_compareButton_clicked()
+{
+    QString pathA = QFileDialog::getOpenFileName(this, "Baseline Trace (A)", QString(), "qtsys traces (*.qtrace)");
+    if (pathA.isEmpty())
+        return;
+    QString pathB = QFileDialog::getOpenFileName(this, "New Trace (B)", QString(), "qtsys traces (*.qtrace)");
+    if (pathB.isEmpty())
+        return;
+
+    // 同一个文件时比较其中的两个时间窗口
+    TimeWindow windowA, windowB;
+    if (pathA == pathB) {
+        QString textA = QInputDialog::getText(this, "Window A", "Seconds from trace start (start:end):", QLineEdit::Normal, "0:10");
+        QString textB = QInputDialog::getText(this, "Window B", "Seconds from trace start (start:end):", QLineEdit::Normal, "10:");
+        if (!TimeWindow::parse(textA, windowA) || !TimeWindow::parse(textB, windowB)) {
+            QMessageBox::warning(this, "Compare Traces", "Invalid time window, expected start:end in seconds.");
+            return;
+        }
+    }
+
+    TraceProfile a, b;
+    QString error;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok = buildProfiles(pathA, windowA, pathB, windowB, a, b, &error);
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        QMessageBox::warning(this, "Compare Traces", error);
+        return;
+    }
+
+    if (m_categoryView) {
+        a = groupByCategory(a);
+        b = groupByCategory(b);
+    }
+    const QVector<DiffRow> rows = diffProfiles(a, b);
+    auto number = [](double v) {
+        auto *item = new QTableWidgetItem();
+        item->setData(Qt::DisplayRole, v);
+        return item;
+    };
+    auto duration = [](quint64 ns) {
+        auto *item = new QTableWidgetItem(formatDuration(qint64(ns)));
+        item->setData(Qt::UserRole, QVariant::fromValue<qulonglong>(ns));
+        return item;
+    };
+
+    ui->diffTable->setSortingEnabled(false);
+    ui->diffTable->setHorizontalHeaderItem(0, new QTableWidgetItem(a.byCategory ? "Category" : "Syscall"));
+    ui->diffTable->setRowCount(rows.size());
+    for (int row = 0; row < rows.size(); ++row) {
+        const DiffRow &r = rows.at(row);
+        double deltaPercent = r.rateA > 0 ? 100.0 * (r.rateB - r.rateA) / r.rateA : 0.0;
+        ui->diffTable->setItem(row, 0, new QTableWidgetItem(profileKeyName(a, r.syscall)));
+        ui->diffTable->setItem(row, 1, number(r.countA));
+        ui->diffTable->setItem(row, 2, number(r.countB));
+        ui->diffTable->setItem(row, 3, number(qRound(r.rateA * 10) / 10.0));
+        ui->diffTable->setItem(row, 4, number(qRound(r.rateB * 10) / 10.0));
+        ui->diffTable->setItem(row, 5, number(qRound(deltaPercent * 10) / 10.0));
+        ui->diffTable->setItem(row, 6, duration(r.p50A));
+        ui->diffTable->setItem(row, 7, duration(r.p50B));
+        ui->diffTable->setItem(row, 8, duration(r.p90A));
+        ui->diffTable->setItem(row, 9, duration(r.p90B));
+        ui->diffTable->setItem(row, 10, duration(r.p99A));
+        ui->diffTable->setItem(row, 11, duration(r.p99B));
+        ui->diffTable->setItem(row, 12, number(qRound(r.errRateA * 1000) / 10.0));
+        ui->diffTable->setItem(row, 13, number(qRound(r.errRateB * 1000) / 10.0));
+        ui->diffTable->setItem(row, 14, new QTableWidgetItem(r.hint));
+    }
+    ui->diffTable->setSortingEnabled(true);
+
+    // 条形图只画变化最显著的 10 个（rows 已按显著性排序），新出现的 syscall/分类没有基线，跳过
+    ensureDiffChart();
+    m_diffChart->removeAllSeries();
+    for (QAbstractAxis *axis : m_diffChart->axes())
+        m_diffChart->removeAxis(axis);
+    auto *set = new QBarSet("Δ rate %");
+    QStringList categories;
+    double extent = 1.0;
+    for (const DiffRow &r : rows) {
+        if (categories.size() >= 10)
+            break;
+        if (r.rateA <= 0)
+            continue;
+        double deltaPercent = 100.0 * (r.rateB - r.rateA) / r.rateA;
+        *set << deltaPercent;
+        categories << profileKeyName(a, r.syscall);
+        extent = qMax(extent, qAbs(deltaPercent));
+    }
+    auto *series = new QBarSeries();
+    series->append(set);
+    m_diffChart->addSeries(series);
+    auto *axisX = new QBarCategoryAxis();
+    axisX->append(categories);
+    auto *axisY = new QValueAxis();
+    axisY->setRange(-extent, extent);
+    axisY->setLabelFormat("%d");
+    m_diffChart->addAxis(axisX, Qt::AlignBottom);
+    m_diffChart->addAxis(axisY, Qt::AlignLeft);
+    series->attachAxis(axisX);
+    series->attachAxis(axisY);
+
+    ui->analysisTabs->setCurrentWidget(ui->diffTab);
+}
+
+void MainWindow::on_filterEdit_returnPressed()
+{
+    applyFilter();
+}
+
+// 过滤栏：解析失败时保留原来的过滤条件，输入框标红并在提示里给出原因
+void MainWindow::applyFilter()
+{
+    m_filterPending = false;
+    if (!m_store)
+        return;
+    QString text = ui->filterEdit->text().trimmed();
+    if (text.isEmpty()) {
+        ui->filterEdit->setStyleSheet(QString());
+        ui->filterEdit->setToolTip(QString());
+        m_tableModel->setFilter(nullptr);
+        return;
+    }
+
+    TraceQuery::Context context;
+    context.bootEpochNs = get_system_boot_time_epoch_ns();
+    if (m_store->size() > 0)
+        context.firstTs = m_store->at(0).ts;
+    else
+        m_filterPending = true;
+
+    TraceQuery query;
+    QString error;
+    if (!TraceQuery::parse(text, context, query, &error)) {
+        ui->filterEdit->setStyleSheet("QLineEdit { background: #ffd6d6; }");
+        ui->filterEdit->setToolTip(error);
+        statusBar()->showMessage(error, 5000);
+        return;
+    }
+    ui->filterEdit->setStyleSheet(QString());
+    ui->filterEdit->setToolTip(QString());
+    m_tableModel->setFilter(std::make_unique<TraceQuery>(query));
+    if (!m_filterPending)
+        statusBar()->showMessage(QString("%1 matching events").arg(m_tableModel->rowCount()), 3000);
+}
+
 void MainWindow::on_listWidget_itemSelectionChanged()
 {
     QList<QListWidgetItem *> selectedItems = ui->listWidget->selectedItems();
@@ -329,43 +1600,28 @@ void MainWindow::on_listWidget_itemSelectionChanged()
     }
 }
 
+// 刷新进程列表：扫描放到后台线程，窗口不等它；扫描期间列表里先显示最近追踪过的进程
 void MainWindow::populateProcessList()
 {
-    ui->listWidget->clear();
-    m_allProcesses.clear();
-    ui-> pidInput->clear();
-
-    QDir procDir("/proc");
-    // 过滤出目录，并只获取以数字命名的目录
-    QStringList pidDirs = procDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks, QDir::Name);
-
-    // 正则表达式来检查目录名是否完全是数字
-    QRegularExpression pidRx("^\\d+$");
-
-    for (const QString& dirName : pidDirs) {
-        if (pidRx.match(dirName).hasMatch()) {
-            qint64 pid = dirName.toLongLong();
-            // 现在调用我们新的辅助函数来获取进程名
-            QString processName = get_process_name(pid);
-            ProcessInfo info;
-            info.name = processName;
-            info.pid = pid;
-            m_allProcesses.append(info);
-        }
-    }
+    if (m_scanThread.joinable())
+        return; // 上一次扫描还没结束
+    ui->refreshButton->setEnabled(false);
+    m_scanCancel.store(false);
+    m_scanThread = std::thread([this]() {
+        QList<ProcessInfo> processes = processscan::scanProcesses(m_scanCancel);
+        if (m_scanCancel.load())
+            return;
+        QMetaObject::invokeMethod(this, [this, processes]() { onProcessScanFinished(processes); }, Qt::QueuedConnection);
+    });
+    fillProcessList(ui->lineEdit->text());
+}
 
-    // 填充QListWidget
-    if (m_allProcesses.isEmpty()) {
-        QListWidgetItem *item = new QListWidgetItem("未找到任何运行中的进程。", ui->listWidget);
-        item->setFlags(item->flags() & ~Qt::ItemIsSelectable);
-    } else {
-        for (int i = 0; i < m_allProcesses.size(); ++i) {
-            const ProcessInfo &info = m_allProcesses.at(i);
-            QString displayText = QString("%1 (PID: %2)").arg(info.name).arg(info.pid);
-            QListWidgetItem *item = new QListWidgetItem(displayText, ui->listWidget);
-            item->setData(Qt::UserRole, QVariant::fromValue(info.pid));
-        }
-    }
+void MainWindow::onProcessScanFinished(const QList<ProcessInfo> &processes)
+{
+    m_scanThread.join();
+    m_allProcesses = processes;
+    ui->refreshButton->setEnabled(true);
+    fillProcessList(ui->lineEdit->text());
 }
 
 void MainWindow::on_refreshButton_clicked()
@@ -375,27 +1631,175 @@ void MainWindow::on_refreshButton_clicked()
 
 void MainWindow::filterProcessList(const QString &text)
 {
+    fillProcessList(text);
+}
+
+// 最近追踪过、且仍以同一个名字在运行的进程（PID 被复用时名字通常不同）
+QList<ProcessInfo> MainWindow::liveRecentTargets() const
+{
+    QList<ProcessInfo> live;
+    for (const ProcessInfo &info : m_recentTargets) {
+        if (get_process_name(info.pid) == info.name)
+            live.append(info);
+    }
+    return live;
+}
+
+// 按关键字重建列表：最近追踪过的进程排在前面，之后是扫描结果；输入框里的 PID 保持选中
+void MainWindow::fillProcessList(const QString &text)
+{
+    // 重建列表时不让选择变化清掉 PID 输入框
+    QSignalBlocker blocker(ui->listWidget);
     ui->listWidget->clear();
 
     QString keyword = text.trimmed();
-
-    if (m_allProcesses.isEmpty()) {
-        return;
+    auto matches = [&keyword](const ProcessInfo &info) {
+        return info.name.contains(keyword, Qt::CaseInsensitive) || QString::number(info.pid).contains(keyword);
+    };
+    const qint64 currentPid = ui->pidInput->text().toLongLong();
+    auto addItem = [&](const ProcessInfo &info, const QString &displayText) {
+        QListWidgetItem *item = new QListWidgetItem(displayText, ui->listWidget);
+        item->setData(Qt::UserRole, QVariant::fromValue(info.pid));
+        if (info.pid == currentPid)
+            item->setSelected(true);
+    };
+
+    QSet<qint64> shown;
+    for (const ProcessInfo &info : liveRecentTargets()) {
+        if (matches(info)) {
+            addItem(info, QString("%1 (PID: %2) - recent").arg(info.name).arg(info.pid));
+            shown.insert(info.pid);
+        }
     }
-
-    int matchCount = 0;
     for (const ProcessInfo &info : m_allProcesses) {
-        if (info.name.contains(keyword, Qt::CaseInsensitive) ||
-            QString::number(info.pid).contains(keyword)) {
-            QString displayText = QString("%1 (PID: %2)").arg(info.name).arg(info.pid);
-            QListWidgetItem *item = new QListWidgetItem(displayText, ui->listWidget);
-            item->setData(Qt::UserRole, QVariant::fromValue(info.pid));
-            matchCount++;
+        if (!shown.contains(info.pid) && matches(info)) {
+            addItem(info, QString("%1 (PID: %2)").arg(info.name).arg(info.pid));
+            shown.insert(info.pid);
         }
     }
 
-    if (matchCount == 0) {
-        QListWidgetItem *item = new QListWidgetItem("未找到匹配的进程。", ui->listWidget);
+    QString placeholder;
+    if (m_scanThread.joinable())
+        placeholder = "正在扫描进程……";
+    else if (shown.isEmpty())
+        placeholder = m_allProcesses.isEmpty() ? "未找到任何运行中的进程。" : "未找到匹配的进程。";
+    if (!placeholder.isEmpty()) {
+        QListWidgetItem *item = new QListWidgetItem(placeholder, ui->listWidget);
         item->setFlags(item->flags() & ~Qt::ItemIsSelectable);
     }
 }
+
+// 会话文件：~/.config/SyscallMonitor/session.ini（随 XDG_CONFIG_HOME 变化）
+static QString sessionFilePath()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation)).filePath("session.ini");
+}
+
+void MainWindow::restoreSession()
+{
+    QSettings settings(sessionFilePath(), QSettings::IniFormat);
+    restoreGeometry(settings.value("window/geometry").toByteArray());
+    restoreState(settings.value("window/state").toByteArray());
+
+    ui->filterEdit->setText(settings.value("filters/events").toString());
+    ui->traceFilterEdit->setText(settings.value("filters/trace").toString());
+    ui->lineEdit->setText(settings.value("filters/processes").toString());
+    ui->stackSyscallsEdit->setText(settings.value("trace/stackSyscalls", ui->stackSyscallsEdit->text()).toString());
+    ui->schedstatCheckBox->setChecked(settings.value("trace/schedstat", false).toBool());
+    ui->followChildrenCheckBox->setChecked(settings.value("trace/followChildren", false).toBool());
+    ui->cgroupEdit->setText(settings.value("trace/cgroup").toString());
+    ui->agentEdit->setText(settings.value("agent/address").toString());
+    ui->agentModeCombo->setCurrentIndex(settings.value("agent/mode", 0).toInt());
+    ui->categoryViewCheckBox->setChecked(settings.value("view/byCategory", false).toBool());
+    ui->windowCombo->setCurrentIndex(settings.value("view/window", 0).toInt());
+    const int latencyTarget = ui->latencyTargetCombo->findText(settings.value("view/latencyTarget").toString());
+    if (latencyTarget >= 0)
+        ui->latencyTargetCombo->setCurrentIndex(latencyTarget);
+
+    ui->flightRecorderCheckBox->setChecked(settings.value("recorder/enabled", false).toBool());
+    ui->recorderWindowSpin->setValue(settings.value("recorder/windowSeconds", ui->recorderWindowSpin->value()).toInt());
+    ui->recorderBufferSpin->setValue(settings.value("recorder/bufferMB", ui->recorderBufferSpin->value()).toInt());
+    ui->latencyTriggerSpin->setValue(settings.value("recorder/latencyMs", ui->latencyTriggerSpin->value()).toDouble());
+    ui->rateTriggerSpin->setValue(settings.value("recorder/rateSpike", ui->rateTriggerSpin->value()).toDouble());
+    ui->errnoTriggerEdit->setText(settings.value("recorder/errno").toString());
+    const QString recorderDir = settings.value("recorder/directory").toString();
+    if (!recorderDir.isEmpty() && QDir(recorderDir).exists())
+        ui->recorderDirEdit->setText(recorderDir);
+
+    m_recentTargets.clear();
+    const int count = settings.beginReadArray("recentTargets");
+    for (int i = 0; i < count && i < kMaxRecentTargets; ++i) {
+        settings.setArrayIndex(i);
+        ProcessInfo info;
+        info.pid = settings.value("pid").toLongLong();
+        info.name = settings.value("name").toString();
+        if (info.pid > 0)
+            m_recentTargets.append(info);
+    }
+    settings.endArray();
+    // 上次追踪的进程还在运行时直接填好 PID，不必等进程扫描
+    const QList<ProcessInfo> live = liveRecentTargets();
+    if (!live.isEmpty())
+        ui->pidInput->setText(QString::number(live.first().pid));
+
+    // 标签页最后恢复：切换会触发对应面板的刷新
+    ui->analysisTabs->setCurrentIndex(settings.value("view/analysisTab", 0).toInt());
+}
+
+void MainWindow::saveSession() const
+{
+    QSettings settings(sessionFilePath(), QSettings::IniFormat);
+    settings.setValue("window/geometry", saveGeometry());
+    settings.setValue("window/state", saveState());
+    settings.setValue("view/analysisTab", ui->analysisTabs->currentIndex());
+    settings.setValue("view/byCategory", ui->categoryViewCheckBox->isChecked());
+    settings.setValue("view/window", ui->windowCombo->currentIndex());
+    settings.setValue("view/latencyTarget", ui->latencyTargetCombo->currentText());
+
+    settings.setValue("filters/events", ui->filterEdit->text());
+    settings.setValue("filters/trace", ui->traceFilterEdit->text());
+    settings.setValue("filters/processes", ui->lineEdit->text());
+    settings.setValue("trace/stackSyscalls", ui->stackSyscallsEdit->text());
+    settings.setValue("trace/schedstat", ui->schedstatCheckBox->isChecked());
+    settings.setValue("trace/followChildren", ui->followChildrenCheckBox->isChecked());
+    settings.setValue("trace/cgroup", ui->cgroupEdit->text());
+    settings.setValue("agent/address", ui->agentEdit->text());
+    settings.setValue("agent/mode", ui->agentModeCombo->currentIndex());
+
+    settings.setValue("recorder/enabled", ui->flightRecorderCheckBox->isChecked());
+    settings.setValue("recorder/windowSeconds", ui->recorderWindowSpin->value());
+    settings.setValue("recorder/bufferMB", ui->recorderBufferSpin->value());
+    settings.setValue("recorder/latencyMs", ui->latencyTriggerSpin->value());
+    settings.setValue("recorder/rateSpike", ui->rateTriggerSpin->value());
+    settings.setValue("recorder/errno", ui->errnoTriggerEdit->text());
+    settings.setValue("recorder/directory", ui->recorderDirEdit->text());
+
+    settings.beginWriteArray("recentTargets", int(m_recentTargets.size()));
+    for (int i = 0; i < m_recentTargets.size(); ++i) {
+        settings.setArrayIndex(i);
+        settings.setValue("pid", m_recentTargets.at(i).pid);
+        settings.setValue("name", m_recentTargets.at(i).name);
+    }
+    settings.endArray();
+}
+
+// 开始追踪时调用：放到最近列表的最前面，同一个 PID 只保留一条
+void MainWindow::rememberTarget(qint64 pid)
+{
+    ProcessInfo info;
+    info.pid = pid;
+    info.name = get_process_name(pid);
+    for (int i = m_recentTargets.size() - 1; i >= 0; --i) {
+        if (m_recentTargets.at(i).pid == pid)
+            m_recentTargets.removeAt(i);
+    }
+    m_recentTargets.prepend(info);
+    while (m_recentTargets.size() > kMaxRecentTargets)
+        m_recentTargets.removeLast();
+}
+
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    saveSession();
+    QMainWindow::closeEvent(event);
+}
@@ -7,18 +7,49 @@
 #include <QtCharts/QBarSeries>
 #include <QtCharts/QBarSet>
 #include <QtCharts/QBarCategoryAxis>
+#include <QtCharts/QLineSeries>
 #include <QTimer>
 #include <QGraphicsScene>
 #include <QGraphicsRectItem>
+#include <QElapsedTimer>
+#include <QTableWidgetItem>
+#include <QTreeWidgetItem>
+#include <QLabel>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "errnostats.h"
+#include "tracermetrics.h"
+#include "rollingstats.h"
+#include "syscallevent.h"
+#include "calltree.h"
+#include "sequenceminer.h"
+#include "categorystats.h"
+#include "addressspace.h"
+#include "networkstats.h"
+#include "futexstats.h"
+#include "processtree.h"
+#include "processscan.h"
 // 向前声明 Tracer 类
 class Tracer;
+class RemoteTracer;
+class EventStore;
+class EventQueue;
+class EventTableModel;
+class TimelineBlockItem;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
-struct ProcessInfo {
-    QString name;
-    qint64 pid;
+// 时间格式化辅助函数，定义在 mainwindow.cpp
+QString formatTimestamp(qint64 nanoseconds);
+QString formatDuration(qint64 nanoseconds);
+// 每个 syscall 的耗时拆分累计值（ns）
+struct TimeSplit {
+    quint64 calls = 0;
+    quint64 onCpu = 0;
+    quint64 runqWait = 0;
+    quint64 blocked = 0;
 };
 class MainWindow : public QMainWindow
 {
@@ -28,30 +59,136 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    void closeEvent(QCloseEvent *event) override;
+
 private slots:
     void on_startButton_clicked();
-    void handleSyscallData(quint64 ts, quint64 duration, long ret, long syscall, unsigned int pid, const QString& comm);
+    // 取走一个周期预算内的事件并刷新表格和时间线；预算用完时队列可能还有事件，返回 true
+    bool drainEvents();
+    void applyRemoteSummaries();
     void onTracingFinished(const QString& message);
+    void refreshPanels();
     void updateFrequencyChart();
+    void updateRateChart();
+    void updateErrnoTable();
+    void handleSyscallTiming(long syscall, quint64 onCpu, quint64 runqWait, quint64 blocked);
+    void updateTimeSplitTable();
+    void updateDiagnostics();
+    void updateFlameGraph();
+    void updateSequenceTable();
+    void updateCategoryTree();
+    void updateMemoryPanel();
+    void updateNetworkPanel();
+    void updateLocksPanel();
+    void updateProcessesPanel();
+    void on_categoryViewCheckBox_toggled(bool checked);
     void on_listWidget_itemSelectionChanged();
     void on_refreshButton_clicked();
     void filterProcessList(const QString &text);
+    void on_saveTraceButton_clicked();
+    void on_dumpNowButton_clicked();
+    void onFlightRecorderDumped(const QString &path, const QString &reason, quint64 events, const QString &error);
+    void on_compareButton_clicked();
+    void on_filterEdit_returnPressed();
 private:
     Ui::MainWindow *ui;
     Tracer *m_tracer;
+    // 经代理远程追踪时代替 m_tracer，同样运行在 m_tracerThread 上
+    RemoteTracer *m_remote;
     QThread *m_tracerThread;
     QChart* m_chart;
     QBarSeries* m_series;
-    QMap<QString, int> m_syscallCounts;
+    QMap<long, int> m_syscallCounts;
+    // 最近 5 分钟的按秒滚动统计，驱动时间窗口 Top 10 和速率曲线
+    RollingStats *m_rollingStats;
+    QChart* m_rateChart;
+    QLineSeries* m_rateSeries;
+    QLineSeries* m_errorRateSeries;
+    QChart* m_diffChart;
+    // 地址空间增长曲线：映射总量、匿名映射和每秒映射/解除映射的字节数
+    QChart* m_memoryChart;
+    QLineSeries* m_mappedSeries;
+    QLineSeries* m_anonSeries;
+    QLineSeries* m_churnSeries;
     QTimer* m_chartUpdateTimer;
     QGraphicsScene* m_timelineScene;
     quint64 m_timelineStartTs = 0;
-    // 用一个 map 来给不同类型的 syscall 分配不同的 Y 轴 "泳道"
-    QMap<QString, int> m_syscallLaneMap;
+    // 给不同类型的 syscall 分配不同的 Y 轴 "泳道"，下标是 syscall 号，-1 表示还没分配。
+    // 时间线图元读取 m_syscallLanes；按分类显示时同一分类的 syscall 共用该分类的泳道
+    QVector<int> m_syscallLanes;
+    QVector<int> m_syscallLaneOf;    // 按 syscall 分配的泳道（首次出现的顺序）
+    QVector<int> m_categoryLaneOf;   // 按分类分配的泳道，下标是分类号
     int m_nextLane = 0;
+    int m_nextCategoryLane = 0;
+    bool m_categoryView = false;
+    void rebuildTimelineLanes();
+    TimelineBlockItem *m_currentBlock = nullptr;
+    // 本次会话的事件存储与追踪线程写入的事件队列
+    EventStore *m_store = nullptr;
+    EventQueue *m_queue = nullptr;
+    EventTableModel *m_tableModel;
+    // 过滤栏里的 t= 以第一个事件为起点；会话还没有事件时先记下，等事件到了再套用
+    bool m_filterPending = false;
+    void applyFilter();
+    QTimer *m_drainTimer;
+    std::vector<SyscallEvent> m_drainBuffer;
+    // 每个周期最多取这么多批、用这么长时间，剩下的留到下一个周期，事件源一直很快时界面也能及时响应和重绘
+    static constexpr int kDrainBatchesPerTick = 8;
+    static constexpr qint64 kDrainBudgetNs = 10000000;
+    void recordEvent(const SyscallEvent &e);
     QList<ProcessInfo> m_allProcesses; // 存储所有进程的列表
     QMap<QString, QGraphicsItem*> m_legendItems;
+    // errno 统计面板：每个 (syscall, errno) 对应表格中的一行，按 key 增量更新
+    ErrnoStats m_errnoStats;
+    QHash<quint64, QTableWidgetItem*> m_errnoRows;
+    QElapsedTimer m_errnoTickClock;
+    // 分类 -> syscall -> errno 汇总树，按节点 key 增量更新
+    CategoryStats m_categoryStats;
+    QHash<quint64, QTreeWidgetItem*> m_categoryItems;
+    // 调度采样得到的耗时拆分
+    QHash<long, TimeSplit> m_timeSplits;
+    bool m_timeSplitsDirty = false;
+    // 每个 TID 上反复出现的 syscall 序列
+    SequenceMiner m_sequences;
+    // 选中 syscall 的调用栈，由追踪线程累计，火焰图按需取快照
+    CallTree m_callTree;
+    quint64 m_callTreeGeneration = 0;
+    // 被追踪进程的地址空间，由追踪线程按内存相关的系统调用增量维护
+    AddressSpace m_addressSpace;
+    // 按连接的网络统计，表格按 socket id 增量更新
+    NetworkStats m_networkStats;
+    QHash<quint32, QTableWidgetItem*> m_networkRows;
+    // futex 按地址的等待/唤醒统计，表格只显示总等待时间最长的一批
+    FutexStats m_futexStats;
+    // 跟随子进程时的进程树和按映像汇总，树节点按 ProcessTree 的下标增量更新
+    ProcessTree m_processTree;
+    QHash<int, QTreeWidgetItem*> m_processItems;
+    // 自监控：追踪线程与 GUI 共享的计数器，以及状态栏上的诊断信息
+    TracerMetrics m_metrics;
+    QLabel *m_diagnosticsLabel;
+    QElapsedTimer m_diagnosticsClock;
+    quint64 m_lastStops = 0;
+    quint64 m_lastWaitNs = 0;
+    quint64 m_lastProcessNs = 0;
+    quint64 m_lastHandleNs = 0;
+    // 进程列表：/proc 扫描在后台线程进行，结果回到 GUI 线程后再填表
+    std::thread m_scanThread;
+    std::atomic<bool> m_scanCancel{false};
     void populateProcessList();
+    void onProcessScanFinished(const QList<ProcessInfo> &processes);
+    void fillProcessList(const QString &text);
+    // 会话：布局、过滤条件、追踪选项和最近追踪过的进程，关闭窗口和开始追踪时写入 session.ini
+    static constexpr int kMaxRecentTargets = 10;
+    QList<ProcessInfo> m_recentTargets;
+    QList<ProcessInfo> liveRecentTargets() const;
+    void restoreSession();
+    void saveSession() const;
+    void rememberTarget(qint64 pid);
+    // 地址空间曲线和对比条形图到第一次用到时才创建
+    void ensureMemoryChart();
+    void ensureDiffChart();
+    void setRecorderInputsEnabled(bool enabled);
 };
 
 #endif // MAINWINDOW_H
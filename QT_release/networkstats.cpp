@@ -0,0 +1,549 @@
+#include "networkstats.h"
+
+#include <QStringList>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <syscall.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+// 从被追踪进程读取 len 字节，读不全时返回 false
+static bool readTracee(pid_t pid, quint64 addr, void *out, size_t len)
+{
+    if (addr == 0 || len == 0)
+        return false;
+    struct iovec local = { out, len };
+    struct iovec remote = { reinterpret_cast<void*>(addr), len };
+    return process_vm_readv(pid, &local, 1, &remote, 1, 0) == ssize_t(len);
+}
+
+// addrLen 为调用方传入的长度；读不到时返回空串
+static QString readSockaddr(pid_t pid, quint64 addr, quint64 addrLen)
+{
+    struct sockaddr_storage storage;
+    size_t len = std::min<size_t>(size_t(addrLen), sizeof(storage));
+    if (len < sizeof(sa_family_t) || !readTracee(pid, addr, &storage, len))
+        return QString();
+    return NetworkStats::formatSockaddr(&storage, len);
+}
+
+// accept/recvfrom 这类由内核填写地址的调用：长度在 addrLenPtr 指向的 socklen_t 里
+static QString readSockaddrOut(pid_t pid, quint64 addr, quint64 addrLenPtr)
+{
+    socklen_t len = 0;
+    if (!readTracee(pid, addrLenPtr, &len, sizeof(len)))
+        return QString();
+    return readSockaddr(pid, addr, len);
+}
+
+int NetworkStats::epollBucket(qint64 ready)
+{
+    if (ready <= 0)
+        return 0;
+    int bucket = 1;
+    while (bucket < kEpollBuckets - 1 && ready >= (qint64(1) << bucket))
+        ++bucket;
+    return bucket;
+}
+
+QString NetworkStats::epollBucketName(int bucket)
+{
+    if (bucket == 0)
+        return "0 (timeout)";
+    if (bucket == 1)
+        return "1";
+    if (bucket == kEpollBuckets - 1)
+        return QString("%1+").arg(1 << (bucket - 1));
+    return QString("%1-%2").arg(1 << (bucket - 1)).arg((1 << bucket) - 1);
+}
+
+QString NetworkStats::stateName(State state)
+{
+    switch (state) {
+    case Open: return "open";
+    case Listening: return "listening";
+    case Connecting: return "connecting";
+    case Connected: return "connected";
+    case Accepted: return "accepted";
+    case Closed: return "closed";
+    }
+    return QString();
+}
+
+QString NetworkStats::protocolName(int family, int type)
+{
+    QString proto = type == SOCK_STREAM ? "tcp" : type == SOCK_DGRAM ? "udp" : type == SOCK_SEQPACKET ? "seqpacket" : "";
+    switch (family) {
+    case AF_INET: return proto;
+    case AF_INET6: return proto + "6";
+    case AF_UNIX: return type == SOCK_DGRAM ? "unix-dgram" : "unix";
+    case AF_NETLINK: return "netlink";
+    case 0: return "?";
+    }
+    return QString("family %1").arg(family);
+}
+
+QString NetworkStats::formatSockaddr(const void *addr, size_t len)
+{
+    if (len < sizeof(sa_family_t))
+        return QString();
+    char text[INET6_ADDRSTRLEN];
+    sa_family_t family;
+    memcpy(&family, addr, sizeof(family));
+    switch (family) {
+    case AF_INET: {
+        if (len < sizeof(sockaddr_in))
+            break;
+        const sockaddr_in *in = static_cast<const sockaddr_in*>(addr);
+        inet_ntop(AF_INET, &in->sin_addr, text, sizeof(text));
+        return QString("%1:%2").arg(text).arg(ntohs(in->sin_port));
+    }
+    case AF_INET6: {
+        if (len < sizeof(sockaddr_in6))
+            break;
+        const sockaddr_in6 *in6 = static_cast<const sockaddr_in6*>(addr);
+        inet_ntop(AF_INET6, &in6->sin6_addr, text, sizeof(text));
+        return QString("[%1]:%2").arg(text).arg(ntohs(in6->sin6_port));
+    }
+    case AF_UNIX: {
+        const sockaddr_un *un = static_cast<const sockaddr_un*>(addr);
+        size_t pathLen = len - offsetof(sockaddr_un, sun_path);
+        if (len <= offsetof(sockaddr_un, sun_path) || pathLen == 0)
+            return "unix:(unnamed)";
+        if (un->sun_path[0] == '\0') // 抽象地址：不以 \0 结尾，长度由 len 决定
+            return "unix:@" + QString::fromLocal8Bit(un->sun_path + 1, int(pathLen - 1));
+        return "unix:" + QString::fromLocal8Bit(un->sun_path, int(strnlen(un->sun_path, pathLen)));
+    }
+    case AF_NETLINK:
+        return "netlink";
+    }
+    return QString("family %1").arg(family);
+}
+
+bool NetworkStats::isNetworkSyscall(long nr)
+{
+    switch (nr) {
+    case SYS_socket: case SYS_socketpair: case SYS_connect: case SYS_accept: case SYS_accept4:
+    case SYS_bind: case SYS_listen: case SYS_shutdown: case SYS_sendto: case SYS_recvfrom:
+    case SYS_sendmsg: case SYS_recvmsg: case SYS_sendmmsg: case SYS_recvmmsg:
+    case SYS_read: case SYS_write: case SYS_readv: case SYS_writev:
+    case SYS_close: case SYS_dup2: case SYS_dup3:
+    case SYS_epoll_wait: case SYS_epoll_pwait:
+#ifdef SYS_epoll_pwait2
+    case SYS_epoll_pwait2:
+#endif
+        return true;
+    }
+    return false;
+}
+
+void NetworkStats::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fdKind.clear();
+    m_fdSocket.clear();
+    m_sockets.clear();
+    m_dirty.clear();
+    m_closedOrder.clear();
+    m_removed.clear();
+    m_nextId = 1;
+    m_epoll = EpollStats();
+    m_procEndpoints.clear();
+    m_procPid = 0;
+    m_procScanTs = 0;
+}
+
+NetworkStats::Socket &NetworkStats::openSocket(int fd, quint64 ts)
+{
+    if (size_t(fd) >= m_fdSocket.size()) {
+        m_fdSocket.resize(size_t(fd) + 1, 0);
+        m_fdKind.resize(size_t(fd) + 1, FdUnknown);
+    }
+    // fd 被复用而我们没看到 close（例如附加前打开、由 dup2 覆盖）：旧 socket 按关闭处理
+    if (m_fdSocket[fd])
+        closeFd(fd, ts);
+    Socket &s = m_sockets[m_nextId];
+    s.id = m_nextId++;
+    s.fd = fd;
+    s.firstTs = s.lastTs = ts;
+    m_fdSocket[fd] = s.id;
+    m_fdKind[fd] = FdSocket;
+    markDirty(s);
+    return s;
+}
+
+void NetworkStats::closeFd(int fd, quint64 ts)
+{
+    if (fd < 0 || size_t(fd) >= m_fdSocket.size())
+        return;
+    quint32 id = m_fdSocket[fd];
+    m_fdSocket[fd] = 0;
+    m_fdKind[fd] = FdUnknown;
+    auto it = m_sockets.find(id);
+    if (it == m_sockets.end())
+        return;
+    it->second.state = Closed;
+    it->second.lastTs = ts;
+    markDirty(it->second);
+    m_closedOrder.push_back(id);
+    while (m_closedOrder.size() > kMaxClosed) {
+        quint32 oldest = m_closedOrder.front();
+        m_closedOrder.pop_front();
+        m_sockets.erase(oldest);
+        m_dirty.erase(oldest);
+        m_removed.push_back(oldest);
+    }
+}
+
+// fd 指向 socket 时返回 1 并给出 inode，不是 socket 返回 0，查不到（fd 已关闭、没有权限）返回 -1
+static int socketInode(pid_t pid, int fd, quint64 *inode)
+{
+    char path[64];
+    char target[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd/%d", pid, fd);
+    ssize_t n = readlink(path, target, sizeof(target) - 1);
+    if (n < 0)
+        return -1;
+    target[n] = '\0';
+    if (n <= 8 || memcmp(target, "socket:[", 8) != 0)
+        return 0;
+    *inode = strtoull(target + 8, nullptr, 10);
+    return 1;
+}
+
+// knownSocket 表示调用本身只能作用于 socket（send*/recv*/connect 等）；read/write 则要先确认 fd 是 socket
+NetworkStats::Socket *NetworkStats::socketFor(pid_t pid, int fd, bool knownSocket, quint64 ts)
+{
+    if (fd < 0)
+        return nullptr;
+    if (size_t(fd) < m_fdSocket.size()) {
+        if (m_fdSocket[fd])
+            return &m_sockets[m_fdSocket[fd]];
+        if (m_fdKind[fd] == FdOther)
+            return nullptr;
+    }
+
+    // 第一次见到这个 fd：附加前打开的，或者不是 socket
+    quint64 inode = 0;
+    int kind = socketInode(pid, fd, &inode);
+    if (kind == 0 || (kind < 0 && !knownSocket)) {
+        if (size_t(fd) >= m_fdKind.size()) {
+            m_fdSocket.resize(size_t(fd) + 1, 0);
+            m_fdKind.resize(size_t(fd) + 1, FdUnknown);
+        }
+        m_fdKind[fd] = FdOther;
+        return nullptr;
+    }
+    Socket &s = openSocket(fd, ts);
+    if (kind > 0)
+        resolveFromProc(pid, s, inode, ts, false);
+    return &s;
+}
+
+// /proc/net/tcp 中的地址："0100007F:1F90"，IPv4 为主机字节序的 32 位十六进制，IPv6 为 4 个这样的字
+static QString formatProcAddress(const char *hex, int family)
+{
+    const char *colon = strchr(hex, ':');
+    if (!colon)
+        return QString();
+    unsigned port = unsigned(strtoul(colon + 1, nullptr, 16));
+    unsigned char bytes[16];
+    int words = family == AF_INET6 ? 4 : 1;
+    for (int i = 0; i < words; ++i) {
+        char word[9] = {};
+        memcpy(word, hex + i * 8, 8);
+        quint32 v = quint32(strtoul(word, nullptr, 16));
+        memcpy(bytes + i * 4, &v, 4);
+    }
+    char text[INET6_ADDRSTRLEN];
+    inet_ntop(family, bytes, text, sizeof(text));
+    return family == AF_INET6 ? QString("[%1]:%2").arg(text).arg(port) : QString("%1:%2").arg(text).arg(port);
+}
+
+// 索引里查不到的 inode（netlink 等不在这几张表里的 socket，或附加后才创建的）最多隔这么久重新解析一次，
+// 大量这样的 fd 不会让每一个都把整张表读一遍
+static const quint64 kProcRescanNs = 1000000000ULL;
+
+void NetworkStats::scanProc(pid_t pid, quint64 ts)
+{
+    m_procEndpoints.clear();
+    m_procPid = pid;
+    m_procScanTs = ts;
+
+    struct Table { const char *name; int family; int type; };
+    static const Table tables[] = {
+        { "tcp", AF_INET, SOCK_STREAM }, { "tcp6", AF_INET6, SOCK_STREAM },
+        { "udp", AF_INET, SOCK_DGRAM }, { "udp6", AF_INET6, SOCK_DGRAM },
+    };
+    char path[64];
+    char line[512];
+    for (const Table &t : tables) {
+        snprintf(path, sizeof(path), "/proc/%d/net/%s", pid, t.name);
+        FILE *f = fopen(path, "re");
+        if (!f)
+            continue;
+        fgets(line, sizeof(line), f); // 表头
+        while (fgets(line, sizeof(line), f)) {
+            //   0: 0100007F:1F90 00000000:0000 0A 00000000:00000000 00:00000000 00000000  1000        0 12345 ...
+            char local[64], remote[64];
+            unsigned state;
+            unsigned long long lineInode;
+            if (sscanf(line, "%*d: %63s %63s %x %*s %*s %*s %*u %*u %llu", local, remote, &state, &lineInode) != 4 ||
+                lineInode == 0)
+                continue;
+            ProcEndpoint &e = m_procEndpoints[lineInode];
+            e.family = t.family;
+            e.type = t.type;
+            e.local = formatProcAddress(local, t.family);
+            if (state == 0x0A) { // TCP_LISTEN
+                e.state = Listening;
+            } else {
+                QString peer = formatProcAddress(remote, t.family);
+                if (!peer.endsWith(":0"))
+                    e.peer = peer;
+                e.state = t.type == SOCK_STREAM ? Connected : Open;
+            }
+        }
+        fclose(f);
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/net/unix", pid);
+    FILE *f = fopen(path, "re");
+    if (!f)
+        return;
+    fgets(line, sizeof(line), f);
+    while (fgets(line, sizeof(line), f)) {
+        // Num       RefCount Protocol Flags    Type St Inode Path
+        unsigned type, st;
+        unsigned long long lineInode;
+        int pathOffset = 0;
+        if (sscanf(line, "%*s %*x %*x %*x %x %x %llu %n", &type, &st, &lineInode, &pathOffset) < 3 || lineInode == 0)
+            continue;
+        ProcEndpoint &e = m_procEndpoints[lineInode];
+        e.family = AF_UNIX;
+        e.type = int(type);
+        QString local = QString::fromLocal8Bit(line + pathOffset).trimmed();
+        if (!local.isEmpty())
+            e.local = "unix:" + local;
+        e.state = st == 1 ? Listening : st == 3 ? Connected : Open; // SS_UNCONNECTED / SS_CONNECTED
+    }
+    fclose(f);
+}
+
+void NetworkStats::resolveFromProc(pid_t pid, Socket &s, quint64 inode, quint64 ts, bool refresh)
+{
+    if (pid != m_procPid || refresh || m_procEndpoints.empty())
+        scanProc(pid, ts);
+    auto it = m_procEndpoints.find(inode);
+    if (it == m_procEndpoints.end() && ts >= m_procScanTs + kProcRescanNs) {
+        scanProc(pid, ts);
+        it = m_procEndpoints.find(inode);
+    }
+    if (it == m_procEndpoints.end())
+        return;
+    const ProcEndpoint &e = it->second;
+    s.family = e.family;
+    s.type = e.type;
+    if (!e.local.isEmpty())
+        s.local = e.local;
+    if (!e.peer.isEmpty())
+        s.peer = e.peer;
+    // UDP 没有连接状态，保留原来的状态
+    if (e.state != Open || e.family == AF_UNIX)
+        s.state = e.state;
+}
+
+void NetworkStats::account(Socket &s, quint64 durationNs, bool failed, quint64 ts)
+{
+    s.calls++;
+    s.blockedNs += durationNs;
+    s.maxNs = std::max(s.maxNs, durationNs);
+    if (failed)
+        s.errors++;
+    s.lastTs = ts;
+    markDirty(s);
+}
+
+void NetworkStats::onSyscall(pid_t pid, long nr, const quint64 args[6], qint64 ret, quint64 ts, quint64 durationNs)
+{
+    const bool failed = ret < 0 && ret >= -4095;
+    const int fd = int(args[0]);
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    switch (nr) {
+    case SYS_socket:
+        if (!failed) {
+            Socket &s = openSocket(int(ret), ts);
+            s.family = int(args[0]);
+            s.type = int(args[1] & 0xf); // 去掉 SOCK_NONBLOCK / SOCK_CLOEXEC
+            account(s, durationNs, false, ts);
+        }
+        return;
+    case SYS_socketpair: {
+        int sv[2];
+        if (failed || !readTracee(pid, args[3], sv, sizeof(sv)))
+            return;
+        for (int i = 0; i < 2; ++i) {
+            Socket &s = openSocket(sv[i], ts);
+            s.family = int(args[0]);
+            s.type = int(args[1] & 0xf);
+            s.state = Connected;
+            s.peer = QString("socketpair fd %1").arg(sv[1 - i]);
+        }
+        return;
+    }
+    case SYS_close:
+        // 只处理已知的 socket，不为 close 去查 /proc
+        if (fd >= 0 && size_t(fd) < m_fdSocket.size() && m_fdSocket[fd]) {
+            account(m_sockets[m_fdSocket[fd]], durationNs, failed, ts);
+            if (!failed)
+                closeFd(fd, ts);
+        } else if (fd >= 0 && size_t(fd) < m_fdKind.size()) {
+            m_fdKind[fd] = FdUnknown;
+        }
+        return;
+    case SYS_dup2:
+    case SYS_dup3:
+        // 目标 fd 上原来打开的文件被隐式关闭
+        if (!failed && int(args[1]) != fd)
+            closeFd(int(args[1]), ts);
+        return;
+    case SYS_epoll_wait:
+    case SYS_epoll_pwait:
+#ifdef SYS_epoll_pwait2
+    case SYS_epoll_pwait2:
+#endif
+        if (failed) {
+            m_epoll.interrupted++;
+        } else {
+            EpollBucket &b = m_epoll.buckets[epollBucket(ret)];
+            b.calls++;
+            b.waitNs += durationNs;
+            b.maxNs = std::max(b.maxNs, durationNs);
+            b.events += quint64(ret);
+        }
+        return;
+    }
+
+    const bool fdOnly = nr == SYS_read || nr == SYS_write || nr == SYS_readv || nr == SYS_writev;
+    Socket *s = socketFor(pid, fd, !fdOnly, ts);
+    if (!s)
+        return;
+    account(*s, durationNs, failed, ts);
+
+    switch (nr) {
+    case SYS_connect: {
+        s->connectNs = durationNs;
+        QString peer = readSockaddr(pid, args[1], args[2]);
+        if (!peer.isEmpty())
+            s->peer = peer;
+        if (!failed)
+            s->state = Connected;
+        else if (ret == -EINPROGRESS)
+            s->state = Connecting;
+        break;
+    }
+    case SYS_bind:
+        if (!failed)
+            s->local = readSockaddr(pid, args[1], args[2]);
+        break;
+    case SYS_listen:
+        if (!failed) {
+            // bind 到 0 端口（或没有 bind）时端口由内核分配，从 /proc 取实际的本地地址
+            quint64 inode = 0;
+            if ((s->local.isEmpty() || s->local.endsWith(":0")) && socketInode(pid, fd, &inode) > 0)
+                resolveFromProc(pid, *s, inode, ts, true);
+            s->state = Listening;
+        }
+        break;
+    case SYS_accept:
+    case SYS_accept4: {
+        if (failed)
+            break;
+        // 新连接继承监听 socket 的协议和本地地址，对端地址由内核填在 args[1]
+        const int family = s->family;
+        const int type = s->type;
+        const QString local = s->local;
+        Socket &conn = openSocket(int(ret), ts);
+        conn.family = family;
+        conn.type = type;
+        conn.local = local;
+        conn.state = Accepted;
+        if (args[1])
+            conn.peer = readSockaddrOut(pid, args[1], args[2]);
+        break;
+    }
+    case SYS_sendto:
+        s->sendCalls++;
+        if (!failed)
+            s->bytesOut += quint64(ret);
+        if (args[4] && s->type == SOCK_DGRAM)
+            s->peer = readSockaddr(pid, args[4], args[5]);
+        break;
+    case SYS_recvfrom:
+        s->recvCalls++;
+        if (!failed) {
+            s->bytesIn += quint64(ret);
+            if (args[4] && s->type == SOCK_DGRAM)
+                s->peer = readSockaddrOut(pid, args[4], args[5]);
+        }
+        break;
+    case SYS_write:
+    case SYS_writev:
+    case SYS_sendmsg:
+        s->sendCalls++;
+        if (!failed)
+            s->bytesOut += quint64(ret);
+        break;
+    case SYS_read:
+    case SYS_readv:
+    case SYS_recvmsg:
+        s->recvCalls++;
+        if (!failed)
+            s->bytesIn += quint64(ret);
+        break;
+    case SYS_sendmmsg:
+    case SYS_recvmmsg: {
+        // 返回值是消息数，字节数在每个 mmsghdr 的 msg_len 里
+        const bool out = nr == SYS_sendmmsg;
+        (out ? s->sendCalls : s->recvCalls)++;
+        if (failed || ret <= 0)
+            break;
+        std::vector<struct mmsghdr> msgs(size_t(std::min<qint64>(ret, 1024)));
+        if (!readTracee(pid, args[1], msgs.data(), msgs.size() * sizeof(struct mmsghdr)))
+            break;
+        quint64 bytes = 0;
+        for (const struct mmsghdr &m : msgs)
+            bytes += m.msg_len;
+        (out ? s->bytesOut : s->bytesIn) += bytes;
+        break;
+    }
+    }
+}
+
+NetworkStats::Changes NetworkStats::takeChanges()
+{
+    Changes changes;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    changes.updated.reserve(m_dirty.size());
+    for (quint32 id : m_dirty) {
+        auto it = m_sockets.find(id);
+        if (it != m_sockets.end())
+            changes.updated.push_back(it->second);
+    }
+    m_dirty.clear();
+    changes.removed.swap(m_removed);
+    return changes;
+}
+
+NetworkStats::EpollStats NetworkStats::epollStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_epoll;
+}
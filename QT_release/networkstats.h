@@ -0,0 +1,117 @@
+#ifndef NETWORKSTATS_H
+#define NETWORKSTATS_H
+
+#include <QString>
+#include <QtGlobal>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/types.h>
+
+// 按连接组织的网络统计：从 socket/connect/accept/bind/close 的出口维护 fd -> socket 表，
+// 把收发调用（send*/recv*，以及落在 socket 上的 read/write/readv/writev）的字节数、次数和阻塞时间累计到对应的 socket，
+// epoll_wait 按就绪事件数分桶统计等待时间。地址从被追踪进程内存中解码；附加前就打开的 socket
+// 在第一次出现时通过 /proc/<pid>/fd 和 /proc/<pid>/net/* 按 inode 补全地址；net/* 一次解析成 inode 索引，
+// 之后的查找复用它，查不到时才（限频）重新解析。
+// onSyscall() 在追踪线程调用，takeChanges()/epollStats() 在 GUI 线程调用，两者之间加锁。
+class NetworkStats
+{
+public:
+    enum State : quint8 { Open, Listening, Connecting, Connected, Accepted, Closed };
+
+    struct Socket {
+        quint32 id = 0;           // 会话内唯一，fd 关闭后会被复用，不能用 fd 作 key
+        int fd = -1;
+        int family = 0;           // AF_INET / AF_INET6 / AF_UNIX，0 表示未知
+        int type = 0;             // SOCK_STREAM / SOCK_DGRAM
+        State state = Open;
+        QString local;
+        QString peer;             // 无连接的 UDP 为最近一次 sendto/recvfrom 的对端
+        quint64 calls = 0;
+        quint64 sendCalls = 0;
+        quint64 recvCalls = 0;
+        quint64 bytesOut = 0;
+        quint64 bytesIn = 0;
+        quint64 blockedNs = 0;    // 在该 socket 上的调用耗时之和
+        quint64 maxNs = 0;
+        quint64 errors = 0;
+        quint64 connectNs = 0;    // connect 的耗时（非阻塞 connect 只是发起的耗时）
+        quint64 firstTs = 0;
+        quint64 lastTs = 0;
+    };
+
+    // epoll_wait 按返回的就绪数分桶：0（超时）, 1, 2-3, 4-7, 8-15, 16-31, 32+
+    static constexpr int kEpollBuckets = 7;
+    struct EpollBucket {
+        quint64 calls = 0;
+        quint64 waitNs = 0;
+        quint64 maxNs = 0;
+        quint64 events = 0;
+    };
+    struct EpollStats {
+        EpollBucket buckets[kEpollBuckets];
+        quint64 interrupted = 0;  // EINTR 等失败
+    };
+
+    struct Changes {
+        std::vector<Socket> updated;  // 上次取走之后有变化的 socket
+        std::vector<quint32> removed; // 为控制表格大小被淘汰的已关闭 socket
+    };
+
+    static constexpr size_t kMaxClosed = 2000; // 保留的已关闭 socket 上限，超出时淘汰最早关闭的
+
+    static int epollBucket(qint64 ready);
+    static QString epollBucketName(int bucket);
+    static QString stateName(State state);
+    static QString protocolName(int family, int type);
+    // 把 sockaddr 格式化成 127.0.0.1:80、[::1]:80、unix:/run/x.sock、unix:@abstract
+    static QString formatSockaddr(const void *addr, size_t len);
+
+    // 统计需要的系统调用（包括 read/write/close 这类不一定作用在 socket 上的）
+    static bool isNetworkSyscall(long nr);
+
+    void clear();
+    // 系统调用出口调用，args 为入口处的 6 个参数
+    void onSyscall(pid_t pid, long nr, const quint64 args[6], qint64 ret, quint64 ts, quint64 durationNs);
+
+    Changes takeChanges();
+    EpollStats epollStats() const;
+
+private:
+    enum FdKind : quint8 { FdUnknown, FdOther, FdSocket };
+
+    Socket *socketFor(pid_t pid, int fd, bool knownSocket, quint64 ts);
+    Socket &openSocket(int fd, quint64 ts);
+    void closeFd(int fd, quint64 ts);
+    // /proc/<pid>/net/* 中一个 socket 的协议、地址和状态
+    struct ProcEndpoint {
+        int family = 0;
+        int type = 0;
+        State state = Open;
+        QString local;
+        QString peer;
+    };
+    // 附加前就打开的 socket：按 inode 在 /proc/<pid>/net/{tcp,tcp6,udp,udp6,unix} 的索引中查出协议、地址和状态。
+    // 索引里没有时，距上次解析超过 kProcRescanNs 或 refresh 为 true（刚 listen 的新 socket）才重新解析
+    void resolveFromProc(pid_t pid, Socket &s, quint64 inode, quint64 ts, bool refresh);
+    void scanProc(pid_t pid, quint64 ts);
+    void account(Socket &s, quint64 durationNs, bool failed, quint64 ts);
+    void markDirty(const Socket &s) { m_dirty.insert(s.id); }
+
+    mutable std::mutex m_mutex;
+    std::vector<quint8> m_fdKind;       // 下标为 fd
+    std::vector<quint32> m_fdSocket;    // 下标为 fd，0 表示没有
+    std::unordered_map<quint32, Socket> m_sockets;
+    std::unordered_set<quint32> m_dirty;
+    std::deque<quint32> m_closedOrder;
+    std::vector<quint32> m_removed;
+    quint32 m_nextId = 1;
+    EpollStats m_epoll;
+    std::unordered_map<quint64, ProcEndpoint> m_procEndpoints; // inode -> 端点，scanProc() 整体重建
+    pid_t m_procPid = 0;                                       // 索引来自哪个进程的 /proc（网络命名空间）
+    quint64 m_procScanTs = 0;
+};
+
+#endif // NETWORKSTATS_H
@@ -0,0 +1,139 @@
+#include "processscan.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace processscan {
+
+// 整个文件读进 buf（最多 size - 1 字节，末尾补 0），返回读到的字节数，打不开返回 -1
+static ssize_t readSmallFile(const char *path, char *buf, size_t size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    size_t total = 0;
+    while (total + 1 < size) {
+        ssize_t n = read(fd, buf + total, size - 1 - total);
+        if (n <= 0)
+            break;
+        total += size_t(n);
+    }
+    close(fd);
+    buf[total] = '\0';
+    return ssize_t(total);
+}
+
+// 全部是数字时返回数值，否则返回 0
+static pid_t parsePid(const char *name)
+{
+    pid_t value = 0;
+    for (const char *p = name; *p; ++p) {
+        if (*p < '0' || *p > '9')
+            return 0;
+        value = value * 10 + (*p - '0');
+    }
+    return value;
+}
+
+QString processName(pid_t pid)
+{
+    char path[32];
+    char comm[64];
+    snprintf(path, sizeof(path), "/proc/%d/comm", int(pid));
+    ssize_t n = readSmallFile(path, comm, sizeof(comm));
+    if (n <= 0)
+        return QString();
+    if (comm[n - 1] == '\n')
+        --n;
+    return QString::fromUtf8(comm, int(n));
+}
+
+bool listPids(const char *dir, std::vector<pid_t> &out)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+        return false;
+    while (struct dirent *entry = readdir(d)) {
+        // /proc 总是给出 d_type；DT_UNKNOWN 时按名字判断，由之后的读取失败兜底
+        if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN)
+            continue;
+        if (pid_t pid = parsePid(entry->d_name))
+            out.push_back(pid);
+    }
+    closedir(d);
+    return true;
+}
+
+bool readPidFile(const char *path, std::vector<pid_t> &out)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    // 大 cgroup 的成员列表可能有几万行，分块读，跨块的数字接着累加
+    char buf[16384];
+    pid_t value = 0;
+    bool digits = false;
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            const char c = buf[i];
+            if (c >= '0' && c <= '9') {
+                value = value * 10 + (c - '0');
+                digits = true;
+            } else {
+                if (digits)
+                    out.push_back(value);
+                value = 0;
+                digits = false;
+            }
+        }
+    }
+    if (digits)
+        out.push_back(value);
+    close(fd);
+    return n == 0;
+}
+
+pid_t threadGroup(pid_t tid, pid_t *ppid)
+{
+    char path[32];
+    char status[1024]; // Tgid 和 PPid 在前十行内
+    snprintf(path, sizeof(path), "/proc/%d/status", int(tid));
+    if (readSmallFile(path, status, sizeof(status)) <= 0)
+        return 0;
+    const char *tgid = strstr(status, "\nTgid:");
+    if (!tgid)
+        return 0;
+    if (ppid) {
+        const char *parent = strstr(status, "\nPPid:");
+        *ppid = parent ? pid_t(strtol(parent + 6, nullptr, 10)) : 0;
+    }
+    return pid_t(strtol(tgid + 6, nullptr, 10));
+}
+
+QList<ProcessInfo> scanProcesses(const std::atomic<bool> &cancel)
+{
+    QList<ProcessInfo> processes;
+    std::vector<pid_t> pids;
+    if (!listPids("/proc", pids))
+        return processes;
+    std::sort(pids.begin(), pids.end());
+    processes.reserve(int(pids.size()));
+    for (pid_t pid : pids) {
+        if (cancel.load(std::memory_order_relaxed))
+            break;
+        ProcessInfo info;
+        info.pid = pid;
+        info.name = processName(pid);
+        // 列目录和读 comm 之间退出的进程不再列出
+        if (!info.name.isEmpty())
+            processes.append(info);
+    }
+    return processes;
+}
+
+} // namespace processscan
@@ -0,0 +1,38 @@
+#ifndef PROCESSSCAN_H
+#define PROCESSSCAN_H
+
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+#include <sys/types.h>
+
+struct ProcessInfo {
+    QString name;
+    qint64 pid;
+};
+
+// /proc 与 cgroup 文件的读取：进程列表、cgroup 成员枚举和追踪器取进程名共用。
+// 都用 open/read 读进栈上的缓冲区、readdir 按 d_type 过滤，不经过 QDir/ifstream/正则，
+// 一次完整的 /proc 扫描只做每个进程一次 open/read/close
+namespace processscan {
+
+// /proc/<pid>/comm 去掉换行；进程已退出时为空
+QString processName(pid_t pid);
+
+// 目录下以数字命名的子目录（/proc、/proc/<pid>/task）追加到 out，不排序；目录打不开返回 false
+bool listPids(const char *dir, std::vector<pid_t> &out);
+
+// 每行一个 id 的文件（cgroup.procs、cgroup.threads、cgroup v1 的 tasks）追加到 out；打不开或读失败返回 false
+bool readPidFile(const char *path, std::vector<pid_t> &out);
+
+// 从 /proc/<tid>/status 读线程所属的进程（Tgid），ppid 不为空时顺带读父进程；线程已退出返回 0
+pid_t threadGroup(pid_t tid, pid_t *ppid = nullptr);
+
+// 全部进程及其进程名，用于进程列表；在后台线程调用，cancel 置位后尽快返回
+QList<ProcessInfo> scanProcesses(const std::atomic<bool> &cancel);
+
+} // namespace processscan
+
+#endif // PROCESSSCAN_H
@@ -0,0 +1,222 @@
+#include "processtree.h"
+
+#include <string.h>
+#include <sys/wait.h>
+#include <algorithm>
+
+QString ProcessTree::exitText(int status)
+{
+    if (WIFSIGNALED(status))
+        return QString("signal %1 (%2)").arg(WTERMSIG(status)).arg(strsignal(WTERMSIG(status)));
+    return QString("exit %1").arg(WEXITSTATUS(status));
+}
+
+void ProcessTree::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_nodes.clear();
+    m_dirty.clear();
+    m_images.clear();
+    m_imageIndex.clear();
+    m_totals = Totals();
+}
+
+int ProcessTree::imageFor(const QString &path)
+{
+    auto it = m_imageIndex.constFind(path);
+    if (it != m_imageIndex.constEnd())
+        return it.value();
+    Image image;
+    image.path = path;
+    m_images.push_back(image);
+    m_imageIndex.insert(path, int(m_images.size() - 1));
+    return int(m_images.size() - 1);
+}
+
+void ProcessTree::enterImage(Node &n, int image, quint64 ts)
+{
+    n.imageIndex = image;
+    n.imageSinceNs = ts;
+    m_images[size_t(image)].processes++;
+    m_images[size_t(image)].running++;
+}
+
+void ProcessTree::leaveImage(Node &n, quint64 ts)
+{
+    if (n.imageIndex < 0)
+        return;
+    Image &image = m_images[size_t(n.imageIndex)];
+    image.wallNs += ts > n.imageSinceNs ? ts - n.imageSinceNs : 0;
+    image.running--;
+    n.imageIndex = -1;
+}
+
+void ProcessTree::markDirty(Node &n)
+{
+    if (!n.dirty) {
+        n.dirty = true;
+        m_dirty.push_back(n.p.index);
+    }
+}
+
+int ProcessTree::onAttach(pid_t pid, const QString &comm, const QString &image, quint64 ts, int parent)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_nodes.size() >= kMaxProcesses) {
+        m_totals.overflow++;
+        return -1;
+    }
+    Node n;
+    n.p.index = int(m_nodes.size());
+    n.p.parent = parent;
+    n.p.pid = pid;
+    n.p.comm = comm;
+    n.p.image = image;
+    n.p.startNs = ts;
+    enterImage(n, imageFor(image), ts);
+    m_nodes.push_back(n);
+    markDirty(m_nodes.back());
+    m_totals.processes++;
+    m_totals.running++;
+    m_totals.threads++;
+    return n.p.index;
+}
+
+int ProcessTree::onFork(int parent, pid_t pid, quint64 ts)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (parent < 0 || m_nodes.size() >= kMaxProcesses) {
+        m_totals.overflow++;
+        return -1;
+    }
+    // 子进程继承父进程的进程名和映像，直到它自己 exec
+    Node n;
+    const Node &from = m_nodes[size_t(parent)];
+    n.p.index = int(m_nodes.size());
+    n.p.parent = parent;
+    n.p.pid = pid;
+    n.p.comm = from.p.comm;
+    n.p.image = from.p.image;
+    n.p.startNs = ts;
+    enterImage(n, imageFor(from.p.image), ts);
+    m_nodes.push_back(n);
+    markDirty(m_nodes.back());
+    m_totals.processes++;
+    m_totals.running++;
+    m_totals.threads++;
+    return n.p.index;
+}
+
+void ProcessTree::onThread(int process)
+{
+    if (process < 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Node &n = m_nodes[size_t(process)];
+    n.p.threads++;
+    m_totals.threads++;
+    markDirty(n);
+}
+
+void ProcessTree::onExec(int process, const QString &comm, const QString &image, quint64 ts)
+{
+    if (process < 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Node &n = m_nodes[size_t(process)];
+    leaveImage(n, ts);
+    n.p.comm = comm;
+    n.p.image = image;
+    n.p.execs++;
+    enterImage(n, imageFor(image), ts);
+    m_totals.execs++;
+    markDirty(n);
+}
+
+void ProcessTree::onExit(int process, int status, quint64 ts)
+{
+    if (process < 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Node &n = m_nodes[size_t(process)];
+    if (n.p.endNs)
+        return;
+    leaveImage(n, ts);
+    n.p.endNs = std::max(ts, n.p.startNs + 1);
+    n.p.exitStatus = status;
+    m_totals.running--;
+    markDirty(n);
+}
+
+void ProcessTree::onSyscall(int process, long nr, qint64 ret, quint64 durationNs)
+{
+    if (process < 0 || nr < 0)
+        return;
+    const bool failed = ret < 0 && ret >= -4095;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Node &n = m_nodes[size_t(process)];
+    n.p.calls++;
+    n.p.errors += failed;
+    n.p.syscallNs += durationNs;
+    markDirty(n);
+    if (n.imageIndex < 0)
+        return;
+    Image &image = m_images[size_t(n.imageIndex)];
+    image.calls++;
+    image.errors += failed;
+    image.syscallNs += durationNs;
+    if (size_t(nr) >= image.syscalls.size())
+        image.syscalls.resize(size_t(nr) + 1);
+    SyscallTotal &t = image.syscalls[size_t(nr)];
+    t.calls++;
+    t.errors += failed;
+    t.ns += durationNs;
+}
+
+void ProcessTree::onDetach(quint64 ts)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Node &n : m_nodes) {
+        if (n.p.endNs || n.p.detached)
+            continue;
+        leaveImage(n, ts);
+        n.p.endNs = std::max(ts, n.p.startNs + 1);
+        n.p.detached = true;
+        m_totals.running--;
+        markDirty(n);
+    }
+}
+
+bool ProcessTree::changed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_dirty.empty();
+}
+
+ProcessTree::Changes ProcessTree::takeChanges()
+{
+    Changes changes;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 下标按创建顺序递增，排序后父进程一定排在子进程之前
+    std::sort(m_dirty.begin(), m_dirty.end());
+    changes.updated.reserve(m_dirty.size());
+    for (int index : m_dirty) {
+        Node &n = m_nodes[size_t(index)];
+        n.dirty = false;
+        changes.updated.push_back(n.p);
+    }
+    m_dirty.clear();
+    changes.totals = m_totals;
+    return changes;
+}
+
+std::vector<ProcessTree::Image> ProcessTree::images(quint64 nowNs) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Image> out = m_images;
+    for (const Node &n : m_nodes) {
+        if (n.imageIndex >= 0 && nowNs > n.imageSinceNs)
+            out[size_t(n.imageIndex)].wallNs += nowNs - n.imageSinceNs;
+    }
+    return out;
+}
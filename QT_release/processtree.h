@@ -0,0 +1,110 @@
+#ifndef PROCESSTREE_H
+#define PROCESSTREE_H
+
+#include <QHash>
+#include <QString>
+#include <QtGlobal>
+#include <mutex>
+#include <vector>
+#include <sys/types.h>
+
+// 进程生命周期与按可执行映像的统计：追踪器跟随 fork/clone/exec 时，每个进程（线程组）一个节点，
+// 记下父进程、进程名、映像路径、起止时间和系统调用合计；exec 之后的调用计入新映像。
+// 同一映像的全部进程再汇总成一份按 syscall 的剖面，构建流水线这类成千上万个短命进程的负载按它来看。
+// 追踪线程持有 onAttach()/onFork() 返回的下标，onSyscall() 只是一次数组访问；
+// takeChanges()/images() 在 GUI 线程调用，两者之间加锁。
+class ProcessTree
+{
+public:
+    static constexpr size_t kMaxProcesses = 200000; // 超出后新进程不再建节点，其调用计入 overflow
+
+    struct Process {
+        int index = -1;           // 会话内唯一，pid 会被复用，不能用 pid 作 key
+        int parent = -1;          // 父进程的 index，-1 表示附加时父进程不在追踪中
+        pid_t pid = 0;
+        QString comm;
+        QString image;            // 当前映像（/proc/<pid>/exe）
+        quint64 startNs = 0;      // fork 或附加的时间
+        quint64 endNs = 0;        // 退出或追踪结束的时间，0 表示仍在运行
+        int exitStatus = 0;       // waitpid 的 status，endNs 不为 0 且没有 detached 时有效
+        bool detached = false;    // 追踪结束时仍在运行
+        quint32 execs = 0;
+        quint32 threads = 1;      // 出现过的线程数
+        quint64 calls = 0;
+        quint64 errors = 0;
+        quint64 syscallNs = 0;
+    };
+
+    struct SyscallTotal {
+        quint64 calls = 0;
+        quint64 errors = 0;
+        quint64 ns = 0;
+    };
+
+    struct Image {
+        QString path;
+        quint64 processes = 0;    // 以该映像运行过的进程数（fork 继承和 exec 进入都算）
+        quint64 running = 0;
+        quint64 calls = 0;
+        quint64 errors = 0;
+        quint64 syscallNs = 0;
+        quint64 wallNs = 0;       // 各进程以该映像运行的时间之和，仍在运行的算到 images() 的 nowNs
+        std::vector<SyscallTotal> syscalls; // 下标为系统调用号
+    };
+
+    struct Totals {
+        quint64 processes = 0;
+        quint64 running = 0;
+        quint64 execs = 0;
+        quint64 threads = 0;
+        quint64 overflow = 0;     // 因进程数超出上限而没有建节点的进程
+    };
+
+    struct Changes {
+        std::vector<Process> updated; // 上次取走之后有变化的进程，父进程在子进程之前
+        Totals totals;
+    };
+
+    // waitpid 的 status 格式化成 "exit 0"、"signal 9 (Killed)"
+    static QString exitText(int status);
+
+    void clear();
+
+    // 以下在追踪线程调用，返回或接受的 process 是节点下标，-1 表示没有节点（超出上限），调用被忽略
+    // parent 是已有节点的下标（按 cgroup 附加时父进程也在追踪中），-1 表示作为根节点
+    int onAttach(pid_t pid, const QString &comm, const QString &image, quint64 ts, int parent = -1);
+    int onFork(int parent, pid_t pid, quint64 ts);
+    void onThread(int process);
+    void onExec(int process, const QString &comm, const QString &image, quint64 ts);
+    void onExit(int process, int status, quint64 ts);
+    void onSyscall(int process, long nr, qint64 ret, quint64 durationNs);
+    // 追踪结束时仍在运行的进程：停止计时，记下结束时间并标记为已 detach
+    void onDetach(quint64 ts);
+
+    // 上次 takeChanges 之后是否有变化
+    bool changed() const;
+    Changes takeChanges();
+    // 按映像汇总，nowNs 用来计算仍在运行的进程的时间（CLOCK_MONOTONIC）
+    std::vector<Image> images(quint64 nowNs) const;
+
+private:
+    struct Node {
+        Process p;
+        int imageIndex = -1;
+        quint64 imageSinceNs = 0; // 进入当前映像的时间
+        bool dirty = false;
+    };
+    int imageFor(const QString &path);
+    void enterImage(Node &n, int image, quint64 ts);
+    void leaveImage(Node &n, quint64 ts);
+    void markDirty(Node &n);
+
+    mutable std::mutex m_mutex;
+    std::vector<Node> m_nodes;
+    std::vector<int> m_dirty;
+    std::vector<Image> m_images;
+    QHash<QString, int> m_imageIndex;
+    Totals m_totals;
+};
+
+#endif // PROCESSTREE_H
@@ -0,0 +1,145 @@
+#include "ptracebackend.h"
+#include "tracer.h"
+
+#include <QDebug>
+#include <sys/epoll.h>
+#include <sys/ptrace.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+LivePtraceBackend::~LivePtraceBackend()
+{
+    for (int fd : { m_epoll, m_signal, m_pidfd }) {
+        if (fd != -1)
+            close(fd);
+    }
+}
+
+bool LivePtraceBackend::openEvents(pid_t pid, int wakeFd)
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_signal = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (m_epoll == -1 || m_signal == -1)
+        return false;
+    // pidfd 需要 5.3 以上的内核，没有时只靠 SIGCHLD
+#ifdef SYS_pidfd_open
+    if (pid > 0)
+        m_pidfd = int(syscall(SYS_pidfd_open, pid, 0));
+#else
+    Q_UNUSED(pid);
+#endif
+    m_wake = wakeFd;
+    for (int fd : { m_signal, m_pidfd, m_wake }) {
+        if (fd == -1)
+            continue;
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) == -1)
+            return false;
+    }
+    return true;
+}
+
+bool LivePtraceBackend::addEventFd(int fd)
+{
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return m_epoll != -1 && epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) != -1;
+}
+
+// 睡眠到有事件或超时，并清空 signalfd 和 eventfd；之后由调用方用 waitStop() 收取停顿。
+// SIGCHLD 不排队，signalfd 里至多挂着一个；eventfd 一次读出全部计数：各读一次就清空了，不再读到 EAGAIN
+void LivePtraceBackend::waitEvents(int timeoutMs)
+{
+    struct epoll_event events[4];
+    int n = epoll_wait(m_epoll, events, 4, timeoutMs);
+    for (int i = 0; i < n; ++i) {
+        if (events[i].data.fd == m_signal) {
+            struct signalfd_siginfo info;
+            if (read(m_signal, &info, sizeof(info)) == -1 && errno != EAGAIN)
+                qWarning() << "Tracer: failed to read signalfd:" << strerror(errno);
+        } else if (events[i].data.fd == m_wake) {
+            quint64 count;
+            if (read(m_wake, &count, sizeof(count)) == -1 && errno != EAGAIN)
+                qWarning() << "Tracer: failed to read wake eventfd:" << strerror(errno);
+        }
+        // pidfd 一直可读，只在追踪单个进程时注册：它退出后由 waitpid 收尸，循环随之结束；addEventFd() 的 fd 由调用方读空
+    }
+}
+
+bool LivePtraceBackend::seize(pid_t pid, unsigned long options)
+{
+    return ptrace(PTRACE_SEIZE, pid, nullptr, reinterpret_cast<void*>(quintptr(options))) != -1;
+}
+
+bool LivePtraceBackend::interrupt(pid_t pid)
+{
+    return ptrace(PTRACE_INTERRUPT, pid, nullptr, nullptr) != -1;
+}
+
+bool LivePtraceBackend::resume(pid_t pid, bool listen, int signal)
+{
+    return ptrace(listen ? PTRACE_LISTEN : PTRACE_SYSCALL, pid, nullptr, reinterpret_cast<void*>(quintptr(signal))) != -1;
+}
+
+bool LivePtraceBackend::detach(pid_t pid, int signal)
+{
+    return ptrace(PTRACE_DETACH, pid, nullptr, reinterpret_cast<void*>(quintptr(signal))) != -1;
+}
+
+bool LivePtraceBackend::getRegs(pid_t pid, user_regs_struct *regs)
+{
+    return ptrace(PTRACE_GETREGS, pid, nullptr, regs) != -1;
+}
+
+bool LivePtraceBackend::eventMessage(pid_t pid, unsigned long *message)
+{
+    return ptrace(PTRACE_GETEVENTMSG, pid, nullptr, message) != -1;
+}
+
+pid_t LivePtraceBackend::waitStop(pid_t pid, int *status, bool block)
+{
+    return waitpid(pid, status, block ? __WALL : __WALL | WNOHANG);
+}
+
+ssize_t LivePtraceBackend::readMemory(pid_t pid, quint64 addr, void *buf, size_t size)
+{
+    struct iovec local = { buf, size };
+    struct iovec remote = { reinterpret_cast<void*>(addr), size };
+    return process_vm_readv(pid, &local, 1, &remote, 1, 0);
+}
+
+quint64 LivePtraceBackend::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return quint64(ts.tv_sec) * 1000000000ULL + quint64(ts.tv_nsec);
+}
+
+QString LivePtraceBackend::processName(pid_t pid)
+{
+    return get_process_name(pid);
+}
+
+QString LivePtraceBackend::executablePath(pid_t pid)
+{
+    char link[64];
+    char path[PATH_MAX];
+    snprintf(link, sizeof(link), "/proc/%d/exe", int(pid));
+    ssize_t n = readlink(link, path, sizeof(path));
+    return n > 0 ? QString::fromLocal8Bit(path, int(n)) : QString();
+}
@@ -0,0 +1,82 @@
+#ifndef PTRACEBACKEND_H
+#define PTRACEBACKEND_H
+
+#include <QString>
+#include <QtGlobal>
+#include <sys/types.h>
+#include <sys/user.h>
+
+// Tracer 与内核之间的薄接口：ptrace 请求、收取停顿、读寄存器和进程内存、时钟。
+// 默认的 LivePtraceBackend 直接调用内核；ptracereplay.h 中的录制/回放实现让追踪引擎的状态机、
+// 入口/出口配对和吞吐量可以脱离真实进程测试。
+class PtraceBackend
+{
+public:
+    virtual ~PtraceBackend() = default;
+
+    // 是否面对真实进程：为 false 时追踪器不读 /proc，也不启用绕过本接口直接读进程的采集
+    // （调用栈、调度拆分、网络、地址空间初始映射）
+    virtual bool live() const = 0;
+
+    // 准备等待停顿的事件源；wakeFd 是 Tracer 的 eventfd，stop()/requestDump() 经它唤醒。
+    // pid 不为 0 时另外监视该进程退出；它退出后仍有被追踪的线程时（跟随子进程、按 cgroup 附加）应传 0
+    virtual bool openEvents(pid_t pid, int wakeFd) = 0;
+    // 睡眠到可能有新停顿、有唤醒请求或超时
+    virtual void waitEvents(int timeoutMs) = 0;
+    // openEvents() 之后调用：fd 可读时也唤醒 waitEvents()，由调用方读空（按 cgroup 附加时的 inotify）；不支持时返回 false
+    virtual bool addEventFd(int fd) = 0;
+
+    // 以下与同名的 ptrace 请求对应，失败返回 false 并设置 errno
+    virtual bool seize(pid_t pid, unsigned long options) = 0;
+    virtual bool interrupt(pid_t pid) = 0;
+    // listen 为 true 时用 PTRACE_LISTEN（组停止中），否则 PTRACE_SYSCALL
+    virtual bool resume(pid_t pid, bool listen, int signal) = 0;
+    virtual bool detach(pid_t pid, int signal) = 0;
+    virtual bool getRegs(pid_t pid, user_regs_struct *regs) = 0;
+    // PTRACE_GETEVENTMSG：fork/clone 事件是新线程的 tid，exec 事件是 exec 之前的 tid
+    virtual bool eventMessage(pid_t pid, unsigned long *message) = 0;
+
+    // waitpid(pid, status, __WALL | WNOHANG)：有停顿返回 tid，没有返回 0，出错返回 -1；pid 为 -1 时收取任一被追踪线程。
+    // block 为 true 时去掉 WNOHANG，睡在 waitpid 里直到有停顿，被信号打断时返回 -1（EINTR）
+    virtual pid_t waitStop(pid_t pid, int *status, bool block) = 0;
+    // process_vm_readv 读一段进程内存，返回读到的字节数，失败返回 -1
+    virtual ssize_t readMemory(pid_t pid, quint64 addr, void *buf, size_t size) = 0;
+    // CLOCK_MONOTONIC，ns
+    virtual quint64 now() = 0;
+    virtual QString processName(pid_t pid) = 0;
+    // /proc/<pid>/exe 指向的路径，读不到时为空
+    virtual QString executablePath(pid_t pid) = 0;
+};
+
+// 直接访问内核：ptrace 停顿经 signalfd(SIGCHLD) 通知，停止和转储请求经 eventfd 通知，
+// 只追踪单个进程时它退出后 pidfd 可读。三者（以及 addEventFd() 加入的 fd）挂在同一个 epoll 上；
+// 热路径上追踪线程直接阻塞在 waitStop(block) 里，只在空闲兜底、停止和按 cgroup 附加时睡在 epoll 上
+class LivePtraceBackend : public PtraceBackend
+{
+public:
+    ~LivePtraceBackend() override;
+
+    bool live() const override { return true; }
+    bool openEvents(pid_t pid, int wakeFd) override;
+    void waitEvents(int timeoutMs) override;
+    bool addEventFd(int fd) override;
+    bool seize(pid_t pid, unsigned long options) override;
+    bool interrupt(pid_t pid) override;
+    bool resume(pid_t pid, bool listen, int signal) override;
+    bool detach(pid_t pid, int signal) override;
+    bool getRegs(pid_t pid, user_regs_struct *regs) override;
+    bool eventMessage(pid_t pid, unsigned long *message) override;
+    pid_t waitStop(pid_t pid, int *status, bool block) override;
+    ssize_t readMemory(pid_t pid, quint64 addr, void *buf, size_t size) override;
+    quint64 now() override;
+    QString processName(pid_t pid) override;
+    QString executablePath(pid_t pid) override;
+
+private:
+    int m_epoll = -1;
+    int m_signal = -1;
+    int m_pidfd = -1;
+    int m_wake = -1;
+};
+
+#endif // PTRACEBACKEND_H
@@ -0,0 +1,681 @@
+#include "ptracereplay.h"
+#include "tracer.h"
+#include "eventqueue.h"
+#include "eventstore.h"
+
+#include <QByteArray>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace ptracereplay;
+
+static constexpr size_t kRegWords = sizeof(user_regs_struct) / sizeof(quint64);
+static_assert(kRegWords <= 32, "register mask is 32 bits");
+static constexpr size_t kChunkBytes = 1 << 20;
+
+// --- varint / zigzag，与 tracecodec 的编码相同 ---
+static void putVarint(std::string &out, quint64 v)
+{
+    while (v >= 0x80) {
+        out.push_back(char(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(char(v));
+}
+
+static void putSigned(std::string &out, qint64 v)
+{
+    putVarint(out, (quint64(v) << 1) ^ quint64(v >> 63));
+}
+
+static void putString(std::string &out, std::string_view s)
+{
+    putVarint(out, s.size());
+    out.append(s.data(), s.size());
+}
+
+// 有界读取；越界后 ok 变为 false，之后的读取都返回 0
+struct Cursor {
+    const std::string &data;
+    size_t pos;
+    size_t end;
+    bool ok = true;
+
+    quint64 varint() {
+        quint64 v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= end) {
+                ok = false;
+                return 0;
+            }
+            quint8 b = quint8(data[pos++]);
+            v |= quint64(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        ok = false;
+        return 0;
+    }
+    qint64 signedVarint() {
+        quint64 v = varint();
+        return qint64(v >> 1) ^ -qint64(v & 1);
+    }
+    std::string_view bytes(size_t n) {
+        if (!ok || end - pos < n) {
+            ok = false;
+            return std::string_view();
+        }
+        std::string_view s(data.data() + pos, n);
+        pos += n;
+        return s;
+    }
+    std::string_view string() { return bytes(size_t(varint())); }
+};
+
+// --- 比较与运行 ---
+
+Comparison ptracereplay::compareEvents(const std::vector<RecordedEvent> &expected, const std::vector<RecordedEvent> &actual)
+{
+    Comparison c;
+    const size_t n = std::min(expected.size(), actual.size());
+    for (size_t i = 0; i < n; ++i) {
+        const SyscallEvent &a = expected[i].event;
+        const SyscallEvent &b = actual[i].event;
+        if (a.syscall != b.syscall || a.ret != b.ret || a.pid != b.pid || a.tid != b.tid
+            || expected[i].comm != actual[i].comm || expected[i].path != actual[i].path) {
+            if (c.firstMismatch < 0) {
+                c.firstMismatch = qint64(i);
+                c.firstDescription = QString("event %1: expected syscall %2 ret %3 path \"%4\", got syscall %5 ret %6 path \"%7\"")
+                                         .arg(i).arg(a.syscall).arg(a.ret).arg(QString::fromStdString(expected[i].path))
+                                         .arg(b.syscall).arg(b.ret).arg(QString::fromStdString(actual[i].path));
+            }
+            c.behaviourMismatches++;
+        } else if (a.ts != b.ts || a.duration != b.duration) {
+            c.timingMismatches++;
+        }
+    }
+    if (expected.size() != actual.size()) {
+        c.behaviourMismatches += quint64(std::max(expected.size(), actual.size()) - n);
+        if (c.firstMismatch < 0) {
+            c.firstMismatch = qint64(n);
+            c.firstDescription = QString("expected %1 events, got %2").arg(expected.size()).arg(actual.size());
+        }
+    }
+    return c;
+}
+
+QString ptracereplay::runTracer(Tracer &tracer, pid_t pid, int stopAfterMs, std::vector<RecordedEvent> &events, quint64 *dropped)
+{
+    Arena arena;
+    StringTable strings(arena);
+    EventQueue queue(1 << 20);
+    TracerMetrics metrics;
+    tracer.setMetrics(&metrics);
+    tracer.setEventSink(&queue, &strings);
+
+    QString message;
+    std::atomic<bool> done{false};
+    // 没有事件循环，直接在追踪线程上调用
+    QObject::connect(&tracer, &Tracer::finished, [&message](const QString &m) { message = m; });
+    std::thread worker([&]() {
+        tracer.start(unsigned(pid));
+        done.store(true);
+    });
+
+    // 先只搬运定长记录，字符串等追踪结束后再解析，消费端不拖慢回放
+    std::vector<SyscallEvent> raw;
+    std::vector<SyscallEvent> batch(4096);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(stopAfterMs);
+    bool stopSent = false;
+    for (;;) {
+        const bool finished = done.load();
+        size_t n;
+        while ((n = queue.pop(batch.data(), batch.size())) > 0)
+            raw.insert(raw.end(), batch.begin(), batch.begin() + n);
+        if (finished)
+            break;
+        if (stopAfterMs > 0 && !stopSent && std::chrono::steady_clock::now() >= deadline) {
+            tracer.stop();
+            stopSent = true;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    worker.join();
+
+    events.clear();
+    events.reserve(raw.size());
+    for (const SyscallEvent &e : raw) {
+        RecordedEvent r;
+        r.event = e;
+        r.comm = std::string(strings.view(e.commId));
+        if (e.pathId)
+            r.path = std::string(strings.view(e.pathId));
+        events.push_back(std::move(r));
+    }
+    if (dropped)
+        *dropped = metrics.dropped.load();
+    return message;
+}
+
+// --- 录制 ---
+
+RecordingPtraceBackend::~RecordingPtraceBackend()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+bool RecordingPtraceBackend::open(const QString &path, pid_t pid, const QString &filterText, QString *error)
+{
+    m_file = fopen(path.toLocal8Bit().constData(), "wb");
+    if (!m_file) {
+        if (error)
+            *error = QString("Cannot create %1: %2").arg(path, strerror(errno));
+        return false;
+    }
+    // 定长头部按本机字节序写（x86_64：小端）
+    const QByteArray filter = filterText.toUtf8();
+    const quint32 magic = kMagic, pidValue = quint32(pid), filterSize = quint32(filter.size());
+    const quint16 version = kVersion;
+    std::string header;
+    header.append(reinterpret_cast<const char*>(&magic), 4);
+    header.append(reinterpret_cast<const char*>(&version), 2);
+    header.append(reinterpret_cast<const char*>(&pidValue), 4);
+    header.append(reinterpret_cast<const char*>(&filterSize), 4);
+    header.append(filter.constData(), size_t(filter.size()));
+    m_failed = fwrite(header.data(), 1, header.size(), m_file) != header.size();
+    m_written = header.size();
+    m_buf.reserve(kChunkBytes + 4096);
+    return !m_failed;
+}
+
+void RecordingPtraceBackend::flushChunk()
+{
+    if (m_buf.empty() || !m_file)
+        return;
+    // 录制在追踪线程上进行，用最快的压缩级别
+    const QByteArray chunk = qCompress(reinterpret_cast<const uchar*>(m_buf.data()), int(m_buf.size()), 1);
+    const quint32 size = quint32(chunk.size());
+    if (fwrite(&size, sizeof(size), 1, m_file) != 1 || fwrite(chunk.constData(), 1, size_t(size), m_file) != size_t(size))
+        m_failed = true;
+    m_written += sizeof(size) + size;
+    m_buf.clear();
+}
+
+bool RecordingPtraceBackend::finish(const std::vector<RecordedEvent> &events, QString *error)
+{
+    m_buf.push_back('Z');
+    quint64 lastTs = 0;
+    for (const RecordedEvent &r : events) {
+        const SyscallEvent &e = r.event;
+        m_buf.push_back('E');
+        putSigned(m_buf, e.syscall);
+        putSigned(m_buf, e.ret);
+        putSigned(m_buf, qint64(e.ts - lastTs));
+        putVarint(m_buf, e.duration);
+        putVarint(m_buf, e.pid);
+        putVarint(m_buf, e.tid);
+        putVarint(m_buf, e.flags);
+        putString(m_buf, r.comm);
+        putString(m_buf, r.path);
+        lastTs = e.ts;
+        if (m_buf.size() >= kChunkBytes)
+            flushChunk();
+    }
+    flushChunk();
+    if (m_file && fclose(m_file) != 0)
+        m_failed = true;
+    m_file = nullptr;
+    if (m_failed && error)
+        *error = QString("Write error: %1").arg(strerror(errno));
+    return !m_failed;
+}
+
+void RecordingPtraceBackend::putRequest(Request request, int signal, bool ok)
+{
+    const int savedErrno = errno;
+    m_buf.push_back('C');
+    m_buf.push_back(char(request));
+    putVarint(m_buf, quint64(signal));
+    m_buf.push_back(char(ok));
+    if (m_buf.size() >= kChunkBytes)
+        flushChunk();
+    errno = savedErrno;
+}
+
+bool RecordingPtraceBackend::seize(pid_t pid, unsigned long options)
+{
+    bool ok = LivePtraceBackend::seize(pid, options);
+    putRequest(Seize, int(options), ok);
+    return ok;
+}
+
+bool RecordingPtraceBackend::interrupt(pid_t pid)
+{
+    bool ok = LivePtraceBackend::interrupt(pid);
+    putRequest(Interrupt, 0, ok);
+    return ok;
+}
+
+bool RecordingPtraceBackend::resume(pid_t pid, bool listen, int signal)
+{
+    bool ok = LivePtraceBackend::resume(pid, listen, signal);
+    putRequest(listen ? Listen : Syscall, signal, ok);
+    return ok;
+}
+
+bool RecordingPtraceBackend::detach(pid_t pid, int signal)
+{
+    bool ok = LivePtraceBackend::detach(pid, signal);
+    putRequest(Detach, signal, ok);
+    return ok;
+}
+
+bool RecordingPtraceBackend::getRegs(pid_t pid, user_regs_struct *regs)
+{
+    bool ok = LivePtraceBackend::getRegs(pid, regs);
+    m_buf.push_back('R');
+    m_buf.push_back(char(ok));
+    if (ok) {
+        // 相邻两次停顿之间大多数寄存器不变，只写变化的字
+        quint64 words[kRegWords], last[kRegWords];
+        memcpy(words, regs, sizeof(words));
+        memcpy(last, &m_lastRegs, sizeof(last));
+        quint32 mask = 0;
+        for (size_t i = 0; i < kRegWords; ++i) {
+            if (words[i] != last[i])
+                mask |= 1u << i;
+        }
+        putVarint(m_buf, mask);
+        for (size_t i = 0; i < kRegWords; ++i) {
+            if (mask & (1u << i))
+                putVarint(m_buf, words[i] ^ last[i]);
+        }
+        m_lastRegs = *regs;
+    }
+    return ok;
+}
+
+bool RecordingPtraceBackend::eventMessage(pid_t pid, unsigned long *message)
+{
+    bool ok = LivePtraceBackend::eventMessage(pid, message);
+    m_buf.push_back('G');
+    m_buf.push_back(char(ok));
+    putVarint(m_buf, ok ? quint64(*message) : 0);
+    return ok;
+}
+
+pid_t RecordingPtraceBackend::waitStop(pid_t pid, int *status, bool block)
+{
+    pid_t reaped = LivePtraceBackend::waitStop(pid, status, block);
+    // 没有停顿的空转和被唤醒信号打断的阻塞等待不影响引擎状态，不记录
+    if (reaped == -1 && errno == EINTR)
+        return reaped;
+    if (reaped != 0) {
+        m_buf.push_back('S');
+        putSigned(m_buf, reaped);
+        putVarint(m_buf, reaped > 0 ? quint32(*status) : 0);
+        if (m_buf.size() >= kChunkBytes)
+            flushChunk();
+    }
+    return reaped;
+}
+
+ssize_t RecordingPtraceBackend::readMemory(pid_t pid, quint64 addr, void *buf, size_t size)
+{
+    ssize_t n = LivePtraceBackend::readMemory(pid, addr, buf, size);
+    m_buf.push_back('M');
+    putVarint(m_buf, addr);
+    putVarint(m_buf, size);
+    putSigned(m_buf, n);
+    if (n > 0)
+        m_buf.append(static_cast<const char*>(buf), size_t(n));
+    return n;
+}
+
+quint64 RecordingPtraceBackend::now()
+{
+    quint64 t = LivePtraceBackend::now();
+    m_buf.push_back('T');
+    putSigned(m_buf, qint64(t - m_lastClock));
+    m_lastClock = t;
+    return t;
+}
+
+void RecordingPtraceBackend::putText(char kind, const QString &value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    m_buf.push_back(kind);
+    putString(m_buf, std::string_view(utf8.constData(), size_t(utf8.size())));
+}
+
+QString RecordingPtraceBackend::processName(pid_t pid)
+{
+    QString name = LivePtraceBackend::processName(pid);
+    putText('N', name);
+    return name;
+}
+
+QString RecordingPtraceBackend::executablePath(pid_t pid)
+{
+    QString path = LivePtraceBackend::executablePath(pid);
+    putText('X', path);
+    return path;
+}
+
+// --- 回放 ---
+
+bool ReplayPtraceBackend::load(const QString &path, QString *error)
+{
+    auto fail = [&](const QString &message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+    FILE *f = fopen(path.toLocal8Bit().constData(), "rb");
+    if (!f)
+        return fail(QString("Cannot open %1: %2").arg(path, strerror(errno)));
+    std::string file;
+    char buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        file.append(buf, n);
+    fclose(f);
+
+    quint32 magic = 0, pid = 0, filterSize = 0;
+    quint16 version = 0;
+    if (file.size() < 14)
+        return fail("Not a stop fixture (file too short).");
+    memcpy(&magic, file.data(), 4);
+    memcpy(&version, file.data() + 4, 2);
+    memcpy(&pid, file.data() + 6, 4);
+    memcpy(&filterSize, file.data() + 10, 4);
+    if (magic != kMagic)
+        return fail("Not a stop fixture (bad magic).");
+    if (version < 1 || version > kVersion)
+        return fail(QString("Unsupported stop fixture version %1.").arg(version));
+    if (file.size() - 14 < filterSize)
+        return fail("Truncated stop fixture header.");
+    m_pid = pid_t(pid);
+    m_filterText = QString::fromUtf8(file.data() + 14, int(filterSize));
+
+    m_stream.clear();
+    size_t pos = 14 + filterSize;
+    while (pos < file.size()) {
+        quint32 size = 0;
+        if (file.size() - pos < 4)
+            return fail("Truncated stop fixture chunk.");
+        memcpy(&size, file.data() + pos, 4);
+        pos += 4;
+        if (file.size() - pos < size)
+            return fail("Truncated stop fixture chunk.");
+        const QByteArray plain = qUncompress(reinterpret_cast<const uchar*>(file.data() + pos), int(size));
+        if (plain.isEmpty() && size > 0)
+            return fail("Corrupt stop fixture chunk.");
+        m_stream.append(plain.constData(), size_t(plain.size()));
+        pos += size;
+    }
+
+    // 先完整走一遍记录流：校验格式、数停顿、找到 'Z'，回放时就不必再检查
+    m_streamEnd = m_stream.size();
+    m_pos = 0;
+    m_stopCount = 0;
+    m_seizeOptions = 0;
+    m_regs = {};
+    m_clock = 0;
+    while (m_pos < m_stream.size() && m_stream[m_pos] != 'Z') {
+        if (!readRecord())
+            return fail(QString("Corrupt stop record at offset %1.").arg(m_pos));
+        if (m_rec.kind == 'S')
+            m_stopCount++;
+        else if (m_rec.kind == 'C' && m_rec.request == Seize && m_stopCount == 0)
+            m_seizeOptions = (unsigned long)(m_rec.result);
+    }
+    if (m_pos >= m_stream.size())
+        return fail("Stop fixture has no end marker (the recording was interrupted).");
+    m_streamEnd = m_pos;
+
+    m_expected.clear();
+    Cursor c{ m_stream, m_streamEnd + 1, m_stream.size() };
+    quint64 lastTs = 0;
+    while (c.ok && c.pos < c.end) {
+        if (c.data[c.pos++] != 'E')
+            return fail("Corrupt expected-event record.");
+        RecordedEvent r = {};
+        r.event.syscall = qint16(c.signedVarint());
+        r.event.ret = c.signedVarint();
+        r.event.ts = lastTs + quint64(c.signedVarint());
+        r.event.duration = c.varint();
+        r.event.pid = quint32(c.varint());
+        r.event.tid = quint32(c.varint());
+        r.event.flags = quint16(c.varint());
+        r.comm = std::string(c.string());
+        r.path = std::string(c.string());
+        lastTs = r.event.ts;
+        m_expected.push_back(std::move(r));
+    }
+    if (!c.ok)
+        return fail("Truncated expected-event record.");
+    rewind();
+    return true;
+}
+
+void ReplayPtraceBackend::rewind()
+{
+    m_pos = 0;
+    m_rec = Current();
+    m_regs = {};
+    m_clock = 0;
+    m_exhausted = false;
+    m_syntheticStops.clear();
+    m_divergences = 0;
+    m_skipped = 0;
+}
+
+bool ReplayPtraceBackend::readRecord()
+{
+    Cursor c{ m_stream, m_pos + 1, m_streamEnd };
+    if (m_pos >= m_streamEnd)
+        return false;
+    m_rec.kind = m_stream[m_pos];
+    switch (m_rec.kind) {
+        case 'N': case 'X':
+            m_rec.data = c.string();
+            break;
+        case 'G':
+            m_rec.ok = c.varint() != 0;
+            m_rec.result = qint64(c.varint());
+            break;
+        case 'C':
+            m_rec.request = quint8(c.varint());
+            m_rec.result = qint64(c.varint()); // 恢复/detach 时交还的信号或 PTRACE_SEIZE 的选项
+            m_rec.ok = c.varint() != 0;
+            break;
+        case 'S':
+            m_rec.pid = c.signedVarint();
+            m_rec.status = quint32(c.varint());
+            break;
+        case 'R': {
+            m_rec.ok = c.varint() != 0;
+            if (!m_rec.ok)
+                break;
+            const quint32 mask = quint32(c.varint());
+            quint64 words[kRegWords];
+            memcpy(words, &m_regs, sizeof(words));
+            for (size_t i = 0; i < kRegWords; ++i) {
+                if (mask & (1u << i))
+                    words[i] ^= c.varint();
+            }
+            memcpy(&m_regs, words, sizeof(words));
+            break;
+        }
+        case 'M':
+            m_rec.addr = c.varint();
+            m_rec.size = c.varint();
+            m_rec.result = c.signedVarint();
+            m_rec.data = m_rec.result > 0 ? c.bytes(size_t(m_rec.result)) : std::string_view();
+            break;
+        case 'T':
+            m_clock += quint64(c.signedVarint());
+            break;
+        default:
+            return false;
+    }
+    if (!c.ok)
+        return false;
+    m_pos = c.pos;
+    return true;
+}
+
+bool ReplayPtraceBackend::seek(char kind)
+{
+    while (m_pos < m_streamEnd) {
+        const char next = m_stream[m_pos];
+        if (next != kind && next == 'S')
+            return false;
+        if (!readRecord())
+            return false;
+        if (next == kind)
+            return true;
+        m_skipped++;
+        if (next == 'C')
+            m_divergences++; // 录制时有、回放时引擎没有发出的请求
+    }
+    return false;
+}
+
+bool ReplayPtraceBackend::request(Request request)
+{
+    if (m_exhausted)
+        return true;
+    if (m_pos >= m_streamEnd || m_stream[m_pos] != 'C' || !readRecord()) {
+        m_divergences++;
+        return true;
+    }
+    if (m_rec.request != request)
+        m_divergences++;
+    if (!m_rec.ok)
+        errno = ESRCH;
+    return m_rec.ok;
+}
+
+bool ReplayPtraceBackend::seize(pid_t, unsigned long)
+{
+    return request(Seize);
+}
+
+bool ReplayPtraceBackend::interrupt(pid_t pid)
+{
+    // 记录流已经用完：引擎正在停止追踪，给这个线程一个中断停顿
+    if (m_exhausted) {
+        m_syntheticStops.push_back(pid);
+        return true;
+    }
+    return request(Interrupt);
+}
+
+bool ReplayPtraceBackend::resume(pid_t, bool listen, int)
+{
+    return request(listen ? Listen : Syscall);
+}
+
+bool ReplayPtraceBackend::detach(pid_t, int)
+{
+    return request(Detach);
+}
+
+bool ReplayPtraceBackend::getRegs(pid_t, user_regs_struct *regs)
+{
+    if (!seek('R')) {
+        m_divergences++;
+        errno = ESRCH;
+        return false;
+    }
+    if (!m_rec.ok) {
+        errno = ESRCH;
+        return false;
+    }
+    *regs = m_regs;
+    return true;
+}
+
+bool ReplayPtraceBackend::eventMessage(pid_t, unsigned long *message)
+{
+    if (!seek('G')) {
+        m_divergences++;
+        errno = ESRCH;
+        return false;
+    }
+    *message = (unsigned long)(m_rec.result);
+    if (!m_rec.ok)
+        errno = ESRCH;
+    return m_rec.ok;
+}
+
+pid_t ReplayPtraceBackend::waitStop(pid_t, int *status, bool)
+{
+    if (!m_syntheticStops.empty()) {
+        const pid_t pid = m_syntheticStops.back();
+        m_syntheticStops.pop_back();
+        *status = (PTRACE_EVENT_STOP << 16) | (SIGTRAP << 8) | 0x7f;
+        return pid;
+    }
+    if (!m_exhausted && seek('S')) {
+        *status = int(m_rec.status);
+        if (m_rec.pid < 0)
+            errno = ECHILD;
+        return pid_t(m_rec.pid);
+    }
+    if (!m_exhausted) {
+        m_exhausted = true;
+        if (m_onExhausted)
+            m_onExhausted();
+    }
+    return 0;
+}
+
+ssize_t ReplayPtraceBackend::readMemory(pid_t, quint64 addr, void *buf, size_t size)
+{
+    if (!seek('M') || m_rec.addr != addr || m_rec.size != size) {
+        m_divergences++;
+        errno = EFAULT;
+        return -1;
+    }
+    if (m_rec.result > 0)
+        memcpy(buf, m_rec.data.data(), m_rec.data.size());
+    else
+        errno = EFAULT;
+    return ssize_t(m_rec.result);
+}
+
+quint64 ReplayPtraceBackend::now()
+{
+    // 下一条正好是时钟读数时取用，否则顺延 1 ns，保持单调
+    if (m_pos < m_streamEnd && m_stream[m_pos] == 'T' && readRecord())
+        return m_clock;
+    return ++m_clock;
+}
+
+QString ReplayPtraceBackend::string(char kind)
+{
+    if (!seek(kind)) {
+        m_divergences++;
+        return QString();
+    }
+    return QString::fromUtf8(m_rec.data.data(), int(m_rec.data.size()));
+}
+
+QString ReplayPtraceBackend::processName(pid_t)
+{
+    return string('N');
+}
+
+QString ReplayPtraceBackend::executablePath(pid_t)
+{
+    return string('X');
+}
@@ -0,0 +1,170 @@
+#ifndef PTRACEREPLAY_H
+#define PTRACEREPLAY_H
+
+#include <QString>
+#include <functional>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ptracebackend.h"
+#include "syscallevent.h"
+
+class Tracer;
+
+// 停顿序列夹具（.qstops）：录制时把追踪引擎从内核得到的每一个输入按调用顺序记下来——
+// 停顿状态、寄存器、读到的进程内存、时钟读数、ptrace 请求的结果——连同引擎当时产生的事件；
+// 回放时按同样的顺序交还给引擎，不接触任何进程，产生的事件可以与录制时逐字段比较。
+//
+// 文件：u32 魔数、u16 版本、u32 pid、u32 长度 + 追踪过滤表达式，之后是若干 qCompress 块（u32 长度 + 数据）。
+// 解压后是记录流，每条记录以一个类型字节开头：
+//   'N' 进程名    'C' ptrace 请求（请求、信号或 PTRACE_SEIZE 的选项、是否成功）    'S' 收取到的停顿（pid、status）
+//   'R' 寄存器（与上一次逐字异或，只写变化的字）    'M' 读内存（地址、长度、结果、数据）
+//   'T' 时钟读数（与上一次的差）    'G' 事件消息（是否成功、值）    'X' 可执行文件路径
+//   'Z' 引擎结束，其后是引擎产生的事件 'E'
+// 版本 2 加入了 'G' 和 'X'（跟随子进程与 exec），版本 1 的夹具仍可回放
+namespace ptracereplay {
+
+static constexpr quint32 kMagic = 0x50545351; // "QSTP"
+static constexpr quint16 kVersion = 2;
+
+enum Request : quint8 { Seize, Interrupt, Syscall, Listen, Detach };
+
+// 引擎产生的一个事件；字符串 id 只在一次会话内有效，比较时用字符串本身
+struct RecordedEvent {
+    SyscallEvent event;
+    std::string comm;
+    std::string path;
+};
+
+// 逐个事件比较：syscall、返回值、pid/tid、进程名和路径不同算行为不同，只有时间戳/耗时不同算计时不同
+// （引擎读时钟的次数变了时，回放出的时间会错位，但配对和状态机仍然可以验证）
+struct Comparison {
+    quint64 behaviourMismatches = 0;
+    quint64 timingMismatches = 0;
+    qint64 firstMismatch = -1;       // 第一个行为不同的事件下标（或数量不同时较短一方的长度）
+    QString firstDescription;
+};
+Comparison compareEvents(const std::vector<RecordedEvent> &expected, const std::vector<RecordedEvent> &actual);
+
+// 在当前线程之外运行 tracer.start(pid)，本线程取走事件直到追踪结束；stopAfterMs > 0 时到时调用 stop()。
+// 事件接收端由这里设置，其余配置（后端、过滤）由调用方先设好。返回 Tracer::finished 的消息
+QString runTracer(Tracer &tracer, pid_t pid, int stopAfterMs, std::vector<RecordedEvent> &events, quint64 *dropped = nullptr);
+
+} // namespace ptracereplay
+
+// 直接访问内核，同时把引擎得到的每个输入写入夹具
+class RecordingPtraceBackend : public LivePtraceBackend
+{
+public:
+    ~RecordingPtraceBackend() override;
+
+    bool open(const QString &path, pid_t pid, const QString &filterText, QString *error);
+    // 追踪结束后调用：写入引擎产生的事件并关闭文件
+    bool finish(const std::vector<ptracereplay::RecordedEvent> &events, QString *error);
+    quint64 bytesWritten() const { return m_written; }
+
+    bool seize(pid_t pid, unsigned long options) override;
+    bool interrupt(pid_t pid) override;
+    bool resume(pid_t pid, bool listen, int signal) override;
+    bool detach(pid_t pid, int signal) override;
+    bool getRegs(pid_t pid, user_regs_struct *regs) override;
+    bool eventMessage(pid_t pid, unsigned long *message) override;
+    pid_t waitStop(pid_t pid, int *status, bool block) override;
+    ssize_t readMemory(pid_t pid, quint64 addr, void *buf, size_t size) override;
+    quint64 now() override;
+    QString processName(pid_t pid) override;
+    QString executablePath(pid_t pid) override;
+
+private:
+    void putText(char kind, const QString &value);
+    void putRequest(ptracereplay::Request request, int signal, bool ok);
+    void flushChunk();
+
+    FILE *m_file = nullptr;
+    bool m_failed = false;
+    std::string m_buf;
+    user_regs_struct m_lastRegs = {};
+    quint64 m_lastClock = 0;
+    quint64 m_written = 0;
+};
+
+// 按录制顺序把输入交还给引擎。引擎的调用与录制不一致时（引擎改过）尽量继续：
+// 多出来的时钟读数顺延 1 ns，多出来或不同的 ptrace 请求计入 divergences，
+// 引擎没有取用的记录在下一次停顿时跳过并计入 skipped；停顿是同步点，不会被跳过。
+// 记录流用完后引擎再等停顿时调用一次 exhausted 处理函数（通常是 Tracer::stop），
+// 之后对每个线程的 PTRACE_INTERRUPT 都得到一个合成的中断停顿，引擎随之结束。
+class ReplayPtraceBackend : public PtraceBackend
+{
+public:
+    bool load(const QString &path, QString *error);
+    pid_t pid() const { return m_pid; }
+    const QString &filterText() const { return m_filterText; }
+    // 录制时 PTRACE_SEIZE 的选项（跟随子进程时含 PTRACE_O_TRACEFORK），回放前按它配置 Tracer
+    unsigned long seizeOptions() const { return m_seizeOptions; }
+    const std::vector<ptracereplay::RecordedEvent> &expectedEvents() const { return m_expected; }
+    quint64 stopCount() const { return m_stopCount; }
+    size_t streamBytes() const { return m_streamEnd; }
+
+    // 从头回放；每一轮开始前调用
+    void rewind();
+    void setExhaustedHandler(std::function<void()> handler) { m_onExhausted = std::move(handler); }
+    quint64 divergences() const { return m_divergences; }
+    quint64 skipped() const { return m_skipped; }
+
+    bool live() const override { return false; }
+    bool openEvents(pid_t, int) override { return true; }
+    void waitEvents(int) override {}
+    bool addEventFd(int) override { return false; }
+    bool seize(pid_t pid, unsigned long options) override;
+    bool interrupt(pid_t pid) override;
+    bool resume(pid_t pid, bool listen, int signal) override;
+    bool detach(pid_t pid, int signal) override;
+    bool getRegs(pid_t pid, user_regs_struct *regs) override;
+    bool eventMessage(pid_t pid, unsigned long *message) override;
+    pid_t waitStop(pid_t pid, int *status, bool block) override;
+    ssize_t readMemory(pid_t pid, quint64 addr, void *buf, size_t size) override;
+    quint64 now() override;
+    QString processName(pid_t pid) override;
+    QString executablePath(pid_t pid) override;
+
+private:
+    QString string(char kind);
+    // 解码 m_pos 处的一条记录到 m_rec，并更新寄存器与时钟状态；数据损坏返回 false
+    bool readRecord();
+    // 跳到下一条 kind 记录并解码；遇到停顿（或流结束）时停下返回 false
+    bool seek(char kind);
+    bool request(ptracereplay::Request request);
+
+    struct Current {
+        char kind = 0;
+        qint64 pid = 0;
+        quint32 status = 0;
+        quint8 request = 0;
+        bool ok = false;
+        quint64 addr = 0;
+        quint64 size = 0;
+        qint64 result = 0;              // 'M' 的结果，'G' 的值
+        std::string_view data;
+    };
+
+    std::string m_stream;
+    size_t m_streamEnd = 0;           // 'Z' 的位置
+    pid_t m_pid = 0;
+    QString m_filterText;
+    unsigned long m_seizeOptions = 0;
+    std::vector<ptracereplay::RecordedEvent> m_expected;
+    quint64 m_stopCount = 0;
+
+    size_t m_pos = 0;
+    Current m_rec;
+    user_regs_struct m_regs = {};
+    quint64 m_clock = 0;
+    bool m_exhausted = false;
+    std::vector<pid_t> m_syntheticStops;
+    std::function<void()> m_onExhausted;
+    quint64 m_divergences = 0;
+    quint64 m_skipped = 0;
+};
+
+#endif // PTRACEREPLAY_H
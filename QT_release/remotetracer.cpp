@@ -0,0 +1,265 @@
+#include "remotetracer.h"
+#include "eventqueue.h"
+#include "eventstore.h"
+#include "tracecodec.h"
+#include "tracermetrics.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace agentprotocol;
+
+// 暂停接收期间检查本地队列是否降到低水位的间隔：消费端取走事件时不通知这里
+static const int kBackpressurePollMs = 10;
+
+RemoteTracer::RemoteTracer(const Address &address, QObject *parent)
+    : QObject(parent), m_address(address)
+{
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+RemoteTracer::~RemoteTracer()
+{
+    if (m_wakeFd != -1)
+        close(m_wakeFd);
+}
+
+void RemoteTracer::wake()
+{
+    quint64 one = 1;
+    if (m_wakeFd != -1 && write(m_wakeFd, &one, sizeof(one)) < 0) {
+        // 计数器已满也会让 poll 返回，忽略
+    }
+}
+
+void RemoteTracer::setMode(Mode mode)
+{
+    m_mode.store(mode);
+    m_modeChanged.store(true);
+    wake();
+}
+
+void RemoteTracer::stop()
+{
+    m_stopRequested.store(true);
+    wake();
+}
+
+std::vector<SummaryEntry> RemoteTracer::takeSummaries()
+{
+    std::vector<SummaryEntry> out;
+    std::lock_guard<std::mutex> lock(m_summaryMutex);
+    out.swap(m_summaries);
+    return out;
+}
+
+void RemoteTracer::start(unsigned int pid)
+{
+    QString error;
+    std::string token;
+    if (!m_address.tokenFile.empty() && !readToken(m_address.tokenFile, geteuid(), token, &error)) {
+        emit finished(QString("Error: Cannot read agent token: %1").arg(error));
+        return;
+    }
+    int fd = connectTo(m_address, &error);
+    if (fd < 0) {
+        emit finished(QString("Error: Cannot connect to agent: %1").arg(error));
+        return;
+    }
+
+    FrameBuffer in;
+    std::string out;
+    char buf[1 << 16];
+    FrameType type;
+    std::string_view payload;
+    qint64 clockOffset = 0; // 本机时钟 - 代理时钟
+    bool helloSeen = false;
+    QString message = "Agent closed the connection.";
+    std::vector<quint32> stringMap(1, 0); // 代理的字符串 id -> 本地 id
+    std::vector<SyscallEvent> events;
+    quint64 agentDropped = 0;
+    quint64 localDropped = 0;
+    // 本地队列积压到高水位时不再从套接字读、也不再解码已收到的帧，套接字缓冲随之填满，代理那边的背压
+    // （积压和按它的策略丢弃）才会生效；降到低水位以下再继续。高水位之上留出余量，正在解码的一帧放得下。
+    // 发出 Stop 之后不再暂停：消费端可能已经不取事件了，剩下的在本地丢弃，尽快读到 Finished
+    const size_t highWater = m_queue->capacity() * 3 / 4;
+    const size_t lowWater = m_queue->capacity() / 4;
+    bool paused = false;
+
+    // Auth、Start 与 Hello 不必互相等待：先发出去，Hello 到了再换算时钟
+    size_t frame;
+    if (!token.empty()) {
+        frame = beginFrame(out, Auth);
+        putBytes(out, token);
+        endFrame(out, frame);
+    }
+    frame = beginFrame(out, Start);
+    putU32(out, pid);
+    putU8(out, quint8(m_mode.load()));
+    QByteArray filter = m_filterText.toUtf8();
+    putBytes(out, std::string_view(filter.constData(), size_t(filter.size())));
+    endFrame(out, frame);
+    m_modeChanged.store(false);
+    bool stopSent = false;
+
+    for (;;) {
+        if (!out.empty()) {
+            if (!sendAll(fd, out.data(), out.size(), 5000)) {
+                message = QString("Error: Lost connection to agent: %1").arg(strerror(errno));
+                break;
+            }
+            out.clear();
+        }
+
+        if (paused && (stopSent || m_queue->size() <= lowWater))
+            paused = false;
+        // 暂停时 fd 置 -1，poll 忽略这一项
+        pollfd fds[2] = { { paused ? -1 : fd, POLLIN, 0 }, { m_wakeFd, POLLIN, 0 } };
+        poll(fds, 2, paused ? kBackpressurePollMs : 1000);
+        if (fds[1].revents & POLLIN) {
+            quint64 count;
+            while (read(m_wakeFd, &count, sizeof(count)) > 0) {}
+        }
+        if (m_stopRequested.load() && !stopSent) {
+            size_t f = beginFrame(out, Stop);
+            endFrame(out, f);
+            stopSent = true;
+        }
+        if (m_modeChanged.exchange(false)) {
+            size_t f = beginFrame(out, SetMode);
+            putU8(out, quint8(m_mode.load()));
+            endFrame(out, f);
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+                break;
+            if (n > 0)
+                in.append(buf, size_t(n));
+        }
+
+        bool done = false;
+        while (!done && !paused && in.next(type, payload)) {
+            Reader r(payload);
+            switch (type) {
+                case Hello: {
+                    quint32 magic = r.u32();
+                    quint16 version = r.u16();
+                    quint64 agentNow = r.u64();
+                    if (!r.ok || magic != kMagic || version != kVersion) {
+                        message = QString("Error: Agent speaks an incompatible protocol (version %1).").arg(version);
+                        done = true;
+                        break;
+                    }
+                    clockOffset = qint64(monotonicNs() - agentNow);
+                    helloSeen = true;
+                    break;
+                }
+                case Strings: {
+                    quint32 first = r.u32();
+                    quint32 count = r.u32();
+                    if (first != stringMap.size())
+                        r.ok = false;
+                    for (quint32 i = 0; r.ok && i < count; ++i) {
+                        std::string_view s = r.bytes();
+                        if (r.ok)
+                            stringMap.push_back(m_strings->intern(s));
+                    }
+                    break;
+                }
+                case Events: {
+                    // 数量来自对端，先核对上限和负载大小再分配
+                    quint32 count = r.u32();
+                    std::string_view data = r.rest();
+                    if (!r.ok || count > kMaxBatchEvents || data.size() < size_t(count) * tracecodec::kMinBytesPerEvent) {
+                        r.ok = false;
+                        break;
+                    }
+                    events.resize(count);
+                    if (!tracecodec::decodeColumns(data.data(), data.size(), count, events.data())) {
+                        r.ok = false;
+                        break;
+                    }
+                    for (SyscallEvent &e : events) {
+                        e.ts = quint64(qint64(e.ts) + clockOffset);
+                        e.commId = e.commId < stringMap.size() ? stringMap[e.commId] : 0;
+                        e.pathId = e.pathId < stringMap.size() ? stringMap[e.pathId] : 0;
+                        if (m_queue->push(e))
+                            TracerMetrics::add(m_metrics->emitted, 1);
+                        else
+                            localDropped++;
+                    }
+                    if (!stopSent && m_queue->size() >= highWater)
+                        paused = true;
+                    break;
+                }
+                case Summary: {
+                    quint32 count = r.u32();
+                    if (!r.ok || count > kMaxSummaryEntries || size_t(r.end - r.p) != size_t(count) * kSummaryEntryBytes) {
+                        r.ok = false;
+                        break;
+                    }
+                    std::vector<SummaryEntry> entries;
+                    entries.reserve(count);
+                    for (quint32 i = 0; r.ok && i < count; ++i) {
+                        SummaryEntry s;
+                        s.second = qint64(r.u64());
+                        s.syscall = qint16(r.u16());
+                        s.count = r.u32();
+                        s.errors = r.u32();
+                        s.durationNs = r.u64();
+                        // 换算到本机时钟的秒
+                        s.second = (s.second * 1000000000LL + clockOffset) / 1000000000LL;
+                        entries.push_back(s);
+                    }
+                    std::lock_guard<std::mutex> lock(m_summaryMutex);
+                    m_summaries.insert(m_summaries.end(), entries.begin(), entries.end());
+                    break;
+                }
+                case Status: {
+                    StatusInfo s;
+                    for (quint64 *v : { &s.stops, &s.waitNs, &s.processNs, &s.emitted, &s.dropped, &s.filtered,
+                                        &s.summarized, &s.bytesSent, &s.backlogBytes })
+                        *v = r.u64();
+                    if (!r.ok)
+                        break;
+                    m_metrics->stops.store(s.stops, std::memory_order_relaxed);
+                    m_metrics->waitNs.store(s.waitNs, std::memory_order_relaxed);
+                    m_metrics->processNs.store(s.processNs, std::memory_order_relaxed);
+                    m_metrics->filtered.store(s.filtered, std::memory_order_relaxed);
+                    agentDropped = s.dropped;
+                    break;
+                }
+                case Finished: {
+                    std::string_view text = r.bytes();
+                    if (r.ok)
+                        message = QString::fromUtf8(text.data(), int(text.size()));
+                    done = true;
+                    break;
+                }
+                default:
+                    break;
+            }
+            if (!r.ok) {
+                message = "Error: Corrupt frame from agent.";
+                done = true;
+            }
+        }
+        // 代理端队列满丢弃的和本地队列满丢弃的都算丢弃
+        m_metrics->dropped.store(agentDropped + localDropped, std::memory_order_relaxed);
+        if (in.corrupt()) {
+            message = "Error: Corrupt frame from agent.";
+            break;
+        }
+        if (done)
+            break;
+    }
+    if (!helloSeen && message.startsWith("Agent closed"))
+        message = "Error: Agent closed the connection before the handshake.";
+    close(fd);
+    emit finished(message);
+}
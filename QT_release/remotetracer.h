@@ -0,0 +1,60 @@
+#ifndef REMOTETRACER_H
+#define REMOTETRACER_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "agentprotocol.h"
+
+class EventQueue;
+class StringTable;
+struct TracerMetrics;
+
+// GUI 一侧的代理客户端，接口与 Tracer 对齐：在自己的线程里运行 start()，收到的事件写入同一个 EventQueue，
+// 字符串驻留到本地 StringTable，因此表格、时间线、errno 等面板不需要区分本地和远程。
+// 合计帧没有单个事件，由 GUI 用 takeSummaries() 取走后计入 Top 10 与滚动统计。
+// 代理的 CLOCK_MONOTONIC 与本机不同，时间戳按 Hello 中的时钟换算到本机（误差为半个往返时间）。
+class RemoteTracer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RemoteTracer(const agentprotocol::Address &address, QObject *parent = nullptr);
+    ~RemoteTracer() override;
+
+    // 以下在 start() 之前调用，含义与 Tracer 的同名函数相同
+    void setMetrics(TracerMetrics *metrics) { m_metrics = metrics; }
+    void setEventSink(EventQueue *queue, StringTable *strings) { m_queue = queue; m_strings = strings; }
+    void setFilterText(const QString &text) { m_filterText = text; }
+    // 任意线程调用；追踪过程中调用时通知代理切换
+    void setMode(agentprotocol::Mode mode);
+    // 任意线程调用：让代理停止追踪，代理发完剩余数据后回复 Finished
+    void stop();
+
+    // GUI 线程调用：取走收到的按秒合计（秒已换算到本机时钟）
+    std::vector<agentprotocol::SummaryEntry> takeSummaries();
+
+public slots:
+    void start(unsigned int pid);
+
+signals:
+    void finished(const QString &message);
+
+private:
+    void wake();
+
+    agentprotocol::Address m_address;
+    TracerMetrics *m_metrics = nullptr;
+    EventQueue *m_queue = nullptr;
+    StringTable *m_strings = nullptr;
+    QString m_filterText;
+    std::atomic<int> m_mode{agentprotocol::EventsMode};
+    std::atomic<bool> m_modeChanged{false};
+    std::atomic<bool> m_stopRequested{false};
+    int m_wakeFd = -1;
+    std::mutex m_summaryMutex;
+    std::vector<agentprotocol::SummaryEntry> m_summaries;
+};
+
+#endif // REMOTETRACER_H
@@ -0,0 +1,105 @@
+#include "rollingstats.h"
+
+#include <algorithm>
+
+RollingStats::RollingStats()
+{
+    clear();
+}
+
+void RollingStats::clear()
+{
+    for (Bucket &b : m_ring)
+        b.second = -1;
+}
+
+RollingStats::Bucket* RollingStats::bucketFor(qint64 sec)
+{
+    if (sec < 0)
+        return nullptr;
+    Bucket &b = m_ring[sec % kBuckets];
+    if (b.second != sec) {
+        // 环形覆盖：这个桶里是 kBuckets 秒之前的数据（或空桶），清零后复用
+        if (b.second > sec)
+            return nullptr; // 比环中最旧的数据还旧的迟到事件，直接丢弃
+        b.second = sec;
+        b.total = 0;
+        b.totalErrors = 0;
+        b.counts.fill(0);
+        b.errors.fill(0);
+        b.durationNs.fill(0);
+        b.latencyRow.fill(-1);
+        b.latency.clear(); // 保留容量，下一轮复用
+    }
+    return &b;
+}
+
+void RollingStats::record(quint64 ts, long syscall, quint64 duration, bool isError)
+{
+    Bucket *b = bucketFor(secondOf(ts));
+    if (!b)
+        return;
+
+    b->total++;
+    if (isError)
+        b->totalErrors++;
+    if (syscall < 0 || syscall >= kMaxSyscall)
+        return;
+    b->counts[syscall]++;
+    b->durationNs[syscall] += duration;
+    if (isError)
+        b->errors[syscall]++;
+
+    qint16 &row = b->latencyRow[syscall];
+    if (row < 0) {
+        row = qint16(b->latency.size());
+        b->latency.emplace_back();
+        b->latency.back().fill(0);
+    }
+    b->latency[size_t(row)][latencyBucketOf(duration)]++;
+}
+
+// 合计帧没有单个调用的耗时，不计入耗时分布
+void RollingStats::recordSummary(qint64 second, long syscall, quint32 count, quint32 errors, quint64 durationNs)
+{
+    Bucket *b = bucketFor(second);
+    if (!b)
+        return;
+
+    b->total += count;
+    b->totalErrors += errors;
+    if (syscall < 0 || syscall >= kMaxSyscall)
+        return;
+    b->counts[syscall] += count;
+    b->durationNs[syscall] += durationNs;
+    b->errors[syscall] += errors;
+}
+
+const RollingStats::Bucket* RollingStats::bucketAt(qint64 second) const
+{
+    if (second < 0)
+        return nullptr;
+    const Bucket &b = m_ring[second % kBuckets];
+    return b.second == second ? &b : nullptr;
+}
+
+void RollingStats::query(int seconds, qint64 nowSec, Window &out) const
+{
+    out = Window();
+    out.seconds = std::min(std::max(seconds, 1), kBuckets);
+
+    for (qint64 sec = nowSec - out.seconds + 1; sec <= nowSec; ++sec) {
+        const Bucket *b = bucketAt(sec);
+        if (!b || b->total == 0)
+            continue;
+        out.total += b->total;
+        out.totalErrors += b->totalErrors;
+        for (int i = 0; i < kMaxSyscall; ++i) {
+            if (b->counts[i] == 0)
+                continue;
+            out.counts[i] += b->counts[i];
+            out.errors[i] += b->errors[i];
+            out.durationNs[i] += b->durationNs[i];
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef ROLLINGSTATS_H
+#define ROLLINGSTATS_H
+
+#include <QtGlobal>
+#include <array>
+#include <vector>
+
+// 按秒分桶的滚动统计：环形缓冲里保存最近 kBuckets 秒，每个桶记录每个 syscall 的
+// 调用次数、总耗时和失败次数。内存大小固定，与追踪时长无关；
+// “最近 N 秒”的查询只需要遍历 N 个桶。
+// 另外按 2 的幂给每个 syscall 的耗时分桶（延迟热力图用），只为这一秒出现过的 syscall 分配。
+class RollingStats
+{
+public:
+    static constexpr int kBuckets = 300;        // 5 分钟
+    static constexpr int kMaxSyscall = 512;     // x86_64 的 syscall 号都在这个范围内
+    static constexpr int kLatencyBuckets = 24;  // [0, 1µs)、[1µs, 2µs) …… 最后一档 >= 4.3 s
+
+    using LatencyRow = std::array<quint32, kLatencyBuckets>;
+
+    struct Bucket {
+        qint64 second = -1;                     // 该桶对应的绝对秒数（CLOCK_MONOTONIC），-1 表示空
+        quint64 total = 0;
+        quint64 totalErrors = 0;
+        std::array<quint32, kMaxSyscall> counts{};
+        std::array<quint32, kMaxSyscall> errors{};
+        std::array<quint64, kMaxSyscall> durationNs{};
+        std::array<qint16, kMaxSyscall> latencyRow; // syscall -> latency 中的下标，-1 表示这一秒没有
+        std::vector<LatencyRow> latency;
+
+        // 这一秒该 syscall 的耗时分布，没有调用时返回 nullptr
+        const LatencyRow* latencyOf(long syscall) const {
+            if (syscall < 0 || syscall >= kMaxSyscall || latencyRow[syscall] < 0)
+                return nullptr;
+            return &latency[size_t(latencyRow[syscall])];
+        }
+    };
+
+    // 一个时间窗口内的合计
+    struct Window {
+        int seconds = 0;
+        quint64 total = 0;
+        quint64 totalErrors = 0;
+        std::array<quint64, kMaxSyscall> counts{};
+        std::array<quint64, kMaxSyscall> errors{};
+        std::array<quint64, kMaxSyscall> durationNs{};
+    };
+
+    RollingStats();
+
+    void clear();
+    // ts 与 Tracer 使用同一个时钟（CLOCK_MONOTONIC，ns）
+    void record(quint64 ts, long syscall, quint64 duration, bool isError);
+    // 已经按秒合计好的数据（例如远程代理的合计帧），效果等同于 count 次 record()
+    void recordSummary(qint64 second, long syscall, quint32 count, quint32 errors, quint64 durationNs);
+
+    // 最近 seconds 秒（含 nowSec 所在的这一秒）的合计，seconds 超过 kBuckets 时截断
+    void query(int seconds, qint64 nowSec, Window &out) const;
+    // 某一秒的桶，不在环中（太旧或还没发生）时返回 nullptr
+    const Bucket* bucketAt(qint64 second) const;
+
+    static qint64 secondOf(quint64 ts) { return qint64(ts / 1000000000ULL); }
+    // 1024 ns 以下为第 0 档，之后每档翻倍
+    static int latencyBucketOf(quint64 ns) {
+        if (ns < 1024)
+            return 0;
+        return qMin(63 - __builtin_clzll(ns) - 9, kLatencyBuckets - 1);
+    }
+    // 档的下界（ns）
+    static quint64 latencyBucketFloor(int bucket) { return bucket <= 0 ? 0 : quint64(1) << (bucket + 9); }
+
+private:
+    Bucket* bucketFor(qint64 sec);
+
+    std::array<Bucket, kBuckets> m_ring;
+};
+
+#endif // ROLLINGSTATS_H
@@ -0,0 +1,96 @@
+#include "schedsampler.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SchedSampler::SchedSampler()
+{
+    long ticks = sysconf(_SC_CLK_TCK);
+    m_nsPerTick = ticks > 0 ? 1000000000ULL / ticks : 10000000ULL;
+}
+
+SchedSampler::~SchedSampler()
+{
+    clear();
+}
+
+SchedSampler::CachedFd SchedSampler::openFor(pid_t tid)
+{
+    auto it = m_fds.constFind(tid);
+    if (it != m_fds.constEnd())
+        return it.value();
+
+    char path[64];
+    CachedFd c;
+    snprintf(path, sizeof(path), "/proc/%d/schedstat", tid);
+    c.fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (c.fd < 0) {
+        snprintf(path, sizeof(path), "/proc/%d/stat", tid);
+        c.fd = open(path, O_RDONLY | O_CLOEXEC);
+        c.isSchedstat = false;
+    }
+    // 打开失败也缓存下来，避免每次系统调用都重试
+    m_fds.insert(tid, c);
+    return c;
+}
+
+bool SchedSampler::sample(pid_t tid, SchedSample &out)
+{
+    CachedFd c = openFor(tid);
+    if (c.fd < 0)
+        return false;
+
+    char buf[512];
+    ssize_t n = pread(c.fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0)
+        return false;
+    buf[n] = '\0';
+
+    if (c.isSchedstat) {
+        // 格式: "<run_ns> <wait_ns> <timeslices>\n"
+        char *end = nullptr;
+        out.runNs = strtoull(buf, &end, 10);
+        out.waitNs = strtoull(end, nullptr, 10);
+        return true;
+    }
+
+    // /proc/<tid>/stat: comm 可能包含空格，从最后一个 ')' 之后开始数字段
+    const char *p = strrchr(buf, ')');
+    if (!p)
+        return false;
+    // ')' 之后是第 3 个字段 state，utime/stime 是第 14/15 个字段
+    int field = 2;
+    while (*p && field < 14) {
+        if (*p == ' ')
+            field++;
+        p++;
+    }
+    char *end = nullptr;
+    quint64 utime = strtoull(p, &end, 10);
+    quint64 stime = strtoull(end, nullptr, 10);
+    out.runNs = (utime + stime) * m_nsPerTick;
+    out.waitNs = 0;
+    return true;
+}
+
+void SchedSampler::forget(pid_t tid)
+{
+    auto it = m_fds.find(tid);
+    if (it == m_fds.end())
+        return;
+    if (it->fd >= 0)
+        close(it->fd);
+    m_fds.erase(it);
+}
+
+void SchedSampler::clear()
+{
+    for (const CachedFd &c : m_fds) {
+        if (c.fd >= 0)
+            close(c.fd);
+    }
+    m_fds.clear();
+}
@@ -0,0 +1,40 @@
+#ifndef SCHEDSAMPLER_H
+#define SCHEDSAMPLER_H
+
+#include <QHash>
+#include <sys/types.h>
+
+// 一次调度统计采样，单位 ns
+struct SchedSample {
+    quint64 runNs = 0;   // 在 CPU 上运行的累计时间
+    quint64 waitNs = 0;  // 在运行队列中等待的累计时间
+};
+
+// 在系统调用边界读取 /proc/<tid>/schedstat。
+// 每个 TID 的文件只打开一次，之后都用 pread 从偏移 0 重新读取，避免反复 open/close。
+// 内核未开启 schedstat 时退回 /proc/<tid>/stat 的 utime+stime（只有 on-CPU，且精度是时钟节拍）。
+class SchedSampler
+{
+public:
+    SchedSampler();
+    ~SchedSampler();
+    SchedSampler(const SchedSampler&) = delete;
+    SchedSampler& operator=(const SchedSampler&) = delete;
+
+    bool sample(pid_t tid, SchedSample &out);
+    // 线程退出后关闭对应的 fd
+    void forget(pid_t tid);
+    void clear();
+
+private:
+    struct CachedFd {
+        int fd = -1;
+        bool isSchedstat = true;
+    };
+    CachedFd openFor(pid_t tid);
+
+    QHash<pid_t, CachedFd> m_fds;
+    quint64 m_nsPerTick;
+};
+
+#endif // SCHEDSAMPLER_H
@@ -0,0 +1,549 @@
+#include "selftest.h"
+#include "tracer.h"
+#include "ptracereplay.h"
+#include "processtree.h"
+#include "cgroupwatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// 命令行模式：sudo SyscallMonitor --record-stops [--follow] PID 夹具.qstops [秒数，默认 10] [追踪过滤表达式]
+// 追踪真实进程，同时把引擎从内核得到的全部输入和它产生的事件写入夹具，供 --replay-stops 回放；
+// --follow 时同时追踪它 fork 出的线程和子进程
+int runRecordStops(const QStringList &options)
+{
+    QStringList args = options;
+    const bool follow = args.removeAll("--follow") > 0;
+    bool ok = args.size() >= 2;
+    const unsigned pid = ok ? args.at(0).toUInt(&ok) : 0;
+    const int seconds = args.size() > 2 ? args.at(2).toInt() : 10;
+    const QString filterText = args.size() > 3 ? args.at(3) : QString();
+    SyscallFilter filter;
+    QString error;
+    if (!ok || seconds <= 0) {
+        fprintf(stderr, "usage: SyscallMonitor --record-stops [--follow] pid fixture.qstops [seconds] [trace filter]\n");
+        return 2;
+    }
+    if (!SyscallFilter::compile(filterText, filter, &error)) {
+        fprintf(stderr, "invalid trace filter: %s\n", qPrintable(error));
+        return 2;
+    }
+    RecordingPtraceBackend backend;
+    if (!backend.open(args.at(1), pid_t(pid), filterText, &error)) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    Tracer tracer;
+    tracer.setBackend(&backend);
+    tracer.setFilter(filter);
+    tracer.setFollowChildren(follow);
+    std::vector<ptracereplay::RecordedEvent> events;
+    quint64 dropped = 0;
+    const QString message = ptracereplay::runTracer(tracer, pid_t(pid), seconds * 1000, events, &dropped);
+    if (!backend.finish(events, &error)) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    printf("%s\nrecorded %zu events (%llu dropped), %llu bytes\n", qPrintable(message), events.size(),
+           (unsigned long long)dropped, (unsigned long long)backend.bytesWritten());
+    return message.startsWith("Error") ? 1 : 0;
+}
+
+// 回放一遍夹具，返回 Tracer::finished 的消息
+static QString replayOnce(ReplayPtraceBackend &backend, const SyscallFilter &filter,
+                          std::vector<ptracereplay::RecordedEvent> &events, quint64 *dropped)
+{
+    backend.rewind();
+    Tracer tracer;
+    tracer.setBackend(&backend);
+    tracer.setFilter(filter);
+    tracer.setFollowChildren(backend.seizeOptions() & PTRACE_O_TRACEFORK);
+    backend.setExhaustedHandler([&tracer]() { tracer.stop(); });
+    return ptracereplay::runTracer(tracer, backend.pid(), 0, events, dropped);
+}
+
+// 命令行模式：SyscallMonitor --replay-stops 夹具.qstops [轮数，默认 5]
+// 不接触任何进程，把录制的停顿序列交给追踪引擎，逐事件与录制时的输出比较，并给出引擎本身的吞吐量。
+// 行为不同（syscall、返回值、路径等）或引擎发出的 ptrace 请求与录制时不同时返回 1
+int runReplayStops(const QStringList &args)
+{
+    bool ok = !args.isEmpty();
+    const int rounds = args.size() > 1 ? args.at(1).toInt(&ok) : 5;
+    if (!ok || rounds <= 0) {
+        fprintf(stderr, "usage: SyscallMonitor --replay-stops fixture.qstops [rounds]\n");
+        return 2;
+    }
+    ReplayPtraceBackend backend;
+    QString error;
+    SyscallFilter filter;
+    if (!backend.load(args.at(0), &error)) {
+        fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    if (!SyscallFilter::compile(backend.filterText(), filter, &error)) {
+        fprintf(stderr, "fixture trace filter no longer compiles: %s\n", qPrintable(error));
+        return 1;
+    }
+    printf("pid %d, %llu stops, %zu recorded events, %zu bytes of records%s%s\n", int(backend.pid()),
+           (unsigned long long)backend.stopCount(), backend.expectedEvents().size(), backend.streamBytes(),
+           backend.filterText().isEmpty() ? "" : ", filter: ", qPrintable(backend.filterText()));
+
+    int failures = 0;
+    double best = 0;
+    for (int round = 1; round <= rounds; ++round) {
+        std::vector<ptracereplay::RecordedEvent> events;
+        quint64 dropped = 0;
+        auto start = std::chrono::steady_clock::now();
+        const QString message = replayOnce(backend, filter, events, &dropped);
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const ptracereplay::Comparison c = ptracereplay::compareEvents(backend.expectedEvents(), events);
+        best = round == 1 ? elapsed : std::min(best, elapsed);
+        printf("round %d: %.3f s, %.2f M stops/s, %zu events, %llu behaviour / %llu timing mismatches, "
+               "%llu request divergences, %llu skipped records, %llu dropped — %s\n",
+               round, elapsed, backend.stopCount() / elapsed / 1e6, events.size(),
+               (unsigned long long)c.behaviourMismatches, (unsigned long long)c.timingMismatches,
+               (unsigned long long)backend.divergences(), (unsigned long long)backend.skipped(),
+               (unsigned long long)dropped, qPrintable(message));
+        if (c.behaviourMismatches || backend.divergences()) {
+            if (c.firstMismatch >= 0)
+                printf("  first difference: %s\n", qPrintable(c.firstDescription));
+            failures++;
+        }
+    }
+    printf("best: %.2f M stops/s, %.2f M events/s\n", backend.stopCount() / best / 1e6,
+           backend.expectedEvents().size() / best / 1e6);
+    return failures ? 1 : 0;
+}
+
+// --- 追踪引擎的冒烟测试：真实子进程 ---
+
+// fork 一个子进程：先阻塞在 gate 管道的 read 上，放行后调用 rounds 次 getppid 和 openat（目标不存在）后退出。
+// 不放行时一直阻塞，用于测试停止追踪。execChild 时放行后先 fork 一个孙进程 exec kSmokeExec 并等它退出
+struct SmokeChild {
+    pid_t pid = -1;
+    int gate = -1; // 写端，写一个字节放行
+};
+using SmokeEvents = std::vector<ptracereplay::RecordedEvent>;
+
+static const char *const kSmokePath = "/nonexistent/qtsys-smoke";
+static const char *const kSmokeExec = "/bin/true";
+
+static SmokeChild spawnSmokeChild(int rounds, bool execChild = false)
+{
+    SmokeChild child;
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+        return child;
+    child.pid = fork();
+    if (child.pid == 0) {
+        // 子进程只调用 async-signal-safe 的函数
+        close(fds[1]);
+        char c;
+        while (read(fds[0], &c, 1) < 0 && errno == EINTR) {}
+        if (execChild) {
+            pid_t grandchild = fork();
+            if (grandchild == 0) {
+                char *const argv[] = { const_cast<char*>(kSmokeExec), nullptr };
+                char *const envp[] = { nullptr };
+                execve(kSmokeExec, argv, envp);
+                _exit(127);
+            }
+            int status;
+            while (grandchild > 0 && waitpid(grandchild, &status, 0) < 0 && errno == EINTR) {}
+        }
+        for (int i = 0; i < rounds; ++i) {
+            syscall(SYS_getppid);
+            int fd = int(syscall(SYS_openat, AT_FDCWD, kSmokePath, O_RDONLY));
+            if (fd >= 0)
+                close(fd);
+        }
+        _exit(0);
+    }
+    close(fds[0]);
+    child.gate = fds[1];
+    return child;
+}
+
+// 等追踪器附加上（/proc/PID/status 的 TracerPid 非 0）后放行子进程
+static std::thread releaseWhenTraced(const SmokeChild &child)
+{
+    return std::thread([child]() {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%d/status", int(child.pid));
+        for (int i = 0; i < 500; ++i) {
+            FILE *f = fopen(path, "r");
+            char line[256];
+            bool traced = false;
+            while (f && fgets(line, sizeof(line), f)) {
+                if (strncmp(line, "TracerPid:", 10) == 0)
+                    traced = strtol(line + 10, nullptr, 10) != 0;
+            }
+            if (f)
+                fclose(f);
+            if (traced)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (write(child.gate, "x", 1) != 1)
+            perror("smoke: release child");
+        close(child.gate);
+    });
+}
+
+static void reapChild(pid_t pid)
+{
+    kill(pid, SIGKILL);
+    int status;
+    while (waitpid(pid, &status, __WALL) < 0 && errno == EINTR) {}
+}
+
+// 事件中 getppid 和 openat(kSmokePath) = -ENOENT 各应出现 rounds 次
+static QString checkSmokeEvents(const SmokeEvents &events, int rounds, bool openatOnly)
+{
+    int getppid = 0, openat = 0, other = 0;
+    for (const ptracereplay::RecordedEvent &r : events) {
+        if (r.event.syscall == SYS_getppid)
+            getppid++;
+        else if (r.event.syscall == SYS_openat && r.path == kSmokePath && r.event.ret == -ENOENT)
+            openat++;
+        else
+            other++;
+    }
+    if (openat != rounds)
+        return QString("expected %1 openat = -ENOENT with the path decoded, got %2").arg(rounds).arg(openat);
+    if (openatOnly ? (getppid != 0 || other != 0) : getppid != rounds)
+        return QString("unexpected counts: getppid %1, other %2").arg(getppid).arg(other);
+    return QString();
+}
+
+// 跟随子进程时：孙进程 exec 之后的调用带它自己的 pid 和 exec 之后的进程名
+static QString checkFollowEvents(const SmokeEvents &events, pid_t child)
+{
+    const char *name = strrchr(kSmokeExec, '/') + 1;
+    for (const ptracereplay::RecordedEvent &r : events) {
+        if (pid_t(r.event.pid) != child && r.comm == name)
+            return QString();
+    }
+    return QString("no events from the exec'd grandchild (%1)").arg(kSmokeExec);
+}
+
+// 录制一次追踪（check 检查录到的事件），再回放两遍：与录制时逐事件相同、引擎发出的 ptrace 请求序列不变时返回空字符串
+static QString smokeRecordAndReplay(const QString &fixture, bool follow, int rounds,
+                                    const std::function<QString(const SmokeEvents &)> &check)
+{
+    SmokeChild child = spawnSmokeChild(rounds, follow);
+    std::thread release = releaseWhenTraced(child);
+    RecordingPtraceBackend recording;
+    QString problem;
+    SmokeEvents recorded;
+    if (recording.open(fixture, child.pid, QString(), &problem)) {
+        Tracer tracer;
+        tracer.setBackend(&recording);
+        tracer.setFollowChildren(follow);
+        const QString message = ptracereplay::runTracer(tracer, child.pid, 0, recorded);
+        if (recording.finish(recorded, &problem))
+            problem = !message.contains("exited") ? message : check(recorded);
+    }
+    release.join();
+    reapChild(child.pid);
+
+    ReplayPtraceBackend replay;
+    SyscallFilter filter;
+    if (problem.isEmpty() && !replay.load(fixture, &problem))
+        problem = "cannot load fixture: " + problem;
+    for (int round = 0; round < 2 && problem.isEmpty(); ++round) {
+        SmokeEvents events;
+        replayOnce(replay, filter, events, nullptr);
+        const ptracereplay::Comparison c = ptracereplay::compareEvents(recorded, events);
+        if (c.behaviourMismatches || c.timingMismatches)
+            problem = QString("replay %1: %2 behaviour / %3 timing mismatches; %4").arg(round + 1)
+                          .arg(c.behaviourMismatches).arg(c.timingMismatches).arg(c.firstDescription);
+        else if (replay.divergences())
+            problem = QString("replay %1: %2 ptrace request divergences").arg(round + 1).arg(replay.divergences());
+    }
+    return problem;
+}
+
+// 往 cgroup.procs 写 pid 把进程移入 cgroup，和 systemd、docker exec 的做法相同
+static bool moveToCgroup(const QString &dir, pid_t pid)
+{
+    const std::string path = (dir + "/cgroup.procs").toStdString();
+    const int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    char text[16];
+    const int n = snprintf(text, sizeof(text), "%d", int(pid));
+    const bool ok = write(fd, text, size_t(n)) == n;
+    close(fd);
+    return ok;
+}
+
+// 等子进程被追踪器收尸（/proc/<pid> 消失）
+static bool waitReaped(pid_t pid, int timeoutMs)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d", int(pid));
+    for (int waited = 0; waited < timeoutMs; waited += 10) {
+        if (access(path, F_OK) != 0)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+// 命令行模式：SyscallMonitor --filter-self-test
+// 不需要 root，也不启动进程：检查追踪过滤表达式的解析。单独的 errno 后面跟 )、&&、|| 时是"调用失败"，
+// 跟 ==、!=、in 时才是比较。全部通过返回 0
+int runFilterSelfTest(const QStringList &args)
+{
+    if (!args.isEmpty()) {
+        fprintf(stderr, "usage: SyscallMonitor --filter-self-test\n");
+        return 2;
+    }
+    SyscallEvent failed = {};
+    failed.syscall = 0; // read
+    failed.ret = -EAGAIN;
+    SyscallEvent succeeded = failed;
+    succeeded.ret = 16;
+    static const struct { const char *text; bool failed, succeeded; } kCases[] = {
+        { "errno", true, false },
+        { "(errno)", true, false },
+        { "(errno) and syscall == read", true, false },
+        { "errno && syscall == read", true, false },
+        { "errno and syscall == read", true, false },
+        { "errno || dur > 1ms", true, false },
+        { "errno or syscall == write", true, false },
+        { "not (errno) && ret == 16", false, true },
+        { "!errno", false, true },
+        { "errno == EAGAIN", true, false },
+        { "errno != EAGAIN", false, true },
+        { "errno in (EINTR, EAGAIN)", true, false },
+    };
+    QString problem;
+    for (const auto &c : kCases) {
+        SyscallFilter filter;
+        QString error;
+        if (!SyscallFilter::compile(c.text, filter, &error))
+            problem = QString("\"%1\" does not compile: %2").arg(c.text, error);
+        else if (filter.matches(failed, nullptr) != c.failed || filter.matches(succeeded, nullptr) != c.succeeded)
+            problem = QString("\"%1\" matches the wrong events").arg(c.text);
+        if (!problem.isEmpty())
+            break;
+    }
+    for (const char *bad : { "errno ==", "errno in", "errno < 3", "(errno", "dur > 5" }) {
+        SyscallFilter filter;
+        if (problem.isEmpty() && SyscallFilter::compile(bad, filter, nullptr))
+            problem = QString("\"%1\" should not compile").arg(bad);
+    }
+    if (!problem.isEmpty()) {
+        printf("FAIL filter parser: %s\n", qPrintable(problem));
+        return 1;
+    }
+    printf("PASS filter parser\n");
+    return 0;
+}
+
+// 命令行模式：SyscallMonitor --tracer-smoke-test [夹具保存目录，默认 $TMPDIR 或 /tmp]
+// 对自己 fork 出来的子进程跑几项端到端检查：追踪到进程退出、追踪过滤、阻塞中停止追踪、跟随 fork 和 exec、
+// 录制后回放两遍与录制时的输出逐事件一致、按 cgroup 附加（不能建 cgroup 时跳过）。
+// 全部通过返回 0
+int runTracerSmokeTest(const QStringList &args)
+{
+    const char *tmp = getenv("TMPDIR");
+    const QString dir = !args.isEmpty() ? args.at(0) : QString(tmp && *tmp ? tmp : "/tmp");
+    constexpr int kRounds = 2000;
+    int failures = 0;
+    auto report = [&failures](const char *name, const QString &problem) {
+        printf("%s %s%s%s\n", problem.isEmpty() ? "PASS" : "FAIL", name, problem.isEmpty() ? "" : ": ", qPrintable(problem));
+        fflush(stdout);
+        if (!problem.isEmpty())
+            failures++;
+    };
+
+    // 1. 追踪到进程退出：入口/出口配对、路径解码、返回值
+    {
+        SmokeChild child = spawnSmokeChild(kRounds);
+        std::thread release = releaseWhenTraced(child);
+        Tracer tracer;
+        std::vector<ptracereplay::RecordedEvent> events;
+        const QString message = ptracereplay::runTracer(tracer, child.pid, 0, events);
+        release.join();
+        reapChild(child.pid);
+        report("trace until exit", !message.contains("exited") ? message : checkSmokeEvents(events, kRounds, false));
+    }
+
+    // 2. 追踪过滤：只留 openat
+    SyscallFilter openatOnly;
+    QString filterError;
+    if (!SyscallFilter::compile("syscall in (openat)", openatOnly, &filterError)) {
+        report("trace filter", QString("\"syscall in (openat)\" does not compile: %1").arg(filterError));
+    } else {
+        SmokeChild child = spawnSmokeChild(kRounds);
+        std::thread release = releaseWhenTraced(child);
+        Tracer tracer;
+        tracer.setFilter(openatOnly);
+        std::vector<ptracereplay::RecordedEvent> events;
+        const QString message = ptracereplay::runTracer(tracer, child.pid, 0, events);
+        release.join();
+        reapChild(child.pid);
+        report("trace filter", !message.contains("exited") ? message : checkSmokeEvents(events, kRounds, true));
+    }
+
+    // 3. 进程阻塞在 read 里时停止追踪：有界时间内结束，进程被释放（不再被追踪）
+    {
+        SmokeChild child = spawnSmokeChild(kRounds);
+        Tracer tracer;
+        std::vector<ptracereplay::RecordedEvent> events;
+        auto start = std::chrono::steady_clock::now();
+        const QString message = ptracereplay::runTracer(tracer, child.pid, 300, events);
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        char path[64], line[256];
+        snprintf(path, sizeof(path), "/proc/%d/status", int(child.pid));
+        bool released = false;
+        FILE *f = fopen(path, "r");
+        while (f && fgets(line, sizeof(line), f)) {
+            if (strncmp(line, "TracerPid:", 10) == 0)
+                released = strtol(line + 10, nullptr, 10) == 0;
+        }
+        if (f)
+            fclose(f);
+        close(child.gate);
+        reapChild(child.pid);
+        QString problem;
+        if (message != "Tracer stopped.")
+            problem = message;
+        else if (elapsed > 2.0)
+            problem = QString("took %1 s to stop").arg(elapsed, 0, 'f', 2);
+        else if (!released)
+            problem = "process is still traced after the tracer finished";
+        report("stop while blocked", problem);
+    }
+
+    // 4. 录制后回放：两遍回放都与录制时的输出逐事件相同，引擎发出的 ptrace 请求序列不变
+    {
+        const QString fixture = dir + QString("/qtsys-smoke-%1.qstops").arg(getpid());
+        report("record and replay", smokeRecordAndReplay(fixture, false, kRounds, [](const SmokeEvents &events) {
+            return checkSmokeEvents(events, kRounds, false);
+        }));
+        if (args.isEmpty())
+            unlink(fixture.toLocal8Bit().constData());
+        else
+            printf("fixture kept at %s\n", qPrintable(fixture));
+    }
+
+    // 5. 跟随子进程：孙进程 exec 之后的事件带它自己的 pid 和新的进程名，进程树里有两个进程和一次 exec；
+    //    录制后回放同样逐事件一致
+    {
+        SmokeChild child = spawnSmokeChild(kRounds, true);
+        std::thread release = releaseWhenTraced(child);
+        ProcessTree tree;
+        Tracer tracer;
+        tracer.setFollowChildren(true);
+        tracer.setProcessTree(&tree);
+        SmokeEvents events;
+        const QString message = ptracereplay::runTracer(tracer, child.pid, 0, events);
+        release.join();
+        reapChild(child.pid);
+        QString problem = !message.contains("exited") ? message : checkSmokeEvents(events, kRounds, false);
+        if (problem.isEmpty())
+            problem = checkFollowEvents(events, child.pid);
+        if (problem.isEmpty()) {
+            const ProcessTree::Changes changes = tree.takeChanges();
+            // /bin 可能是 /usr/bin 的链接，只比较文件名
+            const QString execName = QString(strrchr(kSmokeExec, '/'));
+            const bool execRecorded = std::any_of(changes.updated.begin(), changes.updated.end(), [&execName](const ProcessTree::Process &p) {
+                return p.parent >= 0 && p.execs == 1 && p.image.endsWith(execName) && p.endNs != 0;
+            });
+            if (changes.totals.processes != 2 || changes.totals.execs != 1 || changes.totals.running != 0 || !execRecorded)
+                problem = QString("process tree: %1 processes, %2 execs, %3 running")
+                              .arg(changes.totals.processes).arg(changes.totals.execs).arg(changes.totals.running);
+        }
+        report("follow fork and exec", problem);
+
+        const QString fixture = dir + QString("/qtsys-smoke-follow-%1.qstops").arg(getpid());
+        report("record and replay with children", smokeRecordAndReplay(fixture, true, kRounds, [](const SmokeEvents &events) {
+            QString problem = checkSmokeEvents(events, kRounds, false);
+            return problem.isEmpty() && !events.empty() ? checkFollowEvents(events, pid_t(events.front().event.pid)) : problem;
+        }));
+        if (args.isEmpty())
+            unlink(fixture.toLocal8Bit().constData());
+        else
+            printf("fixture kept at %s\n", qPrintable(fixture));
+    }
+
+    // 6. 按 cgroup 附加：临时 cgroup 里先有一个子进程，追踪开始后再移入第二个（不是被追踪进程的子进程，
+    //    只能靠 cgroup 的通知或重新扫描发现），两者的调用都完整，进程树里是两个根节点
+    {
+        const QString mount = CgroupWatch::cgroup2Mount();
+        const QString cgroupDir = mount + QString("/qtsys-smoke-%1").arg(getpid());
+        if (mount.isEmpty() || mkdir(cgroupDir.toLocal8Bit().constData(), 0755) != 0) {
+            printf("SKIP cgroup attach: cannot create a cgroup under the cgroup2 mount\n");
+        } else {
+            SmokeChild first = spawnSmokeChild(kRounds);
+            SmokeChild second = spawnSmokeChild(kRounds);
+            ProcessTree tree;
+            Tracer tracer;
+            tracer.setCgroup(cgroupDir);
+            tracer.setProcessTree(&tree);
+            SmokeEvents events;
+            QString problem;
+            if (moveToCgroup(cgroupDir, first.pid)) {
+                std::thread driver([&]() {
+                    releaseWhenTraced(first).join();
+                    if (!moveToCgroup(cgroupDir, second.pid))
+                        problem = "cannot move the second child into the cgroup";
+                    releaseWhenTraced(second).join();
+                    waitReaped(first.pid, 10000);
+                    waitReaped(second.pid, 10000);
+                    tracer.stop();
+                });
+                const QString message = ptracereplay::runTracer(tracer, 0, 0, events);
+                driver.join();
+                if (problem.isEmpty() && message != "Tracer stopped.")
+                    problem = message;
+            } else {
+                problem = "cannot move the first child into the cgroup";
+                close(first.gate);
+                close(second.gate);
+            }
+            reapChild(first.pid);
+            reapChild(second.pid);
+            for (pid_t pid : { first.pid, second.pid }) {
+                SmokeEvents own;
+                std::copy_if(events.begin(), events.end(), std::back_inserter(own), [pid](const ptracereplay::RecordedEvent &r) {
+                    return pid_t(r.event.pid) == pid;
+                });
+                if (problem.isEmpty() && !(problem = checkSmokeEvents(own, kRounds, false)).isEmpty())
+                    problem = QString("PID %1: %2").arg(pid).arg(problem);
+            }
+            if (problem.isEmpty()) {
+                const ProcessTree::Changes changes = tree.takeChanges();
+                const bool roots = std::all_of(changes.updated.begin(), changes.updated.end(), [](const ProcessTree::Process &p) {
+                    return p.parent == -1;
+                });
+                if (changes.totals.processes != 2 || changes.totals.running != 0 || !roots)
+                    problem = QString("process tree: %1 processes, %2 running").arg(changes.totals.processes).arg(changes.totals.running);
+            }
+            // 成员都已收尸，cgroup 随即可以删除
+            for (int i = 0; i < 100 && rmdir(cgroupDir.toLocal8Bit().constData()) != 0 && errno == EBUSY; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            report("cgroup attach", problem);
+        }
+    }
+    return failures ? 1 : 0;
+}
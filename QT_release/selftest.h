@@ -0,0 +1,17 @@
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+#include <QStringList>
+
+// 追踪引擎的录制/回放和自检，由 main() 按第一个参数分派，返回值是进程的退出码（0 为通过）
+
+// --record-stops [--follow] PID 夹具 [秒数] [追踪过滤]：追踪真实进程并录成停顿夹具，需要 root
+int runRecordStops(const QStringList &options);
+// --replay-stops 夹具 [轮数]：不接触进程，回放夹具并与录制时的事件逐个比较
+int runReplayStops(const QStringList &args);
+// --filter-self-test：追踪过滤表达式的解析，不需要 root
+int runFilterSelfTest(const QStringList &args);
+// --tracer-smoke-test [目录]：对 fork 出的子进程做端到端检查，需要 root
+int runTracerSmokeTest(const QStringList &args);
+
+#endif // SELFTEST_H
@@ -0,0 +1,221 @@
+#include "sequenceminer.h"
+
+#include <algorithm>
+
+SequenceMiner::SequenceMiner()
+{
+    m_slots.reserve(kCapacity);
+    m_heap.reserve(kCapacity);
+    m_heapPos.reserve(kCapacity);
+    m_indexKeys.assign(kIndexSize, 0);
+    m_indexSlots.assign(kIndexSize, -1);
+}
+
+void SequenceMiner::clear()
+{
+    m_slots.clear();
+    m_heap.clear();
+    m_heapPos.clear();
+    std::fill(m_indexKeys.begin(), m_indexKeys.end(), 0);
+    m_threads.clear();
+}
+
+void SequenceMiner::record(quint32 tid, int syscall, quint64 durationNs, quint32 pathId)
+{
+    History &h = m_threads[tid];
+    if (syscall < 0 || syscall >= (1 << kSyscallBits)) {
+        h.size = 0;
+        return;
+    }
+
+    // 以当前调用结尾，向前逐个延长得到长度 2~5 的序列
+    quint64 key = quint64(syscall);
+    quint64 ns = durationNs;
+    quint64 args = pathId;
+    quint32 path = pathId;
+    for (int len = 2; len <= kMaxLength && len - 1 <= h.size; ++len) {
+        const Call &prev = h.calls[h.size - (len - 1)];
+        key |= quint64(prev.syscall) << (kSyscallBits * (len - 1));
+        ns += prev.durationNs;
+        if (prev.pathId != 0) {
+            args = args * 0x9E3779B97F4A7C15ULL + prev.pathId;
+            if (path == 0)
+                path = prev.pathId;
+        }
+        update((quint64(len) << 61) | key, ns, args, path);
+    }
+
+    if (h.size == kMaxLength - 1) {
+        std::move(h.calls + 1, h.calls + h.size, h.calls);
+        h.size--;
+    }
+    h.calls[h.size++] = { syscall, pathId, durationNs };
+}
+
+static inline int bucketOf(quint64 key)
+{
+    return int((key * 0x9E3779B97F4A7C15ULL) >> 51) & (SequenceMiner::kCapacity * 4 - 1);
+}
+
+int SequenceMiner::findSlot(quint64 key) const
+{
+    for (int b = bucketOf(key); m_indexKeys[b] != 0; b = (b + 1) & (kIndexSize - 1)) {
+        if (m_indexKeys[b] == key)
+            return m_indexSlots[b];
+    }
+    return -1;
+}
+
+void SequenceMiner::insertIndex(quint64 key, int slot)
+{
+    int b = bucketOf(key);
+    while (m_indexKeys[b] != 0)
+        b = (b + 1) & (kIndexSize - 1);
+    m_indexKeys[b] = key;
+    m_indexSlots[b] = slot;
+}
+
+void SequenceMiner::eraseIndex(quint64 key)
+{
+    int b = bucketOf(key);
+    while (m_indexKeys[b] != key)
+        b = (b + 1) & (kIndexSize - 1);
+    // 把后面探测链上的元素往前挪，保证查找不会在空位处提前结束
+    int hole = b;
+    for (int next = (hole + 1) & (kIndexSize - 1); m_indexKeys[next] != 0; next = (next + 1) & (kIndexSize - 1)) {
+        int home = bucketOf(m_indexKeys[next]);
+        // home 不在 (hole, next] 区间内（环形）的元素可以移到 hole
+        bool movable = (next > hole) ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (movable) {
+            m_indexKeys[hole] = m_indexKeys[next];
+            m_indexSlots[hole] = m_indexSlots[next];
+            hole = next;
+        }
+    }
+    m_indexKeys[hole] = 0;
+}
+
+void SequenceMiner::swapHeap(int a, int b)
+{
+    std::swap(m_heap[a], m_heap[b]);
+    m_heapPos[m_heap[a]] = a;
+    m_heapPos[m_heap[b]] = b;
+}
+
+void SequenceMiner::siftDown(int pos)
+{
+    const int n = int(m_heap.size());
+    for (;;) {
+        int smallest = pos;
+        int l = 2 * pos + 1;
+        int r = l + 1;
+        if (l < n && m_slots[m_heap[l]].count < m_slots[m_heap[smallest]].count)
+            smallest = l;
+        if (r < n && m_slots[m_heap[r]].count < m_slots[m_heap[smallest]].count)
+            smallest = r;
+        if (smallest == pos)
+            return;
+        swapHeap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void SequenceMiner::update(quint64 key, quint64 ns, quint64 args, quint32 pathId)
+{
+    int slot = findSlot(key);
+    if (slot >= 0) {
+        Pattern &p = m_slots[slot];
+        p.count++;
+        p.totalNs += ns;
+        if (args != 0 && args == p.lastArgs)
+            p.sameArgs++;
+    } else if (int(m_slots.size()) < kCapacity) {
+        // 新序列计数为 1，是堆里最小的，放到堆尾即可保持堆序（count 相同的不必再比较）
+        slot = int(m_slots.size());
+        Pattern p;
+        p.key = key;
+        p.count = 1;
+        p.totalNs = ns;
+        m_slots.push_back(p);
+        m_heapPos.push_back(int(m_heap.size()));
+        m_heap.push_back(slot);
+        for (int pos = int(m_heap.size()) - 1; pos > 0 && m_slots[m_heap[(pos - 1) / 2]].count > 1; pos = (pos - 1) / 2)
+            swapHeap(pos, (pos - 1) / 2);
+        insertIndex(key, slot);
+    } else {
+        // 顶替计数最小的序列，继承它的计数作为误差上界
+        slot = m_heap[0];
+        Pattern &p = m_slots[slot];
+        eraseIndex(p.key);
+        p.key = key;
+        p.error = p.count;
+        p.count++;
+        p.totalNs = ns;
+        p.sameArgs = 0;
+        insertIndex(key, slot);
+    }
+
+    Pattern &p = m_slots[slot];
+    p.lastArgs = args;
+    if (pathId != 0)
+        p.pathId = pathId;
+    siftDown(m_heapPos[slot]);
+}
+
+// 把 key 展开成按调用顺序排列的 syscall 列表
+static std::vector<int> unpack(quint64 key)
+{
+    std::vector<int> seq(SequenceMiner::length(key));
+    for (int i = 0; i < int(seq.size()); ++i)
+        seq[i] = SequenceMiner::syscallAt(key, i);
+    return seq;
+}
+
+static bool containsRun(const std::vector<int> &haystack, const std::vector<int> &needle)
+{
+    return std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end()) != haystack.end();
+}
+
+QVector<SequenceMiner::Pattern> SequenceMiner::top(int limit) const
+{
+    std::vector<const Pattern*> sorted;
+    sorted.reserve(m_slots.size());
+    for (const Pattern &p : m_slots) {
+        // 继承来的计数占一半以上的序列不可信，不报告
+        if (p.count > 1 && p.error * 2 < p.count)
+            sorted.push_back(&p);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Pattern *a, const Pattern *b) { return a->count > b->count; });
+    // 只在最频繁的一批候选里去重，代价与总容量无关
+    sorted.resize(std::min<size_t>(sorted.size(), size_t(limit) * 8));
+
+    std::vector<std::vector<int>> seqs;
+    seqs.reserve(sorted.size());
+    for (const Pattern *p : sorted)
+        seqs.push_back(unpack(p->key));
+
+    QVector<Pattern> result;
+    std::vector<size_t> accepted;
+    for (size_t i = 0; i < sorted.size() && result.size() < limit; ++i) {
+        bool covered = false;
+        for (size_t j = 0; j < sorted.size() && !covered; ++j) {
+            // 子序列：被一个次数相差不到 20% 的更长序列包含
+            if (seqs[j].size() > seqs[i].size() && sorted[j]->count * 5 >= sorted[i]->count * 4
+                && containsRun(seqs[j], seqs[i]))
+                covered = true;
+        }
+        for (size_t j : accepted) {
+            // 旋转：同样长度，出现在已选序列自身拼接两次的结果中
+            if (covered || seqs[j].size() != seqs[i].size())
+                continue;
+            std::vector<int> doubled = seqs[j];
+            doubled.insert(doubled.end(), seqs[j].begin(), seqs[j].end());
+            covered = containsRun(doubled, seqs[i]);
+        }
+        if (covered)
+            continue;
+        accepted.push_back(i);
+        result.append(*sorted[i]);
+    }
+    return result;
+}
@@ -0,0 +1,74 @@
+#ifndef SEQUENCEMINER_H
+#define SEQUENCEMINER_H
+
+#include <QHash>
+#include <QVector>
+#include <vector>
+
+// 在线挖掘每个 TID 上连续出现的 syscall 序列（长度 2~5 的 n-gram）。
+// 计数用 space-saving：最多跟踪 kCapacity 个序列，满了以后新序列顶替计数最小的那个并继承其计数，
+// 所以内存固定，频繁序列的计数偏高不超过 error。
+// 参数可解码（带路径）的调用，还会统计同一序列连续两次出现时参数完全相同的次数。
+class SequenceMiner
+{
+public:
+    static constexpr int kMinLength = 2;
+    static constexpr int kMaxLength = 5;
+    static constexpr int kCapacity = 2048;
+    static constexpr int kSyscallBits = 9;   // syscall 号 < 512
+
+    struct Pattern {
+        quint64 key = 0;
+        quint64 count = 0;
+        quint64 error = 0;       // space-saving 的计数上界误差
+        quint64 totalNs = 0;     // 被跟踪期间所有出现的耗时之和
+        quint64 sameArgs = 0;    // 与上一次出现参数完全相同的次数
+        quint64 lastArgs = 0;    // 上一次出现的参数指纹，0 表示没有可用参数
+        quint32 pathId = 0;      // 上一次出现时涉及的路径（StringTable id）
+    };
+
+    SequenceMiner();
+    void clear();
+
+    void record(quint32 tid, int syscall, quint64 durationNs, quint32 pathId);
+
+    // 按出现次数降序的前 limit 个序列。被次数相近的更长序列包含的子序列、
+    // 以及同一个循环的其他旋转（a→b→c 与 b→c→a）只保留一个
+    QVector<Pattern> top(int limit) const;
+
+    // key 的编码：高 3 位是长度，低位每 9 位一个 syscall，位置 0 是序列的最后一个调用
+    static int length(quint64 key) { return int(key >> 61); }
+    static int syscallAt(quint64 key, int i) {
+        return int((key >> (kSyscallBits * (length(key) - 1 - i))) & ((1u << kSyscallBits) - 1));
+    }
+
+private:
+    struct Call {
+        int syscall;
+        quint32 pathId;
+        quint64 durationNs;
+    };
+    struct History {
+        Call calls[kMaxLength - 1]; // 该线程最近的调用，最新的在最后
+        int size = 0;
+    };
+
+    // key -> m_slots 下标的开放寻址表（线性探测，删除时回移），顶替频繁时比 unordered_map 少了每次的节点分配
+    static constexpr int kIndexSize = kCapacity * 4;
+    int findSlot(quint64 key) const;
+    void insertIndex(quint64 key, int slot);
+    void eraseIndex(quint64 key);
+
+    void update(quint64 key, quint64 ns, quint64 args, quint32 pathId);
+    void siftDown(int pos);
+    void swapHeap(int a, int b);
+
+    std::vector<Pattern> m_slots;
+    std::vector<int> m_heap;     // 按 count 的最小堆，元素是 m_slots 下标
+    std::vector<int> m_heapPos;  // m_slots 下标 -> 在 m_heap 中的位置
+    std::vector<quint64> m_indexKeys;  // 0 表示空位（合法 key 的长度位不为 0）
+    std::vector<int> m_indexSlots;
+    QHash<quint32, History> m_threads;
+};
+
+#endif // SEQUENCEMINER_H
@@ -0,0 +1,77 @@
+#include "stackunwinder.h"
+#include "symbolizer.h"
+
+#include <sys/uio.h>
+#include <string.h>
+#include <algorithm>
+
+// 相邻两帧的距离超过这个值就认为帧指针已经不可信
+static const quint64 kMaxFrameSize = 8 * 1024 * 1024;
+
+StackUnwinder::StackUnwinder()
+    : m_window(kStackWindow)
+{
+}
+
+bool StackUnwinder::readWord(pid_t pid, quint64 addr, quint64 &out) const
+{
+    if (addr >= m_windowBase && addr + sizeof(out) <= m_windowBase + m_windowSize) {
+        memcpy(&out, m_window.data() + (addr - m_windowBase), sizeof(out));
+        return true;
+    }
+    struct iovec local = { &out, sizeof(out) };
+    struct iovec remote = { reinterpret_cast<void*>(addr), sizeof(out) };
+    return process_vm_readv(pid, &local, 1, &remote, 1, 0) == ssize_t(sizeof(out));
+}
+
+int StackUnwinder::capture(pid_t pid, const struct user_regs_struct &regs, Symbolizer &symbols, quint64 *pcs, int max)
+{
+    if (max <= 0)
+        return 0;
+    int n = 0;
+    pcs[n++] = regs.rip;
+
+    // 按页拆成多个远端 iovec：部分失败时 process_vm_readv 停在第一个读不了的页上，
+    // 这样栈顶离 rsp 不足一个窗口时也能拿到前面可读的部分
+    const quint64 page = 4096;
+    struct iovec remote[kStackWindow / 4096 + 1];
+    int count = 0;
+    quint64 addr = regs.rsp;
+    quint64 left = kStackWindow;
+    while (left > 0) {
+        quint64 chunk = std::min(left, page - (addr % page));
+        remote[count++] = { reinterpret_cast<void*>(addr), size_t(chunk) };
+        addr += chunk;
+        left -= chunk;
+    }
+    struct iovec local = { m_window.data(), size_t(kStackWindow) };
+    ssize_t got = process_vm_readv(pid, &local, 1, remote, unsigned(count), 0);
+    m_windowBase = regs.rsp;
+    m_windowSize = got > 0 ? quint64(got) : 0;
+
+    // libc 的系统调用包装函数通常不建立栈帧，返回地址就在栈顶
+    quint64 ret;
+    if (n < max && readWord(pid, regs.rsp, ret) && symbols.isExecutable(ret))
+        pcs[n++] = ret;
+
+    quint64 fp = regs.rbp;
+    quint64 lowest = regs.rsp;
+    while (n < max) {
+        // 帧指针必须 8 字节对齐，并且只能向栈底（高地址）方向移动
+        if (fp < lowest || (fp & 7) || fp - lowest > kMaxFrameSize)
+            break;
+        quint64 next;
+        if (!readWord(pid, fp, next) || !readWord(pid, fp + 8, ret))
+            break;
+        if (ret == 0 || !symbols.isExecutable(ret))
+            break;
+        // 包装函数建立了栈帧时，栈顶那个值就是第一帧的返回地址，不要重复记录
+        if (!(n == 2 && pcs[1] == ret))
+            pcs[n++] = ret;
+        if (next <= fp)
+            break;
+        lowest = fp + 16;
+        fp = next;
+    }
+    return n;
+}
@@ -0,0 +1,33 @@
+#ifndef STACKUNWINDER_H
+#define STACKUNWINDER_H
+
+#include <QtGlobal>
+#include <sys/types.h>
+#include <sys/user.h>
+#include <vector>
+
+class Symbolizer;
+
+// 在系统调用入口处回溯被追踪线程的用户态栈。
+// 沿 rbp 帧指针链向外走；栈顶附近的一段先用一次 process_vm_readv 整体读进来，
+// 落在这段之外的帧再单独读取。没有保留帧指针的代码会让回溯提前结束，不会产生错误的帧。
+class StackUnwinder
+{
+public:
+    static constexpr int kMaxFrames = 64;
+    static constexpr quint64 kStackWindow = 16 * 1024;
+
+    StackUnwinder();
+
+    // pcs[0] 是 syscall 指令所在地址，之后由内向外依次是各层返回地址；返回帧数
+    int capture(pid_t pid, const struct user_regs_struct &regs, Symbolizer &symbols, quint64 *pcs, int max);
+
+private:
+    bool readWord(pid_t pid, quint64 addr, quint64 &out) const;
+
+    std::vector<char> m_window;
+    quint64 m_windowBase = 0;
+    quint64 m_windowSize = 0;
+};
+
+#endif // STACKUNWINDER_H
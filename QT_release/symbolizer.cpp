@@ -0,0 +1,230 @@
+#include "symbolizer.h"
+
+#include <cxxabi.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+// 映射表缺失某个地址时，两次重新读取 /proc/<pid>/maps 之间至少间隔这么久
+static const quint64 kReloadIntervalNs = 50 * 1000 * 1000ULL; // 50 ms
+
+static quint64 monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return quint64(ts.tv_sec) * 1000000000ULL + quint64(ts.tv_nsec);
+}
+
+Symbolizer::Symbolizer(pid_t pid)
+    : m_pid(pid)
+{
+    reloadMaps();
+}
+
+Symbolizer::~Symbolizer()
+{
+    for (auto &image : m_images) {
+        if (image->data)
+            munmap(image->data, image->size);
+    }
+}
+
+void Symbolizer::reloadMaps()
+{
+    m_lastReloadNs = monotonic_ns();
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", int(m_pid));
+    FILE *f = fopen(path, "re");
+    if (!f)
+        return;
+
+    m_mappings.clear();
+    char *line = nullptr;
+    size_t cap = 0;
+    while (getline(&line, &cap, f) > 0) {
+        unsigned long start, end, offset;
+        char perms[5];
+        int pathPos = 0;
+        if (sscanf(line, "%lx-%lx %4s %lx %*s %*u %n", &start, &end, perms, &offset, &pathPos) < 4)
+            continue;
+        if (perms[2] != 'x')
+            continue;
+
+        std::string file = pathPos > 0 ? std::string(line + pathPos) : std::string();
+        while (!file.empty() && (file.back() == '\n' || file.back() == ' '))
+            file.pop_back();
+        const char deleted[] = " (deleted)";
+        if (file.size() > sizeof(deleted) - 1 && file.compare(file.size() - (sizeof(deleted) - 1), std::string::npos, deleted) == 0)
+            file.resize(file.size() - (sizeof(deleted) - 1));
+
+        int image = -1;
+        if (!file.empty()) {
+            auto it = m_imageIndex.find(file);
+            if (it == m_imageIndex.end()) {
+                auto img = std::make_unique<Image>();
+                img->path = file;
+                size_t slash = file.rfind('/');
+                img->name = slash == std::string::npos ? file : file.substr(slash + 1);
+                // [vdso]/[vsyscall] 这类伪文件不去解析
+                img->loaded = file[0] != '/';
+                image = int(m_images.size());
+                m_images.push_back(std::move(img));
+                m_imageIndex.emplace(file, image);
+            } else {
+                image = it->second;
+            }
+        }
+        m_mappings.push_back({ start, end, offset, image });
+    }
+    free(line);
+    fclose(f);
+    std::sort(m_mappings.begin(), m_mappings.end(),
+              [](const Mapping &a, const Mapping &b) { return a.start < b.start; });
+}
+
+const Symbolizer::Mapping* Symbolizer::lookup(quint64 pc) const
+{
+    auto it = std::upper_bound(m_mappings.begin(), m_mappings.end(), pc,
+                               [](quint64 v, const Mapping &m) { return v < m.start; });
+    if (it == m_mappings.begin())
+        return nullptr;
+    --it;
+    return pc < it->end ? &*it : nullptr;
+}
+
+const Symbolizer::Mapping* Symbolizer::find(quint64 pc)
+{
+    const Mapping *m = lookup(pc);
+    // 可能是新 dlopen 进来的库
+    if (!m && monotonic_ns() - m_lastReloadNs >= kReloadIntervalNs) {
+        reloadMaps();
+        m = lookup(pc);
+    }
+    return m;
+}
+
+bool Symbolizer::isExecutable(quint64 pc)
+{
+    return find(pc) != nullptr;
+}
+
+void Symbolizer::loadImage(Image &image)
+{
+    image.loaded = true;
+
+    // 优先通过 /proc/<pid>/root 打开，被追踪进程在另一个挂载命名空间（容器）里也能找到文件
+    std::string rooted = "/proc/" + std::to_string(m_pid) + "/root" + image.path;
+    int fd = open(rooted.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        fd = open(image.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < off_t(sizeof(Elf64_Ehdr))) {
+        close(fd);
+        return;
+    }
+    void *data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return;
+    image.data = data;
+    image.size = size_t(st.st_size);
+
+    const char *base = static_cast<const char*>(data);
+    const size_t size = image.size;
+    auto inFile = [size](quint64 offset, quint64 bytes) { return offset <= size && bytes <= size - offset; };
+
+    const Elf64_Ehdr *eh = reinterpret_cast<const Elf64_Ehdr*>(base);
+    if (memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != ELFCLASS64)
+        return;
+
+    if (eh->e_phentsize == sizeof(Elf64_Phdr) && inFile(eh->e_phoff, quint64(eh->e_phnum) * sizeof(Elf64_Phdr))) {
+        const Elf64_Phdr *ph = reinterpret_cast<const Elf64_Phdr*>(base + eh->e_phoff);
+        for (int i = 0; i < eh->e_phnum; ++i) {
+            if (ph[i].p_type == PT_LOAD)
+                image.loads.push_back({ ph[i].p_offset, ph[i].p_vaddr, ph[i].p_filesz });
+        }
+    }
+
+    if (eh->e_shentsize != sizeof(Elf64_Shdr) || !inFile(eh->e_shoff, quint64(eh->e_shnum) * sizeof(Elf64_Shdr)))
+        return;
+    const Elf64_Shdr *sh = reinterpret_cast<const Elf64_Shdr*>(base + eh->e_shoff);
+    for (int i = 0; i < eh->e_shnum; ++i) {
+        if (sh[i].sh_type != SHT_SYMTAB && sh[i].sh_type != SHT_DYNSYM)
+            continue;
+        if (sh[i].sh_link >= eh->e_shnum || sh[i].sh_entsize != sizeof(Elf64_Sym))
+            continue;
+        const Elf64_Shdr &strtab = sh[sh[i].sh_link];
+        if (!inFile(sh[i].sh_offset, sh[i].sh_size) || !inFile(strtab.sh_offset, strtab.sh_size))
+            continue;
+
+        const Elf64_Sym *syms = reinterpret_cast<const Elf64_Sym*>(base + sh[i].sh_offset);
+        size_t count = sh[i].sh_size / sizeof(Elf64_Sym);
+        const char *strings = base + strtab.sh_offset;
+        for (size_t s = 0; s < count; ++s) {
+            unsigned type = ELF64_ST_TYPE(syms[s].st_info);
+            if ((type != STT_FUNC && type != STT_GNU_IFUNC) || syms[s].st_value == 0
+                || syms[s].st_shndx == SHN_UNDEF || syms[s].st_name >= strtab.sh_size)
+                continue;
+            // 字符串表末尾必须有 \0，否则这个名字不可信
+            const char *name = strings + syms[s].st_name;
+            if (!memchr(name, '\0', strtab.sh_size - syms[s].st_name))
+                continue;
+            image.symbols.push_back({ syms[s].st_value, syms[s].st_size, name });
+        }
+    }
+    // 同一地址的别名（.symtab 和 .dynsym 各有一份）只保留一个
+    std::sort(image.symbols.begin(), image.symbols.end(),
+              [](const Symbol &a, const Symbol &b) { return a.addr < b.addr || (a.addr == b.addr && a.size > b.size); });
+    image.symbols.erase(std::unique(image.symbols.begin(), image.symbols.end(),
+                                    [](const Symbol &a, const Symbol &b) { return a.addr == b.addr; }),
+                        image.symbols.end());
+}
+
+std::string Symbolizer::symbolize(quint64 pc)
+{
+    const Mapping *m = find(pc);
+    if (!m)
+        return "[unknown]";
+    if (m->image < 0)
+        return "[anon]";
+
+    Image &image = *m_images[m->image];
+    if (!image.loaded)
+        loadImage(image);
+
+    quint64 fileOffset = pc - m->start + m->offset;
+    quint64 vaddr = fileOffset;
+    for (const Segment &seg : image.loads) {
+        if (fileOffset >= seg.offset && fileOffset < seg.offset + seg.filesz) {
+            vaddr = fileOffset - seg.offset + seg.vaddr;
+            break;
+        }
+    }
+
+    auto it = std::upper_bound(image.symbols.begin(), image.symbols.end(), vaddr,
+                               [](quint64 v, const Symbol &s) { return v < s.addr; });
+    if (it != image.symbols.begin()) {
+        --it;
+        // size 为 0 的符号（手写汇编）只能假定它一直延伸到下一个符号
+        if (it->size == 0 || vaddr < it->addr + it->size) {
+            int status = 0;
+            char *demangled = abi::__cxa_demangle(it->name, nullptr, nullptr, &status);
+            std::string name = (status == 0 && demangled) ? demangled : it->name;
+            free(demangled);
+            return name;
+        }
+    }
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "+0x%llx", static_cast<unsigned long long>(fileOffset));
+    return image.name + buf;
+}
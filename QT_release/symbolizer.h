@@ -0,0 +1,68 @@
+#ifndef SYMBOLIZER_H
+#define SYMBOLIZER_H
+
+#include <QtGlobal>
+#include <sys/types.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 把被追踪进程中的代码地址解析成函数名。
+// 可执行映射来自 /proc/<pid>/maps，遇到不在任何映射里的地址时重新读取（有频率限制）；
+// 每个 ELF 文件第一次被用到时才 mmap 并解析 .symtab/.dynsym，之后一直缓存。
+// 只在追踪线程使用，不是线程安全的。
+class Symbolizer
+{
+public:
+    explicit Symbolizer(pid_t pid);
+    ~Symbolizer();
+    Symbolizer(const Symbolizer&) = delete;
+    Symbolizer& operator=(const Symbolizer&) = delete;
+
+    // pc 是否落在可执行映射内，栈回溯用它判断读到的返回地址是否可信
+    bool isExecutable(quint64 pc);
+
+    // 函数名（C++ 名字已还原）；没有符号时返回 "模块名+0x文件偏移"，匿名映射（JIT 等）返回 "[anon]"
+    std::string symbolize(quint64 pc);
+
+private:
+    struct Symbol {
+        quint64 addr;
+        quint64 size;
+        const char *name;     // 指向 mmap 的文件内容
+    };
+    struct Segment {
+        quint64 offset;
+        quint64 vaddr;
+        quint64 filesz;
+    };
+    struct Image {
+        std::string path;
+        std::string name;     // 文件名部分，用于无法解析时的显示
+        bool loaded = false;
+        void *data = nullptr;
+        size_t size = 0;
+        std::vector<Symbol> symbols; // 按 addr 排序
+        std::vector<Segment> loads;  // PT_LOAD 段，用于文件偏移 -> 链接地址
+    };
+    struct Mapping {
+        quint64 start;
+        quint64 end;
+        quint64 offset;
+        int image;            // m_images 下标，-1 表示匿名映射
+    };
+
+    const Mapping* find(quint64 pc);
+    const Mapping* lookup(quint64 pc) const;
+    void reloadMaps();
+    void loadImage(Image &image);
+
+    pid_t m_pid;
+    std::vector<Mapping> m_mappings; // 按 start 排序
+    std::vector<std::unique_ptr<Image>> m_images;
+    std::unordered_map<std::string, int> m_imageIndex;
+    quint64 m_lastReloadNs = 0;
+};
+
+#endif // SYMBOLIZER_H
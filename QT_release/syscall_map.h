@@ -364,8 +364,60 @@ static const QMap<long, const char*> syscall_map = {
     {446, "landlock_restrict_self"},
     {447, "memfd_secret"},
     {448, "process_mrelease"},
+    {449, "futex_waitv"},
+    {450, "set_mempolicy_home_node"},
 };
 
 static QString getSyscallName(long number) {
     return syscall_map.value(number, "Unknown");
 }
+
+// 系统调用分类，规则见 generate_syscall_map.cpp 中的 kCategoryRules
+enum SyscallCategory {
+    SyscallCategoryFile,
+    SyscallCategoryNet,
+    SyscallCategoryMemory,
+    SyscallCategoryProcess,
+    SyscallCategorySync,
+    SyscallCategoryTime,
+    SyscallCategoryOther,
+    SyscallCategoryCount
+};
+
+static const char *const syscall_category_names[SyscallCategoryCount] = { "file", "net", "memory", "process", "sync", "time", "other" };
+
+// 下标为 syscall 号
+static const unsigned char syscall_categories[451] = {
+    0, 0, 0, 0, 0, 0, 0, 4, 0, 2, 2, 2, 2, 3, 3, 3, 0, 0, 0, 0, 0, 0, 4, 4, 4, 2, 2, 2, 2, 4, 4, 4,
+    0, 0, 3, 5, 5, 5, 5, 3, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    5, 3, 3, 3, 5, 3, 3, 6, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 0, 0, 6, 3, 6, 0, 0, 6, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 6, 6, 0, 6, 3, 3, 5,
+    3, 0, 0, 6, 5, 0, 0, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 3, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 3, 5, 4, 3, 3, 3, 0, 0, 0, 0, 0, 3, 6, 4, 6, 6, 2, 0, 3, 3, 4, 0, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 3, 4, 4, 3, 0, 6, 2, 2, 2, 4, 4, 4, 4, 4, 4, 6, 3, 6, 6, 6, 3, 3, 0, 0, 0,
+    2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 4, 3, 4, 4, 0, 0, 0, 0, 2, 0, 4, 4, 5, 4, 0, 5, 5,
+    1, 4, 4, 4, 0, 4, 0, 0, 0, 3, 6, 1, 0, 0, 3, 0, 0, 5, 0, 1, 3, 3, 2, 2, 6, 6, 3, 3, 0, 3, 6, 2,
+    6, 6, 3, 2, 2, 2, 0, 0, 0, 2, 2, 2, 0, 0, 3, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 3, 0, 0, 0, 6, 6, 6, 6, 6, 6, 3, 3, 0, 0, 3, 0, 2, 4, 6, 6, 6, 6, 6, 2,
+    2, 4, 2,
+};
+
+static int getSyscallCategory(long number) {
+    return (number >= 0 && number < long(sizeof(syscall_categories))) ? syscall_categories[number] : SyscallCategoryOther;
+}
+
+static QString getSyscallCategoryName(int category) {
+    return (category >= 0 && category < SyscallCategoryCount) ? syscall_category_names[category] : "Unknown";
+}
+
+// 分类名 -> 分类，无法识别返回 -1
+static int syscallCategoryFromName(const QString &name) {
+    for (int c = 0; c < SyscallCategoryCount; ++c) {
+        if (name == QLatin1String(syscall_category_names[c]))
+            return c;
+    }
+    return -1;
+}
@@ -0,0 +1,25 @@
+#ifndef SYSCALLEVENT_H
+#define SYSCALLEVENT_H
+
+#include <QtGlobal>
+
+// 一次完整系统调用（入口 + 出口）的定长记录。
+// 字符串（进程名、路径）不随事件复制，而是以 StringTable 的 32 位 id 引用；
+// 其他解码出的参数以 Arena 引用保存。整条记录 48 字节，1000 万条约 460 MB。
+struct SyscallEvent
+{
+    quint64 ts;        // 入口时间戳，CLOCK_MONOTONIC，ns
+    quint64 duration;  // 耗时，ns（已扣除标定的 ptrace 开销）
+    qint64 ret;        // 返回值，[-4095, -1] 表示 -errno
+    quint32 pid;       // 线程组 id
+    quint32 tid;       // 线程 id
+    quint32 commId;    // 进程名，StringTable id
+    quint32 pathId;    // 解码出的路径参数，StringTable id，0 表示没有
+    quint32 argRef;    // Arena 中附加的参数数据，0 表示没有
+    qint16 syscall;
+    quint16 flags;
+};
+
+static_assert(sizeof(SyscallEvent) == 48, "SyscallEvent layout changed");
+
+#endif // SYSCALLEVENT_H
@@ -0,0 +1,538 @@
+#include "syscallfilter.h"
+#include "chunksummary.h"
+#include "errnostats.h"
+#include "syscall_map.h"
+#include "tracequery.h"
+
+#include <QStringList>
+#include <algorithm>
+#include <limits>
+#include <fnmatch.h>
+#include <string.h>
+
+static constexpr int kSyscallBits = ChunkSummary::kSyscallBits;
+static constexpr int kErrnoBits = 4096;
+
+static void setBit(std::vector<quint64> &bits, int index)
+{
+    bits[size_t(index) / 64] |= 1ULL << (index % 64);
+}
+
+static bool testBit(const std::vector<quint64> &bits, long index)
+{
+    return index >= 0 && size_t(index) / 64 < bits.size() && (bits[size_t(index) / 64] >> (index % 64)) & 1;
+}
+
+static QString categoryList()
+{
+    QStringList names;
+    for (int c = 0; c < SyscallCategoryCount; ++c)
+        names << getSyscallCategoryName(c);
+    return names.join(", ");
+}
+
+static std::string lower(std::string s)
+{
+    for (char &c : s)
+        c = char(tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+// --- 词法与语法分析：递归下降，生成语法树 ---
+
+class SyscallFilter::Parser
+{
+public:
+    Parser(const std::string &text, SyscallFilter &filter) : m_filter(filter) { tokenize(text); }
+
+    int parse()
+    {
+        if (!m_error.isEmpty())
+            return -1;
+        int root = parseOr();
+        if (root >= 0 && peek().type != Token::End)
+            return fail(QString("unexpected '%1'").arg(QString::fromStdString(peek().text)));
+        return root;
+    }
+
+    QString error() const { return m_error; }
+
+private:
+    struct Token {
+        enum Type { Word, String, Symbol, End } type;
+        std::string text;
+    };
+
+    static bool isSymbolChar(char c) { return strchr("()!,=<>~&|", c) != nullptr; }
+
+    void tokenize(const std::string &text)
+    {
+        size_t i = 0;
+        while (i < text.size()) {
+            char c = text[i];
+            if (isspace(static_cast<unsigned char>(c))) {
+                ++i;
+            } else if (c == '"' || c == '\'') {
+                size_t close = text.find(c, i + 1);
+                if (close == std::string::npos) {
+                    fail("unterminated string");
+                    return;
+                }
+                m_tokens.push_back({ Token::String, text.substr(i + 1, close - i - 1) });
+                i = close + 1;
+            } else if (isSymbolChar(c)) {
+                // 两个字符的运算符优先
+                static const char *const kPairs[] = { "==", "!=", "<=", ">=", "&&", "||", "!~" };
+                std::string symbol(1, c);
+                for (const char *pair : kPairs) {
+                    if (text.compare(i, 2, pair) == 0) {
+                        symbol = pair;
+                        break;
+                    }
+                }
+                i += symbol.size();
+                m_tokens.push_back({ Token::Symbol, symbol == "=" ? std::string("==") : symbol });
+            } else {
+                // 不带引号的值可以包含 / * ? . - 等字符，例如 path ~ /etc/*
+                size_t begin = i;
+                while (i < text.size() && !isspace(static_cast<unsigned char>(text[i])) && !isSymbolChar(text[i]))
+                    ++i;
+                m_tokens.push_back({ Token::Word, text.substr(begin, i - begin) });
+            }
+        }
+        m_tokens.push_back({ Token::End, std::string() });
+    }
+
+    const Token& peek() const { return m_tokens[m_pos]; }
+    const Token& next() { return m_tokens[m_pos < m_tokens.size() - 1 ? m_pos++ : m_pos]; }
+    bool acceptSymbol(const char *symbol)
+    {
+        if (peek().type == Token::Symbol && peek().text == symbol) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+    bool acceptKeyword(const char *keyword)
+    {
+        if (peek().type == Token::Word && lower(peek().text) == keyword) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    int fail(const QString &message)
+    {
+        if (m_error.isEmpty())
+            m_error = message;
+        return -1;
+    }
+
+    int add(const Node &node)
+    {
+        m_filter.m_nodes.push_back(node);
+        return int(m_filter.m_nodes.size()) - 1;
+    }
+    int addBinary(Node::Kind kind, int lhs, int rhs)
+    {
+        Node node;
+        node.kind = kind;
+        node.lhs = lhs;
+        node.rhs = rhs;
+        return add(node);
+    }
+    int addLeaf(Op op, Cmp cmp = Eq, quint16 arg = 0, qint64 value = 0)
+    {
+        Node node;
+        node.leaf = Instr{ op, cmp, arg, value };
+        return add(node);
+    }
+
+    int parseOr()
+    {
+        int lhs = parseAnd();
+        while (lhs >= 0 && (acceptSymbol("||") || acceptKeyword("or"))) {
+            int rhs = parseAnd();
+            if (rhs < 0)
+                return -1;
+            lhs = addBinary(Node::Or, lhs, rhs);
+        }
+        return lhs;
+    }
+
+    int parseAnd()
+    {
+        int lhs = parseUnary();
+        while (lhs >= 0 && (acceptSymbol("&&") || acceptKeyword("and"))) {
+            int rhs = parseUnary();
+            if (rhs < 0)
+                return -1;
+            lhs = addBinary(Node::And, lhs, rhs);
+        }
+        return lhs;
+    }
+
+    int parseUnary()
+    {
+        if (acceptSymbol("!") || acceptKeyword("not")) {
+            int operand = parseUnary();
+            return operand < 0 ? -1 : addBinary(Node::Not, operand, -1);
+        }
+        if (acceptSymbol("(")) {
+            int inner = parseOr();
+            if (inner >= 0 && !acceptSymbol(")"))
+                return fail("missing ')'");
+            return inner;
+        }
+        return parsePredicate();
+    }
+
+    // ==、!= 后面跟一个值，in 后面跟括号括起来的列表
+    bool parseValues(std::vector<std::string> &values, bool &negate)
+    {
+        negate = false;
+        if (acceptSymbol("==") || (acceptSymbol("!=") && (negate = true))) {
+            const Token &t = next();
+            if (t.type != Token::Word && t.type != Token::String) {
+                fail("expected a value");
+                return false;
+            }
+            values.push_back(t.text);
+            return true;
+        }
+        if (!acceptKeyword("in")) {
+            fail("expected ==, != or in");
+            return false;
+        }
+        if (!acceptSymbol("(")) {
+            fail("expected '(' after in");
+            return false;
+        }
+        do {
+            const Token &t = next();
+            if (t.type != Token::Word && t.type != Token::String) {
+                fail("expected a value");
+                return false;
+            }
+            values.push_back(t.text);
+        } while (acceptSymbol(","));
+        if (!acceptSymbol(")")) {
+            fail("missing ')'");
+            return false;
+        }
+        return true;
+    }
+
+    bool parseCmp(Cmp &cmp)
+    {
+        static const struct { const char *symbol; Cmp cmp; } kOps[] = {
+            { "==", Eq }, { "!=", Ne }, { "<=", Le }, { ">=", Ge }, { "<", Lt }, { ">", Gt },
+        };
+        for (const auto &op : kOps) {
+            if (acceptSymbol(op.symbol)) {
+                cmp = op.cmp;
+                return true;
+            }
+        }
+        fail("expected a comparison operator");
+        return false;
+    }
+
+    bool parseInteger(const std::string &text, qint64 &value)
+    {
+        char *end = nullptr;
+        value = strtoll(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0') {
+            fail(QString("not a number: %1").arg(QString::fromStdString(text)));
+            return false;
+        }
+        return true;
+    }
+
+    bool parseDurationValue(const std::string &text, qint64 &ns)
+    {
+        quint64 value;
+        if (!parseDuration(QString::fromStdString(text), value) || value > quint64(std::numeric_limits<qint64>::max())) {
+            fail(QString("bad duration: %1 (e.g. 1ms, 500us)").arg(QString::fromStdString(text)));
+            return false;
+        }
+        ns = qint64(value);
+        return true;
+    }
+
+    int negated(int node, bool negate) { return negate ? addBinary(Node::Not, node, -1) : node; }
+
+    int parsePredicate()
+    {
+        const Token &field = next();
+        if (field.type != Token::Word)
+            return fail(field.type == Token::End ? QString("unexpected end of filter")
+                                                 : QString("unexpected '%1'").arg(QString::fromStdString(field.text)));
+        const std::string name = lower(field.text);
+        std::vector<std::string> values;
+        bool negate = false;
+
+        if (name == "syscall" || name == "class") {
+            if (!parseValues(values, negate))
+                return -1;
+            std::vector<quint64> bits(kSyscallBits / 64, 0);
+            for (const std::string &v : values) {
+                if (name == "syscall") {
+                    int nr = syscallFromName(QString::fromStdString(v));
+                    if (nr < 0)
+                        return fail(QString("unknown syscall: %1").arg(QString::fromStdString(v)));
+                    setBit(bits, nr);
+                    continue;
+                }
+                // 分类由 generate_syscall_map 生成，见 syscall_map.h
+                int category = syscallCategoryFromName(QString::fromStdString(lower(v)));
+                if (category < 0)
+                    return fail(QString("unknown class: %1 (%2)").arg(QString::fromStdString(v)).arg(categoryList()));
+                for (int nr = 0; nr < kSyscallBits; ++nr) {
+                    if (getSyscallCategory(nr) == category)
+                        setBit(bits, nr);
+                }
+            }
+            m_filter.m_syscallSets.push_back(std::move(bits));
+            return negated(addLeaf(SyscallIn, Eq, quint16(m_filter.m_syscallSets.size() - 1)), negate);
+        }
+
+        if (name == "errno") {
+            // 单独的 errno 表示失败的调用；只有紧跟 ==、!= 或 in 时才是比较，后面是 )、&&、|| 等时仍是单独的 errno
+            const Token &op = peek();
+            if (!(op.type == Token::Symbol && (op.text == "==" || op.text == "!="))
+                && !(op.type == Token::Word && lower(op.text) == "in"))
+                return addLeaf(IsError);
+            if (!parseValues(values, negate))
+                return -1;
+            std::vector<quint64> bits(kErrnoBits / 64, 0);
+            for (const std::string &v : values) {
+                int err = ErrnoStats::errnoFromName(QString::fromStdString(v));
+                if (err <= 0 || err >= kErrnoBits)
+                    return fail(QString("unknown errno: %1").arg(QString::fromStdString(v)));
+                setBit(bits, err);
+            }
+            m_filter.m_errnoSets.push_back(std::move(bits));
+            return negated(addLeaf(ErrnoIn, Eq, quint16(m_filter.m_errnoSets.size() - 1)), negate);
+        }
+
+        if (name == "tid" || name == "pid") {
+            if (peek().type == Token::Word && lower(peek().text) == "in") {
+                if (!parseValues(values, negate))
+                    return -1;
+                std::vector<quint32> ids;
+                for (const std::string &v : values) {
+                    qint64 id;
+                    if (!parseInteger(v, id))
+                        return -1;
+                    ids.push_back(quint32(id));
+                }
+                std::sort(ids.begin(), ids.end());
+                m_filter.m_idSets.push_back(std::move(ids));
+                return addLeaf(name == "tid" ? TidIn : PidIn, Eq, quint16(m_filter.m_idSets.size() - 1));
+            }
+            Cmp cmp;
+            qint64 id;
+            if (!parseCmp(cmp) || !parseInteger(next().text, id))
+                return -1;
+            return addLeaf(name == "tid" ? TidCmp : PidCmp, cmp, 0, id);
+        }
+
+        if (name == "ret" || name == "dur") {
+            Cmp cmp;
+            qint64 value;
+            if (!parseCmp(cmp))
+                return -1;
+            const std::string text = next().text;
+            if (name == "ret" ? !parseInteger(text, value) : !parseDurationValue(text, value))
+                return -1;
+            return addLeaf(name == "ret" ? RetCmp : DurCmp, cmp, 0, value);
+        }
+
+        if (name == "path") {
+            bool glob = acceptSymbol("~");
+            bool notGlob = !glob && acceptSymbol("!~");
+            if (!glob && !notGlob && !(acceptSymbol("==") || (acceptSymbol("!=") && (negate = true))))
+                return fail("expected ~, !~, == or != after path");
+            const Token &t = next();
+            if (t.type != Token::Word && t.type != Token::String)
+                return fail("expected a path");
+            m_filter.m_patterns.push_back(t.text);
+            m_filter.m_usesPath = true;
+            int leaf = addLeaf(glob || notGlob ? PathGlob : PathEquals, Eq, quint16(m_filter.m_patterns.size() - 1));
+            return negated(leaf, negate || notGlob);
+        }
+
+        return fail(QString("unknown field: %1 (syscall, class, tid, pid, ret, errno, dur, path)")
+                        .arg(QString::fromStdString(field.text)));
+    }
+
+    SyscallFilter &m_filter;
+    std::vector<Token> m_tokens;
+    size_t m_pos = 0;
+    QString m_error;
+};
+
+// --- 编译 ---
+
+bool SyscallFilter::compile(const QString &text, SyscallFilter &out, QString *error)
+{
+    out = SyscallFilter();
+    out.m_text = text.trimmed();
+    if (out.m_text.isEmpty())
+        return true;
+
+    Parser parser(out.m_text.toStdString(), out);
+    out.m_root = parser.parse();
+    if (out.m_root < 0) {
+        if (error)
+            *error = parser.error();
+        out = SyscallFilter();
+        return false;
+    }
+    out.emitCode(out.m_nodes, out.m_root);
+    if (out.m_code.size() > 0xffff) { // 跳转目标是 16 位
+        if (error)
+            *error = "filter too long";
+        out = SyscallFilter();
+        return false;
+    }
+    return true;
+}
+
+// and/or 编译成短路跳转：左边已经决定结果时跳过右边，累加器里留下的正是整个表达式的值
+void SyscallFilter::emitCode(const std::vector<Node> &nodes, int index)
+{
+    const Node &node = nodes[index];
+    switch (node.kind) {
+    case Node::Leaf:
+        m_code.push_back(node.leaf);
+        break;
+    case Node::Not:
+        emitCode(nodes, node.lhs);
+        m_code.push_back(Instr{ Not, Eq, 0, 0 });
+        break;
+    case Node::And:
+    case Node::Or: {
+        emitCode(nodes, node.lhs);
+        size_t jump = m_code.size();
+        m_code.push_back(Instr{ node.kind == Node::And ? JumpIfFalse : JumpIfTrue, Eq, 0, 0 });
+        emitCode(nodes, node.rhs);
+        m_code[jump].arg = quint16(m_code.size());
+        break;
+    }
+    }
+}
+
+// --- 求值 ---
+
+bool SyscallFilter::compare(qint64 lhs, Cmp cmp, qint64 rhs)
+{
+    switch (cmp) {
+    case Eq: return lhs == rhs;
+    case Ne: return lhs != rhs;
+    case Lt: return lhs < rhs;
+    case Le: return lhs <= rhs;
+    case Gt: return lhs > rhs;
+    case Ge: return lhs >= rhs;
+    }
+    return false;
+}
+
+bool SyscallFilter::matches(const SyscallEvent &e, const char *path) const
+{
+    bool acc = true;
+    const size_t n = m_code.size();
+    for (size_t pc = 0; pc < n; ++pc) {
+        const Instr &in = m_code[pc];
+        switch (in.op) {
+        case SyscallIn:
+            acc = testBit(m_syscallSets[in.arg], e.syscall);
+            break;
+        case ErrnoIn:
+            acc = testBit(m_errnoSets[in.arg], ErrnoStats::errnoFromRet(e.ret));
+            break;
+        case IsError:
+            acc = ErrnoStats::errnoFromRet(e.ret) != 0;
+            break;
+        case TidIn:
+        case PidIn: {
+            const std::vector<quint32> &ids = m_idSets[in.arg];
+            acc = std::binary_search(ids.begin(), ids.end(), in.op == TidIn ? e.tid : e.pid);
+            break;
+        }
+        case TidCmp:
+            acc = compare(e.tid, in.cmp, in.value);
+            break;
+        case PidCmp:
+            acc = compare(e.pid, in.cmp, in.value);
+            break;
+        case RetCmp:
+            acc = compare(e.ret, in.cmp, in.value);
+            break;
+        case DurCmp:
+            // 时长不会超过 qint64 的范围
+            acc = compare(qint64(e.duration), in.cmp, in.value);
+            break;
+        case PathGlob:
+            acc = path && fnmatch(m_patterns[in.arg].c_str(), path, 0) == 0;
+            break;
+        case PathEquals:
+            acc = path && m_patterns[in.arg] == path;
+            break;
+        case Not:
+            acc = !acc;
+            break;
+        case JumpIfFalse:
+            if (!acc)
+                pc = size_t(in.arg) - 1;
+            break;
+        case JumpIfTrue:
+            if (acc)
+                pc = size_t(in.arg) - 1;
+            break;
+        }
+    }
+    return acc;
+}
+
+// 三值逻辑：只有 syscall/class 条件能在入口处确定，不带路径参数的系统调用上路径条件恒为假
+SyscallFilter::Tristate SyscallFilter::evalForSyscall(const std::vector<Node> &nodes, int index, int nr, bool hasPath) const
+{
+    const Node &node = nodes[index];
+    switch (node.kind) {
+    case Node::Leaf:
+        if (node.leaf.op == SyscallIn)
+            return testBit(m_syscallSets[node.leaf.arg], nr) ? Yes : No;
+        if ((node.leaf.op == PathGlob || node.leaf.op == PathEquals) && !hasPath)
+            return No;
+        return Maybe;
+    case Node::Not: {
+        Tristate v = evalForSyscall(nodes, node.lhs, nr, hasPath);
+        return v == Maybe ? Maybe : v == Yes ? No : Yes;
+    }
+    case Node::And:
+    case Node::Or: {
+        Tristate decisive = node.kind == Node::And ? No : Yes;
+        Tristate l = evalForSyscall(nodes, node.lhs, nr, hasPath);
+        if (l == decisive)
+            return decisive;
+        Tristate r = evalForSyscall(nodes, node.rhs, nr, hasPath);
+        if (r == decisive)
+            return decisive;
+        return l == Maybe || r == Maybe ? Maybe : l;
+    }
+    }
+    return Maybe;
+}
+
+std::vector<bool> SyscallFilter::syscallMask(int syscallCount, const std::function<bool(int)> &hasPath) const
+{
+    std::vector<bool> mask(size_t(std::max(syscallCount, 0)), true);
+    if (m_root < 0)
+        return mask;
+    for (int nr = 0; nr < syscallCount; ++nr)
+        mask[size_t(nr)] = evalForSyscall(m_nodes, m_root, nr, hasPath(nr)) != No;
+    return mask;
+}
@@ -0,0 +1,91 @@
+#ifndef SYSCALLFILTER_H
+#define SYSCALLFILTER_H
+
+#include <QString>
+#include <functional>
+#include <string>
+#include <vector>
+#include "syscallevent.h"
+
+// 追踪过滤表达式：在追踪线程上、事件进入队列之前求值，不匹配的事件不会进入队列、飞行记录器和调用树。
+// 语法（关键字不区分大小写）：
+//   syscall == read    syscall in (read, write, 0)     class == file    class in (net, sync)
+//   tid == 1234        tid in (1, 2)                   pid != 42
+//   ret < 0            ret == 0                        errno            errno == EAGAIN    errno in (EINTR, EAGAIN)
+//   dur > 1ms          dur <= 20us                     path ~ "/etc/*"  path == /tmp/x
+//   条件之间用 and / or / not（也可以写 && || !）和括号组合，例如
+//   not syscall in (futex, read, write) and (errno or dur > 1ms)
+// syscall 名和时长（单位必须写出）的写法与过滤栏相同，见 tracequery.h 中两种语法的分工。
+// 表达式只编译一次：叶子条件编译成扁平的指令序列，and/or 编译成条件跳转（短路求值），
+// 因此求值只需要一个布尔累加器，不需要递归也不需要栈。
+class SyscallFilter
+{
+public:
+    // 只知道系统调用号时对某个条件的判断
+    enum Tristate : qint8 { No, Yes, Maybe };
+
+    static bool compile(const QString &text, SyscallFilter &out, QString *error);
+
+    bool isEmpty() const { return m_code.empty(); }
+    QString text() const { return m_text; }
+    bool usesPath() const { return m_usesPath; }
+
+    // 系统调用入口处的预筛选：返回 v[nr] 为 false 的系统调用不可能匹配，入口处就可以跳过路径解码、
+    // 栈回溯与调度采样，出口处也不必再读寄存器。hasPath(nr) 表示该系统调用是否带路径参数
+    std::vector<bool> syscallMask(int syscallCount, const std::function<bool(int)> &hasPath) const;
+
+    // path 为解码出的路径参数，没有时传 nullptr
+    bool matches(const SyscallEvent &e, const char *path) const;
+
+private:
+    enum Op : quint8 {
+        SyscallIn,     // arg: m_syscallSets 下标
+        ErrnoIn,       // arg: m_errnoSets 下标
+        IsError,
+        TidIn,         // arg: m_idSets 下标
+        PidIn,
+        TidCmp,        // cmp + value
+        PidCmp,
+        RetCmp,
+        DurCmp,
+        PathGlob,      // arg: m_patterns 下标
+        PathEquals,
+        Not,
+        JumpIfFalse,   // arg: 跳转目标
+        JumpIfTrue,
+    };
+    enum Cmp : quint8 { Eq, Ne, Lt, Le, Gt, Ge };
+
+    struct Instr {
+        Op op;
+        Cmp cmp;
+        quint16 arg;
+        qint64 value;
+    };
+
+    // 编译期间的语法树；求值只用指令序列，语法树留给 syscallMask 做三值求值
+    struct Node {
+        enum Kind { Leaf, And, Or, Not } kind = Leaf;
+        Instr leaf{};
+        int lhs = -1;
+        int rhs = -1;
+    };
+
+    class Parser;
+
+    void emitCode(const std::vector<Node> &nodes, int index);
+    Tristate evalForSyscall(const std::vector<Node> &nodes, int index, int nr, bool hasPath) const;
+    static bool compare(qint64 lhs, Cmp cmp, qint64 rhs);
+
+    QString m_text;
+    std::vector<Instr> m_code;
+    std::vector<std::vector<quint64>> m_syscallSets; // 位图
+    std::vector<std::vector<quint64>> m_errnoSets;   // 位图
+    std::vector<std::vector<quint32>> m_idSets;      // 已排序
+    std::vector<std::string> m_patterns;
+    bool m_usesPath = false;
+    std::vector<Node> m_nodes;
+    int m_root = -1;
+};
+
+#endif // SYSCALLFILTER_H
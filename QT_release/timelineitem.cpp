@@ -0,0 +1,97 @@
+#include "timelineitem.h"
+#include "mainwindow.h"
+#include "syscall_map.h"
+#include "errnostats.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QGraphicsSceneHoverEvent>
+
+TimelineBlockItem::TimelineBlockItem(const EventStore *store, const QVector<int> *lanes, quint64 firstIndex, quint64 originTs)
+    : m_store(store)
+    , m_lanes(lanes)
+    , m_first(firstIndex)
+    , m_end(firstIndex)
+    , m_originTs(originTs)
+{
+    setAcceptHoverEvents(true);
+    // 让 paint() 拿到 exposedRect，只画可见部分
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF TimelineBlockItem::eventRect(quint64 index) const
+{
+    const SyscallEvent &e = m_store->at(index);
+    int lane = (e.syscall >= 0 && e.syscall < m_lanes->size()) ? m_lanes->at(e.syscall) : 0;
+    double x = (e.ts - m_originTs) * kScale;
+    double y = lane * (kLaneHeight + kLaneSpacing);
+    double w = (e.duration > 0) ? (e.duration * kScale) : 2.0; // 持续时间太短的给个最小宽度
+    return QRectF(x, y, qMax(w, 2.0), kLaneHeight);
+}
+
+void TimelineBlockItem::extendTo(quint64 endIndex)
+{
+    if (endIndex <= m_end)
+        return;
+    QRectF bounds = m_bounds;
+    for (quint64 i = m_end; i < endIndex; ++i)
+        bounds = bounds.isNull() ? eventRect(i) : bounds.united(eventRect(i));
+    prepareGeometryChange();
+    m_bounds = bounds;
+    m_end = endIndex;
+}
+
+void TimelineBlockItem::relayout()
+{
+    QRectF bounds;
+    for (quint64 i = m_first; i < m_end; ++i)
+        bounds = bounds.isNull() ? eventRect(i) : bounds.united(eventRect(i));
+    prepareGeometryChange();
+    m_bounds = bounds;
+    update();
+}
+
+QRectF TimelineBlockItem::boundingRect() const
+{
+    return m_bounds;
+}
+
+void TimelineBlockItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget);
+    const QRectF exposed = option->exposedRect;
+    painter->setPen(Qt::NoPen);
+    for (quint64 i = m_first; i < m_end; ++i) {
+        QRectF r = eventRect(i);
+        if (!r.intersects(exposed))
+            continue;
+        // 根据系统调用类型设置不同颜色
+        long syscall = m_store->at(i).syscall;
+        painter->fillRect(r, QColor::fromHsv((syscall * 20) % 360, 200, 230));
+    }
+}
+
+void TimelineBlockItem::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
+{
+    // 从后往前找，重叠时取最新的事件
+    for (quint64 i = m_end; i > m_first; --i) {
+        if (!eventRect(i - 1).contains(event->pos()))
+            continue;
+        if (m_tooltipIndex != qint64(i - 1)) {
+            const SyscallEvent &e = m_store->at(i - 1);
+            m_tooltipIndex = qint64(i - 1);
+            QString text = QString("Syscall: %1 (%2)\nStart: %3 \nDuration: %4 \nReturn: %5")
+                               .arg(getSyscallName(e.syscall))
+                               .arg(getSyscallCategoryName(getSyscallCategory(e.syscall)))
+                               .arg(formatTimestamp(e.ts))
+                               .arg(formatDuration(e.duration))
+                               .arg(ErrnoStats::formatReturn(e.ret));
+            if (e.pathId != 0)
+                text += QString("\nPath: %1").arg(m_store->strings().string(e.pathId));
+            setToolTip(text);
+        }
+        return;
+    }
+    m_tooltipIndex = -1;
+    setToolTip(QString());
+}
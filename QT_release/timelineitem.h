@@ -0,0 +1,47 @@
+#ifndef TIMELINEITEM_H
+#define TIMELINEITEM_H
+
+#include <QGraphicsItem>
+#include <QVector>
+#include "eventstore.h"
+
+// 时间线上的一段连续事件（最多 kEventsPerBlock 条）由一个图元统一绘制，
+// 不再为每个事件创建一个 QGraphicsRectItem；工具提示在鼠标悬停时才根据事件现算。
+class TimelineBlockItem : public QGraphicsItem
+{
+public:
+    static constexpr quint64 kEventsPerBlock = 4096;
+    static constexpr double kScale = 0.00001; // 100,000 ns = 1 pixel
+    static constexpr int kLaneHeight = 20;
+    static constexpr int kLaneSpacing = 5;
+
+    // lanes: syscall 号 -> 泳道号，由 MainWindow 持有；originTs: 时间线起点
+    TimelineBlockItem(const EventStore *store, const QVector<int> *lanes, quint64 firstIndex, quint64 originTs);
+
+    // 把 [firstIndex, endIndex) 范围内新追加的事件纳入本图元
+    void extendTo(quint64 endIndex);
+    // 泳道分配改变后重新计算范围
+    void relayout();
+    bool isFull() const { return m_end - m_first >= kEventsPerBlock; }
+    quint64 capacityLeft() const { return kEventsPerBlock - (m_end - m_first); }
+    quint64 endIndex() const { return m_end; }
+
+    QRectF eventRect(quint64 index) const;
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+protected:
+    void hoverMoveEvent(QGraphicsSceneHoverEvent *event) override;
+
+private:
+    const EventStore *m_store;
+    const QVector<int> *m_lanes;
+    quint64 m_first;
+    quint64 m_end;
+    quint64 m_originTs;
+    QRectF m_bounds;
+    qint64 m_tooltipIndex = -1; // 当前工具提示对应的事件，避免重复格式化
+};
+
+#endif // TIMELINEITEM_H
@@ -0,0 +1,330 @@
+#include "traceagent.h"
+#include "tracer.h"
+#include "eventqueue.h"
+#include "eventstore.h"
+#include "syscallfilter.h"
+#include "tracecodec.h"
+#include "tracermetrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace agentprotocol;
+
+bool TraceAgent::loadOrCreateToken(const std::string &path, uid_t owner, std::string &token, QString *error)
+{
+    if (access(path.c_str(), F_OK) == 0 || errno != ENOENT)
+        return readToken(path, owner, token, error);
+    unsigned char random[32];
+    if (getrandom(random, sizeof(random), 0) != ssize_t(sizeof(random))) {
+        *error = QString("getrandom: %1").arg(strerror(errno));
+        return false;
+    }
+    static const char hex[] = "0123456789abcdef";
+    token.clear();
+    for (unsigned char b : random) {
+        token.push_back(hex[b >> 4]);
+        token.push_back(hex[b & 15]);
+    }
+    // O_EXCL | O_NOFOLLOW：不跟随别人预先放好的符号链接，也不覆盖已有文件
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    const std::string content = token + "\n";
+    const bool ok = fd >= 0 && fchown(fd, owner, gid_t(-1)) == 0
+                    && write(fd, content.data(), content.size()) == ssize_t(content.size());
+    if (!ok)
+        *error = QString("%1: %2").arg(QString::fromStdString(path), strerror(errno));
+    if (fd >= 0)
+        close(fd);
+    if (!ok && fd >= 0)
+        unlink(path.c_str());
+    return ok;
+}
+
+int TraceAgent::run()
+{
+    for (;;) {
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("agent: accept");
+            return 1;
+        }
+        if (m_unixSocket) {
+            ucred peer = {};
+            socklen_t len = sizeof(peer);
+            if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &len) != 0
+                || (peer.uid != 0 && peer.uid != getuid() && peer.uid != m_allowedUid)) {
+                fprintf(stderr, "agent: rejected connection from uid %u\n", unsigned(peer.uid));
+                close(fd);
+                continue;
+            }
+        }
+        serve(fd);
+        close(fd);
+    }
+}
+
+// 非阻塞地尽量写出发送缓冲；连接已断开时返回 false
+bool TraceAgent::flush(int fd)
+{
+    while (m_outSent < m_out.size()) {
+        ssize_t n = send(fd, m_out.data() + m_outSent, m_out.size() - m_outSent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            m_outSent += size_t(n);
+            m_bytesSent += quint64(n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            break;
+        return false;
+    }
+    // 已写出的部分超过一半时再前移，避免每次写一点就搬动整个缓冲
+    if (m_outSent == m_out.size()) {
+        m_out.clear();
+        m_outSent = 0;
+    } else if (m_outSent > m_out.size() / 2) {
+        m_out.erase(0, m_outSent);
+        m_outSent = 0;
+    }
+    return true;
+}
+
+void TraceAgent::appendSummaries()
+{
+    // 积压时取出的一批事件可能跨很多秒，超过单帧上限的部分分到后续帧里
+    auto it = m_pendingSummary.begin();
+    while (it != m_pendingSummary.end()) {
+        const quint32 count = quint32(std::min<size_t>(kMaxSummaryEntries, size_t(std::distance(it, m_pendingSummary.end()))));
+        size_t frame = beginFrame(m_out, Summary);
+        putU32(m_out, count);
+        for (quint32 i = 0; i < count; ++i, ++it) {
+            const SummaryEntry &s = it->second;
+            putU64(m_out, quint64(s.second));
+            putU16(m_out, quint16(s.syscall));
+            putU32(m_out, s.count);
+            putU32(m_out, s.errors);
+            putU64(m_out, s.durationNs);
+        }
+        endFrame(m_out, frame);
+    }
+    m_pendingSummary.clear();
+}
+
+void TraceAgent::serve(int fd)
+{
+    m_out.clear();
+    m_outSent = 0;
+    m_bytesSent = 0;
+    m_pendingSummary.clear();
+
+    size_t frame = beginFrame(m_out, Hello);
+    putU32(m_out, kMagic);
+    putU16(m_out, kVersion);
+    putU64(m_out, monotonicNs());
+    endFrame(m_out, frame);
+    if (!sendAll(fd, m_out.data(), m_out.size(), 5000))
+        return;
+    m_out.clear();
+
+    auto finish = [&](const QString &message) {
+        size_t f = beginFrame(m_out, Finished);
+        QByteArray utf8 = message.toUtf8();
+        putBytes(m_out, std::string_view(utf8.constData(), size_t(utf8.size())));
+        endFrame(m_out, f);
+        sendAll(fd, m_out.data() + m_outSent, m_out.size() - m_outSent, 5000);
+        fprintf(stderr, "agent: %s\n", qPrintable(message));
+    };
+
+    // --- 等待 Start：pid、模式、追踪过滤表达式。TCP 连接必须先通过 Auth，之前的任何其他帧都直接断开 ---
+    FrameBuffer in;
+    char buf[65536];
+    FrameType type;
+    std::string_view payload;
+    bool authenticated = m_unixSocket; // unix socket 的对端在 run() 里已按 uid 检查过
+    bool started = false;
+    quint32 pid = 0;
+    Mode mode = EventsMode;
+    QString filterText;
+    while (!started) {
+        pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, authenticated ? 30000 : 5000) <= 0)
+            return;
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+            return;
+        in.append(buf, size_t(n));
+        while (!started && in.next(type, payload)) {
+            Reader r(payload);
+            if (type == Auth) {
+                std::string_view token = r.bytes();
+                if (!m_unixSocket && !(r.ok && tokenMatches(m_token, token))) {
+                    finish("Error: Agent rejected the connection: wrong token.");
+                    return;
+                }
+                authenticated = true;
+                continue;
+            }
+            if (!authenticated) {
+                finish("Error: Agent rejected the connection: TCP connections must authenticate with a token.");
+                return;
+            }
+            if (type != Start)
+                continue;
+            pid = r.u32();
+            mode = Mode(r.u8());
+            std::string_view filter = r.bytes();
+            if (!r.ok || mode > AutoMode)
+                return;
+            filterText = QString::fromUtf8(filter.data(), int(filter.size()));
+            started = true;
+        }
+        if (in.corrupt())
+            return;
+    }
+
+    SyscallFilter filter;
+    QString filterError;
+    if (!SyscallFilter::compile(filterText, filter, &filterError)) {
+        finish(QString("Invalid trace filter: %1").arg(filterError));
+        return;
+    }
+    fprintf(stderr, "agent: tracing PID %u, mode %s%s%s\n", pid, qPrintable(modeName(mode)),
+            filterText.isEmpty() ? "" : ", filter ", qPrintable(filterText));
+
+    // --- 追踪器在自己的线程里运行，本线程负责取事件、编码和写 socket ---
+    Arena arena;
+    StringTable strings(arena);
+    EventQueue queue;
+    TracerMetrics metrics;
+    Tracer tracer;
+    tracer.setMetrics(&metrics);
+    tracer.setEventSink(&queue, &strings);
+    tracer.setFilter(filter);
+    QString finishMessage;
+    std::atomic<bool> done{false};
+    // 没有事件循环，直接在追踪线程上调用
+    QObject::connect(&tracer, &Tracer::finished, [&finishMessage](const QString &message) { finishMessage = message; });
+    std::thread worker([&]() {
+        tracer.start(pid);
+        done.store(true);
+    });
+
+    std::vector<SyscallEvent> batch(kBatchEvents);
+    std::string encoded;
+    quint32 sentStrings = 1; // id 0 是空字符串，两端都有
+    quint64 summarized = 0;
+    quint64 lastSummaryNs = monotonicNs();
+    quint64 lastStatusNs = 0;
+    bool connected = true;
+
+    for (;;) {
+        const bool backlog = m_out.size() - m_outSent > kBacklogLimit;
+        pollfd pfd = { fd, short(POLLIN | (m_outSent < m_out.size() ? POLLOUT : 0)), 0 };
+        poll(&pfd, 1, backlog || queue.size() == 0 ? 20 : 0);
+
+        // --- GUI 的请求 ---
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                connected = false;
+            } else if (n > 0) {
+                in.append(buf, size_t(n));
+                while (in.next(type, payload)) {
+                    Reader r(payload);
+                    if (type == SetMode) {
+                        quint8 m = r.u8();
+                        if (r.ok && m <= AutoMode) {
+                            mode = Mode(m);
+                            fprintf(stderr, "agent: mode %s\n", qPrintable(modeName(mode)));
+                        }
+                    } else if (type == Stop) {
+                        tracer.stop();
+                    }
+                }
+                connected = !in.corrupt();
+            }
+        }
+        if (!connected || !flush(fd)) {
+            fprintf(stderr, "agent: GUI disconnected, detaching\n");
+            tracer.stop();
+            worker.join();
+            return;
+        }
+
+        // --- 从追踪器取事件：积压时 Events 模式暂停取，Auto 模式改为合计 ---
+        const bool nowBacklogged = m_out.size() - m_outSent > kBacklogLimit;
+        const bool summarize = mode == SummaryMode || (mode == AutoMode && nowBacklogged);
+        if (!(mode == EventsMode && nowBacklogged)) {
+            size_t n;
+            int batches = 0;
+            while (batches++ < 16 && (n = queue.pop(batch.data(), batch.size())) > 0) {
+                if (summarize) {
+                    for (size_t i = 0; i < n; ++i) {
+                        const SyscallEvent &e = batch[i];
+                        const qint64 second = qint64((e.ts + e.duration) / 1000000000ULL);
+                        SummaryEntry &s = m_pendingSummary[(quint64(second) << 16) | quint16(e.syscall)];
+                        s.second = second;
+                        s.syscall = e.syscall;
+                        s.count++;
+                        if (e.ret < 0 && e.ret >= -4095)
+                            s.errors++;
+                        s.durationNs += e.duration;
+                    }
+                    summarized += n;
+                    continue;
+                }
+                // 事件引用的字符串在入队之前就已驻留，先把新字符串发出去
+                const quint32 stringCount = strings.size();
+                if (stringCount > sentStrings) {
+                    size_t f = beginFrame(m_out, Strings);
+                    putU32(m_out, sentStrings);
+                    putU32(m_out, stringCount - sentStrings);
+                    for (quint32 id = sentStrings; id < stringCount; ++id)
+                        putBytes(m_out, strings.view(id));
+                    endFrame(m_out, f);
+                    sentStrings = stringCount;
+                }
+                encoded.clear();
+                tracecodec::encodeColumns(batch.data(), quint32(n), encoded);
+                size_t f = beginFrame(m_out, Events);
+                putU32(m_out, quint32(n));
+                m_out.append(encoded);
+                endFrame(m_out, f);
+                if (m_out.size() - m_outSent > kBacklogLimit)
+                    break;
+            }
+        }
+
+        const quint64 now = monotonicNs();
+        const bool finished = done.load() && queue.size() == 0;
+        if (finished || now - lastSummaryNs >= quint64(kSummaryIntervalMs) * 1000000ULL) {
+            appendSummaries();
+            lastSummaryNs = now;
+        }
+        if (finished || now - lastStatusNs >= quint64(kStatusIntervalMs) * 1000000ULL) {
+            size_t f = beginFrame(m_out, Status);
+            for (quint64 v : { metrics.stops.load(), metrics.waitNs.load(), metrics.processNs.load(),
+                               metrics.emitted.load(), metrics.dropped.load(), metrics.filtered.load(),
+                               summarized, m_bytesSent, quint64(m_out.size() - m_outSent) })
+                putU64(m_out, v);
+            endFrame(m_out, f);
+            lastStatusNs = now;
+        }
+        if (finished) {
+            finish(finishMessage);
+            break;
+        }
+    }
+    worker.join();
+}
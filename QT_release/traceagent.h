@@ -0,0 +1,51 @@
+#ifndef TRACEAGENT_H
+#define TRACEAGENT_H
+
+#include <QString>
+#include <QtGlobal>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include "agentprotocol.h"
+
+// 无界面的追踪代理：在监听 socket 上逐个接受 GUI 的连接，每个连接是一次追踪会话。
+// 追踪器在代理进程内运行（需要 ptrace 权限），追踪过滤表达式在这里求值；
+// 事件按批编码后写给 GUI，写不出去的部分留在发送缓冲里，超过上限即视为积压：
+// Events 模式下暂停从追踪器取事件，Auto 模式下改发按秒合计，Summary 模式始终只发合计。
+class TraceAgent
+{
+public:
+    static constexpr size_t kBatchEvents = agentprotocol::kMaxBatchEvents;
+    static constexpr size_t kBacklogLimit = 4u << 20;     // 发送缓冲超过 4 MB 视为积压
+    static constexpr int kSummaryIntervalMs = 250;        // 合计帧的发送间隔
+    static constexpr int kStatusIntervalMs = 1000;
+
+    // unixSocket 时只接受 root、代理自己和 allowedUid（通常是 sudo 之前的用户）的连接；
+    // TCP 没有对端身份，连接必须先发出与 token 一致的 Auth 帧，token 为空时拒绝全部 TCP 连接
+    TraceAgent(int listenFd, bool unixSocket, uid_t allowedUid, const std::string &token = std::string())
+        : m_listenFd(listenFd), m_unixSocket(unixSocket), m_allowedUid(allowedUid), m_token(token) {}
+
+    // TCP 模式的令牌文件：已存在时按 agentprotocol::readToken 的要求读出，
+    // 不存在时生成随机令牌，以 0600 写入并交给 owner，客户端在地址后加 ,token=path 使用
+    static bool loadOrCreateToken(const std::string &path, uid_t owner, std::string &token, QString *error);
+
+    // 依次服务每个连接，直到 accept 失败
+    int run();
+
+private:
+    void serve(int fd);
+    bool flush(int fd);
+    void appendSummaries();
+
+    int m_listenFd;
+    bool m_unixSocket;
+    uid_t m_allowedUid;
+    std::string m_token;
+    std::string m_out;        // 已编码、等待写入 socket 的字节
+    size_t m_outSent = 0;
+    quint64 m_bytesSent = 0;
+    // (秒 << 16 | syscall) -> 合计，只保存还没发出去的部分
+    std::map<quint64, agentprotocol::SummaryEntry> m_pendingSummary;
+};
+
+#endif // TRACEAGENT_H
@@ -0,0 +1,352 @@
+#include "tracecodec.h"
+
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+namespace tracecodec {
+
+// ---------------- 编码 ----------------
+
+static inline void putVarint(std::string &out, quint64 v)
+{
+    char buf[10];
+    int n = 0;
+    while (v >= 0x80) {
+        buf[n++] = char(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = char(v);
+    out.append(buf, size_t(n));
+}
+
+static inline quint64 zigzag(qint64 v)
+{
+    return (quint64(v) << 1) ^ quint64(v >> 63);
+}
+
+// 列以 u32 长度开头，先占位，写完再回填
+static size_t beginColumn(std::string &out)
+{
+    size_t at = out.size();
+    out.append(4, '\0');
+    return at;
+}
+
+static void endColumn(std::string &out, size_t at)
+{
+    quint32 len = quint32(out.size() - at - 4);
+    memcpy(&out[at], &len, sizeof(len));
+}
+
+template <typename Get>
+static void putDictColumn(std::string &out, quint32 count, Get get)
+{
+    std::unordered_map<quint64, quint32> index;
+    std::vector<quint64> dict;
+    std::vector<quint32> codes(count);
+    for (quint32 i = 0; i < count; ++i) {
+        quint64 v = get(i);
+        auto it = index.find(v);
+        if (it == index.end()) {
+            it = index.emplace(v, quint32(dict.size())).first;
+            dict.push_back(v);
+        }
+        codes[i] = it->second;
+    }
+
+    size_t at = beginColumn(out);
+    putVarint(out, dict.size());
+    for (quint64 v : dict)
+        putVarint(out, v);
+    if (dict.size() <= 256) {
+        size_t base = out.size();
+        out.resize(base + count);
+        for (quint32 i = 0; i < count; ++i)
+            out[base + i] = char(codes[i]);
+    } else {
+        for (quint32 c : codes)
+            putVarint(out, c);
+    }
+    endColumn(out, at);
+}
+
+void encodeColumns(const SyscallEvent *events, quint32 count, std::string &out)
+{
+    // 大部分字段只占 1~2 字节，预留一个保守的上限
+    out.reserve(out.size() + size_t(count) * 12 + 64);
+    if (count == 0)
+        return;
+
+    size_t at = beginColumn(out);
+    out.append(reinterpret_cast<const char*>(&events[0].ts), sizeof(quint64));
+    qint64 prevDelta = 0;
+    for (quint32 i = 1; i < count; ++i) {
+        qint64 delta = qint64(events[i].ts - events[i - 1].ts);
+        putVarint(out, zigzag(delta - prevDelta));
+        prevDelta = delta;
+    }
+    endColumn(out, at);
+
+    at = beginColumn(out);
+    for (quint32 i = 0; i < count; ++i)
+        putVarint(out, events[i].duration);
+    endColumn(out, at);
+
+    at = beginColumn(out);
+    for (quint32 i = 0; i < count; ++i)
+        putVarint(out, zigzag(events[i].ret));
+    endColumn(out, at);
+
+    putDictColumn(out, count, [events](quint32 i) { return quint64(events[i].pid); });
+    putDictColumn(out, count, [events](quint32 i) { return quint64(events[i].tid); });
+    putDictColumn(out, count, [events](quint32 i) { return quint64(events[i].commId); });
+    putDictColumn(out, count, [events](quint32 i) { return quint64(quint16(events[i].syscall)); });
+
+    at = beginColumn(out);
+    for (quint32 i = 0; i < count; ++i)
+        putVarint(out, events[i].pathId);
+    endColumn(out, at);
+
+    at = beginColumn(out);
+    for (quint32 i = 0; i < count; ++i)
+        putVarint(out, events[i].flags);
+    endColumn(out, at);
+}
+
+// ---------------- 解码 ----------------
+
+namespace {
+
+// 一列数据的游标；越界后 ok 置为 false，之后读到的都是 0
+struct Cursor {
+    const unsigned char *p;
+    const unsigned char *end;
+    bool ok = true;
+
+    inline quint64 varint() {
+        // 单字节是最常见的情况
+        if (p < end && *p < 0x80)
+            return *p++;
+        quint64 v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) {
+                ok = false;
+                return 0;
+            }
+            unsigned char b = *p++;
+            v |= quint64(b & 0x7f) << shift;
+            if (b < 0x80)
+                return v;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+inline qint64 unzigzag(quint64 v)
+{
+    return qint64(v >> 1) ^ -qint64(v & 1);
+}
+
+} // namespace
+
+static bool nextColumn(const char *&data, const char *end, Cursor &col)
+{
+    quint32 len;
+    if (end - data < 4)
+        return false;
+    memcpy(&len, data, sizeof(len));
+    data += 4;
+    if (quint64(end - data) < len)
+        return false;
+    col.p = reinterpret_cast<const unsigned char*>(data);
+    col.end = col.p + len;
+    col.ok = true;
+    data += len;
+    return true;
+}
+
+template <typename Set>
+static bool getDictColumn(const char *&data, const char *end, quint32 count, Set set)
+{
+    Cursor col;
+    if (!nextColumn(data, end, col))
+        return false;
+    quint64 size = col.varint();
+    if (!col.ok || size > count)
+        return false;
+    std::vector<quint64> dict(size);
+    for (quint64 &v : dict)
+        v = col.varint();
+    if (!col.ok)
+        return false;
+
+    if (size <= 256) {
+        if (quint64(col.end - col.p) != count)
+            return false;
+        for (quint32 i = 0; i < count; ++i) {
+            unsigned char c = col.p[i];
+            if (c >= size)
+                return false;
+            set(i, dict[c]);
+        }
+    } else {
+        for (quint32 i = 0; i < count; ++i) {
+            quint64 c = col.varint();
+            if (!col.ok || c >= size)
+                return false;
+            set(i, dict[c]);
+        }
+    }
+    return true;
+}
+
+// 行式和列式解码共用的逻辑，Sink 决定每个字段写到哪里
+template <typename Sink>
+static bool decodeInto(const char *data, size_t size, quint32 count, Sink &sink)
+{
+    const char *end = data + size;
+    if (count == 0)
+        return size == 0;
+
+    Cursor col;
+    if (!nextColumn(data, end, col) || col.end - col.p < 8)
+        return false;
+    quint64 ts;
+    memcpy(&ts, col.p, sizeof(ts));
+    col.p += 8;
+    qint64 delta = 0;
+    for (quint32 i = 0; i < count; ++i) {
+        if (i > 0) {
+            delta += unzigzag(col.varint());
+            ts += quint64(delta);
+        }
+        sink.ts(i, ts);
+    }
+    if (!col.ok)
+        return false;
+
+    if (!nextColumn(data, end, col))
+        return false;
+    for (quint32 i = 0; i < count; ++i)
+        sink.duration(i, col.varint());
+    if (!col.ok)
+        return false;
+
+    if (!nextColumn(data, end, col))
+        return false;
+    for (quint32 i = 0; i < count; ++i)
+        sink.ret(i, unzigzag(col.varint()));
+    if (!col.ok)
+        return false;
+
+    if (!getDictColumn(data, end, count, [&sink](quint32 i, quint64 v) { sink.pid(i, quint32(v)); })
+        || !getDictColumn(data, end, count, [&sink](quint32 i, quint64 v) { sink.tid(i, quint32(v)); })
+        || !getDictColumn(data, end, count, [&sink](quint32 i, quint64 v) { sink.commId(i, quint32(v)); })
+        || !getDictColumn(data, end, count, [&sink](quint32 i, quint64 v) { sink.syscall(i, qint16(quint16(v))); }))
+        return false;
+
+    if (!nextColumn(data, end, col))
+        return false;
+    for (quint32 i = 0; i < count; ++i)
+        sink.pathId(i, quint32(col.varint()));
+    if (!col.ok)
+        return false;
+
+    if (!nextColumn(data, end, col))
+        return false;
+    for (quint32 i = 0; i < count; ++i)
+        sink.flags(i, quint16(col.varint()));
+    return col.ok && data == end;
+}
+
+namespace {
+
+struct RowSink {
+    SyscallEvent *out;
+    void ts(quint32 i, quint64 v) { out[i].ts = v; out[i].argRef = 0; }
+    void duration(quint32 i, quint64 v) { out[i].duration = v; }
+    void ret(quint32 i, qint64 v) { out[i].ret = v; }
+    void pid(quint32 i, quint32 v) { out[i].pid = v; }
+    void tid(quint32 i, quint32 v) { out[i].tid = v; }
+    void commId(quint32 i, quint32 v) { out[i].commId = v; }
+    void syscall(quint32 i, qint16 v) { out[i].syscall = v; }
+    void pathId(quint32 i, quint32 v) { out[i].pathId = v; }
+    void flags(quint32 i, quint16 v) { out[i].flags = v; }
+};
+
+struct ColumnSink {
+    ColumnBatch &b;
+    void ts(quint32 i, quint64 v) { b.ts[i] = v; }
+    void duration(quint32 i, quint64 v) { b.duration[i] = v; }
+    void ret(quint32 i, qint64 v) { b.ret[i] = v; }
+    void pid(quint32 i, quint32 v) { b.pid[i] = v; }
+    void tid(quint32 i, quint32 v) { b.tid[i] = v; }
+    void commId(quint32 i, quint32 v) { b.commId[i] = v; }
+    void syscall(quint32 i, qint16 v) { b.syscall[i] = v; }
+    void pathId(quint32 i, quint32 v) { b.pathId[i] = v; }
+    void flags(quint32 i, quint16 v) { b.flags[i] = v; }
+};
+
+} // namespace
+
+bool decodeColumns(const char *data, size_t size, quint32 count, SyscallEvent *out)
+{
+    RowSink sink{ out };
+    return decodeInto(data, size, count, sink);
+}
+
+bool decodeColumns(const char *data, size_t size, quint32 count, ColumnBatch &batch)
+{
+    batch.resize(count);
+    ColumnSink sink{ batch };
+    return decodeInto(data, size, count, sink);
+}
+
+// ---------------- ColumnBatch ----------------
+
+void ColumnBatch::resize(quint32 n)
+{
+    count = n;
+    ts.resize(n);
+    duration.resize(n);
+    ret.resize(n);
+    pid.resize(n);
+    tid.resize(n);
+    commId.resize(n);
+    pathId.resize(n);
+    syscall.resize(n);
+    flags.resize(n);
+}
+
+void ColumnBatch::set(quint32 i, const SyscallEvent &e)
+{
+    ts[i] = e.ts;
+    duration[i] = e.duration;
+    ret[i] = e.ret;
+    pid[i] = e.pid;
+    tid[i] = e.tid;
+    commId[i] = e.commId;
+    pathId[i] = e.pathId;
+    syscall[i] = e.syscall;
+    flags[i] = e.flags;
+}
+
+SyscallEvent ColumnBatch::event(quint32 i) const
+{
+    SyscallEvent e;
+    e.ts = ts[i];
+    e.duration = duration[i];
+    e.ret = ret[i];
+    e.pid = pid[i];
+    e.tid = tid[i];
+    e.commId = commId[i];
+    e.pathId = pathId[i];
+    e.argRef = 0;
+    e.syscall = syscall[i];
+    e.flags = flags[i];
+    return e;
+}
+
+} // namespace tracecodec
@@ -0,0 +1,51 @@
+#ifndef TRACECODEC_H
+#define TRACECODEC_H
+
+#include <QtGlobal>
+#include <string>
+#include <vector>
+#include "syscallevent.h"
+
+// 追踪文件块的列式编码。一块事件按字段拆成若干列，每列前有 u32 字节数，列内：
+//   ts        第一个时间戳原样 8 字节，之后是二阶差分（delta-of-delta）的 zigzag varint
+//   duration  varint
+//   ret       zigzag varint
+//   pid/tid/commId/syscall  字典编码：varint 字典大小 + 字典值（varint）+ 每个事件的下标
+//                           （字典不超过 256 项时每个下标 1 字节，否则 varint）
+//   pathId/flags            varint
+// argRef 只在会话内有效，不写入。
+namespace tracecodec {
+
+// 按列解码的一块事件，供查询按列过滤后再只物化匹配的行
+struct ColumnBatch {
+    quint32 count = 0;
+    std::vector<quint64> ts;
+    std::vector<quint64> duration;
+    std::vector<qint64> ret;
+    std::vector<quint32> pid;
+    std::vector<quint32> tid;
+    std::vector<quint32> commId;
+    std::vector<quint32> pathId;
+    std::vector<qint16> syscall;
+    std::vector<quint16> flags;
+
+    void resize(quint32 n);
+    void set(quint32 i, const SyscallEvent &e);
+    SyscallEvent event(quint32 i) const;
+};
+
+// 每个事件在 ts 之外的八列里各至少占 1 字节，ts 列的差分也至少 1 字节：
+// 数据不足 count * kMinBytesPerEvent 字节时不可能是 count 个事件，解码前即可拒绝，不必先按 count 分配
+constexpr size_t kMinBytesPerEvent = 9;
+
+// 追加编码结果到 out
+void encodeColumns(const SyscallEvent *events, quint32 count, std::string &out);
+
+// 解码 count 个事件到 out；数据损坏（越界、列长度不符）时返回 false
+bool decodeColumns(const char *data, size_t size, quint32 count, SyscallEvent *out);
+// 同上，但按列解码到 batch
+bool decodeColumns(const char *data, size_t size, quint32 count, ColumnBatch &batch);
+
+} // namespace tracecodec
+
+#endif // TRACECODEC_H
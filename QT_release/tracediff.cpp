@@ -0,0 +1,259 @@
+#include "tracediff.h"
+#include "tracefile.h"
+#include "columnkernels.h"
+#include "syscall_map.h"
+
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+bool TimeWindow::parse(const QString &text, TimeWindow &out)
+{
+    int colon = text.indexOf(':');
+    if (colon < 0)
+        return false;
+    QString start = text.left(colon).trimmed();
+    QString end = text.mid(colon + 1).trimmed();
+    bool ok = true;
+    out.startSec = start.isEmpty() ? 0.0 : start.toDouble(&ok);
+    if (!ok)
+        return false;
+    out.endSec = end.isEmpty() ? -1.0 : end.toDouble(&ok);
+    return ok && (out.endSec < 0 || out.endSec > out.startSec);
+}
+
+bool buildProfile(const QString &path, const TimeWindow &window, TraceProfile &out, QString *error)
+{
+    out = TraceProfile();
+    out.source = path;
+
+    TraceReader reader;
+    if (!reader.open(path)) {
+        if (error)
+            *error = reader.errorString();
+        return false;
+    }
+
+    // 按列解码，时间窗口筛选和按 syscall 的汇总都是整列扫描，见 columnkernels.h
+    tracecodec::ColumnBatch batch;
+    std::vector<quint32> selection;
+    std::vector<quint16> buckets;
+    std::vector<columnkernels::Aggregate> totals(columnkernels::kMaxKeys);
+    std::vector<std::unique_ptr<LatencyHistogram>> latency(columnkernels::kMaxKeys);
+    quint64 from = 0;
+    quint64 to = ~0ULL;
+    bool first = true;
+
+    for (size_t c = 0; c < reader.chunkCount(); ++c) {
+        if (!reader.readChunk(c, batch, error))
+            return false;
+        if (batch.count == 0)
+            continue;
+        if (first) {
+            // 时间窗口相对于整份追踪的第一个事件
+            quint64 origin = batch.ts[0];
+            from = origin + quint64(window.startSec * 1e9);
+            if (window.endSec >= 0)
+                to = origin + quint64(window.endSec * 1e9);
+            first = false;
+        }
+
+        selection.resize(batch.count);
+        quint32 n = columnkernels::selectRange(batch.ts.data(), batch.count, from, to, selection.data());
+        if (n == 0)
+            continue;
+        // 整块都在窗口内时不经过 selection，内核按连续内存读
+        const quint32 *rows = n == batch.count ? nullptr : selection.data();
+        auto row = [rows](quint32 r) { return rows ? rows[r] : r; };
+
+        if (out.events == 0)
+            out.firstTs = batch.ts[row(0)];
+        for (quint32 r = 0; r < n; ++r) {
+            quint32 i = row(r);
+            out.lastTs = qMax(out.lastTs, batch.ts[i] + batch.duration[i]);
+        }
+        out.events += n;
+
+        columnkernels::aggregateByKey(batch.syscall.data(), batch.duration.data(), batch.ret.data(),
+                                      rows, n, totals.data());
+        buckets.resize(n);
+        columnkernels::latencyBuckets(batch.duration.data(), rows, n, buckets.data());
+        for (quint32 r = 0; r < n; ++r) {
+            int key = batch.syscall[row(r)];
+            if (key < 0 || key >= columnkernels::kMaxKeys)
+                continue;
+            std::unique_ptr<LatencyHistogram> &h = latency[size_t(key)];
+            if (!h)
+                h.reset(new LatencyHistogram);
+            h->addBucket(buckets[r]);
+        }
+    }
+
+    for (int key = 0; key < columnkernels::kMaxKeys; ++key) {
+        const columnkernels::Aggregate &a = totals[size_t(key)];
+        if (a.count == 0)
+            continue;
+        SyscallProfile &p = out.syscalls[key];
+        p.count = a.count;
+        p.errors = a.errors;
+        p.durationNs = a.sum;
+        p.latency = *latency[size_t(key)];
+    }
+
+    // 给定了完整窗口时按窗口长度算速率，否则按实际事件跨度
+    if (window.endSec >= 0)
+        out.seconds = window.endSec - window.startSec;
+    else if (out.events > 0)
+        out.seconds = (out.lastTs - out.firstTs) / 1e9;
+    out.seconds = qMax(out.seconds, 0.001);
+    return true;
+}
+
+bool buildProfiles(const QString &pathA, const TimeWindow &windowA,
+                   const QString &pathB, const TimeWindow &windowB,
+                   TraceProfile &a, TraceProfile &b, QString *error)
+{
+    QString errorA;
+    QString errorB;
+    bool okA = false;
+    // 两份输入互不相关，A 在新线程里读，B 在当前线程里读
+    std::thread worker([&] { okA = buildProfile(pathA, windowA, a, &errorA); });
+    bool okB = buildProfile(pathB, windowB, b, &errorB);
+    worker.join();
+
+    if (error)
+        *error = !okA ? errorA : errorB;
+    return okA && okB;
+}
+
+TraceProfile groupByCategory(const TraceProfile &profile)
+{
+    TraceProfile out = profile;
+    out.byCategory = true;
+    out.syscalls.clear();
+    for (auto it = profile.syscalls.constBegin(); it != profile.syscalls.constEnd(); ++it) {
+        SyscallProfile &p = out.syscalls[getSyscallCategory(it.key())];
+        p.count += it.value().count;
+        p.errors += it.value().errors;
+        p.durationNs += it.value().durationNs;
+        p.latency.merge(it.value().latency);
+    }
+    return out;
+}
+
+QString profileKeyName(const TraceProfile &profile, int key)
+{
+    return profile.byCategory ? getSyscallCategoryName(key) : getSyscallName(key);
+}
+
+QVector<DiffRow> diffProfiles(const TraceProfile &a, const TraceProfile &b)
+{
+    QList<int> keys = a.syscalls.keys();
+    for (int key : b.syscalls.keys()) {
+        if (!a.syscalls.contains(key))
+            keys.append(key);
+    }
+
+    const SyscallProfile empty;
+    QVector<DiffRow> rows;
+    rows.reserve(keys.size());
+    for (int key : keys) {
+        auto ia = a.syscalls.constFind(key);
+        auto ib = b.syscalls.constFind(key);
+        const SyscallProfile &pa = ia != a.syscalls.constEnd() ? ia.value() : empty;
+        const SyscallProfile &pb = ib != b.syscalls.constEnd() ? ib.value() : empty;
+
+        DiffRow r;
+        r.syscall = key;
+        r.countA = pa.count;
+        r.countB = pb.count;
+        r.rateA = pa.count / a.seconds;
+        r.rateB = pb.count / b.seconds;
+        r.p50A = pa.latency.percentile(0.50);
+        r.p50B = pb.latency.percentile(0.50);
+        r.p90A = pa.latency.percentile(0.90);
+        r.p90B = pb.latency.percentile(0.90);
+        r.p99A = pa.latency.percentile(0.99);
+        r.p99B = pb.latency.percentile(0.99);
+        r.errRateA = pa.count ? double(pa.errors) / pa.count : 0.0;
+        r.errRateB = pb.count ? double(pb.errors) / pb.count : 0.0;
+
+        // 速率：两个泊松计数之差，方差 = cA/tA² + cB/tB²
+        double rateVar = pa.count / (a.seconds * a.seconds) + pb.count / (b.seconds * b.seconds);
+        r.rateZ = rateVar > 0 ? (r.rateB - r.rateA) / std::sqrt(rateVar) : 0.0;
+
+        // 失败比例：合并比例下的两比例 z 检验
+        if (pa.count > 0 && pb.count > 0) {
+            double pooled = double(pa.errors + pb.errors) / double(pa.count + pb.count);
+            double errVar = pooled * (1 - pooled) * (1.0 / pa.count + 1.0 / pb.count);
+            r.errZ = errVar > 0 ? (r.errRateB - r.errRateA) / std::sqrt(errVar) : 0.0;
+        }
+
+        QStringList hints;
+        const double kZ = 3.0;        // 约 99.7% 置信度
+        const quint64 kMinSamples = 30;
+        if (pa.count == 0)
+            hints << "new";
+        else if (pb.count == 0)
+            hints << "gone";
+        else if (std::fabs(r.rateZ) >= kZ)
+            hints << (r.rateZ > 0 ? "rate ↑" : "rate ↓");
+        // 直方图桶的相对误差约 12.5%，变化超过 25% 才提示
+        if (pa.count >= kMinSamples && pb.count >= kMinSamples && r.p90A > 0) {
+            double ratio = double(r.p90B) / double(r.p90A);
+            if (ratio >= 1.25)
+                hints << "p90 slower";
+            else if (ratio <= 0.8)
+                hints << "p90 faster";
+        }
+        if (std::fabs(r.errZ) >= kZ)
+            hints << (r.errZ > 0 ? "errors ↑" : "errors ↓");
+        r.hint = hints.join(", ");
+        rows.append(r);
+    }
+
+    std::sort(rows.begin(), rows.end(), [](const DiffRow &x, const DiffRow &y) {
+        return std::fabs(x.rateZ) > std::fabs(y.rateZ);
+    });
+    return rows;
+}
+
+// 紧凑的耗时格式，表格对齐用
+static QString compactDuration(quint64 ns)
+{
+    if (ns < 1000)
+        return QString("%1ns").arg(ns);
+    if (ns < 1000000)
+        return QString("%1us").arg(ns / 1e3, 0, 'f', 1);
+    if (ns < 1000000000)
+        return QString("%1ms").arg(ns / 1e6, 0, 'f', 1);
+    return QString("%1s").arg(ns / 1e9, 0, 'f', 2);
+}
+
+QString formatDiffTable(const TraceProfile &a, const TraceProfile &b, const QVector<DiffRow> &rows)
+{
+    QStringList lines;
+    lines << QString("A: %1  (%2 events, %3 s)").arg(a.source).arg(a.events).arg(a.seconds, 0, 'f', 2);
+    lines << QString("B: %1  (%2 events, %3 s)").arg(b.source).arg(b.events).arg(b.seconds, 0, 'f', 2);
+    lines << QString();
+    lines << QString("%1 %2 %3 %4 %5 %6 %7  %8")
+                 .arg(QString(a.byCategory ? "category" : "syscall"), -20)
+                 .arg(QString("rate A/s"), 11).arg(QString("rate B/s"), 11).arg(QString("delta"), 8)
+                 .arg(QString("p90 A"), 9).arg(QString("p90 B"), 9)
+                 .arg(QString("err% A/B"), 13)
+                 .arg(QString("hint"));
+    for (const DiffRow &r : rows) {
+        QString delta = r.rateA > 0 ? QString("%1%").arg(100.0 * (r.rateB - r.rateA) / r.rateA, 0, 'f', 1)
+                                    : QString("-");
+        lines << QString("%1 %2 %3 %4 %5 %6 %7  %8")
+                     .arg(profileKeyName(a, r.syscall), -20)
+                     .arg(r.rateA, 11, 'f', 1).arg(r.rateB, 11, 'f', 1).arg(delta, 8)
+                     .arg(compactDuration(r.p90A), 9).arg(compactDuration(r.p90B), 9)
+                     .arg(QString("%1/%2").arg(100 * r.errRateA, 0, 'f', 1).arg(100 * r.errRateB, 0, 'f', 1), 13)
+                     .arg(r.hint);
+    }
+    return lines.join('\n') + '\n';
+}
@@ -0,0 +1,68 @@
+#ifndef TRACEDIFF_H
+#define TRACEDIFF_H
+
+#include <QMap>
+#include <QString>
+#include <QVector>
+#include "latencyhistogram.h"
+
+// 两份追踪（或同一份追踪的两个时间窗口）的系统调用画像对比
+
+// 相对于追踪中第一个事件的时间窗口，单位秒；endSec < 0 表示到结尾
+struct TimeWindow {
+    double startSec = 0.0;
+    double endSec = -1.0;
+    // 解析 "start:end"，两端都可以省略，例如 "10:" 或 ":30"
+    static bool parse(const QString &text, TimeWindow &out);
+};
+
+struct SyscallProfile {
+    quint64 count = 0;
+    quint64 errors = 0;
+    quint64 durationNs = 0;
+    LatencyHistogram latency;
+};
+
+struct TraceProfile {
+    QString source;
+    quint64 events = 0;
+    quint64 firstTs = 0;
+    quint64 lastTs = 0;
+    double seconds = 0.0;            // 用于计算速率的时间跨度
+    bool byCategory = false;         // syscalls 的 key 是分类号（见 syscall_map.h）而不是 syscall 号
+    QMap<int, SyscallProfile> syscalls;
+};
+
+struct DiffRow {
+    int syscall = -1;                // 按分类汇总时是分类号
+    quint64 countA = 0, countB = 0;
+    double rateA = 0, rateB = 0;     // 次/秒
+    quint64 p50A = 0, p50B = 0;
+    quint64 p90A = 0, p90B = 0;
+    quint64 p99A = 0, p99B = 0;
+    double errRateA = 0, errRateB = 0; // 失败比例 0~1
+    double rateZ = 0;                // 速率差异的 z 值（泊松近似）
+    double errZ = 0;                 // 失败比例差异的 z 值（两比例检验）
+    QString hint;                    // 显著性提示，例如 "rate ↑, p90 slower"
+};
+
+// 流式读取一份追踪文件并汇总成画像，内存占用与文件大小无关
+bool buildProfile(const QString &path, const TimeWindow &window, TraceProfile &out, QString *error);
+
+// 两个输入在两个线程里并行汇总
+bool buildProfiles(const QString &pathA, const TimeWindow &windowA,
+                   const QString &pathB, const TimeWindow &windowB,
+                   TraceProfile &a, TraceProfile &b, QString *error);
+
+// 按分类合并各 syscall 的计数与延迟直方图
+TraceProfile groupByCategory(const TraceProfile &profile);
+// 画像中 key 的显示名：syscall 名或分类名
+QString profileKeyName(const TraceProfile &profile, int key);
+
+// 按速率变化的显著程度降序排列
+QVector<DiffRow> diffProfiles(const TraceProfile &a, const TraceProfile &b);
+
+// CLI 输出用的纯文本表格
+QString formatDiffTable(const TraceProfile &a, const TraceProfile &b, const QVector<DiffRow> &rows);
+
+#endif // TRACEDIFF_H
@@ -0,0 +1,446 @@
+#include "tracefile.h"
+#include "eventstore.h"
+#include "tracecodec.h"
+
+#include <QByteArray>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <time.h>
+
+using namespace tracefile;
+
+// ---------------- TraceWriter ----------------
+
+TraceWriter::~TraceWriter()
+{
+    stopWorkers();
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+bool TraceWriter::writeAll(const void *data, size_t size)
+{
+    const char *p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::write(m_fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            m_error = QString("write failed: %1").arg(strerror(errno));
+            return false;
+        }
+        p += n;
+        size -= size_t(n);
+        m_offset += quint64(n);
+    }
+    return true;
+}
+
+bool TraceWriter::open(const QString &path, const Options &options)
+{
+    m_fd = ::open(path.toLocal8Bit().constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        m_error = QString("cannot create %1: %2").arg(path).arg(strerror(errno));
+        return false;
+    }
+    m_offset = 0;
+    m_options = options;
+    m_pending.clear();
+    m_pending.reserve(kChunkEvents);
+    m_index.clear();
+
+    int threads = options.threads > 0 ? options.threads
+                                      : int(std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+    m_stopping = false;
+    for (int i = 0; i < threads; ++i)
+        m_workers.emplace_back(&TraceWriter::workerLoop, this);
+
+    quint32 header[2] = { kVersion, 0 };
+    return writeAll(kMagic, sizeof(kMagic)) && writeAll(header, sizeof(header));
+}
+
+void TraceWriter::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobReady.notify_all();
+    for (std::thread &t : m_workers)
+        t.join();
+    m_workers.clear();
+    m_queued.clear();
+    m_todo.clear();
+}
+
+void TraceWriter::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_jobReady.wait(lock, [this] { return m_stopping || !m_todo.empty(); });
+        if (m_todo.empty())
+            return;
+        std::shared_ptr<Job> job = m_todo.front();
+        m_todo.pop_front();
+        lock.unlock();
+        encode(*job);
+        lock.lock();
+        job->done = true;
+        m_jobDone.notify_all();
+    }
+}
+
+void TraceWriter::encode(Job &job) const
+{
+    quint32 count = quint32(job.events.size());
+    for (const SyscallEvent &e : job.events)
+        job.summary.add(e);
+    if (!m_options.columnar) {
+        job.encoding = RawEncoding;
+        job.payload.assign(reinterpret_cast<const char*>(job.events.data()), count * sizeof(SyscallEvent));
+        return;
+    }
+    job.encoding = ColumnarEncoding;
+    tracecodec::encodeColumns(job.events.data(), count, job.payload);
+    if (m_options.compress) {
+        // 压缩级别 1：列式编码已经去掉了大部分冗余，更高的级别收益很小
+        QByteArray packed = qCompress(reinterpret_cast<const uchar*>(job.payload.data()), int(job.payload.size()), 1);
+        if (size_t(packed.size()) < job.payload.size()) {
+            job.payload.assign(packed.constData(), size_t(packed.size()));
+            job.encoding |= CompressedFlag;
+        }
+    }
+    // 事件本身不再需要，尽早释放
+    std::vector<SyscallEvent>().swap(job.events);
+}
+
+bool TraceWriter::writeFinished(size_t maxQueued)
+{
+    for (;;) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_queued.empty())
+                return true;
+            if (m_queued.size() > maxQueued)
+                m_jobDone.wait(lock, [this] { return m_queued.front()->done; });
+            else if (!m_queued.front()->done)
+                return true;
+            job = m_queued.front();
+            m_queued.pop_front();
+        }
+        m_index.emplace_back(m_offset, job->summary);
+        ChunkHeader h;
+        h.magic = kChunkMagic;
+        h.eventCount = job->eventCount;
+        h.encoding = job->encoding;
+        h.payloadBytes = quint32(job->payload.size());
+        if (!writeAll(&h, sizeof(h)) || !writeAll(job->payload.data(), job->payload.size()))
+            return false;
+    }
+}
+
+bool TraceWriter::write(const SyscallEvent *events, size_t count)
+{
+    while (count > 0) {
+        size_t take = std::min<size_t>(count, kChunkEvents - m_pending.size());
+        m_pending.insert(m_pending.end(), events, events + take);
+        events += take;
+        count -= take;
+        if (m_pending.size() == kChunkEvents && !flushChunk())
+            return false;
+    }
+    return true;
+}
+
+bool TraceWriter::flushChunk()
+{
+    if (m_pending.empty())
+        return true;
+    // Arena 引用只在本次会话内有效，不写入文件
+    for (SyscallEvent &e : m_pending)
+        e.argRef = 0;
+
+    auto job = std::make_shared<Job>();
+    job->eventCount = quint32(m_pending.size());
+    job->events.swap(m_pending);
+    m_pending.reserve(kChunkEvents);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued.push_back(job);
+        m_todo.push_back(job);
+    }
+    m_jobReady.notify_one();
+    // 每个线程最多积压两块，限制内存占用
+    return writeFinished(m_workers.size() * 2);
+}
+
+bool TraceWriter::finish(const StringTable &strings)
+{
+    if (m_fd < 0)
+        return false;
+    if (!flushChunk() || !writeFinished(0))
+        return false;
+    stopWorkers();
+
+    // 块索引：查询时不必解码就能跳过不相关的块
+    quint64 indexOffset = m_offset;
+    struct timespec realtime, monotonic;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    qint64 bootEpochNs = (qint64(realtime.tv_sec) - qint64(monotonic.tv_sec)) * 1000000000LL
+                         + (qint64(realtime.tv_nsec) - qint64(monotonic.tv_nsec));
+    quint32 indexHeader[2] = { kIndexMagic, quint32(m_index.size()) };
+    if (!writeAll(indexHeader, sizeof(indexHeader)) || !writeAll(&bootEpochNs, sizeof(bootEpochNs)))
+        return false;
+    for (const auto &entry : m_index) {
+        if (!writeAll(&entry.first, sizeof(entry.first)) || !writeAll(&entry.second, sizeof(entry.second)))
+            return false;
+    }
+
+    quint64 stringsOffset = m_offset;
+    quint32 count = strings.size();
+    quint32 header[2] = { kStringsMagic, count };
+    if (!writeAll(header, sizeof(header)))
+        return false;
+    std::string buffer;
+    for (quint32 id = 0; id < count; ++id) {
+        std::string_view s = strings.view(id);
+        quint32 len = quint32(s.size());
+        buffer.append(reinterpret_cast<const char*>(&len), sizeof(len));
+        buffer.append(s.data(), s.size());
+        if (buffer.size() >= (1 << 20)) {
+            if (!writeAll(buffer.data(), buffer.size()))
+                return false;
+            buffer.clear();
+        }
+    }
+    bool ok = writeAll(buffer.data(), buffer.size())
+              && writeAll(&indexOffset, sizeof(indexOffset))
+              && writeAll(&stringsOffset, sizeof(stringsOffset))
+              && writeAll(kEndMagic, sizeof(kEndMagic));
+    ::close(m_fd);
+    m_fd = -1;
+    return ok;
+}
+
+// ---------------- TraceReader ----------------
+
+TraceReader::~TraceReader()
+{
+    close();
+}
+
+void TraceReader::close()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_fd = -1;
+    m_chunks.clear();
+    m_summaries.clear();
+    m_strings.clear();
+    m_eventCount = 0;
+    m_bootEpochNs = 0;
+}
+
+bool TraceReader::fail(const QString &message)
+{
+    m_error = message;
+    close();
+    return false;
+}
+
+static bool preadAll(int fd, void *data, size_t size, quint64 offset)
+{
+    char *p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = ::pread(fd, p, size, off_t(offset));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= size_t(n);
+        offset += quint64(n);
+    }
+    return true;
+}
+
+bool TraceReader::open(const QString &path)
+{
+    close();
+    m_fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+        return fail(QString("cannot open %1: %2").arg(path).arg(strerror(errno)));
+
+    char magic[8];
+    quint32 header[2];
+    if (!preadAll(m_fd, magic, sizeof(magic), 0) || memcmp(magic, kMagic, sizeof(magic)) != 0
+        || !preadAll(m_fd, header, sizeof(header), sizeof(magic)))
+        return fail(QString("%1 is not a qtsys trace").arg(path));
+    if (header[0] == 0 || header[0] > kVersion)
+        return fail(QString("%1: unsupported trace version %2").arg(path).arg(header[0]));
+
+    off_t fileSize = ::lseek(m_fd, 0, SEEK_END);
+    const bool indexed = header[0] >= kFirstIndexedVersion;
+    const quint64 footerBytes = (indexed ? 16 : 8) + 8;
+    quint64 offsets[2] = { 0, 0 }; // [块索引偏移,] 字符串表偏移
+    char endMagic[8];
+    if (fileSize < off_t(16 + footerBytes)
+        || !preadAll(m_fd, indexed ? offsets : offsets + 1, footerBytes - 8, quint64(fileSize) - footerBytes)
+        || !preadAll(m_fd, endMagic, sizeof(endMagic), quint64(fileSize) - 8)
+        || memcmp(endMagic, kEndMagic, sizeof(endMagic)) != 0)
+        return fail(QString("%1: truncated trace (missing footer)").arg(path));
+    const quint64 stringsOffset = offsets[1];
+
+    if (indexed) {
+        if (!readIndex(path, offsets[0], stringsOffset))
+            return false;
+    } else {
+        // 旧版本没有块索引：依次读块头建立索引，负载本身不读
+        quint64 offset = sizeof(magic) + sizeof(header);
+        while (offset < stringsOffset) {
+            ChunkHeader h;
+            if (!preadAll(m_fd, &h, sizeof(h), offset) || h.magic != kChunkMagic)
+                return fail(QString("%1: corrupt chunk at offset %2").arg(path).arg(offset));
+            m_chunks.push_back({ offset, h.eventCount });
+            m_eventCount += h.eventCount;
+            offset += sizeof(h) + h.payloadBytes;
+        }
+    }
+
+    quint32 strHeader[2];
+    if (!preadAll(m_fd, strHeader, sizeof(strHeader), stringsOffset) || strHeader[0] != kStringsMagic)
+        return fail(QString("%1: corrupt string table").arg(path));
+    if (stringsOffset + sizeof(strHeader) > quint64(fileSize) - footerBytes)
+        return fail(QString("%1: corrupt string table").arg(path));
+    size_t tableBytes = size_t(quint64(fileSize) - footerBytes - stringsOffset - sizeof(strHeader));
+    std::string table(tableBytes, '\0');
+    if (!preadAll(m_fd, &table[0], tableBytes, stringsOffset + sizeof(strHeader)))
+        return fail(QString("%1: corrupt string table").arg(path));
+    size_t pos = 0;
+    m_strings.reserve(strHeader[1]);
+    for (quint32 i = 0; i < strHeader[1]; ++i) {
+        quint32 len;
+        if (pos + sizeof(len) > table.size())
+            return fail(QString("%1: corrupt string table").arg(path));
+        memcpy(&len, table.data() + pos, sizeof(len));
+        pos += sizeof(len);
+        if (pos + len > table.size())
+            return fail(QString("%1: corrupt string table").arg(path));
+        m_strings.emplace_back(table.data() + pos, len);
+        pos += len;
+    }
+    return true;
+}
+
+bool TraceReader::readIndex(const QString &path, quint64 indexOffset, quint64 stringsOffset)
+{
+    quint32 indexHeader[2];
+    if (indexOffset >= stringsOffset || !preadAll(m_fd, indexHeader, sizeof(indexHeader), indexOffset)
+        || indexHeader[0] != kIndexMagic
+        || !preadAll(m_fd, &m_bootEpochNs, sizeof(m_bootEpochNs), indexOffset + sizeof(indexHeader)))
+        return fail(QString("%1: corrupt chunk index").arg(path));
+
+    const quint64 entryBytes = sizeof(quint64) + sizeof(ChunkSummary);
+    const quint64 entriesOffset = indexOffset + sizeof(indexHeader) + sizeof(m_bootEpochNs);
+    if (entriesOffset + indexHeader[1] * entryBytes != stringsOffset)
+        return fail(QString("%1: corrupt chunk index").arg(path));
+    std::string entries(size_t(indexHeader[1] * entryBytes), '\0');
+    if (!entries.empty() && !preadAll(m_fd, &entries[0], entries.size(), entriesOffset))
+        return fail(QString("%1: corrupt chunk index").arg(path));
+
+    m_chunks.reserve(indexHeader[1]);
+    m_summaries.resize(indexHeader[1]);
+    for (quint32 i = 0; i < indexHeader[1]; ++i) {
+        quint64 offset;
+        memcpy(&offset, entries.data() + i * entryBytes, sizeof(offset));
+        memcpy(&m_summaries[i], entries.data() + i * entryBytes + sizeof(offset), sizeof(ChunkSummary));
+        if (offset + sizeof(ChunkHeader) > indexOffset)
+            return fail(QString("%1: corrupt chunk index").arg(path));
+        m_chunks.push_back({ offset, m_summaries[i].eventCount });
+        m_eventCount += m_summaries[i].eventCount;
+    }
+    return true;
+}
+
+static bool chunkError(QString *error, const QString &message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+
+bool TraceReader::readPayload(size_t index, ChunkHeader &h, std::string &payload, QString *error) const
+{
+    if (index >= m_chunks.size())
+        return chunkError(error, QString("no chunk %1").arg(index));
+    if (!preadAll(m_fd, &h, sizeof(h), m_chunks[index].offset) || h.magic != kChunkMagic)
+        return chunkError(error, QString("read failed at chunk %1").arg(index));
+    quint32 encoding = h.encoding & EncodingMask;
+    if ((encoding != RawEncoding && encoding != ColumnarEncoding)
+        || (h.encoding & ~quint32(EncodingMask | CompressedFlag)))
+        return chunkError(error, QString("unsupported encoding in chunk %1").arg(index));
+    // 块头的事件数决定解码时分配多少，先与块索引和负载大小对一遍
+    if (h.eventCount != m_chunks[index].eventCount || h.eventCount > TraceWriter::kChunkEvents)
+        return chunkError(error, QString("corrupt chunk %1: %2 events").arg(index).arg(h.eventCount));
+    payload.resize(h.payloadBytes);
+    if (!preadAll(m_fd, &payload[0], h.payloadBytes, m_chunks[index].offset + sizeof(h)))
+        return chunkError(error, QString("read failed at chunk %1").arg(index));
+    if (h.encoding & CompressedFlag) {
+        QByteArray plain = qUncompress(reinterpret_cast<const uchar*>(payload.data()), int(payload.size()));
+        if (plain.isEmpty())
+            return chunkError(error, QString("corrupt chunk %1").arg(index));
+        payload.assign(plain.constData(), size_t(plain.size()));
+    }
+    // 压缩块的大小要在解压之后才能核对
+    if (encoding == RawEncoding ? payload.size() != size_t(h.eventCount) * sizeof(SyscallEvent)
+                                : payload.size() < size_t(h.eventCount) * tracecodec::kMinBytesPerEvent)
+        return chunkError(error, QString("corrupt chunk %1: %2 events in %3 bytes").arg(index).arg(h.eventCount).arg(payload.size()));
+    return true;
+}
+
+bool TraceReader::readChunk(size_t index, std::vector<SyscallEvent> &out, QString *error) const
+{
+    // 每个线程一份读缓冲，反复解码时不必重新分配
+    thread_local std::string payload;
+    ChunkHeader h;
+    if (!readPayload(index, h, payload, error))
+        return false;
+    out.resize(h.eventCount);
+    if ((h.encoding & EncodingMask) == RawEncoding) {
+        memcpy(out.data(), payload.data(), payload.size());
+        return true;
+    }
+    if (!tracecodec::decodeColumns(payload.data(), payload.size(), h.eventCount, out.data()))
+        return chunkError(error, QString("corrupt chunk %1").arg(index));
+    return true;
+}
+
+bool TraceReader::readChunk(size_t index, tracecodec::ColumnBatch &out, QString *error) const
+{
+    thread_local std::string payload;
+    ChunkHeader h;
+    if (!readPayload(index, h, payload, error))
+        return false;
+    if ((h.encoding & EncodingMask) == RawEncoding) {
+        out.resize(h.eventCount);
+        const SyscallEvent *events = reinterpret_cast<const SyscallEvent*>(payload.data());
+        for (quint32 i = 0; i < h.eventCount; ++i)
+            out.set(i, events[i]);
+        return true;
+    }
+    if (!tracecodec::decodeColumns(payload.data(), payload.size(), h.eventCount, out))
+        return chunkError(error, QString("corrupt chunk %1").arg(index));
+    return true;
+}
+
+const std::string& TraceReader::string(quint32 id) const
+{
+    static const std::string empty;
+    return id < m_strings.size() ? m_strings[id] : empty;
+}
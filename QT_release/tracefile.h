@@ -0,0 +1,165 @@
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+
+#include <QString>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "syscallevent.h"
+#include "chunksummary.h"
+#include "tracecodec.h"
+
+class StringTable;
+
+// 追踪文件格式（.qtrace）：
+//   文件头  "QTSYSTRC" | u32 版本 | u32 保留
+//   若干块  ChunkHeader | 负载（本块的事件，原样或按列编码，可选再整体压缩）
+//   块索引  "IDX1" | u32 块数 | u64 开机时刻（UTC ns）| 每块 [u64 块偏移][ChunkSummary]   （版本 3 起）
+//   字符串表 "STRS" | u32 数量 | 每个字符串 [u32 长度][字节]，下标即事件中的 commId/pathId
+//   文件尾  [u64 块索引偏移]（版本 3 起）| u64 字符串表偏移 | "QTSYSEND"
+// 每块都可以单独解码，读取时可以跳到任意块，也可以多线程各读各的块。
+namespace tracefile {
+
+constexpr char kMagic[8] = { 'Q', 'T', 'S', 'Y', 'S', 'T', 'R', 'C' };
+constexpr char kEndMagic[8] = { 'Q', 'T', 'S', 'Y', 'S', 'E', 'N', 'D' };
+constexpr quint32 kVersion = 3;          // 版本 1 只有原样编码的块，版本 2 没有块索引，都仍然可以读取
+constexpr quint32 kFirstIndexedVersion = 3;
+constexpr quint32 kChunkMagic = 0x4b4e4843; // "CHNK"
+constexpr quint32 kStringsMagic = 0x53525453; // "STRS"
+constexpr quint32 kIndexMagic = 0x31584449; // "IDX1"
+
+enum ChunkEncoding : quint32 {
+    RawEncoding = 0,      // SyscallEvent 数组原样写入
+    ColumnarEncoding = 1, // 按列编码，见 tracecodec.h
+    EncodingMask = 0xff,
+    CompressedFlag = 0x100, // 负载再经过 qCompress（zlib）
+};
+
+struct ChunkHeader {
+    quint32 magic;
+    quint32 eventCount;
+    quint32 encoding;
+    quint32 payloadBytes;
+};
+
+} // namespace tracefile
+
+class TraceWriter
+{
+public:
+    static constexpr quint32 kChunkEvents = 1 << 16;
+
+    struct Options {
+        bool columnar = true;   // 按列编码；关闭时写出与版本 1 相同的原样块
+        bool compress = false;  // 编码后再用 zlib 压缩一遍，更小但编解码更慢
+        int threads = 0;        // 编码线程数，0 表示按 CPU 核数（最多 4 个）
+    };
+
+    TraceWriter() = default;
+    ~TraceWriter();
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    bool open(const QString &path, const Options &options);
+    bool open(const QString &path) { return open(path, Options()); }
+    // 事件先在内存里攒满一块再写出
+    bool write(const SyscallEvent *events, size_t count);
+    // 写出剩余事件、字符串表和文件尾，然后关闭文件
+    bool finish(const StringTable &strings);
+
+    QString errorString() const { return m_error; }
+
+private:
+    // 一块待编码的事件；编码在线程池里完成，写文件仍按提交顺序在调用线程进行
+    struct Job {
+        quint32 eventCount = 0;
+        ChunkSummary summary;
+        std::vector<SyscallEvent> events;
+        std::string payload;
+        quint32 encoding = 0;
+        bool done = false;
+    };
+
+    bool flushChunk();
+    bool writeAll(const void *data, size_t size);
+    // 按提交顺序写出已编码完成的块；未写出的块多于 maxQueued 时等待队首编码完成
+    bool writeFinished(size_t maxQueued);
+    void encode(Job &job) const;
+    void workerLoop();
+    void stopWorkers();
+
+    int m_fd = -1;
+    quint64 m_offset = 0;
+    Options m_options;
+    std::vector<SyscallEvent> m_pending;
+    std::vector<std::pair<quint64, ChunkSummary>> m_index; // 已写出的块：偏移与摘要
+    QString m_error;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_jobReady;
+    std::condition_variable m_jobDone;
+    std::deque<std::shared_ptr<Job>> m_queued;  // 已提交、尚未写出的块，按提交顺序
+    std::deque<std::shared_ptr<Job>> m_todo;    // 尚未被工作线程取走的块
+    bool m_stopping = false;
+};
+
+class TraceReader
+{
+public:
+    struct ChunkInfo {
+        quint64 offset;      // 块头在文件中的偏移
+        quint32 eventCount;
+    };
+
+    TraceReader() = default;
+    ~TraceReader();
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    bool open(const QString &path);
+    void close();
+
+    size_t chunkCount() const { return m_chunks.size(); }
+    const ChunkInfo& chunk(size_t index) const { return m_chunks[index]; }
+    quint64 eventCount() const { return m_eventCount; }
+
+    // 版本 3 起文件尾部带有每块的摘要，查询可以据此跳过整块
+    bool hasSummaries() const { return !m_summaries.empty(); }
+    const ChunkSummary& summary(size_t index) const { return m_summaries[index]; }
+    // 写文件时机器的开机时刻（UTC ns），用于把单调时钟时间戳换算成墙上时间；未知时为 0
+    qint64 bootEpochNs() const { return m_bootEpochNs; }
+
+    // 解码第 index 块到 out（覆盖原有内容）。基于 pread，可以在多个线程里同时调用；
+    // 失败原因写入 error（可以为空），不经过 errorString()，各线程互不影响
+    bool readChunk(size_t index, std::vector<SyscallEvent> &out, QString *error = nullptr) const;
+    // 同上，按列解码
+    bool readChunk(size_t index, tracecodec::ColumnBatch &out, QString *error = nullptr) const;
+
+    // 文件中的字符串表
+    const std::string& string(quint32 id) const;
+    size_t stringCount() const { return m_strings.size(); }
+
+    // open() 失败的原因
+    QString errorString() const { return m_error; }
+
+private:
+    bool fail(const QString &message);
+    bool readIndex(const QString &path, quint64 indexOffset, quint64 stringsOffset);
+    // 读出第 index 块的块头和负载（压缩过的已经解压），并检查事件数与负载大小相符；失败时写入 error
+    bool readPayload(size_t index, tracefile::ChunkHeader &h, std::string &payload, QString *error) const;
+
+    int m_fd = -1;
+    std::vector<ChunkInfo> m_chunks;
+    std::vector<ChunkSummary> m_summaries;
+    qint64 m_bootEpochNs = 0;
+    std::vector<std::string> m_strings;
+    quint64 m_eventCount = 0;
+    QString m_error;
+};
+
+#endif // TRACEFILE_H
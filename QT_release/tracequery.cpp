@@ -0,0 +1,311 @@
+#include "tracequery.h"
+#include "tracefile.h"
+#include "errnostats.h"
+#include "columnkernels.h"
+#include "syscall_map.h"
+
+#include <QRegularExpression>
+#include <QStringList>
+#include <algorithm>
+
+static constexpr quint64 kNsPerSecond = 1000000000ULL;
+static constexpr quint64 kNsPerDay = 86400 * kNsPerSecond;
+// 界面上的时间按 UTC+8 显示（见 formatTimestamp），time= 也按同一时区理解
+static constexpr qint64 kDisplayOffsetNs = 8 * 3600 * qint64(kNsPerSecond);
+
+bool parseDuration(const QString &text, quint64 &ns)
+{
+    static const QRegularExpression re("^(\\d+(?:\\.\\d+)?)(ns|us|ms|s)$");
+    QRegularExpressionMatch m = re.match(text);
+    if (!m.hasMatch())
+        return false;
+    const QString unit = m.captured(2);
+    double scale = unit == "ns" ? 1.0 : unit == "us" ? 1e3 : unit == "ms" ? 1e6 : 1e9;
+    ns = quint64(m.captured(1).toDouble() * scale + 0.5);
+    return true;
+}
+
+// "12:00:05.250" -> 当天的第几纳秒；秒和小数部分可以省略
+static bool parseClock(const QString &text, quint64 &ns)
+{
+    static const QRegularExpression re("^(\\d{1,2}):(\\d{2})(?::(\\d{2})(\\.\\d{1,9})?)?$");
+    QRegularExpressionMatch m = re.match(text);
+    if (!m.hasMatch())
+        return false;
+    int h = m.captured(1).toInt();
+    int min = m.captured(2).toInt();
+    int s = m.captured(3).isEmpty() ? 0 : m.captured(3).toInt();
+    if (h > 23 || min > 59 || s > 59)
+        return false;
+    ns = (quint64(h) * 3600 + quint64(min) * 60 + quint64(s)) * kNsPerSecond;
+    if (!m.captured(4).isEmpty())
+        ns += quint64(("0" + m.captured(4)).toDouble() * 1e9 + 0.5);
+    return true;
+}
+
+static bool parseIdList(const QString &text, std::vector<quint32> &out)
+{
+    for (const QString &part : text.split(',', Qt::SkipEmptyParts)) {
+        bool ok;
+        quint32 id = part.toUInt(&ok);
+        if (!ok)
+            return false;
+        out.push_back(id);
+    }
+    return !out.empty();
+}
+
+int syscallFromName(const QString &name)
+{
+    bool isNumber;
+    int nr = name.toInt(&isNumber);
+    if (isNumber)
+        return nr >= 0 && nr < ChunkSummary::kSyscallBits ? nr : -1;
+    for (auto it = syscall_map.constBegin(); it != syscall_map.constEnd(); ++it) {
+        if (name == QLatin1String(it.value()))
+            return it.key() < ChunkSummary::kSyscallBits ? int(it.key()) : -1;
+    }
+    return -1;
+}
+
+bool TraceQuery::parse(const QString &text, const Context &context, TraceQuery &out, QString *error)
+{
+    out = TraceQuery();
+    auto fail = [error](const QString &message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    static const QRegularExpression durationRe("^dur(>=|<=|>|<)(.+)$");
+    for (const QString &token : text.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts)) {
+        if (token == "errors") {
+            out.errorsOnly = true;
+            continue;
+        }
+        if (token.startsWith("path~")) {
+            out.pathContains = token.mid(5).toStdString();
+            if (out.pathContains.empty())
+                return fail("path~ needs a substring");
+            continue;
+        }
+        QRegularExpressionMatch dm = durationRe.match(token);
+        if (dm.hasMatch()) {
+            quint64 ns;
+            if (!parseDuration(dm.captured(2), ns))
+                return fail(QString("invalid duration: %1 (e.g. 1ms, 500us)").arg(dm.captured(2)));
+            const QString op = dm.captured(1);
+            if (op == ">")
+                out.minDurationNs = qMax(out.minDurationNs, ns + 1);
+            else if (op == ">=")
+                out.minDurationNs = qMax(out.minDurationNs, ns);
+            else if (op == "<")
+                out.maxDurationNs = qMin(out.maxDurationNs, ns == 0 ? 0 : ns - 1);
+            else
+                out.maxDurationNs = qMin(out.maxDurationNs, ns);
+            continue;
+        }
+
+        int eq = token.indexOf('=');
+        if (eq <= 0)
+            return fail(QString("unknown filter: %1").arg(token));
+        const QString key = token.left(eq);
+        const QString value = token.mid(eq + 1);
+
+        if (key == "tid" || key == "pid") {
+            if (!parseIdList(value, key == "tid" ? out.tids : out.pids))
+                return fail(QString("invalid %1 list: %2").arg(key, value));
+        } else if (key == "syscall") {
+            out.anySyscall = false;
+            for (const QString &name : value.split(',', Qt::SkipEmptyParts)) {
+                int nr = syscallFromName(name);
+                if (nr < 0)
+                    return fail(QString("unknown syscall: %1").arg(name));
+                out.syscalls[nr / 64] |= 1ULL << (nr % 64);
+            }
+        } else if (key == "t") {
+            int dash = value.indexOf('-');
+            if (dash < 0)
+                return fail("t= expects start-end in seconds, e.g. t=5-10");
+            bool ok = true;
+            QString start = value.left(dash);
+            QString end = value.mid(dash + 1);
+            double from = start.isEmpty() ? 0.0 : start.toDouble(&ok);
+            if (!ok || from < 0)
+                return fail(QString("invalid time range: %1").arg(value));
+            double to = end.isEmpty() ? -1.0 : end.toDouble(&ok);
+            if (!ok || (to >= 0 && to <= from))
+                return fail(QString("invalid time range: %1").arg(value));
+            out.fromTs = qMax(out.fromTs, context.firstTs + quint64(from * 1e9));
+            if (to >= 0)
+                out.toTs = qMin(out.toTs, context.firstTs + quint64(to * 1e9));
+        } else if (key == "time") {
+            if (context.bootEpochNs == 0)
+                return fail("time= needs a trace with a recorded boot time; use t= instead");
+            int dash = value.indexOf('-');
+            quint64 from, to;
+            if (dash < 0 || !parseClock(value.left(dash), from) || !parseClock(value.mid(dash + 1), to))
+                return fail("time= expects HH:MM:SS-HH:MM:SS, e.g. time=12:00:05-12:00:10");
+            if (to <= from)
+                to += kNsPerDay; // 跨过午夜
+            // 第一个事件所在那一天的 0 点，换算回单调时钟
+            qint64 firstWall = context.bootEpochNs + qint64(context.firstTs) + kDisplayOffsetNs;
+            qint64 dayStart = firstWall - firstWall % qint64(kNsPerDay);
+            qint64 base = dayStart - kDisplayOffsetNs - context.bootEpochNs;
+            out.fromTs = qMax(out.fromTs, quint64(qMax<qint64>(base + qint64(from), 0)));
+            out.toTs = qMin(out.toTs, quint64(qMax<qint64>(base + qint64(to), 0)));
+        } else {
+            return fail(QString("unknown filter: %1").arg(token));
+        }
+    }
+    return true;
+}
+
+bool TraceQuery::isEmpty() const
+{
+    return fromTs == 0 && toTs == ~0ULL && minDurationNs == 0 && maxDurationNs == ~0ULL && !errorsOnly
+           && anySyscall && tids.empty() && pids.empty() && pathContains.empty();
+}
+
+bool TraceQuery::mayMatch(const ChunkSummary &summary) const
+{
+    if (summary.eventCount == 0)
+        return false;
+    if (summary.maxTs < fromTs || summary.minTs >= toTs)
+        return false;
+    if (summary.maxDuration < minDurationNs)
+        return false;
+    if (errorsOnly && summary.errorCount == 0)
+        return false;
+    if (!anySyscall) {
+        bool any = false;
+        for (int i = 0; i < ChunkSummary::kSyscallBits / 64 && !any; ++i)
+            any = (syscalls[i] & summary.syscalls[i]) != 0;
+        if (!any)
+            return false;
+    }
+    if (!tids.empty()
+        && std::none_of(tids.begin(), tids.end(), [&](quint32 tid) { return summary.mayHaveTid(tid); }))
+        return false;
+    return true;
+}
+
+bool TraceQuery::pathMatches(quint32 pathId, const PathLookup &paths) const
+{
+    if (pathId == 0)
+        return false;
+    if (pathId >= m_pathMatch.size())
+        m_pathMatch.resize(size_t(pathId) + 1, -1);
+    qint8 &cached = m_pathMatch[pathId];
+    if (cached < 0)
+        cached = paths(pathId).find(pathContains) != std::string_view::npos ? 1 : 0;
+    return cached == 1;
+}
+
+bool TraceQuery::matches(const SyscallEvent &e, const PathLookup &paths) const
+{
+    if (e.ts < fromTs || e.ts >= toTs)
+        return false;
+    if (e.duration < minDurationNs || e.duration > maxDurationNs)
+        return false;
+    if (errorsOnly && ErrnoStats::errnoFromRet(e.ret) == 0)
+        return false;
+    if (!hasSyscall(e.syscall))
+        return false;
+    if (!tids.empty() && std::find(tids.begin(), tids.end(), e.tid) == tids.end())
+        return false;
+    if (!pids.empty() && std::find(pids.begin(), pids.end(), e.pid) == pids.end())
+        return false;
+    if (!pathContains.empty() && !pathMatches(e.pathId, paths))
+        return false;
+    return true;
+}
+
+void TraceQuery::filter(const tracecodec::ColumnBatch &batch, const PathLookup &paths,
+                        std::vector<quint32> &selection) const
+{
+    // 第一遍按时间戳列生成候选行，之后每个条件只读自己那一列，在原地压缩候选行
+    selection.resize(batch.count);
+    selection.resize(columnkernels::selectRange(batch.ts.data(), batch.count, fromTs, toTs, selection.data()));
+    auto keep = [&selection](auto predicate) {
+        size_t n = 0;
+        for (quint32 row : selection) {
+            if (predicate(row))
+                selection[n++] = row;
+        }
+        selection.resize(n);
+    };
+
+    if (minDurationNs != 0 || maxDurationNs != ~0ULL) {
+        const quint64 *duration = batch.duration.data();
+        keep([&](quint32 i) { return duration[i] >= minDurationNs && duration[i] <= maxDurationNs; });
+    }
+    if (errorsOnly) {
+        const qint64 *ret = batch.ret.data();
+        keep([&](quint32 i) { return ErrnoStats::errnoFromRet(ret[i]) != 0; });
+    }
+    if (!anySyscall) {
+        const qint16 *syscall = batch.syscall.data();
+        keep([&](quint32 i) { return hasSyscall(syscall[i]); });
+    }
+    if (!tids.empty()) {
+        const quint32 *tid = batch.tid.data();
+        keep([&](quint32 i) { return std::find(tids.begin(), tids.end(), tid[i]) != tids.end(); });
+    }
+    if (!pids.empty()) {
+        const quint32 *pid = batch.pid.data();
+        keep([&](quint32 i) { return std::find(pids.begin(), pids.end(), pid[i]) != pids.end(); });
+    }
+    if (!pathContains.empty()) {
+        const quint32 *pathId = batch.pathId.data();
+        keep([&](quint32 i) { return pathMatches(pathId[i], paths); });
+    }
+}
+
+bool queryContext(const TraceReader &reader, TraceQuery::Context &out, QString *error)
+{
+    out = TraceQuery::Context();
+    out.bootEpochNs = reader.bootEpochNs();
+    // 与 --diff 的时间窗口一致，以文件中第一个事件为起点
+    std::vector<SyscallEvent> events;
+    for (size_t c = 0; c < reader.chunkCount(); ++c) {
+        if (!reader.readChunk(c, events, error))
+            return false;
+        if (!events.empty()) {
+            out.firstTs = events.front().ts;
+            break;
+        }
+    }
+    return true;
+}
+
+bool runQuery(const TraceReader &reader, const TraceQuery &query,
+              const std::function<bool(const SyscallEvent&)> &callback, QueryStats &stats, QString *error)
+{
+    stats = QueryStats();
+    query.resetPathCache();
+    const TraceQuery::PathLookup paths = [&reader](quint32 id) -> std::string_view {
+        return reader.string(id);
+    };
+
+    tracecodec::ColumnBatch batch;
+    std::vector<quint32> selection;
+    for (size_t c = 0; c < reader.chunkCount(); ++c) {
+        stats.chunksTotal++;
+        // 版本 3 之前的文件没有块摘要，只能逐块解码
+        if (reader.hasSummaries() && !query.mayMatch(reader.summary(c))) {
+            stats.chunksSkipped++;
+            continue;
+        }
+        if (!reader.readChunk(c, batch, error))
+            return false;
+        stats.eventsScanned += batch.count;
+        query.filter(batch, paths, selection);
+        for (quint32 row : selection) {
+            stats.eventsMatched++;
+            if (!callback(batch.event(row)))
+                return true;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef TRACEQUERY_H
+#define TRACEQUERY_H
+
+#include <QString>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "syscallevent.h"
+#include "chunksummary.h"
+#include "tracecodec.h"
+
+class TraceReader;
+
+// 事件过滤条件，过滤栏和 --query 共用。各条件之间是“与”的关系，未给出的条件不限制。
+// 与追踪过滤表达式（syscallfilter.h）分成两种语法：这里作用于已经记录下来的事件，只有“与”，
+// 因此每个条件都能对照块摘要整块跳过、按列逐步缩小选择，还支持按时间范围查看；
+// 追踪过滤表达式在追踪时逐个事件求值，需要 or/not 和括号，没有时间范围。两者的值（syscall 名、时长）按同样的规则解析。
+// 文本语法（空格分隔，多个值用逗号）：
+//   tid=1234,1235   pid=42   syscall=read,write   dur>1ms   dur<=20us   errors
+//   time=12:00:05-12:00:10     墙上时间（北京时间，与界面显示一致），日期取第一个事件所在的那一天
+//   t=5-10                     相对于第一个事件的秒数，两端都可以省略，例如 t=5- 或 t=-10
+//   path~/etc/                 路径包含子串
+struct TraceQuery
+{
+    // 解析 time= 与 t= 所需的信息
+    struct Context {
+        qint64 bootEpochNs = 0;   // 开机时刻（UTC ns）；为 0 时不支持 time=
+        quint64 firstTs = 0;      // 第一个事件的时间戳
+    };
+
+    quint64 fromTs = 0;           // [fromTs, toTs)
+    quint64 toTs = ~0ULL;
+    quint64 minDurationNs = 0;
+    quint64 maxDurationNs = ~0ULL;
+    bool errorsOnly = false;
+    bool anySyscall = true;
+    quint64 syscalls[ChunkSummary::kSyscallBits / 64] = {};
+    std::vector<quint32> tids;
+    std::vector<quint32> pids;
+    std::string pathContains;
+
+    static bool parse(const QString &text, const Context &context, TraceQuery &out, QString *error);
+
+    bool isEmpty() const;
+    bool hasSyscall(int nr) const {
+        return anySyscall || (nr >= 0 && nr < ChunkSummary::kSyscallBits && (syscalls[nr / 64] >> (nr % 64)) & 1);
+    }
+
+    // 这一段事件里可能有匹配的事件；返回 false 时可以整段跳过
+    bool mayMatch(const ChunkSummary &summary) const;
+
+    // 路径 id -> 字符串。匹配结果按 id 缓存，换一个字符串表之前要调用 resetPathCache()
+    using PathLookup = std::function<std::string_view(quint32)>;
+    void resetPathCache() const { m_pathMatch.clear(); }
+
+    bool matches(const SyscallEvent &e, const PathLookup &paths) const;
+    // 按列过滤：每个条件只扫一遍自己的列，逐步缩小 selection。selection 输出匹配的行号
+    void filter(const tracecodec::ColumnBatch &batch, const PathLookup &paths, std::vector<quint32> &selection) const;
+
+private:
+    bool pathMatches(quint32 pathId, const PathLookup &paths) const;
+
+    mutable std::vector<qint8> m_pathMatch; // -1 未知，0 不匹配，1 匹配
+};
+
+// --- 过滤栏、--query、追踪过滤表达式和调用栈 syscall 列表共用的值解析 ---
+// syscall 名或编号 -> 编号；不认识或超出 ChunkSummary::kSyscallBits 时返回 -1
+int syscallFromName(const QString &name);
+// "1.5ms" -> 1500000；单位（ns、us、ms、s）必须写出
+bool parseDuration(const QString &text, quint64 &ns);
+
+struct QueryStats {
+    quint64 chunksTotal = 0;
+    quint64 chunksSkipped = 0;    // 凭块摘要跳过、没有解码的块
+    quint64 eventsScanned = 0;
+    quint64 eventsMatched = 0;
+};
+
+// 第一个事件的时间戳与开机时刻，用来解析查询里的时间条件
+bool queryContext(const TraceReader &reader, TraceQuery::Context &out, QString *error);
+
+// 在追踪文件上执行查询，按文件顺序对每个匹配的事件调用 callback；callback 返回 false 时提前结束
+bool runQuery(const TraceReader &reader, const TraceQuery &query,
+              const std::function<bool(const SyscallEvent&)> &callback, QueryStats &stats, QString *error);
+
+#endif // TRACEQUERY_H
@@ -1,4 +1,18 @@
 #include "tracer.h"
+#include "schedsampler.h"
+#include "eventqueue.h"
+#include "eventstore.h"
+#include "calltree.h"
+#include "symbolizer.h"
+#include "stackunwinder.h"
+#include "addressspace.h"
+#include "networkstats.h"
+#include "futexstats.h"
+#include "syscall_map.h"
+#include "ptracebackend.h"
+#include "processtree.h"
+#include "processscan.h"
+#include "cgroupwatch.h"
 #include <QDebug>
 
 // 包含了 ptrace 和 waitpid 所需的头文件
@@ -6,11 +20,21 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/user.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <syscall.h>
-#include <fstream>
 #include <string>
 #include <time.h> // For clock_gettime
+#include <signal.h>
+#include <sched.h>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
 
 // 辅助函数：获取高精度时间戳
 quint64 get_timestamp_ns() {
@@ -18,84 +42,786 @@ quint64 get_timestamp_ns() {
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return (quint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
-// 用于获取进程名的辅助函数
+// 用于获取进程名的辅助函数；exec 和进程列表都会调用，读法见 processscan
 QString get_process_name(pid_t pid) {
-    QString comm_path = QString("/proc/%1/comm").arg(pid);
-    std::ifstream comm_file(comm_path.toStdString());
-    std::string name;
-    if (comm_file.is_open()) {
-        std::getline(comm_file, name);
-        comm_file.close();
+    return processscan::processName(pid);
+}
+
+// 获取第 i 个参数（x86_64 下最多 6 个）
+static unsigned long long syscall_arg(const struct user_regs_struct &regs, int index) {
+    switch (index) {
+        case 0: return regs.rdi;
+        case 1: return regs.rsi;
+        case 2: return regs.rdx;
+        case 3: return regs.r10;
+        case 4: return regs.r8;
+        case 5: return regs.r9;
+        default: return 0;
+    }
+}
+
+// 带路径参数的系统调用：返回路径是第几个参数，其他返回 -1
+static int path_arg_index(long nr) {
+    switch (nr) {
+        case SYS_open: case SYS_creat: case SYS_stat: case SYS_lstat: case SYS_access:
+        case SYS_execve: case SYS_readlink: case SYS_unlink: case SYS_mkdir: case SYS_rmdir:
+        case SYS_chdir: case SYS_rename: case SYS_truncate: case SYS_chmod: case SYS_chown:
+        case SYS_lchown: case SYS_link: case SYS_mknod: case SYS_statfs: case SYS_utimes:
+            return 0;
+        case SYS_openat: case SYS_newfstatat: case SYS_statx: case SYS_faccessat:
+        case SYS_readlinkat: case SYS_unlinkat: case SYS_mkdirat: case SYS_renameat:
+        case SYS_renameat2: case SYS_fchmodat: case SYS_fchownat: case SYS_execveat:
+        case SYS_utimensat: case SYS_mknodat: case SYS_inotify_add_watch: case SYS_symlink:
+#ifdef SYS_faccessat2
+        case SYS_faccessat2:
+#endif
+#ifdef SYS_openat2
+        case SYS_openat2:
+#endif
+            return 1;
+        default:
+            return -1;
+    }
+}
+
+// 改变地址空间的系统调用
+static bool is_memory_syscall(long nr) {
+    return nr == SYS_mmap || nr == SYS_munmap || nr == SYS_mremap || nr == SYS_mprotect || nr == SYS_brk;
+}
+
+// 在出口处把成功的内存调用应用到地址空间；args 为入口处的参数
+static void apply_memory_syscall(AddressSpace *space, long nr, const quint64 args[6], long ret, quint64 ts) {
+    if (ret < 0 && ret >= -4095)
+        return;
+    switch (nr) {
+        case SYS_mmap: space->applyMmap(quint64(ret), args[1], int(args[2]), int(args[3]), ts); break;
+        case SYS_munmap: space->applyMunmap(args[0], args[1], ts); break;
+        case SYS_mremap: space->applyMremap(args[0], args[1], quint64(ret), args[2], ts); break;
+        case SYS_mprotect: space->applyMprotect(args[0], args[1], int(args[2]), ts); break;
+        case SYS_brk: space->applyBrk(quint64(ret), ts); break;
     }
-    return QString::fromStdString(name);
 }
 
-Tracer::Tracer(QObject *parent) : QObject(parent) {}
+// 读取被追踪进程中的 C 字符串，按页分段读取以免跨越未映射的页。
+// 返回字符串长度（不含 \0），失败返回 -1
+static ssize_t read_tracee_string(PtraceBackend &kernel, pid_t pid, unsigned long long addr, char *buf, size_t size) {
+    const size_t page = 4096;
+    size_t got = 0;
+    while (got + 1 < size) {
+        size_t chunk = std::min<size_t>(page - ((addr + got) % page), size - 1 - got);
+        ssize_t n = kernel.readMemory(pid, addr + got, buf + got, chunk);
+        if (n <= 0)
+            break;
+        const char *nul = static_cast<const char*>(memchr(buf + got, '\0', size_t(n)));
+        if (nul)
+            return nul - buf;
+        got += size_t(n);
+    }
+    if (got == 0)
+        return -1;
+    buf[got] = '\0'; // 截断的长路径
+    return ssize_t(got);
+}
+
+// 停止追踪时等待被追踪进程响应 PTRACE_INTERRUPT 的上限；处于不可中断睡眠的进程可能等不到
+static const quint64 kInterruptTimeoutNs = 1000000000ULL;
+// epoll 的兜底超时：即使 SIGCHLD 被别的线程取走，也不会一直睡下去
+static const int kPollFallbackMs = 100;
+// 打断阻塞在 waitpid 上的追踪线程的信号：默认动作是忽略，误发到别的线程也无害
+static const int kWakeSignal = SIGURG;
+// 唤醒信号可能落在追踪线程检查请求之后、进入 waitpid 之前而丢失，隔这么久重发一次，最多重发 kWakeAttempts 次
+static const useconds_t kWakeRetryUs = 1000;
+static const int kWakeAttempts = 100;
+// 按 cgroup 附加时重新扫描成员的间隔：inotify 看不到的加入方式（clone3 直接生在 cgroup 里）最多晚这么久被附加
+static const quint64 kCgroupRescanNs = 250000000ULL;
+
+// 处理函数什么也不做，只为让 waitpid 以 EINTR 返回；安装时不带 SA_RESTART
+static void on_wake_signal(int) {}
+
+Tracer::Tracer(QObject *parent) : QObject(parent) {
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+Tracer::~Tracer() {
+    if (m_wakeFd != -1)
+        close(m_wakeFd);
+}
+
+void Tracer::blockChildSignal() {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+}
+
+quint64 Tracer::calibrateStopOverhead() {
+    static quint64 cached = [] {
+        const int kRounds = 200;
+        pid_t child = fork();
+        if (child == -1)
+            return quint64(0);
+        if (child == 0) {
+            // 子进程只调用 async-signal-safe 的函数
+            ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+            raise(SIGSTOP);
+            for (int i = 0; i < kRounds; ++i)
+                syscall(SYS_getppid);
+            _exit(0);
+        }
+
+        int status;
+        if (waitpid(child, &status, 0) == -1 || !WIFSTOPPED(status)) {
+            kill(child, SIGKILL);
+            waitpid(child, &status, 0);
+            return quint64(0);
+        }
+        ptrace(PTRACE_SETOPTIONS, child, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+
+        // getppid 本身几乎不耗时，测到的 entry->exit 时间基本就是两次停顿的开销
+        std::vector<quint64> samples;
+        samples.reserve(kRounds);
+        bool entry = true;
+        quint64 start_ts = 0;
+        long nr = -1;
+        while (ptrace(PTRACE_SYSCALL, child, nullptr, nullptr) != -1) {
+            if (waitpid(child, &status, 0) == -1 || WIFEXITED(status) || WIFSIGNALED(status))
+                break;
+            if (!(WIFSTOPPED(status) && (WSTOPSIG(status) & 0x80)))
+                continue;
+            if (entry) {
+                struct user_regs_struct regs;
+                ptrace(PTRACE_GETREGS, child, nullptr, &regs);
+                nr = regs.orig_rax;
+                start_ts = get_timestamp_ns();
+            } else if (nr == SYS_getppid) {
+                // 与 Tracer::start 一样，出口处先读寄存器再取时间戳
+                struct user_regs_struct regs;
+                ptrace(PTRACE_GETREGS, child, nullptr, &regs);
+                samples.push_back(get_timestamp_ns() - start_ts);
+            }
+            entry = !entry;
+        }
+        kill(child, SIGKILL);
+        waitpid(child, &status, 0);
+
+        if (samples.empty())
+            return quint64(0);
+        // 取中位数，避免个别被调度打断的样本把结果拉高
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        quint64 overhead = samples[samples.size() / 2];
+        qInfo() << "Calibrated ptrace stop overhead:" << overhead << "ns";
+        return overhead;
+    }();
+    return cached;
+}
+
+void Tracer::wake() {
+    quint64 one = 1;
+    if (m_wakeFd != -1 && write(m_wakeFd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+        qWarning() << "Tracer: failed to signal wake eventfd:" << strerror(errno);
+    // 热路径上追踪线程睡在 waitpid 里，eventfd 叫不醒它。请求已在调用前发布，追踪线程进入 waitpid 前会再检查一次，
+    // 所以只有它已经宣布阻塞时才需要信号；信号赶在它进入 waitpid 之前到达就会丢失，直到它醒来之前一直重发
+    for (int attempt = 0; attempt < kWakeAttempts; ++attempt) {
+        {
+            std::lock_guard<std::mutex> lock(m_threadMutex);
+            if (!m_threadActive || !m_blockedInWait.load())
+                return;
+            pthread_kill(m_thread, kWakeSignal);
+        }
+        usleep(kWakeRetryUs);
+    }
+}
 
 void Tracer::stop() {
-    m_running = false;
+    m_running.store(false);
+    wake();
+}
+
+void Tracer::requestDump() {
+    m_dumpRequested.store(true, std::memory_order_relaxed);
+    wake();
+}
+
+namespace {
+// 一个被追踪的线程。停顿按 tid 收取，入口/出口配对、待交还的信号等状态都按线程保存
+struct TracedTask {
+    pid_t tid = 0;
+    pid_t tgid = 0;
+    int process = -1;             // ProcessTree 节点
+    quint32 commId = 0;
+    bool running = true;          // 已恢复运行（或刚被自动附加），等它的下一次停顿
+    bool held = false;            // 自动附加的新线程先于父进程的 fork/clone 事件停下：归属确定前不恢复
+    bool inSyscall = false;       // 下一次 syscall 停顿是出口
+    bool skipCall = false;        // 本次调用在入口处已确定不会匹配
+    int resumeSignal = 0;         // 信号投递停顿：恢复时把信号原样交还给线程
+    bool groupStop = false;       // 组停止（进程被 SIGSTOP 等停下）：用 PTRACE_LISTEN 恢复，线程保持停止
+    long syscall = -1;
+    quint64 startTs = 0;
+    quint8 tracked = 0;
+    quint64 args[6] = {};
+    ssize_t pathLen = -1;         // 本次调用解码出的路径长度，出口处才驻留（被过滤掉的路径不进入字符串表）
+    std::unique_ptr<char[]> path; // PATH_MAX，第一次解码路径时分配
+    int stackDepth = -1;          // -1 表示本次调用没有采集栈
+    std::unique_ptr<quint32[]> stackFrames;
+    SchedSample schedEntry;
+    bool haveSchedEntry = false;
+};
+}
+
+// clone/clone3 事件时读出创建标志：clone 在第一个参数里，clone3 在第一个参数指向的 clone_args 开头
+static quint64 clone_flags(PtraceBackend &kernel, const TracedTask &task) {
+    if (task.syscall == SYS_clone)
+        return task.args[0];
+#ifdef SYS_clone3
+    quint64 flags = 0;
+    if (task.syscall == SYS_clone3 && kernel.readMemory(task.tid, task.args[0], &flags, sizeof(flags)) == ssize_t(sizeof(flags)))
+        return flags;
+#else
+    Q_UNUSED(kernel);
+#endif
+    return 0;
 }
 
 void Tracer::start(unsigned int pid) {
-    m_running = true;
+    m_running.store(true);
+    // main() 已经为所有线程屏蔽了 SIGCHLD，这里再屏蔽一次本线程，保证 signalfd 能收到
+    blockChildSignal();
+    static const bool wakeHandlerInstalled = [] {
+        struct sigaction action = {};
+        action.sa_handler = on_wake_signal;
+        sigemptyset(&action.sa_mask);
+        return sigaction(kWakeSignal, &action, nullptr) == 0;
+    }();
+    // 登记追踪线程供 wake() 发送信号，任何返回路径上都撤销登记
+    struct ThreadRegistration {
+        Tracer *tracer;
+        explicit ThreadRegistration(Tracer *t) : tracer(t) {
+            std::lock_guard<std::mutex> lock(tracer->m_threadMutex);
+            tracer->m_thread = pthread_self();
+            tracer->m_threadActive = true;
+        }
+        ~ThreadRegistration() {
+            std::lock_guard<std::mutex> lock(tracer->m_threadMutex);
+            tracer->m_threadActive = false;
+            tracer->m_blockedInWait.store(false);
+        }
+    } registration(this);
+
+    // 没有指定后端时直接访问内核
+    LivePtraceBackend liveBackend;
+    PtraceBackend &kernel = m_backend ? *m_backend : liveBackend;
+    // 以下几项绕过后端直接读 /proc 或进程内存，回放时关闭
+    const bool live = kernel.live();
 
-    if (ptrace(PTRACE_ATTACH, pid, nullptr, nullptr) == -1) {
-        emit finished(QString("Error: Failed to attach to PID %1. Make sure you are running with sudo.").arg(pid));
+    // 按 cgroup 附加时没有单个目标进程：pid 置 0，只针对目标进程的几项统计随之不启用
+    CgroupWatch cgroup;
+    const bool cgroup_mode = !m_cgroup.isEmpty();
+    if (cgroup_mode) {
+        QString error;
+        if (!live) {
+            emit finished("Error: Attaching to a cgroup needs direct access to the kernel.");
+            return;
+        }
+        if (!cgroup.open(m_cgroup, &error)) {
+            emit finished(QString("Error: %1").arg(error));
+            return;
+        }
+        pid = 0;
+    }
+    // 跟随子进程时根进程退出后子进程还在，pidfd 会一直可读（水平触发）让追踪线程空转，
+    // 这时不监视根进程退出，全部停顿和退出都靠 SIGCHLD
+    const bool follow = m_followChildren || cgroup_mode;
+    if (!kernel.openEvents(follow ? 0 : pid, m_wakeFd)) {
+        emit finished(QString("Error: Failed to set up the tracer event loop: %1").arg(strerror(errno)));
         return;
     }
+    if (cgroup_mode && cgroup.notifyFd() != -1)
+        kernel.addEventFd(cgroup.notifyFd());
 
-    int status;
-    waitpid(pid, &status, 0);
+    // PTRACE_SEIZE 不向进程发送 SIGSTOP，之后可以随时用 PTRACE_INTERRUPT 让它停下；
+    // 第一次停顿由主循环收取，和其他停顿走同一套处理。
+    // exec 总是以事件停顿报告，用来刷新进程名；跟随子进程时 fork/vfork/clone 出的线程和进程由内核自动附加
+    unsigned long options = PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEEXEC;
+    if (follow)
+        options |= PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK | PTRACE_O_TRACECLONE;
+    if (!cgroup_mode) {
+        if (!kernel.seize(pid, options)) {
+            emit finished(QString("Error: Failed to attach to PID %1. Make sure you are running with sudo.").arg(pid));
+            return;
+        }
+        if (!kernel.interrupt(pid)) {
+            emit finished(QString("Error: Failed to stop process %1 after attaching.").arg(pid));
+            kernel.detach(pid, 0);
+            return;
+        }
+        qInfo() << "Successfully attached to PID" << pid;
+        if (m_addressSpace && live)
+            m_addressSpace->load(pid, kernel.now());
+    }
 
-    // 检查进程是否真的被附加了
-    if (!WIFSTOPPED(status)) {
-        emit finished(QString("Error: Failed to stop process %1 after attaching.").arg(pid));
-        ptrace(PTRACE_DETACH, pid, nullptr, nullptr);
-        return;
+    // 被追踪的线程；不跟随子进程时只有最初附加的这一个。unordered_map 插入时不移动元素，引用一直有效
+    std::unordered_map<pid_t, TracedTask> tasks;
+    std::unordered_set<pid_t> exited_early; // 父进程的事件到达之前就已退出的新线程
+    const pid_t wait_for = follow ? pid_t(-1) : pid_t(pid);
+    ProcessTree *tree = follow ? m_processTree : nullptr;
+    if (!cgroup_mode) {
+        const QString processName = kernel.processName(pid);
+        TracedTask &root = tasks[pid_t(pid)];
+        root.tid = root.tgid = pid_t(pid);
+        root.commId = m_strings ? m_strings->intern(processName) : 0;
+        if (tree)
+            root.process = tree->onAttach(pid_t(pid), processName, kernel.executablePath(pid), kernel.now());
     }
 
-    qInfo() << "Successfully attached to PID" << pid;
-    QString processName = get_process_name(pid);
+    // cgroup 里新出现的线程逐个 PTRACE_SEIZE + PTRACE_INTERRUPT，第一次停顿和最初附加的进程一样由主循环收取。
+    // seize 失败的多半已经退出，或者正由追踪中的父进程的 fork 事件自动附加（EPERM），之后照常收取。
+    // 同一进程的主线程排在前面，其他线程沿用它的进程节点
+    std::vector<CgroupWatch::Thread> newcomers;
+    quint64 next_cgroup_scan = 0;
+    auto scan_cgroup = [&](quint64 ts) {
+        next_cgroup_scan = ts + kCgroupRescanNs;
+        newcomers.clear();
+        cgroup.scan([&tasks](pid_t tid) { return tasks.count(tid) != 0; }, newcomers);
+        int attached = 0;
+        const TracedTask *process = nullptr; // 本轮上一个附加的线程，同一进程的线程排在一起
+        for (const CgroupWatch::Thread &t : newcomers) {
+            if (!kernel.seize(t.tid, options))
+                continue;
+            kernel.interrupt(t.tid);
+            attached++;
+            if (!process || process->tgid != t.tgid) {
+                auto leader = tasks.find(t.tgid);
+                process = leader != tasks.end() ? &leader->second : nullptr;
+            }
+            TracedTask &task = tasks[t.tid];
+            task.tid = t.tid;
+            task.tgid = t.tgid;
+            if (process) {
+                task.process = process->process;
+                task.commId = process->commId;
+                if (tree)
+                    tree->onThread(task.process);
+            } else {
+                const QString name = kernel.processName(t.tgid);
+                task.commId = m_strings ? m_strings->intern(name) : 0;
+                if (tree) {
+                    auto parent = tasks.find(t.ppid);
+                    task.process = tree->onAttach(t.tgid, name, kernel.executablePath(t.tgid), ts,
+                                                  parent != tasks.end() ? parent->second.process : -1);
+                }
+            }
+            process = &task;
+        }
+        return attached;
+    };
+    if (cgroup_mode) {
+        const int attached = scan_cgroup(kernel.now());
+        if (attached == 0 && !newcomers.empty()) {
+            emit finished(QString("Error: Failed to attach to cgroup %1. Make sure you are running with sudo.").arg(cgroup.directory()));
+            return;
+        }
+        qInfo() << "Attached to" << attached << "threads in cgroup" << cgroup.directory() << "(" << cgroup.cgroupCount() << "cgroups )";
+    }
 
-    ptrace(PTRACE_SETOPTIONS, pid, nullptr, PTRACE_O_TRACESYSGOOD);
+    // 调度统计采样（可选）
+    SchedSampler sampler;
+    const bool sched_sampling = m_schedSampling && live;
+    quint64 stop_overhead = sched_sampling ? calibrateStopOverhead() : 0;
 
-    bool is_syscall_entry = true;
-    long current_syscall = -1;
-    quint64 start_ts = 0;
+    // 调用栈采集（可选）：只对选中的 syscall 回溯，同一个返回地址只解析一次
+    std::unique_ptr<Symbolizer> symbolizer;
+    std::unique_ptr<StackUnwinder> unwinder;
+    std::vector<bool> stack_mask;
+    std::vector<quint32> leaf_ids;
+    std::unordered_map<quint64, quint32> frame_ids;
+    if (m_callTree && m_strings && !m_stackSyscalls.isEmpty() && live && !cgroup_mode) {
+        symbolizer = std::make_unique<Symbolizer>(pid);
+        unwinder = std::make_unique<StackUnwinder>();
+        stack_mask.assign(syscall_map.size() ? syscall_map.lastKey() + 1 : 0, false);
+        for (int nr : m_stackSyscalls) {
+            if (nr >= 0 && nr < int(stack_mask.size()))
+                stack_mask[nr] = true;
+        }
+        leaf_ids.assign(stack_mask.size(), 0);
+    }
+
+    // 追踪过滤（可选）：入口处按系统调用号预筛选，出口处对完整的事件求值
+    std::vector<bool> filter_mask;
+    if (!m_filter.isEmpty())
+        filter_mask = m_filter.syscallMask(syscall_map.size() ? int(syscall_map.lastKey()) + 1 : 0,
+                                           [](int nr) { return path_arg_index(nr) >= 0; });
+    // 地址空间、网络与锁竞争统计（可选）：相关调用在入口处记下参数，出口处更新，不经过入口预筛选。
+    // 这三项和调用栈只针对最初附加的进程（它的各个线程），子进程的地址和 fd 属于别的进程
+    const int syscall_count = syscall_map.size() ? int(syscall_map.lastKey()) + 1 : 0;
+    std::vector<quint8> tracked(size_t(syscall_count), 0);
+    enum { TrackMemory = 1, TrackNetwork = 2, TrackFutex = 4, TrackClone = 8 };
+    NetworkStats *network = live && !cgroup_mode ? m_network : nullptr;
+    for (int nr = 0; nr < syscall_count; ++nr) {
+        if (m_addressSpace && !cgroup_mode && is_memory_syscall(nr))
+            tracked[nr] |= TrackMemory;
+        if (network && NetworkStats::isNetworkSyscall(nr))
+            tracked[nr] |= TrackNetwork;
+        if (m_futex && !cgroup_mode && nr == SYS_futex)
+            tracked[nr] |= TrackFutex;
+        // clone 事件要用入口参数判断新任务是线程还是进程
+#ifdef SYS_clone3
+        if (follow && (nr == SYS_clone || nr == SYS_clone3))
+#else
+        if (follow && nr == SYS_clone)
+#endif
+            tracked[nr] |= TrackClone;
+        if (tracked[nr] && nr < int(filter_mask.size()))
+            filter_mask[nr] = true;
+    }
+    const quint8 root_only = TrackMemory | TrackNetwork | TrackFutex;
+
+    // 飞行记录器（可选）：取代事件队列，只保留最近的事件
+    std::unique_ptr<FlightRecorder> recorder;
+    if (m_flightRecorder && m_strings) {
+        m_dumpRequested.store(false, std::memory_order_relaxed);
+        recorder = std::make_unique<FlightRecorder>(m_recorderConfig, m_strings,
+            [this](const QString &path, const QString &reason, quint64 events, const QString &error) {
+                emit flightRecorderDumped(path, reason, events, error);
+            });
+    }
+
+    TracerMetrics &metrics = *m_metrics;
+    quint64 last_wake_ts = kernel.now();
 
-    while (m_running) {
-        if (ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr) == -1) break;
-        if (waitpid(pid, &status, 0) == -1) break;
+    auto resume = [&kernel](TracedTask &t) {
+        // 失败（线程刚被 SIGKILL）时也当作在运行，它的退出随后由 waitpid 收取
+        kernel.resume(t.tid, t.groupStop, t.groupStop ? 0 : t.resumeSignal);
+        t.running = true;
+    };
+    auto any_running = [&tasks]() {
+        return std::any_of(tasks.begin(), tasks.end(), [](const auto &entry) { return entry.second.running; });
+    };
 
-        if (!(WIFSTOPPED(status) && (WSTOPSIG(status) & 0x80))) continue;
+    // 刚附加时所有线程都在运行，等待 PTRACE_INTERRUPT 造成的第一次停顿
+    TracedTask *stopped = nullptr; // 刚处理完、等待恢复的线程
+    bool exited = false;
+    bool interrupting = false;    // 已请求停止追踪，并向运行中的线程发出了 PTRACE_INTERRUPT
+    quint64 interrupt_deadline = 0;
+    int status;
+
+    for (;;) {
+        if (stopped) {
+            // 已请求停止时保持停顿，最后统一 detach
+            if (m_running.load(std::memory_order_relaxed))
+                resume(*stopped);
+            stopped = nullptr;
+        }
+        if (!m_running.load(std::memory_order_relaxed) && !any_running())
+            break;
 
-        if (is_syscall_entry) {
+        // 热路径：直接阻塞在 waitpid 上，每次停顿只有一次系统调用；被追踪线程的退出也由它报告。
+        // 先宣布阻塞再检查请求，与 wake() 先发布请求再检查这个标记配对，两边至少有一边看到对方；
+        // 被唤醒信号打断（EINTR）时转入下面的 epoll 循环处理停止/转储请求。
+        // 按 cgroup 附加时还要等 inotify 和定时扫描，始终走 epoll
+        quint64 wait_begin_ts = kernel.now();
+        pid_t reaped = 0;
+        if (!cgroup_mode && wakeHandlerInstalled) {
+            m_blockedInWait.store(true);
+            if (m_running.load() && !m_dumpRequested.load()) {
+                reaped = kernel.waitStop(wait_for, &status, true);
+                if (reaped == -1 && errno == EINTR)
+                    reaped = 0;
+            }
+            m_blockedInWait.store(false);
+        } else if (tasks.size() > 1) {
+            // 线程多于一个时停顿可能已经在排队，先收取
+            reaped = kernel.waitStop(wait_for, &status, false);
+        }
+        // 睡在 epoll 上直到有停顿、停止/转储请求或进程退出，再用 WNOHANG 收取停顿
+        while (reaped == 0) {
+            if (!m_running.load(std::memory_order_relaxed) && !interrupting) {
+                // 线程可能正阻塞在系统调用里，让它们停下才能在停顿状态下 detach
+                for (auto &entry : tasks) {
+                    if (entry.second.running)
+                        kernel.interrupt(entry.first);
+                }
+                interrupting = true;
+                interrupt_deadline = kernel.now() + kInterruptTimeoutNs;
+            }
+            kernel.waitEvents(kPollFallbackMs);
+            // 进程空闲时手动转储也能及时完成
+            if (recorder && m_dumpRequested.load(std::memory_order_relaxed) && m_dumpRequested.exchange(false))
+                recorder->dump(FlightRecorder::ManualTrigger, kernel.now(), pid);
+            // cgroup 有变化（inotify）或到了重新扫描的时间时附加新成员
+            if (cgroup_mode && m_running.load(std::memory_order_relaxed)) {
+                const bool changed = cgroup.drain();
+                const quint64 ts = kernel.now();
+                if (changed || ts >= next_cgroup_scan)
+                    scan_cgroup(ts);
+            }
+            reaped = kernel.waitStop(wait_for, &status, false);
+            // cgroup 暂时没有被追踪的线程时 waitpid 报 ECHILD，继续等新成员；已请求停止时随之结束
+            if (reaped == -1 && cgroup_mode && tasks.empty() && m_running.load(std::memory_order_relaxed))
+                reaped = 0;
+            if (reaped == 0 && interrupting && kernel.now() > interrupt_deadline)
+                break;
+        }
+        if (reaped <= 0) {
+            if (reaped == 0)
+                qWarning() << "Tracer: PID" << pid << "did not stop in time; it is released when the tracer thread exits";
+            break;
+        }
+
+        quint64 wake_ts = kernel.now();
+        TracerMetrics::add(metrics.stops, 1);
+        TracerMetrics::add(metrics.waitNs, wake_ts - wait_begin_ts);
+        TracerMetrics::add(metrics.processNs, wait_begin_ts - last_wake_ts);
+        last_wake_ts = wake_ts;
+        // 一直有停顿时不会睡到 epoll 上，按时间重新扫描 cgroup，inotify 的事件也在这时读空
+        if (cgroup_mode && wake_ts >= next_cgroup_scan && m_running.load(std::memory_order_relaxed)) {
+            cgroup.drain();
+            scan_cgroup(wake_ts);
+        }
+
+        auto found = tasks.find(reaped);
+        if (found == tasks.end()) {
+            if (WIFEXITED(status) || WIFSIGNALED(status)) {
+                exited_early.insert(reaped);
+            } else {
+                // 自动附加的新线程的第一次停顿：等父进程的 fork/clone 事件确定归属
+                TracedTask &t = tasks[reaped];
+                t.tid = reaped;
+                t.running = false;
+                t.held = true;
+            }
+            continue;
+        }
+        TracedTask &task = found->second;
+        task.running = false;
+
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            // 主线程的退出要等其他线程都退出后才报告，此时整个进程结束
+            if (tree && task.tid == task.tgid)
+                tree->onExit(task.process, status, wake_ts);
+            if (sched_sampling)
+                sampler.forget(task.tid);
+            tasks.erase(found);
+            // 按 cgroup 附加时成员全部退出也继续等新成员，直到 stop()
+            if (tasks.empty() && !cgroup_mode) {
+                exited = true;
+                break;
+            }
+            continue;
+        }
+        stopped = &task;
+
+        task.resumeSignal = 0;
+        task.groupStop = false;
+        if (WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+            const int stop_signal = WSTOPSIG(status);
+            const int event = status >> 16;
+            if (event == PTRACE_EVENT_STOP) {
+                // PTRACE_INTERRUPT 或自动附加造成的停顿（SIGTRAP），或组停止
+                task.groupStop = stop_signal == SIGSTOP || stop_signal == SIGTSTP || stop_signal == SIGTTIN || stop_signal == SIGTTOU;
+            } else if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK || event == PTRACE_EVENT_CLONE) {
+                unsigned long message = 0;
+                const pid_t child = kernel.eventMessage(task.tid, &message) ? pid_t(message) : 0;
+                if (child <= 0 || exited_early.erase(child))
+                    continue;
+                const bool thread = event == PTRACE_EVENT_CLONE && (clone_flags(kernel, task) & CLONE_THREAD);
+                auto [it, inserted] = tasks.try_emplace(child);
+                TracedTask &c = it->second;
+                const bool held = !inserted && c.held;
+                c.tid = child;
+                c.tgid = thread ? task.tgid : child;
+                c.commId = task.commId;
+                if (thread) {
+                    c.process = task.process;
+                    if (tree)
+                        tree->onThread(task.process);
+                } else if (tree) {
+                    c.process = tree->onFork(task.process, child, wake_ts);
+                }
+                c.held = false;
+                if (!held)
+                    c.running = true; // 它的第一次停顿还没到
+                else if (m_running.load(std::memory_order_relaxed))
+                    resume(c);
+            } else if (event == PTRACE_EVENT_EXEC) {
+                // 非主线程 exec 时它接管了主线程的 tid，原来的主线程不再报告退出：把 exec 线程的状态搬过来
+                unsigned long former = 0;
+                if (kernel.eventMessage(task.tid, &former) && pid_t(former) != task.tid) {
+                    auto it = tasks.find(pid_t(former));
+                    if (it != tasks.end()) {
+                        task = std::move(it->second);
+                        task.tid = reaped;
+                        task.running = false;
+                        tasks.erase(it);
+                    }
+                }
+                const QString name = kernel.processName(task.tid);
+                if (m_strings)
+                    task.commId = m_strings->intern(name);
+                if (tree)
+                    tree->onExec(task.process, name, kernel.executablePath(task.tid), wake_ts);
+                if (task.tgid == pid_t(pid) && live) {
+                    // 最初附加的进程换了映像：地址空间和符号都要重新读入
+                    if (m_addressSpace)
+                        m_addressSpace->reload(pid, wake_ts);
+                    if (symbolizer) {
+                        symbolizer = std::make_unique<Symbolizer>(pid);
+                        frame_ids.clear();
+                    }
+                }
+            } else if (event == 0) {
+                task.resumeSignal = stop_signal;
+            }
+            continue;
+        }
+
+        if (!task.inSyscall) {
             // 系统调用入口
+            task.inSyscall = true;
             struct user_regs_struct regs_entry;
-            if (ptrace(PTRACE_GETREGS, pid, nullptr, &regs_entry) == -1) break;
+            if (!kernel.getRegs(task.tid, &regs_entry)) {
+                task.skipCall = true;
+                continue;
+            }
+
+            const long nr = regs_entry.orig_rax;
+            task.syscall = nr;
+            task.skipCall = nr >= 0 && nr < long(filter_mask.size()) && !filter_mask[nr];
+            if (task.skipCall) {
+                // 不解码路径、不回溯、不采样，出口处也不读寄存器
+                TracerMetrics::add(metrics.filtered, 1);
+                continue;
+            }
+
+            task.tracked = (nr >= 0 && nr < syscall_count) ? tracked[nr] : 0;
+            if (task.tgid != pid_t(pid))
+                task.tracked &= quint8(~root_only);
+            if (task.tracked) {
+                for (int i = 0; i < 6; ++i)
+                    task.args[i] = syscall_arg(regs_entry, i);
+            }
+
+            // 解码路径参数，出口处驻留后只随事件传递 32 位 id
+            task.pathLen = -1;
+            int path_index = path_arg_index(nr);
+            if (path_index >= 0 && m_strings) {
+                if (!task.path)
+                    task.path = std::make_unique<char[]>(PATH_MAX);
+                task.pathLen = read_tracee_string(kernel, task.tid, syscall_arg(regs_entry, path_index), task.path.get(), PATH_MAX);
+            }
 
-            current_syscall = regs_entry.orig_rax;
-            start_ts = get_timestamp_ns();
+            task.stackDepth = -1;
+            if (unwinder && task.tgid == pid_t(pid) && nr >= 0 && nr < long(stack_mask.size()) && stack_mask[nr]) {
+                quint64 stack_begin = kernel.now();
+                quint64 pcs[StackUnwinder::kMaxFrames];
+                int n = unwinder->capture(task.tid, regs_entry, *symbolizer, pcs, StackUnwinder::kMaxFrames);
+                if (!task.stackFrames)
+                    task.stackFrames = std::make_unique<quint32[]>(StackUnwinder::kMaxFrames);
+                // 调用树从最外层开始；地址减 1 落回 call/syscall 指令本身，避免解析到紧随其后的下一个函数
+                task.stackDepth = 0;
+                for (int i = n - 1; i >= 0; --i) {
+                    quint64 pc = pcs[i] - 1;
+                    auto it = frame_ids.find(pc);
+                    if (it == frame_ids.end())
+                        it = frame_ids.emplace(pc, m_strings->intern(symbolizer->symbolize(pc))).first;
+                    task.stackFrames[task.stackDepth++] = it->second;
+                }
+                if (leaf_ids[nr] == 0)
+                    leaf_ids[nr] = m_strings->intern(getSyscallName(nr));
+                TracerMetrics::add(metrics.stacks, 1);
+                TracerMetrics::add(metrics.stackNs, kernel.now() - stack_begin);
+            }
+
+            if (sched_sampling)
+                task.haveSchedEntry = sampler.sample(task.tid, task.schedEntry);
+            task.startTs = kernel.now();
 
         } else {
             // 系统调用出口
+            task.inSyscall = false;
+            if (task.skipCall)
+                continue;
             struct user_regs_struct regs_exit;
-            if (ptrace(PTRACE_GETREGS, pid, nullptr, &regs_exit) == -1) break;
+            if (!kernel.getRegs(task.tid, &regs_exit))
+                continue;
 
-            quint64 end_ts = get_timestamp_ns();
-            quint64 duration = (end_ts > start_ts) ? (end_ts - start_ts) : 0;
+            quint64 end_ts = kernel.now();
+            quint64 duration = (end_ts > task.startTs) ? (end_ts - task.startTs) : 0;
+            // 扣除标定的 ptrace 停顿开销
+            duration = (duration > stop_overhead) ? (duration - stop_overhead) : 0;
 
             // 从 regs_exit.rax 获取返回值
+            const long nr = task.syscall;
             long return_value = regs_exit.rax;
+            const int stack_depth = std::max(task.stackDepth, 0);
+            if (task.tracked & TrackMemory)
+                apply_memory_syscall(m_addressSpace, nr, task.args, return_value, end_ts);
+            if (task.tracked & TrackNetwork)
+                network->onSyscall(task.tgid, nr, task.args, return_value, end_ts, duration);
+            if (task.tracked & TrackFutex)
+                m_futex->onSyscall(task.tid, task.args, return_value, end_ts, duration, task.stackFrames.get(), stack_depth);
 
-            // 发射带有返回值的信号
-            emit newSyscallData(start_ts, duration, return_value, current_syscall, pid, processName);
-        }
+            // 写入事件队列；GUI 来不及取走导致队列已满时丢弃，由 dropped 计数反映
+            SyscallEvent event;
+            event.ts = task.startTs;
+            event.duration = duration;
+            event.ret = return_value;
+            event.pid = task.tgid;
+            event.tid = task.tid;
+            event.commId = task.commId;
+            event.pathId = 0;
+            event.argRef = 0;
+            event.syscall = qint16(nr);
+            event.flags = 0;
+            const char *path = task.pathLen > 0 ? task.path.get() : nullptr;
+            if (!m_filter.isEmpty() && !m_filter.matches(event, path)) {
+                TracerMetrics::add(metrics.filtered, 1);
+                task.haveSchedEntry = false;
+                continue;
+            }
+            if (path)
+                event.pathId = m_strings->intern(std::string_view(path, size_t(task.pathLen)));
+            if (tree)
+                tree->onSyscall(task.process, nr, return_value, duration);
+            if (recorder) {
+                FlightRecorder::Trigger reason = recorder->record(event);
+                if (reason != FlightRecorder::NoTrigger)
+                    recorder->dump(reason, end_ts, pid);
+            } else if (m_queue && m_queue->push(event)) {
+                TracerMetrics::add(metrics.emitted, 1);
+            } else {
+                TracerMetrics::add(metrics.dropped, 1);
+            }
+
+            if (task.stackDepth >= 0)
+                m_callTree->add(task.stackFrames.get(), task.stackDepth, leaf_ids[nr], duration);
 
-        is_syscall_entry = !is_syscall_entry; // 切换状态
+            SchedSample sched_exit;
+            if (task.haveSchedEntry && sampler.sample(task.tid, sched_exit)) {
+                // 采样点位于停顿期间，两次采样之间的 run/wait 增量就是本次调用期间的值
+                quint64 on_cpu = sched_exit.runNs - task.schedEntry.runNs;
+                quint64 runq_wait = sched_exit.waitNs - task.schedEntry.waitNs;
+                // 计数器精度有限，拆分结果不超过总耗时
+                on_cpu = std::min(on_cpu, duration);
+                runq_wait = std::min(runq_wait, duration - on_cpu);
+                quint64 blocked = duration - on_cpu - runq_wait;
+                emit newSyscallTiming(nr, on_cpu, runq_wait, blocked);
+            }
+            task.haveSchedEntry = false;
+        }
     }
 
-    ptrace(PTRACE_DETACH, pid, nullptr, nullptr);
-    qInfo() << "Detached from PID" << pid;
-    emit finished("Tracer stopped.");
+    // 只能在停顿状态下 detach；待投递的信号一并交还，组停止中的线程继续保持停止
+    int detached = 0;
+    for (auto &entry : tasks) {
+        TracedTask &t = entry.second;
+        if (!t.running && kernel.detach(t.tid, t.groupStop ? 0 : t.resumeSignal))
+            detached++;
+    }
+    if (detached)
+        qInfo() << "Detached from" << (cgroup_mode ? cgroup.directory() : QString("PID %1").arg(pid)) << "(" << detached << "threads )";
+    if (tree)
+        tree->onDetach(kernel.now());
+    // 等后台线程把最后一个文件写完
+    recorder.reset();
+    emit finished(exited ? QString("Tracer stopped: process %1 exited.").arg(pid) : QString("Tracer stopped."));
 }
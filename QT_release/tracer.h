@@ -3,26 +3,111 @@
 
 #include <QObject>
 #include <QString>
+#include <QSet>
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
+#include "tracermetrics.h"
+#include "flightrecorder.h"
+#include "syscallfilter.h"
+class EventQueue;
+class StringTable;
+class CallTree;
+class AddressSpace;
+class NetworkStats;
+class FutexStats;
+class ProcessTree;
+class PtraceBackend;
 QString get_process_name(pid_t pid);
 class Tracer : public QObject
 {
     Q_OBJECT
 public:
     explicit Tracer(QObject *parent = nullptr);
+    ~Tracer() override;
+    // 任意线程调用：唤醒追踪线程并在有界时间内结束追踪，被追踪进程空闲（不产生停顿）时也一样
     void stop();
+    // 在 start() 之前调用：开启后在系统调用边界采样调度统计，并扣除标定出的 ptrace 停顿开销
+    void setSchedSampling(bool enabled) { m_schedSampling = enabled; }
+    // 在 start() 之前调用：自监控计数器由调用方持有，不设置时写入 Tracer 自己的一份
+    void setMetrics(TracerMetrics *metrics) { m_metrics = metrics ? metrics : &m_ownMetrics; }
+    // 在 start() 之前调用：事件写入 queue，进程名和路径参数驻留到 strings，两者都由调用方持有
+    void setEventSink(EventQueue *queue, StringTable *strings) { m_queue = queue; m_strings = strings; }
+    // 在 start() 之前调用：syscalls 中的系统调用在入口处回溯用户栈，按调用路径把耗时累计到 tree（由调用方持有）。
+    // 帧名驻留到 setEventSink() 给出的 StringTable，因此两者需要一起设置
+    void setStackCapture(const QSet<int> &syscalls, CallTree *tree) { m_stackSyscalls = syscalls; m_callTree = tree; }
+    // 在 start() 之前调用：开启飞行记录器模式后事件只进入预分配的环形缓冲区，不再发给界面，触发时写出文件
+    void setFlightRecorder(bool enabled, const FlightRecorder::Config &config) { m_flightRecorder = enabled; m_recorderConfig = config; }
+    // 在 start() 之前调用：只有匹配 filter 的事件才会进入队列、飞行记录器、调用树和调度统计；空的 filter 不过滤
+    void setFilter(const SyscallFilter &filter) { m_filter = filter; }
+    // 在 start() 之前调用：附加时读入进程已有的映射，之后按 mmap/munmap/mremap/mprotect/brk 增量更新 space（由调用方持有）。
+    // 这几个系统调用不受追踪过滤影响，否则地址空间会与实际不符
+    void setAddressSpace(AddressSpace *space) { m_addressSpace = space; }
+    // 在 start() 之前调用：网络相关调用（socket、connect、accept、收发、close、epoll_wait）的出口交给 stats（由调用方持有）
+    // 按连接累计；同样不受追踪过滤影响
+    void setNetworkStats(NetworkStats *stats) { m_network = stats; }
+    // 在 start() 之前调用：futex 的出口按 uaddr 交给 stats（由调用方持有）统计等待与唤醒；
+    // futex 同时在 setStackCapture() 的列表中时附带调用栈。同样不受追踪过滤影响
+    void setFutexStats(FutexStats *stats) { m_futex = stats; }
+    // 在 start() 之前调用：开启后 fork/vfork/clone 出的线程和子进程都被自动附加，事件带各自的 pid/tid 和进程名，
+    // 直到它们全部退出；地址空间、网络、锁竞争和调用栈仍只针对最初附加的进程
+    void setFollowChildren(bool enabled) { m_followChildren = enabled; }
+    // 在 start() 之前调用：跟随子进程时按进程和可执行映像统计调用，写入 tree（由调用方持有）
+    void setProcessTree(ProcessTree *tree) { m_processTree = tree; }
+    // 在 start() 之前调用：path 不为空时按 cgroup 附加，start() 的 pid 不再使用——附加 cgroup 子树里现有的全部线程，
+    // 之后移入的进程经 inotify 和定期重新扫描附加，并总是跟随子进程；cgroup 空了也继续等，直到 stop()。
+    // 地址空间、网络、锁竞争和调用栈这几项按单个进程统计，此时不启用，按进程的拆分看 setProcessTree() 的进程树
+    void setCgroup(const QString &path) { m_cgroup = path; }
+    // 在 start() 之前调用：ptrace、收取停顿、读寄存器/内存和时钟都经 backend（由调用方持有），
+    // 用于录制和回放停顿序列；不设置时直接访问内核
+    void setBackend(PtraceBackend *backend) { m_backend = backend; }
+    // 任意线程调用：请求飞行记录器在下一次停顿时写出一份（手动触发）
+    void requestDump();
+    // 在创建任何线程之前调用（main 开头）：所有线程都屏蔽 SIGCHLD，ptrace 停顿通知只经追踪线程的 signalfd 读取
+    static void blockChildSignal();
+    // 用一个自跟踪的子进程测量一次 syscall-entry/exit 停顿往返的开销（ns），结果只测一次并缓存
+    static quint64 calibrateStopOverhead();
 
 public slots:
     // 启动追踪，接收 PID 作为参数
     void start(unsigned int pid);
 
 signals:
-    // 当捕获到新的系统调用时，发射此信号
-    void newSyscallData(quint64 ts, quint64 duration, long ret, long syscall, unsigned int pid, const QString& comm);
+    // 开启调度采样时，每个系统调用额外发射一次：耗时拆分为 on-CPU、运行队列等待、阻塞三部分
+    void newSyscallTiming(long syscall, quint64 onCpu, quint64 runqWait, quint64 blocked);
+    // 飞行记录器写完一个文件后发射（来自写文件的后台线程），失败时 error 不为空
+    void flightRecorderDumped(const QString &path, const QString &reason, quint64 events, const QString &error);
     // 当追踪结束时发射
     void finished(const QString& message);
 
 private:
-    volatile bool m_running = false;
+    void wake();
+
+    std::atomic<bool> m_running{false};
+    int m_wakeFd = -1; // eventfd：stop() 和 requestDump() 用它唤醒阻塞在 epoll 上的追踪线程
+    // 阻塞在 waitpid 上的追踪线程由 wake() 发送线程定向的信号打断；m_threadMutex 保证信号不会发给已经结束的线程
+    std::mutex m_threadMutex;
+    pthread_t m_thread = 0;
+    bool m_threadActive = false;
+    std::atomic<bool> m_blockedInWait{false};
+    bool m_schedSampling = false;
+    TracerMetrics m_ownMetrics;
+    TracerMetrics *m_metrics = &m_ownMetrics;
+    EventQueue *m_queue = nullptr;
+    StringTable *m_strings = nullptr;
+    QSet<int> m_stackSyscalls;
+    CallTree *m_callTree = nullptr;
+    bool m_flightRecorder = false;
+    FlightRecorder::Config m_recorderConfig;
+    SyscallFilter m_filter;
+    AddressSpace *m_addressSpace = nullptr;
+    NetworkStats *m_network = nullptr;
+    FutexStats *m_futex = nullptr;
+    bool m_followChildren = false;
+    ProcessTree *m_processTree = nullptr;
+    QString m_cgroup;
+    PtraceBackend *m_backend = nullptr;
+    std::atomic<bool> m_dumpRequested{false};
 };
 
 #endif // TRACER_H
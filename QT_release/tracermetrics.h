@@ -0,0 +1,46 @@
+#ifndef TRACERMETRICS_H
+#define TRACERMETRICS_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <initializer_list>
+
+// 追踪器与 GUI 的自监控计数器。
+// 由 MainWindow 持有（生命周期长于 Tracer），Tracer 线程与 GUI 线程各写各的字段，
+// 全部使用 relaxed 原子操作：只用于展示，不需要与其他数据建立先后关系。
+struct TracerMetrics
+{
+    // --- 追踪线程写 ---
+    alignas(64) std::atomic<quint64> stops{0};        // ptrace 停顿次数
+    std::atomic<quint64> waitNs{0};                   // 阻塞在 waitpid 中的时间
+    std::atomic<quint64> processNs{0};                // 两次 waitpid 之间处理停顿的时间
+    std::atomic<quint64> emitted{0};                  // 已写入事件队列的事件数
+    std::atomic<quint64> dropped{0};                  // 事件队列已满时丢弃的事件数
+    std::atomic<quint64> filtered{0};                 // 被追踪过滤表达式排除的事件数
+    std::atomic<quint64> stacks{0};                   // 回溯的调用栈数
+    std::atomic<quint64> stackNs{0};                  // 回溯与符号解析的累计耗时
+
+    // --- GUI 线程写 ---
+    alignas(64) std::atomic<quint64> consumed{0};     // GUI 已处理的事件数
+    std::atomic<quint64> handleNs{0};                 // GUI 从队列取事件并处理的累计耗时
+    std::atomic<quint64> lastFlushNs{0};              // 最近一次面板批量刷新的耗时
+    std::atomic<quint64> storageBytes{0};             // 事件存储（事件块 + Arena）占用的内存
+
+    quint64 queueDepth() const {
+        quint64 e = emitted.load(std::memory_order_relaxed);
+        quint64 c = consumed.load(std::memory_order_relaxed);
+        return e > c ? e - c : 0;
+    }
+
+    static void add(std::atomic<quint64> &counter, quint64 v) {
+        counter.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (std::atomic<quint64> *c : { &stops, &waitNs, &processNs, &emitted, &dropped, &filtered, &stacks, &stackNs,
+                                         &consumed, &handleNs, &lastFlushNs, &storageBytes })
+            c->store(0, std::memory_order_relaxed);
+    }
+};
+
+#endif // TRACERMETRICS_H
@@ -1,10 +1,13 @@
 #include <sys/ptrace.h>
 #include <sys/wait.h>
 #include <sys/user.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <bits/stdc++.h>
 #include <errno.h>
-#include "syscall_table.h" // syscall_names: std::map<long, std::string>
+#include <signal.h>
+#include <time.h>
+#include "syscall_table.h" // syscall_names: std::unordered_map<long, std::string>
 
 #define COLOR_SYSCALL "\033[1;32m"
 #define COLOR_ARGTYPE "\033[1;34m"
@@ -14,130 +17,662 @@
 
 using namespace std;
 
-// 用于描述哪些参数是字符串（最多支持6个参数）
-struct SyscallParamInfo {
-    vector<int> string_indices; // 比如 {0,1} 表示第1、第2个参数是字符串
+// 用法：hello [-c | -C] [--bench N] [pid]
+//   默认每个系统调用输出一行，格式与 strace 相同：openat(-100, "/etc/passwd", 0x80000) = 3
+//   -c  只在结束时输出汇总表（与 strace -c 相同的列），-C 同时输出每行和汇总表
+//   --bench N  不追踪，把 N 个构造的调用按同样的路径格式化输出，用来测输出吞吐量（结果写到 stderr）
+//   没有给出 pid 时从标准输入读取；Ctrl-C 结束追踪并 detach
+// 只有标准输出是终端时才带颜色；输出先写进预分配的缓冲区，满了（或终端上追踪进程即将阻塞时）才整块 write(2)
+
+static const int kMaxSyscall = 512;
+static const int kMaxStringLen = 32;  // 字符串参数最多显示的字节数，同 strace -s 32
+static const int kMaxArgv = 16;       // execve 的 argv 最多显示的项数
+static const size_t kMaxLine = 8192;  // 一行的上限，由上面两个上限保证
+
+// --- 每个系统调用的静态信息：启动时从名字表建好，追踪时按调用号直接下标访问 ---
+
+struct SyscallInfo {
+    const char *name = nullptr;
+    unsigned char nameLen = 0;
+    unsigned char nargs = 6;       // 没有列出的按 6 个参数输出
+    unsigned char stringArgs = 0;  // 位图：第 i 位表示第 i 个参数是 C 字符串
+    signed char argvArg = -1;      // execve/execveat：第几个参数是 argv，按字符串数组输出
+    unsigned char pointerArgs = 0; // 位图：第 i 位表示第 i 个参数是指针，为 0 时输出 NULL
 };
-std::map<long, std::string> syscall_arg_types = {
-    {59, "execve(const char *filename, char *const argv[], char *const envp[])"},
-    {257, "openat(int dirfd, const char *pathname, int flags, mode_t mode)"},
-    {2, "open(const char *pathname, int flags, mode_t mode)"},
-    {21, "access(const char *pathname, int mode)"},
+static SyscallInfo g_syscalls[kMaxSyscall];
+
+static const pair<const char*, int> kArgCounts[] = {
+    {"read", 3}, {"write", 3}, {"open", 3}, {"close", 1}, {"stat", 2}, {"fstat", 2}, {"lstat", 2},
+    {"poll", 3}, {"lseek", 3}, {"mmap", 6}, {"mprotect", 3}, {"munmap", 2}, {"brk", 1},
+    {"rt_sigaction", 4}, {"rt_sigprocmask", 4}, {"rt_sigreturn", 0}, {"ioctl", 3}, {"pread64", 4},
+    {"pwrite64", 4}, {"readv", 3}, {"writev", 3}, {"access", 2}, {"pipe", 1}, {"select", 5},
+    {"sched_yield", 0}, {"mremap", 5}, {"msync", 3}, {"mincore", 3}, {"madvise", 3}, {"dup", 1},
+    {"dup2", 2}, {"pause", 0}, {"nanosleep", 2}, {"getitimer", 2}, {"alarm", 1}, {"setitimer", 3},
+    {"getpid", 0}, {"sendfile", 4}, {"socket", 3}, {"connect", 3}, {"accept", 3}, {"sendto", 6},
+    {"recvfrom", 6}, {"sendmsg", 3}, {"recvmsg", 3}, {"shutdown", 2}, {"bind", 3}, {"listen", 2},
+    {"getsockname", 3}, {"getpeername", 3}, {"socketpair", 4}, {"setsockopt", 5}, {"getsockopt", 5},
+    {"clone", 5}, {"fork", 0}, {"vfork", 0}, {"execve", 3}, {"exit", 1}, {"wait4", 4}, {"kill", 2},
+    {"uname", 1}, {"fcntl", 3}, {"flock", 2}, {"fsync", 1}, {"fdatasync", 1}, {"truncate", 2},
+    {"ftruncate", 2}, {"getdents", 3}, {"getcwd", 2}, {"chdir", 1}, {"fchdir", 1}, {"rename", 2},
+    {"mkdir", 2}, {"rmdir", 1}, {"creat", 2}, {"link", 2}, {"unlink", 1}, {"symlink", 2},
+    {"readlink", 3}, {"chmod", 2}, {"fchmod", 2}, {"chown", 3}, {"fchown", 3}, {"lchown", 3},
+    {"umask", 1}, {"gettimeofday", 2}, {"getrlimit", 2}, {"getrusage", 2}, {"sysinfo", 1},
+    {"times", 1}, {"ptrace", 4}, {"getuid", 0}, {"getgid", 0}, {"setuid", 1}, {"setgid", 1},
+    {"geteuid", 0}, {"getegid", 0}, {"setpgid", 2}, {"getppid", 0}, {"getpgrp", 0}, {"setsid", 0},
+    {"sigaltstack", 2}, {"statfs", 2}, {"fstatfs", 2}, {"mlock", 2}, {"munlock", 2}, {"prctl", 5},
+    {"arch_prctl", 2}, {"gettid", 0}, {"futex", 6}, {"sched_setaffinity", 3},
+    {"sched_getaffinity", 3}, {"epoll_create", 1}, {"getdents64", 3}, {"set_tid_address", 1},
+    {"clock_gettime", 2}, {"clock_getres", 2}, {"clock_nanosleep", 4}, {"exit_group", 1},
+    {"epoll_wait", 4}, {"epoll_ctl", 4}, {"tgkill", 3}, {"openat", 3}, {"mkdirat", 3},
+    {"newfstatat", 4}, {"unlinkat", 3}, {"renameat", 4}, {"readlinkat", 4}, {"faccessat", 3},
+    {"pselect6", 6}, {"ppoll", 5}, {"set_robust_list", 2}, {"get_robust_list", 3},
+    {"epoll_pwait", 6}, {"timerfd_create", 2}, {"eventfd2", 2}, {"epoll_create1", 1}, {"dup3", 3},
+    {"pipe2", 2}, {"inotify_init1", 1}, {"signalfd4", 4}, {"recvmmsg", 5}, {"sendmmsg", 4},
+    {"prlimit64", 4}, {"getcpu", 3}, {"getrandom", 3}, {"memfd_create", 2}, {"execveat", 5},
+    {"statx", 5}, {"rseq", 4}, {"clone3", 2}, {"close_range", 3}, {"faccessat2", 4},
 };
 
-std::map<long, SyscallParamInfo> string_param_map = {
-    {59, {{0, 1}}},    // execve(filename, argv, envp)
-    {2,  {{0}}},       // open(pathname, ...)
-    {257, {{1}}},      // openat(dirfd, pathname, ...)
-    {21, {{0}}},       // access(pathname, ...)
-    {0,  {}},          // read(fd, buf, count) - buf 不是字符串，不解析
+// 路径参数（第几个参数是字符串）
+static const pair<const char*, unsigned char> kStringArgs[] = {
+    {"open", 1 << 0}, {"stat", 1 << 0}, {"lstat", 1 << 0}, {"access", 1 << 0}, {"execve", 1 << 0},
+    {"truncate", 1 << 0}, {"chdir", 1 << 0}, {"rename", 1 << 0 | 1 << 1}, {"mkdir", 1 << 0},
+    {"rmdir", 1 << 0}, {"creat", 1 << 0}, {"link", 1 << 0 | 1 << 1}, {"unlink", 1 << 0},
+    {"symlink", 1 << 0 | 1 << 1}, {"readlink", 1 << 0}, {"chmod", 1 << 0}, {"chown", 1 << 0},
+    {"lchown", 1 << 0}, {"statfs", 1 << 0}, {"openat", 1 << 1}, {"mkdirat", 1 << 1},
+    {"newfstatat", 1 << 1}, {"unlinkat", 1 << 1}, {"renameat", 1 << 1 | 1 << 3},
+    {"readlinkat", 1 << 1}, {"faccessat", 1 << 1}, {"faccessat2", 1 << 1}, {"statx", 1 << 1},
+    {"execveat", 1 << 1}, {"memfd_create", 1 << 0},
 };
 
-std::string read_string(pid_t pid, unsigned long addr) {
-    std::string result;
-    union {
-        long word;
-        char chars[sizeof(long)];
-    } data;
+// 指针参数（缓冲区、结构体、输出参数）：同 strace，空指针输出 NULL，其余按十六进制
+static const pair<const char*, unsigned char> kPointerArgs[] = {
+    {"read", 1 << 1}, {"write", 1 << 1}, {"stat", 1 << 1}, {"fstat", 1 << 1}, {"lstat", 1 << 1},
+    {"poll", 1 << 0}, {"mmap", 1 << 0}, {"mprotect", 1 << 0}, {"munmap", 1 << 0}, {"brk", 1 << 0},
+    {"rt_sigaction", 1 << 1 | 1 << 2}, {"rt_sigprocmask", 1 << 1 | 1 << 2}, {"pread64", 1 << 1},
+    {"pwrite64", 1 << 1}, {"readv", 1 << 1}, {"writev", 1 << 1}, {"pipe", 1 << 0},
+    {"select", 1 << 1 | 1 << 2 | 1 << 3 | 1 << 4}, {"mremap", 1 << 0 | 1 << 4}, {"msync", 1 << 0},
+    {"mincore", 1 << 0 | 1 << 2}, {"madvise", 1 << 0}, {"nanosleep", 1 << 0 | 1 << 1},
+    {"getitimer", 1 << 1}, {"setitimer", 1 << 1 | 1 << 2}, {"sendfile", 1 << 2}, {"connect", 1 << 1},
+    {"accept", 1 << 1 | 1 << 2}, {"sendto", 1 << 1 | 1 << 4}, {"recvfrom", 1 << 1 | 1 << 4 | 1 << 5},
+    {"sendmsg", 1 << 1}, {"recvmsg", 1 << 1}, {"bind", 1 << 1}, {"getsockname", 1 << 1 | 1 << 2},
+    {"getpeername", 1 << 1 | 1 << 2}, {"socketpair", 1 << 3}, {"setsockopt", 1 << 3},
+    {"getsockopt", 1 << 3 | 1 << 4}, {"clone", 1 << 1 | 1 << 2 | 1 << 3}, {"execve", 1 << 2},
+    {"wait4", 1 << 1 | 1 << 3}, {"uname", 1 << 0}, {"getdents", 1 << 1}, {"getcwd", 1 << 0},
+    {"readlink", 1 << 1}, {"gettimeofday", 1 << 0 | 1 << 1}, {"getrlimit", 1 << 1},
+    {"getrusage", 1 << 1}, {"sysinfo", 1 << 0}, {"times", 1 << 0}, {"ptrace", 1 << 2 | 1 << 3},
+    {"sigaltstack", 1 << 0 | 1 << 1}, {"statfs", 1 << 1}, {"fstatfs", 1 << 1}, {"mlock", 1 << 0},
+    {"munlock", 1 << 0}, {"futex", 1 << 0 | 1 << 3 | 1 << 4}, {"sched_setaffinity", 1 << 2},
+    {"sched_getaffinity", 1 << 2}, {"getdents64", 1 << 1}, {"set_tid_address", 1 << 0},
+    {"clock_gettime", 1 << 1}, {"clock_getres", 1 << 1}, {"clock_nanosleep", 1 << 2 | 1 << 3},
+    {"epoll_wait", 1 << 1}, {"epoll_ctl", 1 << 3}, {"newfstatat", 1 << 2}, {"readlinkat", 1 << 2},
+    {"pselect6", 1 << 1 | 1 << 2 | 1 << 3 | 1 << 4 | 1 << 5}, {"ppoll", 1 << 0 | 1 << 2 | 1 << 3},
+    {"set_robust_list", 1 << 0}, {"get_robust_list", 1 << 1 | 1 << 2}, {"epoll_pwait", 1 << 1 | 1 << 4},
+    {"signalfd4", 1 << 1}, {"pipe2", 1 << 0}, {"recvmmsg", 1 << 1 | 1 << 4}, {"sendmmsg", 1 << 1},
+    {"prlimit64", 1 << 2 | 1 << 3}, {"getcpu", 1 << 0 | 1 << 1 | 1 << 2}, {"getrandom", 1 << 0},
+    {"execveat", 1 << 3}, {"statx", 1 << 4}, {"rseq", 1 << 0}, {"clone3", 1 << 0},
+};
 
-    while (true) {
-        errno = 0;
-        data.word = ptrace(PTRACE_PEEKDATA, pid, addr, nullptr);
-        if (errno != 0) break;
+static void init_syscall_info() {
+    unordered_map<string, int> by_name;
+    for (const auto &entry : syscall_names) {
+        if (entry.first < 0 || entry.first >= kMaxSyscall)
+            continue;
+        SyscallInfo &info = g_syscalls[entry.first];
+        info.name = entry.second.c_str();
+        info.nameLen = (unsigned char)min<size_t>(entry.second.size(), 255);
+        by_name[entry.second] = int(entry.first);
+    }
+    for (const auto &entry : kArgCounts) {
+        auto it = by_name.find(entry.first);
+        if (it != by_name.end())
+            g_syscalls[it->second].nargs = (unsigned char)entry.second;
+    }
+    for (const auto &entry : kStringArgs) {
+        auto it = by_name.find(entry.first);
+        if (it != by_name.end())
+            g_syscalls[it->second].stringArgs = entry.second;
+    }
+    for (const auto &entry : kPointerArgs) {
+        auto it = by_name.find(entry.first);
+        if (it != by_name.end())
+            g_syscalls[it->second].pointerArgs = entry.second;
+    }
+    for (const auto &entry : { make_pair("execve", 1), make_pair("execveat", 2) }) {
+        auto it = by_name.find(entry.first);
+        if (it != by_name.end())
+            g_syscalls[it->second].argvArg = (signed char)entry.second;
+    }
+}
+
+// errno 名字和描述，同样启动时建好
+struct ErrnoInfo {
+    string name;
+    string text;
+};
+static vector<ErrnoInfo> g_errnos;
+
+static void init_errno_info() {
+    g_errnos.resize(134);
+    for (int e = 1; e < int(g_errnos.size()); ++e) {
+        const char *name = strerrorname_np(e);
+        g_errnos[e].name = name ? name : "E" + to_string(e);
+        g_errnos[e].text = strerror(e);
+    }
+}
+
+// --- 手写的格式化：直接写进调用方给出的缓冲区，返回新的写入位置 ---
+
+static inline char *put_str(char *p, const char *s, size_t n) {
+    memcpy(p, s, n);
+    return p + n;
+}
+
+static inline char *put_str(char *p, const char *s) {
+    return put_str(p, s, strlen(s));
+}
+
+static char *put_udec(char *p, unsigned long long v) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = char('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n)
+        *p++ = tmp[--n];
+    return p;
+}
+
+static char *put_dec(char *p, long long v) {
+    if (v < 0) {
+        *p++ = '-';
+        return put_udec(p, 0ULL - (unsigned long long)v);
+    }
+    return put_udec(p, (unsigned long long)v);
+}
+
+static char *put_hex(char *p, unsigned long long v) {
+    static const char digits[] = "0123456789abcdef";
+    int n = v ? (64 - __builtin_clzll(v) + 3) / 4 : 1;
+    *p++ = '0';
+    *p++ = 'x';
+    for (int i = n - 1; i >= 0; --i)
+        p[i] = digits[v & 0xf], v >>= 4;
+    return p + n;
+}
+
+// 不知道参数类型时：小的非负数和负数按十进制（fd、标志、长度、AT_FDCWD），其余按十六进制（地址）
+static char *put_arg(char *p, unsigned long long v) {
+    long long s = (long long)v;
+    if (s >= -4096 && s < 4096)
+        return put_dec(p, s);
+    return put_hex(p, v);
+}
+
+// 用 process_vm_readv 读取被追踪进程中的 C 字符串，按页分段读取以免跨越未映射的页。
+// 最多读 size - 1 个字节，返回读到的长度（不含 \0），截断时 *truncated 为 true；失败返回 -1
+static ssize_t read_string(pid_t pid, unsigned long addr, char *buf, size_t size, bool *truncated) {
+    const size_t page = 4096;
+    size_t got = 0;
+    *truncated = false;
+    while (got + 1 < size) {
+        size_t chunk = min(page - ((addr + got) % page), size - 1 - got);
+        struct iovec local = { buf + got, chunk };
+        struct iovec remote = { (void*)(addr + got), chunk };
+        ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+        if (n <= 0)
+            break;
+        const char *nul = (const char*)memchr(buf + got, '\0', size_t(n));
+        if (nul)
+            return nul - buf;
+        got += size_t(n);
+    }
+    if (got == 0)
+        return -1;
+    *truncated = true;
+    return ssize_t(got);
+}
+
+// 带引号和转义的字符串参数，超过 kMaxStringLen 时后面加 ...（同 strace）
+static char *put_string_arg(char *p, pid_t pid, unsigned long addr) {
+    if (addr == 0)
+        return put_str(p, "NULL", 4);
+    char buf[kMaxStringLen + 1];
+    bool truncated;
+    ssize_t n = read_string(pid, addr, buf, sizeof(buf), &truncated);
+    if (n < 0)
+        return put_hex(p, addr);
+    *p++ = '"';
+    for (ssize_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)buf[i];
+        switch (c) {
+            case '"': *p++ = '\\'; *p++ = '"'; break;
+            case '\\': *p++ = '\\'; *p++ = '\\'; break;
+            case '\n': *p++ = '\\'; *p++ = 'n'; break;
+            case '\t': *p++ = '\\'; *p++ = 't'; break;
+            case '\r': *p++ = '\\'; *p++ = 'r'; break;
+            default:
+                if (c < 0x20 || c >= 0x7f) {
+                    *p++ = '\\';
+                    *p++ = char('0' + (c >> 6));
+                    *p++ = char('0' + ((c >> 3) & 7));
+                    *p++ = char('0' + (c & 7));
+                } else {
+                    *p++ = char(c);
+                }
+        }
+    }
+    *p++ = '"';
+    if (truncated)
+        p = put_str(p, "...", 3);
+    return p;
+}
+
+// execve 的 argv：["ls", "-l"]
+static char *put_argv_arg(char *p, pid_t pid, unsigned long addr) {
+    if (addr == 0)
+        return put_str(p, "NULL", 4);
+    unsigned long ptrs[kMaxArgv + 1];
+    struct iovec local = { ptrs, sizeof(ptrs) };
+    struct iovec remote = { (void*)addr, sizeof(ptrs) };
+    ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+    if (n < ssize_t(sizeof(unsigned long)))
+        return put_hex(p, addr);
+    int count = int(n / ssize_t(sizeof(unsigned long)));
+    *p++ = '[';
+    int i = 0;
+    for (; i < count && i < kMaxArgv && ptrs[i]; ++i) {
+        if (i)
+            p = put_str(p, ", ", 2);
+        p = put_string_arg(p, pid, ptrs[i]);
+    }
+    if (i < count && ptrs[i])
+        p = put_str(p, ", ...", 5);
+    *p++ = ']';
+    return p;
+}
+
+// 系统调用入口：name(arg0, arg1, ...)，写入 line，返回写入位置
+static char *format_entry(char *p, pid_t pid, long nr, const unsigned long long args[6], bool color) {
+    const SyscallInfo *info = (nr >= 0 && nr < kMaxSyscall) ? &g_syscalls[nr] : nullptr;
+    if (color)
+        p = put_str(p, COLOR_SYSCALL);
+    if (info && info->name) {
+        p = put_str(p, info->name, info->nameLen);
+    } else {
+        p = put_str(p, "syscall_", 8);
+        p = put_dec(p, nr);
+    }
+    if (color)
+        p = put_str(p, COLOR_RESET);
+    *p++ = '(';
+    int nargs = info ? info->nargs : 6;
+    for (int i = 0; i < nargs; ++i) {
+        if (i)
+            p = put_str(p, ", ", 2);
+        if (info && info->argvArg == i)
+            p = put_argv_arg(p, pid, args[i]);
+        else if (info && (info->stringArgs >> i & 1))
+            p = put_string_arg(p, pid, args[i]);
+        else if (info && (info->pointerArgs >> i & 1))
+            p = args[i] ? put_hex(p, args[i]) : put_str(p, "NULL", 4);
+        else
+            p = put_arg(p, args[i]);
+    }
+    *p++ = ')';
+    return p;
+}
+
+// 系统调用出口： = ret 或 = -1 ENOENT (No such file or directory)
+static char *format_return(char *p, long long ret, bool color) {
+    p = put_str(p, " = ", 3);
+    if (ret < 0 && ret >= -4095) {
+        int err = int(-ret);
+        if (color)
+            p = put_str(p, COLOR_ERROR);
+        p = put_str(p, "-1 ", 3);
+        if (err < int(g_errnos.size())) {
+            const ErrnoInfo &e = g_errnos[err];
+            p = put_str(p, e.name.data(), e.name.size());
+            p = put_str(p, " (", 2);
+            p = put_str(p, e.text.data(), e.text.size());
+            *p++ = ')';
+        } else {
+            p = put_str(p, "errno ", 6);
+            p = put_dec(p, err);
+        }
+    } else {
+        if (color)
+            p = put_str(p, COLOR_RETURN);
+        p = put_arg(p, (unsigned long long)ret);
+    }
+    if (color)
+        p = put_str(p, COLOR_RESET);
+    *p++ = '\n';
+    return p;
+}
+
+// --- 输出缓冲：预分配一大块内存，格式化直接写进去，满了才用一次 write(2) 整块写出 ---
 
-        for (int i = 0; i < sizeof(long); i++) {
-            if (data.chars[i] == '\0') return result;
-            result += data.chars[i];
+class OutBuf {
+public:
+    OutBuf(int fd, size_t capacity) : fd_(fd), buf_(new char[capacity]), cap_(capacity) {}
+    ~OutBuf() { flush(); delete[] buf_; }
+
+    // 返回至少能写 need 字节的位置，写完后用 commit 提交
+    char *reserve(size_t need) {
+        if (len_ + need > cap_)
+            flush();
+        return buf_ + len_;
+    }
+    void commit(char *end) { len_ = size_t(end - buf_); }
+    bool empty() const { return len_ == 0; }
+
+    void flush() {
+        size_t done = 0;
+        while (done < len_) {
+            ssize_t n = write(fd_, buf_ + done, len_ - done);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                break; // 管道已关闭等：丢弃剩下的输出
+            }
+            done += size_t(n);
         }
-        addr += sizeof(long);
+        len_ = 0;
     }
-    return result;
+
+private:
+    int fd_;
+    char *buf_;
+    size_t cap_;
+    size_t len_ = 0;
+};
+
+// --- -c 汇总表 ---
+
+struct SyscallTotals {
+    unsigned long long calls = 0;
+    unsigned long long errors = 0;
+    unsigned long long ns = 0;
+};
+static SyscallTotals g_totals[kMaxSyscall];
+
+// 与 strace -c 相同的列；时间是入口到出口之间的墙钟时间，按总耗时从高到低排列
+static void print_summary(FILE *out) {
+    vector<int> order;
+    unsigned long long total_calls = 0, total_errors = 0, total_ns = 0;
+    for (int nr = 0; nr < kMaxSyscall; ++nr) {
+        if (g_totals[nr].calls == 0)
+            continue;
+        order.push_back(nr);
+        total_calls += g_totals[nr].calls;
+        total_errors += g_totals[nr].errors;
+        total_ns += g_totals[nr].ns;
+    }
+    sort(order.begin(), order.end(), [](int a, int b) {
+        if (g_totals[a].ns != g_totals[b].ns)
+            return g_totals[a].ns > g_totals[b].ns;
+        return g_totals[a].calls > g_totals[b].calls;
+    });
+    const char *rule = "------ ----------- ----------- --------- --------- ----------------\n";
+    fprintf(out, "%% time     seconds  usecs/call     calls    errors syscall\n%s", rule);
+    for (int nr : order) {
+        const SyscallTotals &t = g_totals[nr];
+        fprintf(out, "%6.2f %11.6f %11llu %9llu ", total_ns ? 100.0 * double(t.ns) / double(total_ns) : 0.0,
+                double(t.ns) / 1e9, t.ns / t.calls / 1000, t.calls);
+        if (t.errors)
+            fprintf(out, "%9llu ", t.errors);
+        else
+            fprintf(out, "%9s ", "");
+        if (g_syscalls[nr].name)
+            fprintf(out, "%s\n", g_syscalls[nr].name);
+        else
+            fprintf(out, "syscall_%d\n", nr);
+    }
+    fprintf(out, "%s%6.2f %11.6f %11s %9llu %9llu total\n", rule, 100.0, double(total_ns) / 1e9, "",
+            total_calls, total_errors);
+}
+
+static unsigned long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
 }
 
-// 获取第 i 个参数（仅限 x86_64 下最多6个）
-unsigned long get_syscall_arg(const user_regs_struct& regs, int index) {
-    switch (index) {
-        case 0: return regs.rdi;
-        case 1: return regs.rsi;
-        case 2: return regs.rdx;
-        case 3: return regs.r10;
-        case 4: return regs.r8;
-        case 5: return regs.r9;
-        default: return 0;
+// --- 输出吞吐量测试：构造的调用走与追踪时完全相同的格式化和输出路径（字符串从本进程读取） ---
+
+static int run_bench(long long lines, bool color) {
+    static const char path[] = "/usr/lib/x86_64-linux-gnu/libc.so.6";
+    static const char *argv_strings[] = { "/bin/ls", "-l", "--color=auto", nullptr };
+    struct Call {
+        long nr;
+        unsigned long long args[6];
+        long long ret;
+    };
+    const Call calls[] = {
+        { 0, { 3, 0x7ffc1e2a3b40, 832, 0, 0, 0 }, 832 },
+        { 257, { (unsigned long long)-100, (unsigned long long)path, 0x80000, 0, 0, 0 }, 3 },
+        { 257, { (unsigned long long)-100, (unsigned long long)"/etc/missing", 0, 0, 0, 0 }, -ENOENT },
+        { 9, { 0, 8192, 3, 0x22, (unsigned long long)-1, 0 }, 0x7f3a5c2d1000 },
+        { 1, { 1, 0x55d0c0a012a0, 14, 0, 0, 0 }, 14 },
+        { 59, { (unsigned long long)argv_strings[0], (unsigned long long)argv_strings, 0x7ffc1e2a3c58, 0, 0, 0 }, 0 },
+        { 202, { 0x7f3a5c2d1990, 0x80, 2, 0, 0xffffffff, 0 }, -EAGAIN },
+        { 3, { 3, 0, 0, 0, 0, 0 }, 0 },
+    };
+    const int kinds = int(sizeof(calls) / sizeof(calls[0]));
+    pid_t self = getpid();
+
+    OutBuf out(STDOUT_FILENO, 1 << 20);
+    unsigned long long begin = now_ns();
+    for (long long i = 0; i < lines; ++i) {
+        const Call &c = calls[i % kinds];
+        char *p = out.reserve(kMaxLine);
+        p = format_entry(p, self, c.nr, c.args, color);
+        p = format_return(p, c.ret, color);
+        out.commit(p);
     }
+    out.flush();
+    double seconds = double(now_ns() - begin) / 1e9;
+    fprintf(stderr, "%lld lines in %.3f s: %.0f lines/s\n", lines, seconds, seconds > 0 ? double(lines) / seconds : 0.0);
+    return 0;
+}
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_stop_signal(int) {
+    g_stop = 1;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+    bool summary = false;  // -c / -C
+    bool lines = true;     // -c 时不输出每行
+    long long bench_lines = -1;
+    pid_t target_pid = -1;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-c") {
+            summary = true;
+            lines = false;
+        } else if (arg == "-C") {
+            summary = true;
+            lines = true;
+        } else if (arg == "--bench" && i + 1 < argc) {
+            bench_lines = atoll(argv[++i]);
+        } else if (!arg.empty() && isdigit((unsigned char)arg[0])) {
+            target_pid = atoi(arg.c_str());
+        } else {
+            fprintf(stderr, "usage: %s [-c | -C] [--bench N] [pid]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    init_syscall_info();
+    init_errno_info();
+    const bool color = isatty(STDOUT_FILENO);
+
+    if (bench_lines >= 0)
+        return run_bench(bench_lines, color);
+
+    if (target_pid <= 0)
+        cin >> target_pid;
 
-    pid_t target_pid;
-    cin >> target_pid;
-    // 附加到目标进程
-    if (ptrace(PTRACE_ATTACH, target_pid, NULL, NULL) < 0) {
+    // Ctrl-C / kill 时结束追踪：不设置 SA_RESTART，阻塞中的 waitpid 会以 EINTR 返回
+    struct sigaction sa = {};
+    sa.sa_handler = on_stop_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    // PTRACE_SEIZE 附加后可以随时 PTRACE_INTERRUPT，结束时才能让进程停下再 detach
+    if (ptrace(PTRACE_SEIZE, target_pid, NULL, (void*)(long)PTRACE_O_TRACESYSGOOD) < 0 ||
+        ptrace(PTRACE_INTERRUPT, target_pid, NULL, NULL) < 0) {
         perror("ptrace attach failed");
         return 1;
     }
 
-    int status;
-    waitpid(target_pid, &status, 0);
+    OutBuf out(STDOUT_FILENO, 1 << 20);
+    char pending[kMaxLine];   // 入口处格式化好的 "name(args)"，出口处补上返回值
+    size_t pending_len = 0;
+    bool have_pending = false;
 
+    int status;
     bool entering = true;
+    bool running = true;      // 进程正在运行（刚附加时等待 PTRACE_INTERRUPT 的停顿）
+    bool exited = false;
+    bool group_stop = false;  // 组停止（进程被 SIGSTOP 等停下）：用 PTRACE_LISTEN 恢复，进程保持停止
+    int resume_signal = 0;
+    long syscall_num = -1;
+    unsigned long long entry_ts = 0;
     struct user_regs_struct regs;
 
     while (true) {
-        ptrace(PTRACE_SYSCALL, target_pid, NULL, NULL);
-        waitpid(target_pid, &status, 0);
-
-        if (WIFEXITED(status)) break;
-
-        ptrace(PTRACE_GETREGS, target_pid, NULL, &regs);
-
-#ifdef __x86_64__
-        long syscall_num = regs.orig_rax;
-
-        if (entering) {
-            auto it = syscall_names.find(syscall_num);
-            string name = (it != syscall_names.end()) ? it->second : "unknown";
+        if (!running) {
+            if (g_stop)
+                break;
+            if (group_stop)
+                ptrace(PTRACE_LISTEN, target_pid, NULL, NULL);
+            else
+                ptrace(PTRACE_SYSCALL, target_pid, NULL, (void*)(long)resume_signal);
+            running = true;
+            resume_signal = 0;
+        }
 
-            cout << COLOR_SYSCALL << "→ " << name << COLOR_RESET << " (" << syscall_num << ")\n";
+        // 终端上要让用户及时看到输出：进程还没停下、即将阻塞等待时先把缓冲区写出。
+        // 重定向到文件或管道时只在缓冲区满了才写
+        pid_t r = 0;
+        if (color && !out.empty()) {
+            r = waitpid(target_pid, &status, __WALL | WNOHANG);
+            if (r == 0)
+                out.flush();
+        }
+        if (r == 0)
+            r = waitpid(target_pid, &status, __WALL);
+        if (r < 0) {
+            if (errno == EINTR && g_stop) {
+                // 进程可能正阻塞在系统调用里，让它停下才能 detach
+                ptrace(PTRACE_INTERRUPT, target_pid, NULL, NULL);
+                r = waitpid(target_pid, &status, __WALL);
+                if (r < 0)
+                    break;
+            } else if (errno == EINTR) {
+                continue;
+            } else {
+                break;
+            }
+        }
+        running = false;
+        group_stop = false;
 
-            // 打印参数类型
-            if (syscall_arg_types.count(syscall_num)) {
-                cout << COLOR_ARGTYPE << "    " << syscall_arg_types[syscall_num] << COLOR_RESET << "\n";
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            exited = true;
+            if (lines) {
+                char *p = out.reserve(kMaxLine + 64);
+                if (have_pending) {
+                    // exit_group 等没有出口停顿
+                    p = put_str(p, pending, pending_len);
+                    p = put_str(p, " = ?\n", 5);
+                }
+                if (WIFEXITED(status)) {
+                    p = put_str(p, "+++ exited with ", 16);
+                    p = put_dec(p, WEXITSTATUS(status));
+                } else {
+                    p = put_str(p, "+++ killed by ", 14);
+                    const char *name = sigabbrev_np(WTERMSIG(status));
+                    if (name) {
+                        p = put_str(p, "SIG", 3);
+                        p = put_str(p, name);
+                    } else {
+                        p = put_dec(p, WTERMSIG(status));
+                    }
+                }
+                p = put_str(p, " +++\n", 5);
+                out.commit(p);
             }
+            break;
+        }
 
-            // 打印参数值，并尝试解码字符串
-            for (int i = 0; i < 6; ++i) {
-                unsigned long val = get_syscall_arg(regs, i);
-                cout << "    arg" << i << " = 0x" << std::hex << val;
-
-                // 判断是否应该解码为字符串
-                auto info_it = string_param_map.find(syscall_num);
-                if (info_it != string_param_map.end()) {
-                    for (int str_idx : info_it->second.string_indices) {
-                        if (str_idx == i && val > 0x1000) {
-                            std::string s = read_string(target_pid, val);
-                            if (!s.empty())
-                                cout << " → \"" << s << "\"";
-                            break;
-                        }
+        int sig = WSTOPSIG(status);
+        if (sig != (SIGTRAP | 0x80)) {
+            // PTRACE_INTERRUPT 或组停止（status >> 16 为 PTRACE_EVENT_STOP）不交还信号；信号投递停顿原样交还。
+            // 组停止用 PTRACE_SYSCALL 恢复会让进程继续跑，SIGSTOP 失效
+            if ((status >> 16) == PTRACE_EVENT_STOP) {
+                group_stop = sig == SIGSTOP || sig == SIGTSTP || sig == SIGTTIN || sig == SIGTTOU;
+            } else if ((status >> 16) == 0) {
+                resume_signal = sig;
+                if (lines) {
+                    char *p = out.reserve(64);
+                    p = put_str(p, "--- ", 4);
+                    const char *name = sigabbrev_np(sig);
+                    if (name) {
+                        p = put_str(p, "SIG", 3);
+                        p = put_str(p, name);
+                    } else {
+                        p = put_dec(p, sig);
                     }
+                    p = put_str(p, " ---\n", 5);
+                    out.commit(p);
                 }
-                cout << "\n";
             }
+            continue;
+        }
+
+        if (ptrace(PTRACE_GETREGS, target_pid, NULL, &regs) < 0)
+            break;
 
+#ifdef __x86_64__
+        if (entering) {
+            syscall_num = regs.orig_rax;
+            if (lines) {
+                const unsigned long long args[6] = { regs.rdi, regs.rsi, regs.rdx, regs.r10, regs.r8, regs.r9 };
+                pending_len = size_t(format_entry(pending, target_pid, syscall_num, args, color) - pending);
+                have_pending = true;
+            }
+            entry_ts = now_ns();
         } else {
-            long ret = regs.rax;
-            if (ret >= 0) {
-                cout << COLOR_RETURN << "← Return: 0x" << std::hex << ret << COLOR_RESET << "\n\n";
-            } else {
-                cout << COLOR_ERROR << "← Return (err): " << ret << COLOR_RESET << "\n\n";
+            long long ret = (long long)regs.rax;
+            if (summary && syscall_num >= 0 && syscall_num < kMaxSyscall) {
+                SyscallTotals &t = g_totals[syscall_num];
+                ++t.calls;
+                t.errors += (ret < 0 && ret >= -4095);
+                t.ns += now_ns() - entry_ts;
+            }
+            if (have_pending) {
+                char *p = out.reserve(kMaxLine);
+                p = put_str(p, pending, pending_len);
+                p = format_return(p, ret, color);
+                out.commit(p);
+                have_pending = false;
             }
         }
 #endif
         entering = !entering;
     }
 
-    // 脱离目标进程
-    ptrace(PTRACE_DETACH, target_pid, NULL, NULL);
+    // 脱离目标进程（只能在停顿状态下 detach）
+    if (!exited && !running)
+        ptrace(PTRACE_DETACH, target_pid, NULL, (void*)(long)resume_signal);
+    out.flush();
+    if (summary)
+        print_summary(stderr);
     return 0;
-}
\ No newline at end of file
+}